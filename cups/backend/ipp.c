@@ -566,6 +566,10 @@ main(int  argc,				/* I - Number of command-line args */
 	  compression = "gzip";
         else if (!_cups_strcasecmp(value, "deflate"))
 	  compression = "deflate";
+#ifdef HAVE_ZSTD
+        else if (!_cups_strcasecmp(value, "zstd"))
+	  compression = "zstd";
+#endif /* HAVE_ZSTD */
         else if (!_cups_strcasecmp(value, "false") ||
                  !_cups_strcasecmp(value, "no") ||
 		 !_cups_strcasecmp(value, "off") ||
@@ -671,6 +675,20 @@ main(int  argc,				/* I - Number of command-line args */
                       0, NULL);
   httpSetTimeout(http, 30.0, timeout_cb, NULL);
 
+ /*
+  * Use a larger write buffer so print data goes out in fewer, larger
+  * writes...
+  */
+
+  _httpSetBufferSize(http, 0, 65536);
+
+ /*
+  * Compress print data on all available processors so compression does not
+  * limit how fast we can send a job...
+  */
+
+  _httpSetCodingThreads(http, 0);
+
  /*
   * See if the printer supports SNMP...
   */
@@ -1126,6 +1144,11 @@ main(int  argc,				/* I - Number of command-line args */
       }
       else if (!compression && (!strcmp(final_content_type, "image/pwg-raster") || !strcmp(final_content_type, "image/urf")))
       {
+#ifdef HAVE_ZSTD
+        if (ippContainsString(compression_sup, "zstd"))
+          compression = "zstd";
+        else
+#endif /* HAVE_ZSTD */
         if (ippContainsString(compression_sup, "gzip"))
           compression = "gzip";
         else if (ippContainsString(compression_sup, "deflate"))
@@ -2248,6 +2271,17 @@ main(int  argc,				/* I - Number of command-line args */
   httpClose(http);
   http = NULL;
 
+#ifdef HAVE_SSL
+  {
+    size_t	tls_full,		/* Full TLS handshakes */
+		tls_resumed;		/* Resumed TLS handshakes */
+
+    _httpTLSGetStatistics(&tls_full, &tls_resumed);
+    if (tls_full || tls_resumed)
+      fprintf(stderr, "DEBUG: TLS handshakes: " CUPS_LLFMT " full, " CUPS_LLFMT " resumed.\n", CUPS_LLCAST tls_full, CUPS_LLCAST tls_resumed);
+  }
+#endif /* HAVE_SSL */
+
   ippDelete(supported);
 
  /*
@@ -261,6 +261,13 @@ AC_CHECK_HEADER(zlib.h,
 	if test "x$GZIPPROG" != x; then
 		INSTALL_GZIP="-z"
 	fi]))
+
+dnl zstd
+AC_CHECK_HEADER(zstd.h,
+    AC_CHECK_LIB(zstd, ZSTD_compressStream2,[
+	AC_DEFINE(HAVE_ZSTD)
+	LIBZ="$LIBZ -lzstd"
+	LIBS="$LIBS -lzstd"]))
 AC_SUBST(INSTALL_GZIP)
 AC_SUBST(LIBZ)
 
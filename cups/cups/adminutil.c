@@ -137,8 +137,7 @@ cupsAdminGetServerSettings(
 	* Need to close the current connection because something has changed...
 	*/
 
-	httpClose(cg->http);
-	cg->http = NULL;
+	_cupsDisconnect(cg);
       }
     }
 
@@ -466,9 +465,24 @@ cupsAdminSetServerSettings(
   */
 
   if (!http)
-    http = _cupsConnect();
+  {
+    int	ret;				/* Return value */
 
-  if (!http || !num_settings || !settings)
+    if ((http = _cupsConnect()) == NULL)
+      return (0);
+
+   /*
+    * Use the default connection, then hand it back to the pool (if any)...
+    */
+
+    ret = cupsAdminSetServerSettings(http, num_settings, settings);
+
+    _cupsConnectRelease();
+
+    return (ret);
+  }
+
+  if (!num_settings || !settings)
   {
     _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(EINVAL), 0);
 
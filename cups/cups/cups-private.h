@@ -42,6 +42,23 @@ extern "C" {
  * Types...
  */
 
+typedef struct _cups_async_s _cups_async_t;
+					/**** Asynchronous request context ****/
+
+typedef void (*_cups_async_cb_t)(void *user_data, int id, http_status_t status, ipp_t *response);
+					/**** Asynchronous response callback ****/
+
+typedef struct _cups_pool_s _cups_pool_t;
+					/**** Connection pool ****/
+
+typedef struct _cups_pool_stats_s	/**** Connection pool statistics ****/
+{
+  unsigned long		hits,		/* Requests that reused an idle connection */
+			misses,		/* Requests that needed a new connection */
+			waits,		/* Requests that waited for the per-host limit */
+			closed;		/* Idle connections closed (timeout or EOF) */
+} _cups_pool_stats_t;
+
 typedef struct _cups_buffer_s		/**** Read/write buffer ****/
 {
   struct _cups_buffer_s	*next;		/* Next buffer in list */
@@ -151,6 +168,7 @@ typedef struct _cups_globals_s		/**** CUPS global state data ****/
 
   /* request.c */
   http_t		*http;		/* Current server connection */
+  _cups_pool_t		*http_pool;	/* Pool for current connection, if any */
   ipp_status_t		last_error;	/* Last IPP error */
   char			*last_status_message;
 					/* Last IPP status-message */
@@ -186,7 +204,8 @@ typedef struct _cups_globals_s		/**** CUPS global state data ****/
 			trust_first,	/* Trust on first use? */
 			any_root,	/* Allow any (e.g., self-signed) root */
 			expired_certs,	/* Allow expired certs */
-			validate_certs;	/* Validate certificates */
+			validate_certs,	/* Validate certificates */
+			dinfo_cache;	/* Cache destination information? */
 
   /* util.c */
   char			def_printer[256];
@@ -256,13 +275,23 @@ extern void		_cupsAppleSetDefaultPrinter(CFStringRef name) _CUPS_PRIVATE;
 extern void		_cupsAppleSetUseLastPrinter(int uselast) _CUPS_PRIVATE;
 #  endif /* __APPLE__ */
 
+extern void		_cupsAsyncDelete(_cups_async_t *async) _CUPS_PRIVATE;
+extern _cups_async_t	*_cupsAsyncNew(int depth) _CUPS_PRIVATE;
+extern int		_cupsAsyncPending(_cups_async_t *async) _CUPS_PRIVATE;
+extern int		_cupsAsyncPoll(_cups_async_t *async, int msec) _CUPS_PRIVATE;
+extern int		_cupsAsyncSubmit(_cups_async_t *async, http_t *http, ipp_t *request, const char *resource, _cups_async_cb_t cb, void *user_data) _CUPS_PRIVATE;
+
 extern char		*_cupsBufferGet(size_t size) _CUPS_PRIVATE;
 extern void		_cupsBufferRelease(char *b) _CUPS_PRIVATE;
 
+extern int		_cupsCheckDInfoCache(ipp_t *cached, ipp_t *current) _CUPS_PRIVATE;
 extern http_t		*_cupsConnect(void) _CUPS_PRIVATE;
+extern void		_cupsConnectRelease(void) _CUPS_INTERNAL;
+extern void		_cupsDisconnect(_cups_globals_t *cg) _CUPS_INTERNAL;
 extern char		*_cupsCreateDest(const char *name, const char *info, const char *device_id, const char *device_uri, char *uri, size_t urisize) _CUPS_PRIVATE;
 extern ipp_attribute_t	*_cupsEncodeOption(ipp_t *ipp, ipp_tag_t group_tag, _ipp_option_t *map, const char *name, const char *value) _CUPS_PRIVATE;
 extern int		_cupsGet1284Values(const char *device_id, cups_option_t **values) _CUPS_PRIVATE;
+extern char		*_cupsGetCachePath(const char *name, char *buffer, size_t bufsize, int create) _CUPS_PRIVATE;
 extern const char	*_cupsGetDestResource(cups_dest_t *dest, unsigned flags, char *resource, size_t resourcesize) _CUPS_PRIVATE;
 extern int		_cupsGetDests(http_t *http, ipp_op_t op, const char *name, cups_dest_t **dests, cups_ptype_t type, cups_ptype_t mask) _CUPS_PRIVATE;
 extern const char	*_cupsGetPassword(const char *prompt) _CUPS_PRIVATE;
@@ -273,13 +302,24 @@ extern void		_cupsGlobalUnlock(void) _CUPS_PRIVATE;
 extern const char	*_cupsGSSServiceName(void) _CUPS_PRIVATE;
 #  endif /* HAVE_GSSAPI */
 extern int		_cupsNextDelay(int current, int *previous) _CUPS_PRIVATE;
+extern http_t		*_cupsPoolAcquire(_cups_pool_t *pool, const char *host, int port, http_encryption_t encryption, const char *user) _CUPS_PRIVATE;
+extern void		_cupsPoolDelete(_cups_pool_t *pool) _CUPS_PRIVATE;
+extern void		_cupsPoolGetStats(_cups_pool_t *pool, _cups_pool_stats_t *stats) _CUPS_PRIVATE;
+extern _cups_pool_t	*_cupsPoolNew(int max_per_host, int idle_timeout) _CUPS_PRIVATE;
+extern void		_cupsPoolRelease(_cups_pool_t *pool, http_t *http) _CUPS_PRIVATE;
+extern void		_cupsPoolSetDefault(_cups_pool_t *pool) _CUPS_PRIVATE;
+extern ipp_t		*_cupsReadDInfoCache(const char *filename) _CUPS_PRIVATE;
+extern int		_cupsReadDNSSDCache(const char *filename, cups_dest_t **dests) _CUPS_PRIVATE;
 extern void		_cupsSetDefaults(void) _CUPS_INTERNAL;
 extern void		_cupsSetError(ipp_status_t status, const char *message, int localize) _CUPS_PRIVATE;
 extern void		_cupsSetHTTPError(http_status_t status) _CUPS_INTERNAL;
 #  ifdef HAVE_GSSAPI
 extern int		_cupsSetNegotiateAuthString(http_t *http, const char *method, const char *resource) _CUPS_PRIVATE;
 #  endif /* HAVE_GSSAPI */
+extern ipp_t		*_cupsStreamRequest(http_t *http, ipp_t *request, const char *resource, ipp_attribute_t **attr) _CUPS_PRIVATE;
 extern char		*_cupsUserDefault(char *name, size_t namesize) _CUPS_INTERNAL;
+extern int		_cupsWriteDInfoCache(const char *filename, ipp_t *attrs) _CUPS_PRIVATE;
+extern int		_cupsWriteDNSSDCache(const char *filename, int num_dests, cups_dest_t *dests) _CUPS_PRIVATE;
 
 
 /*
@@ -78,18 +78,11 @@ cupsCloseDestJob(
 
   DEBUG_printf(("cupsCloseDestJob(http=%p, dest=%p(%s/%s), info=%p, job_id=%d)", (void *)http, (void *)dest, dest ? dest->name : NULL, dest ? dest->instance : NULL, (void *)info, job_id));
 
- /*
-  * Get the default connection as needed...
-  */
-
-  if (!http)
-    http = _cupsConnect();
-
  /*
   * Range check input...
   */
 
-  if (!http || !dest || !info || job_id <= 0)
+  if (!dest || !info || job_id <= 0)
   {
     _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(EINVAL), 0);
     DEBUG_puts("1cupsCloseDestJob: Bad arguments.");
@@ -173,13 +166,6 @@ cupsCreateDestJob(
   DEBUG_printf(("cupsCreateDestJob(http=%p, dest=%p(%s/%s), info=%p, "
                 "job_id=%p, title=\"%s\", num_options=%d, options=%p)", (void *)http, (void *)dest, dest ? dest->name : NULL, dest ? dest->instance : NULL, (void *)info, (void *)job_id, title, num_options, (void *)options));
 
- /*
-  * Get the default connection as needed...
-  */
-
-  if (!http)
-    http = _cupsConnect();
-
  /*
   * Range check input...
   */
@@ -187,7 +173,7 @@ cupsCreateDestJob(
   if (job_id)
     *job_id = 0;
 
-  if (!http || !dest || !info || !job_id)
+  if (!dest || !info || !job_id)
   {
     _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(EINVAL), 0);
     DEBUG_puts("1cupsCreateDestJob: Bad arguments.");
@@ -260,18 +246,11 @@ cupsFinishDestDocument(
 {
   DEBUG_printf(("cupsFinishDestDocument(http=%p, dest=%p(%s/%s), info=%p)", (void *)http, (void *)dest, dest ? dest->name : NULL, dest ? dest->instance : NULL, (void *)info));
 
- /*
-  * Get the default connection as needed...
-  */
-
-  if (!http)
-    http = _cupsConnect();
-
  /*
   * Range check input...
   */
 
-  if (!http || !dest || !info)
+  if (!dest || !info)
   {
     _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(EINVAL), 0);
     DEBUG_puts("1cupsFinishDestDocument: Bad arguments.");
@@ -322,18 +301,11 @@ cupsStartDestDocument(
 
   DEBUG_printf(("cupsStartDestDocument(http=%p, dest=%p(%s/%s), info=%p, job_id=%d, docname=\"%s\", format=\"%s\", num_options=%d, options=%p, last_document=%d)", (void *)http, (void *)dest, dest ? dest->name : NULL, dest ? dest->instance : NULL, (void *)info, job_id, docname, format, num_options, (void *)options, last_document));
 
- /*
-  * Get the default connection as needed...
-  */
-
-  if (!http)
-    http = _cupsConnect();
-
  /*
   * Range check input...
   */
 
-  if (!http || !dest || !info || job_id <= 0)
+  if (!dest || !info || job_id <= 0)
   {
     _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(EINVAL), 0);
     DEBUG_puts("1cupsStartDestDocument: Bad arguments.");
@@ -13,6 +13,7 @@
 
 #include "cups-private.h"
 #include "debug-internal.h"
+#include <sys/stat.h>
 
 
 /*
@@ -40,6 +41,8 @@ static void		cups_create_constraints(cups_dinfo_t *dinfo);
 static void		cups_create_defaults(cups_dinfo_t *dinfo);
 static void		cups_create_media_db(cups_dinfo_t *dinfo,
 			                     unsigned flags);
+static char		*cups_dinfo_cache_path(const char *uri, char *buffer,
+			                       size_t bufsize, int create);
 static void		cups_free_media_db(_cups_media_db_t *mdb);
 static int		cups_get_media_db(http_t *http, cups_dinfo_t *dinfo,
 			                  pwg_media_t *pwg, unsigned flags,
@@ -187,7 +190,18 @@ cupsCheckDestSupported(
   */
 
   if (!http)
-    http = _cupsConnect();
+  {
+    int	ret;				/* Return value */
+
+    if ((http = _cupsConnect()) == NULL)
+      return (0);
+
+    ret = cupsCheckDestSupported(http, dest, dinfo, option, value);
+
+    _cupsConnectRelease();
+
+    return (ret);
+  }
 
  /*
   * Range check input...
@@ -435,7 +449,18 @@ cupsCopyDestConflicts(
   */
 
   if (!http)
-    http = _cupsConnect();
+  {
+    int	ret;				/* Return value */
+
+    if ((http = _cupsConnect()) == NULL)
+      return (0);
+
+    ret = cupsCopyDestConflicts(http, dest, dinfo, num_options, options, new_option, new_value, num_conflicts, conflicts, num_resolved, resolved);
+
+    _cupsConnectRelease();
+
+    return (ret);
+  }
 
  /*
   * Range check input...
@@ -687,11 +712,14 @@ cupsCopyDestInfo(
   char		resource[1024];		/* Resource path */
   int		version;		/* IPP version */
   ipp_status_t	status;			/* Status of request */
+  char		cachefile[1024];	/* Cache filename */
+  int		cached = 0;		/* Using cached attributes? */
   _cups_globals_t *cg = _cupsGlobals();	/* Pointer to library globals */
   static const char * const requested_attrs[] =
   {					/* Requested attributes */
     "job-template",
     "media-col-database",
+    "printer-config-change-time",
     "printer-description"
   };
 
@@ -705,8 +733,15 @@ cupsCopyDestInfo(
   if (!http)
   {
     DEBUG_puts("1cupsCopyDestInfo: Default server connection.");
-    http   = _cupsConnect();
-    dflags = CUPS_DEST_FLAGS_NONE;
+
+    if ((http = _cupsConnect()) == NULL)
+      return (NULL);
+
+    dinfo = cupsCopyDestInfo(http, dest);
+
+    _cupsConnectRelease();
+
+    return (dinfo);
   }
 #ifdef AF_LOCAL
   else if (httpAddrFamily(http->hostaddr) == AF_LOCAL)
@@ -743,6 +778,51 @@ cupsCopyDestInfo(
     return (NULL);
   }
 
+ /*
+  * Use the cached attributes if the printer configuration has not changed
+  * since they were saved...
+  */
+
+  response = NULL;
+  version  = 20;
+
+  if (cg->dinfo_cache < 0)
+    _cupsSetDefaults();
+
+  if (cg->dinfo_cache && cups_dinfo_cache_path(uri, cachefile, sizeof(cachefile), 0) && (response = _cupsReadDInfoCache(cachefile)) != NULL)
+  {
+    int			major,		/* Major version */
+			minor;		/* Minor version */
+    ipp_t		*current;	/* Current printer-config-change-time */
+
+    major   = ippGetVersion(response, &minor);
+    version = major * 10 + minor;
+
+    request = ippNewRequest(IPP_OP_GET_PRINTER_ATTRIBUTES);
+
+    ippSetVersion(request, major, minor);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uri);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsUser());
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", NULL, "printer-config-change-time");
+
+    current = cupsDoRequest(http, request, resource);
+
+    if (cupsLastError() <= IPP_STATUS_OK_IGNORED_OR_SUBSTITUTED && _cupsCheckDInfoCache(response, current))
+    {
+      DEBUG_printf(("1cupsCopyDestInfo: Using cached attributes from \"%s\".", cachefile));
+      cached = 1;
+    }
+    else
+    {
+      DEBUG_printf(("1cupsCopyDestInfo: Cached attributes in \"%s\" are out of date.", cachefile));
+      ippDelete(response);
+      response = NULL;
+      version  = 20;
+    }
+
+    ippDelete(current);
+  }
+
  /*
   * Get the supported attributes...
   */
@@ -750,9 +830,8 @@ cupsCopyDestInfo(
   delay      = 1;
   prev_delay = 1;
   tries      = 0;
-  version    = 20;
 
-  do
+  while (!response && tries < 10)
   {
    /*
     * Send a Get-Printer-Attributes request...
@@ -790,7 +869,6 @@ cupsCopyDestInfo(
 
     tries ++;
   }
-  while (!response && tries < 10);
 
   if (!response)
   {
@@ -798,6 +876,9 @@ cupsCopyDestInfo(
     return (NULL);
   }
 
+  if (!cached && cg->dinfo_cache && ippFindAttribute(response, "printer-config-change-time", IPP_TAG_INTEGER) && cups_dinfo_cache_path(uri, cachefile, sizeof(cachefile), 1))
+    _cupsWriteDInfoCache(cachefile, response);
+
  /*
   * Allocate a cups_dinfo_t structure and return it...
   */
@@ -847,7 +928,18 @@ cupsFindDestDefault(
   */
 
   if (!http)
-    http = _cupsConnect();
+  {
+    ipp_attribute_t	*attr;		/* Attribute */
+
+    if ((http = _cupsConnect()) == NULL)
+      return (NULL);
+
+    attr = cupsFindDestDefault(http, dest, dinfo, option);
+
+    _cupsConnectRelease();
+
+    return (attr);
+  }
 
  /*
   * Range check input...
@@ -895,7 +987,18 @@ cupsFindDestReady(
   */
 
   if (!http)
-    http = _cupsConnect();
+  {
+    ipp_attribute_t	*attr;		/* Attribute */
+
+    if ((http = _cupsConnect()) == NULL)
+      return (NULL);
+
+    attr = cupsFindDestReady(http, dest, dinfo, option);
+
+    _cupsConnectRelease();
+
+    return (attr);
+  }
 
  /*
   * Range check input...
@@ -945,7 +1048,18 @@ cupsFindDestSupported(
   */
 
   if (!http)
-    http = _cupsConnect();
+  {
+    ipp_attribute_t	*attr;		/* Attribute */
+
+    if ((http = _cupsConnect()) == NULL)
+      return (NULL);
+
+    attr = cupsFindDestSupported(http, dest, dinfo, option);
+
+    _cupsConnectRelease();
+
+    return (attr);
+  }
 
  /*
   * Range check input...
@@ -1036,7 +1150,18 @@ cupsGetDestMediaByIndex(
   */
 
   if (!http)
-    http = _cupsConnect();
+  {
+    int	ret;				/* Return value */
+
+    if ((http = _cupsConnect()) == NULL)
+      return (0);
+
+    ret = cupsGetDestMediaByIndex(http, dest, dinfo, n, flags, size);
+
+    _cupsConnectRelease();
+
+    return (ret);
+  }
 
  /*
   * Range check input...
@@ -1131,7 +1256,18 @@ cupsGetDestMediaByName(
   */
 
   if (!http)
-    http = _cupsConnect();
+  {
+    int	ret;				/* Return value */
+
+    if ((http = _cupsConnect()) == NULL)
+      return (0);
+
+    ret = cupsGetDestMediaByName(http, dest, dinfo, media, flags, size);
+
+    _cupsConnectRelease();
+
+    return (ret);
+  }
 
  /*
   * Range check input...
@@ -1206,7 +1342,18 @@ cupsGetDestMediaBySize(
   */
 
   if (!http)
-    http = _cupsConnect();
+  {
+    int	ret;				/* Return value */
+
+    if ((http = _cupsConnect()) == NULL)
+      return (0);
+
+    ret = cupsGetDestMediaBySize(http, dest, dinfo, width, length, flags, size);
+
+    _cupsConnectRelease();
+
+    return (ret);
+  }
 
  /*
   * Range check input...
@@ -1264,7 +1411,18 @@ cupsGetDestMediaCount(
   */
 
   if (!http)
-    http = _cupsConnect();
+  {
+    int	ret;				/* Return value */
+
+    if ((http = _cupsConnect()) == NULL)
+      return (0);
+
+    ret = cupsGetDestMediaCount(http, dest, dinfo, flags);
+
+    _cupsConnectRelease();
+
+    return (ret);
+  }
 
  /*
   * Range check input...
@@ -1316,7 +1474,18 @@ cupsGetDestMediaDefault(
   */
 
   if (!http)
-    http = _cupsConnect();
+  {
+    int	ret;				/* Return value */
+
+    if ((http = _cupsConnect()) == NULL)
+      return (0);
+
+    ret = cupsGetDestMediaDefault(http, dest, dinfo, flags, size);
+
+    _cupsConnectRelease();
+
+    return (ret);
+  }
 
  /*
   * Range check input...
@@ -1358,6 +1527,110 @@ cupsGetDestMediaDefault(
 }
 
 
+/*
+ * '_cupsCheckDInfoCache()' - Check whether cached printer attributes are current.
+ *
+ * The cached attributes are current when their "printer-config-change-time"
+ * value matches the one reported by the printer.
+ */
+
+int					/* O - 1 if current, 0 if stale */
+_cupsCheckDInfoCache(
+    ipp_t *cached,			/* I - Cached printer attributes */
+    ipp_t *current)			/* I - Current printer-config-change-time */
+{
+  ipp_attribute_t	*cached_attr,	/* Cached printer-config-change-time */
+			*current_attr;	/* Current printer-config-change-time */
+
+
+  cached_attr  = ippFindAttribute(cached, "printer-config-change-time", IPP_TAG_INTEGER);
+  current_attr = ippFindAttribute(current, "printer-config-change-time", IPP_TAG_INTEGER);
+
+  return (cached_attr && current_attr && ippGetInteger(cached_attr, 0) == ippGetInteger(current_attr, 0));
+}
+
+
+/*
+ * '_cupsReadDInfoCache()' - Read cached printer attributes.
+ */
+
+ipp_t *					/* O - Printer attributes or `NULL` */
+_cupsReadDInfoCache(
+    const char *filename)		/* I - Cache filename */
+{
+  cups_file_t	*fp;			/* Cache file */
+  ipp_t		*attrs;			/* Printer attributes */
+  ipp_state_t	state;			/* Read state */
+
+
+  if ((fp = cupsFileOpen(filename, "r")) == NULL)
+    return (NULL);
+
+  attrs = ippNew();
+
+  while ((state = ippReadIO(fp, (ipp_iocb_t)cupsFileRead, 1, NULL, attrs)) != IPP_STATE_DATA)
+    if (state == IPP_STATE_ERROR)
+      break;
+
+  cupsFileClose(fp);
+
+  if (state != IPP_STATE_DATA)
+  {
+    DEBUG_printf(("4_cupsReadDInfoCache: Unable to read \"%s\".", filename));
+    ippDelete(attrs);
+    return (NULL);
+  }
+
+  return (attrs);
+}
+
+
+/*
+ * '_cupsWriteDInfoCache()' - Write printer attributes to the cache.
+ *
+ * The attributes are written to a temporary file that is then renamed, so
+ * that other processes never see a partial file.
+ */
+
+int					/* O - 0 on success, -1 on error */
+_cupsWriteDInfoCache(
+    const char *filename,		/* I - Cache filename */
+    ipp_t      *attrs)			/* I - Printer attributes */
+{
+  cups_file_t	*fp;			/* Cache file */
+  char		tempfile[1024];		/* Temporary filename */
+  ipp_state_t	state;			/* Write state */
+
+
+  if (snprintf(tempfile, sizeof(tempfile), "%s.%d", filename, (int)getpid()) >= (int)sizeof(tempfile))
+  {
+    DEBUG_printf(("4_cupsWriteDInfoCache: Cache filename \"%s\" is too long.", filename));
+    return (-1);
+  }
+
+  if ((fp = cupsFileOpen(tempfile, "w")) == NULL)
+  {
+    DEBUG_printf(("4_cupsWriteDInfoCache: Unable to create \"%s\": %s", tempfile, strerror(errno)));
+    return (-1);
+  }
+
+  attrs->state = IPP_STATE_IDLE;
+
+  while ((state = ippWriteIO(fp, (ipp_iocb_t)cupsFileWrite, 1, NULL, attrs)) != IPP_STATE_DATA)
+    if (state == IPP_STATE_ERROR)
+      break;
+
+  if (cupsFileClose(fp) || state != IPP_STATE_DATA || rename(tempfile, filename))
+  {
+    DEBUG_printf(("4_cupsWriteDInfoCache: Unable to write \"%s\": %s", filename, strerror(errno)));
+    unlink(tempfile);
+    return (-1);
+  }
+
+  return (0);
+}
+
+
 /*
  * 'cups_add_dconstres()' - Add a constraint or resolver to an array.
  */
@@ -2247,6 +2520,32 @@ cups_create_media_db(
 }
 
 
+/*
+ * 'cups_dinfo_cache_path()' - Get the cache filename for a printer URI.
+ */
+
+static char *				/* O - Filename or `NULL` if none */
+cups_dinfo_cache_path(
+    const char *uri,			/* I - Printer URI */
+    char       *buffer,			/* I - Filename buffer */
+    size_t     bufsize,			/* I - Size of filename buffer */
+    int        create)			/* I - Create the cache directory? */
+{
+  unsigned char	hash[32];		/* Hash of URI */
+  ssize_t	hashlen;		/* Length of hash */
+  char		hashstr[65],		/* Hash as a hex string */
+		name[70];		/* Cache filename */
+
+
+  if ((hashlen = cupsHashData("sha2-256", uri, strlen(uri), hash, sizeof(hash))) < 0 && (hashlen = cupsHashData("md5", uri, strlen(uri), hash, sizeof(hash))) < 0)
+    return (NULL);
+
+  snprintf(name, sizeof(name), "%s.ipp", cupsHashString(hash, (size_t)hashlen, hashstr, sizeof(hashstr)));
+
+  return (_cupsGetCachePath(name, buffer, bufsize, create));
+}
+
+
 /*
  * 'cups_free_media_cb()' - Free a media entry.
  */
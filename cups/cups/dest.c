@@ -58,11 +58,17 @@
 
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
 #  define _CUPS_DNSSD_GET_DESTS 250     /* Milliseconds for cupsGetDests */
+#  define _CUPS_DNSSD_MAXQUERIES 32	/* Maximum number of TXT record queries at once */
 #  define _CUPS_DNSSD_MAXTIME	50	/* Milliseconds for maximum quantum of time */
+#  define _CUPS_DNSSD_REFRESH	2000	/* Milliseconds for background cache refresh */
+#  define _CUPS_DNSSD_TTL	4500	/* Seconds to cache TXT records without a TTL */
 #else
 #  define _CUPS_DNSSD_GET_DESTS 0       /* Milliseconds for cupsGetDests */
 #endif /* HAVE_DNSSD || HAVE_AVAHI */
 
+#define _CUPS_DEST_FLAGS_REFRESH 0x40000000
+					/* Refreshing the discovery cache */
+
 
 /*
  * Types...
@@ -94,6 +100,7 @@ typedef struct _cups_dnssd_data_s	/* Enumeration data */
   cups_ptype_t		type,		/* Printer type filter */
 			mask;		/* Printer type mask */
   cups_array_t		*devices;	/* Devices found so far */
+  int			num_queries;	/* Number of TXT record queries in progress */
   int			num_dests;	/* Number of lpoptions destinations */
   cups_dest_t		*dests;		/* lpoptions destinations */
   char			def_name[1024],	/* Default printer name, if any */
@@ -112,6 +119,7 @@ typedef struct _cups_dnssd_device_s	/* Enumerated device */
 			*regtype,	/* Registration type */
 			*domain;	/* Domain name */
   cups_ptype_t		type;		/* Device registration type */
+  time_t		expires;	/* Time when TXT record expires */
   cups_dest_t		dest;		/* Destination record */
 } _cups_dnssd_device_t;
 
@@ -137,6 +145,18 @@ typedef struct _cups_namedata_s
 } _cups_namedata_t;
 
 
+/*
+ * Local globals...
+ */
+
+static _cups_mutex_t	dnssd_cache_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for discovery cache */
+#if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
+static int		dnssd_refreshing = 0;
+					/* Is a cache refresh running? */
+#endif /* HAVE_DNSSD || HAVE_AVAHI */
+
+
 /*
  * Local functions...
  */
@@ -160,6 +180,8 @@ static int		cups_block_cb(cups_dest_block_t block, unsigned flags,
 #endif /* __BLOCKS__ */
 static int		cups_compare_dests(cups_dest_t *a, cups_dest_t *b);
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
+static int		cups_dnssd_add_dest(_cups_dnssd_data_t *data,
+			                    _cups_dnssd_device_t *device);
 #  ifdef HAVE_DNSSD
 static void		cups_dnssd_browse_cb(DNSServiceRef sdRef,
 					     DNSServiceFlags flags,
@@ -183,6 +205,9 @@ static void		cups_dnssd_client_cb(AvahiClient *client,
 					     AvahiClientState state,
 					     void *context);
 #  endif /* HAVE_DNSSD */
+static int		cups_dnssd_cache_load(_cups_dnssd_data_t *data,
+			                      int refresh);
+static void		cups_dnssd_cache_write(_cups_dnssd_data_t *data);
 static int		cups_dnssd_compare_devices(_cups_dnssd_device_t *a,
 			                           _cups_dnssd_device_t *b);
 static void		cups_dnssd_free_device(_cups_dnssd_device_t *device,
@@ -215,6 +240,9 @@ static void		cups_dnssd_query_cb(AvahiRecordBrowser *browser,
 					    AvahiLookupResultFlags flags,
 					    void *context);
 #  endif /* HAVE_DNSSD */
+static void		*cups_dnssd_refresh(void *arg);
+static void		cups_dnssd_release_query(_cups_dnssd_data_t *data,
+			                         _cups_dnssd_device_t *device);
 static const char	*cups_dnssd_resolve(cups_dest_t *dest, const char *uri,
 					    int msec, int *cancel,
 					    cups_dest_cb_t cb, void *user_data);
@@ -1094,6 +1122,48 @@ cupsGetDest(const char  *name,		/* I - Destination name or @code NULL@ for the d
 }
 
 
+/*
+ * '_cupsGetCachePath()' - Get a filename in the per-user cache directory.
+ *
+ * Cache files live in "~/.cups/cache".  The directory is created as needed
+ * when "create" is non-zero.
+ */
+
+char *					/* O - Filename or @code NULL@ on error */
+_cupsGetCachePath(const char *name,	/* I - Name of cache file */
+                  char       *buffer,	/* I - Filename buffer */
+                  size_t     bufsize,	/* I - Size of filename buffer */
+                  int        create)	/* I - Create the cache directory? */
+{
+  _cups_globals_t *cg = _cupsGlobals();	/* Pointer to library globals */
+
+
+  if (!cg->home)
+    return (NULL);
+
+  if (create)
+  {
+    snprintf(buffer, bufsize, "%s/.cups", cg->home);
+    if (access(buffer, 0) && mkdir(buffer, 0700))
+    {
+      DEBUG_printf(("4_cupsGetCachePath: Unable to create \"%s\": %s", buffer, strerror(errno)));
+      return (NULL);
+    }
+
+    snprintf(buffer, bufsize, "%s/.cups/cache", cg->home);
+    if (access(buffer, 0) && mkdir(buffer, 0700))
+    {
+      DEBUG_printf(("4_cupsGetCachePath: Unable to create \"%s\": %s", buffer, strerror(errno)));
+      return (NULL);
+    }
+  }
+
+  snprintf(buffer, bufsize, "%s/.cups/cache/%s", cg->home, name);
+
+  return (buffer);
+}
+
+
 /*
  * '_cupsGetDestResource()' - Get the resource path and URI for a destination.
  */
@@ -1671,12 +1741,24 @@ cupsGetDests2(http_t      *http,	/* I - Connection to server or @code CUPS_HTTP_
 
   if (!http)
   {
+    int	num_dests;			/* Number of destinations */
+
     if ((http = _cupsConnect()) == NULL)
     {
       *dests = NULL;
 
       return (0);
     }
+
+   /*
+    * Use the default connection, then hand it back to the pool (if any)...
+    */
+
+    num_dests = cupsGetDests2(http, dests);
+
+    _cupsConnectRelease();
+
+    return (num_dests);
   }
 
  /*
@@ -2227,6 +2309,112 @@ cupsSetDests2(http_t      *http,	/* I - Connection to server or @code CUPS_HTTP_
 }
 
 
+/*
+ * '_cupsReadDNSSDCache()' - Read printers from a discovery cache file.
+ *
+ * Each printer is returned with its TXT record values as options, along with
+ * the "dnssd-full-name", "dnssd-regtype", "dnssd-domain", and "dnssd-expires"
+ * options.  Printers that are incomplete or whose "dnssd-expires" time has
+ * passed are skipped.  Free the destinations with @link cupsFreeDests@.
+ */
+
+int					/* O - Number of printers */
+_cupsReadDNSSDCache(
+    const char  *filename,		/* I - Cache filename */
+    cups_dest_t **dests)		/* O - Printers */
+{
+  cups_file_t		*fp;		/* Cache file */
+  ipp_t			*cache;		/* Cached printers */
+  ipp_state_t		state;		/* Read state */
+  ipp_attribute_t	*attr;		/* Current attribute */
+  const char		*name,		/* Attribute name */
+			*printer = NULL;/* printer-name value */
+  char			value[32];	/* Integer value */
+  int			num_dests = 0,	/* Number of printers */
+			num_options = 0;/* Number of options */
+  cups_option_t		*options = NULL;/* Options */
+  cups_dest_t		*dest;		/* New printer */
+  time_t		expires = 0,	/* dnssd-expires value */
+			curtime = time(NULL);
+					/* Current time */
+
+
+  *dests = NULL;
+
+  if ((fp = cupsFileOpen(filename, "r")) == NULL)
+    return (0);
+
+  cache = ippNew();
+
+  while ((state = ippReadIO(fp, (ipp_iocb_t)cupsFileRead, 1, NULL, cache)) != IPP_STATE_DATA)
+    if (state == IPP_STATE_ERROR)
+      break;
+
+  cupsFileClose(fp);
+
+  if (state != IPP_STATE_DATA)
+  {
+    DEBUG_printf(("4_cupsReadDNSSDCache: Unable to read \"%s\".", filename));
+    ippDelete(cache);
+    return (0);
+  }
+
+  for (attr = ippFirstAttribute(cache); ; attr = ippNextAttribute(cache))
+  {
+    if (!attr || (name = ippGetName(attr)) == NULL)
+    {
+     /*
+      * End of a printer, add it if it is complete, unexpired, and not already
+      * listed...
+      */
+
+      if (printer && expires > curtime && cupsGetOption("dnssd-full-name", num_options, options) && cupsGetOption("dnssd-regtype", num_options, options) && cupsGetOption("dnssd-domain", num_options, options) && !cupsGetDest(printer, NULL, num_dests, *dests))
+      {
+        num_dests = cupsAddDest(printer, NULL, num_dests, dests);
+
+        if ((dest = cupsGetDest(printer, NULL, num_dests, *dests)) != NULL)
+        {
+          dest->num_options = num_options;
+          dest->options     = options;
+          options           = NULL;
+        }
+      }
+
+      cupsFreeOptions(num_options, options);
+
+      printer     = NULL;
+      num_options = 0;
+      options     = NULL;
+      expires     = 0;
+
+      if (!attr)
+        break;
+      else
+        continue;
+    }
+
+    if (!strcmp(name, "printer-name"))
+    {
+      printer = ippGetString(attr, 0, NULL);
+    }
+    else if (ippGetValueTag(attr) == IPP_TAG_INTEGER)
+    {
+      if (!strcmp(name, "dnssd-expires"))
+        expires = (time_t)ippGetInteger(attr, 0);
+
+      snprintf(value, sizeof(value), "%d", ippGetInteger(attr, 0));
+      num_options = cupsAddOption(name, value, num_options, &options);
+    }
+    else if (ippGetValueTag(attr) == IPP_TAG_TEXT || ippGetValueTag(attr) == IPP_TAG_NAME)
+      num_options = cupsAddOption(name, ippGetString(attr, 0, NULL), num_options, &options);
+  }
+
+  ippDelete(cache);
+
+  return (num_dests);
+}
+
+
 /*
  * '_cupsUserDefault()' - Get the user default printer from environment
  *                        variables and location information.
@@ -2281,6 +2469,86 @@ _cupsUserDefault(char   *name,		/* I - Name buffer */
 }
 
 
+/*
+ * '_cupsWriteDNSSDCache()' - Write printers to a discovery cache file.
+ *
+ * Printers use the options described for @code _cupsReadDNSSDCache@ and are
+ * skipped when their "dnssd-expires" time has passed.  The file is written to
+ * a temporary name and then renamed, so that other processes never see a
+ * partial file.
+ */
+
+int					/* O - 0 on success, -1 on error */
+_cupsWriteDNSSDCache(
+    const char  *filename,		/* I - Cache filename */
+    int         num_dests,		/* I - Number of printers */
+    cups_dest_t *dests)			/* I - Printers */
+{
+  char			tempfile[1024];	/* Temporary filename */
+  cups_file_t		*fp;		/* Cache file */
+  ipp_t			*cache;		/* Cached printers */
+  ipp_state_t		state = IPP_STATE_ERROR;
+					/* Write state */
+  int			i;		/* Looping var */
+  cups_option_t		*option;	/* Current option */
+  const char		*expires;	/* dnssd-expires value */
+  time_t		curtime = time(NULL);
+					/* Current time */
+  int			ret = -1;	/* Return value */
+
+
+  cache = ippNew();
+
+  for (; num_dests > 0; num_dests --, dests ++)
+  {
+    if ((expires = cupsGetOption("dnssd-expires", dests->num_options, dests->options)) == NULL || (time_t)strtol(expires, NULL, 10) <= curtime)
+      continue;
+
+    if (ippFirstAttribute(cache))
+      ippAddSeparator(cache);
+
+    ippAddString(cache, IPP_TAG_PRINTER, IPP_TAG_NAME, "printer-name", NULL, dests->name);
+
+    for (i = dests->num_options, option = dests->options; i > 0; i --, option ++)
+    {
+      if (!strcmp(option->name, "dnssd-expires"))
+        ippAddInteger(cache, IPP_TAG_PRINTER, IPP_TAG_INTEGER, option->name, (int)strtol(option->value, NULL, 10));
+      else if (!strcmp(option->name, "dnssd-regtype") || !strcmp(option->name, "dnssd-domain"))
+        ippAddString(cache, IPP_TAG_PRINTER, IPP_TAG_NAME, option->name, NULL, option->value);
+      else
+        ippAddString(cache, IPP_TAG_PRINTER, IPP_TAG_TEXT, option->name, NULL, option->value);
+    }
+  }
+
+  _cupsMutexLock(&dnssd_cache_mutex);
+
+  snprintf(tempfile, sizeof(tempfile), "%s.%d", filename, (int)getpid());
+
+  if ((fp = cupsFileOpen(tempfile, "w")) != NULL)
+  {
+    while ((state = ippWriteIO(fp, (ipp_iocb_t)cupsFileWrite, 1, NULL, cache)) != IPP_STATE_DATA)
+      if (state == IPP_STATE_ERROR)
+	break;
+
+    if (cupsFileClose(fp) || state != IPP_STATE_DATA || rename(tempfile, filename))
+    {
+      DEBUG_printf(("4_cupsWriteDNSSDCache: Unable to write \"%s\": %s", filename, strerror(errno)));
+      unlink(tempfile);
+    }
+    else
+      ret = 0;
+  }
+  else
+    DEBUG_printf(("4_cupsWriteDNSSDCache: Unable to create \"%s\": %s", tempfile, strerror(errno)));
+
+  _cupsMutexUnlock(&dnssd_cache_mutex);
+
+  ippDelete(cache);
+
+  return (ret);
+}
+
+
 #if _CUPS_LOCATION_DEFAULTS
 /*
  * 'appleCopyLocations()' - Copy the location history array.
@@ -2554,6 +2822,63 @@ cups_compare_dests(cups_dest_t *a,	/* I - First destination */
 
 
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
+/*
+ * 'cups_dnssd_add_dest()' - Report a discovered destination.
+ *
+ * User defaults from lpoptions are applied to a copy of the destination so
+ * that they do not end up in the discovery cache.
+ */
+
+static int				/* O - 1 to continue, 0 to stop */
+cups_dnssd_add_dest(
+    _cups_dnssd_data_t   *data,		/* I - Enumeration data */
+    _cups_dnssd_device_t *device)	/* I - Device */
+{
+  int		i,			/* Looping var */
+		ret;			/* Return value */
+  cups_dest_t	dest,			/* Destination with user defaults */
+		*user_dest;		/* Destination from lpoptions */
+  cups_option_t	*option;		/* Current option */
+
+
+  device->state = _CUPS_DNSSD_ACTIVE;
+
+  if (!data->cb || (device->type & data->mask) != data->type)
+    return (1);
+
+  dest             = device->dest;
+  dest.num_options = 0;
+  dest.options     = NULL;
+
+  for (i = device->dest.num_options, option = device->dest.options; i > 0; i --, option ++)
+    dest.num_options = cupsAddOption(option->name, option->value, dest.num_options, &dest.options);
+
+  if ((user_dest = cupsGetDest(dest.name, dest.instance, data->num_dests, data->dests)) != NULL)
+  {
+   /*
+    * Apply user defaults to this destination...
+    */
+
+    for (i = user_dest->num_options, option = user_dest->options; i > 0; i --, option ++)
+      dest.num_options = cupsAddOption(option->name, option->value, dest.num_options, &dest.options);
+  }
+
+  if (!strcasecmp(dest.name, data->def_name) && !data->def_instance)
+  {
+    DEBUG_printf(("6cups_dnssd_add_dest: Setting is_default on discovered \"%s\".", dest.name));
+    dest.is_default = 1;
+  }
+
+  DEBUG_printf(("6cups_dnssd_add_dest: Add callback for \"%s\".", dest.name));
+
+  ret = (*data->cb)(data->user_data, CUPS_DEST_FLAGS_NONE, &dest);
+
+  cupsFreeOptions(dest.num_options, dest.options);
+
+  return (ret);
+}
+
+
 #  ifdef HAVE_DNSSD
 /*
  * 'cups_dnssd_browse_cb()' - Browse for printers.
@@ -2680,6 +3005,127 @@ cups_dnssd_client_cb(
 #  endif /* HAVE_DNSSD */
 
 
+/*
+ * 'cups_dnssd_cache_load()' - Load unexpired printers from the discovery cache.
+ *
+ * Cached printers are added in the "pending" state so they are reported right
+ * away, or in the "new" state when refreshing so their TXT records are queried
+ * again.  Printers that are already listed are skipped.
+ */
+
+static int				/* O - Number of printers loaded */
+cups_dnssd_cache_load(
+    _cups_dnssd_data_t *data,		/* I - Enumeration data */
+    int                refresh)		/* I - Load for a refresh? */
+{
+  char			filename[1024];	/* Cache filename */
+  int			i, j,		/* Looping vars */
+			num_dests;	/* Number of cached printers */
+  cups_dest_t		*dests,		/* Cached printers */
+			*dest;		/* Current cached printer */
+  cups_option_t		*option;	/* Current option */
+  const char		*ptype;		/* printer-type value */
+  _cups_dnssd_device_t	*device;	/* Current device */
+  int			count = 0;	/* Number of printers loaded */
+
+
+  if (!_cupsGetCachePath("dnssd.ipp", filename, sizeof(filename), 0))
+    return (0);
+
+  num_dests = _cupsReadDNSSDCache(filename, &dests);
+
+  for (i = num_dests, dest = dests; i > 0; i --, dest ++)
+  {
+    if ((device = calloc(1, sizeof(_cups_dnssd_device_t))) == NULL)
+      break;
+
+    device->dest.name = _cupsStrAlloc(dest->name);
+
+    for (j = dest->num_options, option = dest->options; j > 0; j --, option ++)
+    {
+      if (!strcmp(option->name, "dnssd-full-name"))
+        device->fullName = _cupsStrAlloc(option->value);
+      else if (!strcmp(option->name, "dnssd-regtype"))
+        device->regtype = _cupsStrAlloc(option->value);
+      else if (!strcmp(option->name, "dnssd-domain"))
+        device->domain = _cupsStrAlloc(option->value);
+      else if (!strcmp(option->name, "dnssd-expires"))
+        device->expires = (time_t)strtol(option->value, NULL, 10);
+      else
+        device->dest.num_options = cupsAddOption(option->name, option->value, device->dest.num_options, &device->dest.options);
+    }
+
+    if (cupsArrayFind(data->devices, device))
+    {
+      cups_dnssd_free_device(device, data);
+      continue;
+    }
+
+    ptype = cupsGetOption("printer-type", device->dest.num_options, device->dest.options);
+
+    device->type  = ptype ? (cups_ptype_t)strtol(ptype, NULL, 10) : CUPS_PRINTER_DISCOVERED;
+    device->state = refresh ? _CUPS_DNSSD_NEW : _CUPS_DNSSD_PENDING;
+
+    DEBUG_printf(("4cups_dnssd_cache_load: Adding cached \"%s\".", device->dest.name));
+
+    cupsArrayAdd(data->devices, device);
+    count ++;
+  }
+
+  cupsFreeDests(num_dests, dests);
+
+  return (count);
+}
+
+
+/*
+ * 'cups_dnssd_cache_write()' - Save discovered printers to the cache.
+ */
+
+static void
+cups_dnssd_cache_write(
+    _cups_dnssd_data_t *data)		/* I - Enumeration data */
+{
+  char			filename[1024],	/* Cache filename */
+			expires[32];	/* dnssd-expires value */
+  int			num_dests = 0;	/* Number of printers to cache */
+  cups_dest_t		*dests = NULL,	/* Printers to cache */
+			*dest;		/* Current printer */
+  _cups_dnssd_device_t	*device;	/* Current device */
+  int			i;		/* Looping var */
+  cups_option_t		*option;	/* Current option */
+
+
+  if (!_cupsGetCachePath("dnssd.ipp", filename, sizeof(filename), 1))
+    return;
+
+  for (device = (_cups_dnssd_device_t *)cupsArrayFirst(data->devices); device; device = (_cups_dnssd_device_t *)cupsArrayNext(data->devices))
+  {
+    if (device->state == _CUPS_DNSSD_INCOMPATIBLE || device->state == _CUPS_DNSSD_ERROR)
+      continue;
+
+    num_dests = cupsAddDest(device->dest.name, NULL, num_dests, &dests);
+
+    if ((dest = cupsGetDest(device->dest.name, NULL, num_dests, dests)) == NULL)
+      continue;
+
+    for (i = device->dest.num_options, option = device->dest.options; i > 0; i --, option ++)
+      dest->num_options = cupsAddOption(option->name, option->value, dest->num_options, &dest->options);
+
+    snprintf(expires, sizeof(expires), "%ld", (long)device->expires);
+
+    dest->num_options = cupsAddOption("dnssd-full-name", device->fullName, dest->num_options, &dest->options);
+    dest->num_options = cupsAddOption("dnssd-regtype", device->regtype, dest->num_options, &dest->options);
+    dest->num_options = cupsAddOption("dnssd-domain", device->domain, dest->num_options, &dest->options);
+    dest->num_options = cupsAddOption("dnssd-expires", expires, dest->num_options, &dest->options);
+  }
+
+  _cupsWriteDNSSDCache(filename, num_dests, dests);
+
+  cupsFreeDests(num_dests, dests);
+}
+
+
 /*
  * 'cups_dnssd_compare_device()' - Compare two devices.
  */
@@ -2832,22 +3278,14 @@ cups_dnssd_get_device(
   _cupsStrFree(device->fullName);
   device->fullName = _cupsStrAlloc(fullName);
 
-  if (device->ref)
-  {
-#  ifdef HAVE_DNSSD
-    DNSServiceRefDeallocate(device->ref);
-#  else /* HAVE_AVAHI */
-    avahi_record_browser_free(device->ref);
-#  endif /* HAVE_DNSSD */
-
-    device->ref = 0;
-  }
+  cups_dnssd_release_query(data, device);
 
   if (device->state == _CUPS_DNSSD_ACTIVE)
   {
     DEBUG_printf(("6cups_dnssd_get_device: Remove callback for \"%s\".", device->dest.name));
 
-    (*data->cb)(data->user_data, CUPS_DEST_FLAGS_REMOVED, &device->dest);
+    if (data->cb)
+      (*data->cb)(data->user_data, CUPS_DEST_FLAGS_REMOVED, &device->dest);
     device->state = _CUPS_DNSSD_NEW;
   }
 
@@ -3187,6 +3625,12 @@ cups_dnssd_query_cb(
       device->dest.num_options = cupsAddOption("printer-make-and-model", model, device->dest.num_options, &device->dest.options);
 
     device->type = type;
+#  ifdef HAVE_DNSSD
+    device->expires = time(NULL) + (ttl > 0 ? (time_t)ttl : _CUPS_DNSSD_TTL);
+#  else /* HAVE_AVAHI */
+    device->expires = time(NULL) + _CUPS_DNSSD_TTL;
+#  endif /* HAVE_DNSSD */
+
     snprintf(value, sizeof(value), "%u", type);
     device->dest.num_options = cupsAddOption("printer-type", value, device->dest.num_options, &device->dest.options);
 
@@ -3209,6 +3653,48 @@ cups_dnssd_query_cb(
 }
 
 
+/*
+ * 'cups_dnssd_refresh()' - Refresh the discovery cache in the background.
+ */
+
+static void *				/* O - Thread exit status (unused) */
+cups_dnssd_refresh(void *arg)		/* I - Argument (unused) */
+{
+  (void)arg;
+
+  cups_enum_dests(CUPS_HTTP_DEFAULT, _CUPS_DEST_FLAGS_REFRESH, _CUPS_DNSSD_REFRESH, NULL, CUPS_PRINTER_DISCOVERED, CUPS_PRINTER_DISCOVERED, NULL, NULL);
+
+  _cupsMutexLock(&dnssd_cache_mutex);
+  dnssd_refreshing = 0;
+  _cupsMutexUnlock(&dnssd_cache_mutex);
+
+  return (NULL);
+}
+
+
+/*
+ * 'cups_dnssd_release_query()' - Stop the TXT record query for a device.
+ */
+
+static void
+cups_dnssd_release_query(
+    _cups_dnssd_data_t   *data,		/* I - Enumeration data */
+    _cups_dnssd_device_t *device)	/* I - Device */
+{
+  if (!device->ref)
+    return;
+
+#  ifdef HAVE_DNSSD
+  DNSServiceRefDeallocate(device->ref);
+#  else /* HAVE_AVAHI */
+  avahi_record_browser_free(device->ref);
+#  endif /* HAVE_DNSSD */
+
+  device->ref = 0;
+  data->num_queries --;
+}
+
+
 /*
  * 'cups_dnssd_resolve()' - Resolve a Bonjour printer URI.
  */
@@ -3393,7 +3879,8 @@ cups_enum_dests(
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
   int           count,                  /* Number of queries started */
                 completed,              /* Number of completed queries */
-                remaining;              /* Remainder of timeout */
+                remaining,              /* Remainder of timeout */
+                write_cache = 0;        /* Update the discovery cache? */
   struct timeval curtime;               /* Current time */
   _cups_dnssd_data_t data;		/* Data for callback */
   _cups_dnssd_device_t *device;         /* Current device */
@@ -3430,9 +3917,7 @@ cups_enum_dests(
   * Range check input...
   */
 
-  (void)flags;
-
-  if (!cb)
+  if (!cb && !(flags & _CUPS_DEST_FLAGS_REFRESH))
   {
     DEBUG_puts("1cups_enum_dests: No callback, returning 0.");
     return (0);
@@ -3467,7 +3952,7 @@ cups_enum_dests(
     else
       strlcpy(data.def_name, dest->name, sizeof(data.def_name));
   }
-  else
+  else if (!(flags & _CUPS_DEST_FLAGS_REFRESH))
   {
     const char	*default_printer;	/* Server default printer */
 
@@ -3591,6 +4076,46 @@ cups_enum_dests(
     goto enum_finished;
 
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
+ /*
+  * Report printers from the discovery cache right away.  When there are any
+  * and the caller has a timeout, refresh the cache in the background instead
+  * of browsing now...
+  */
+
+  if (cg->dinfo_cache < 0)
+    _cupsSetDefaults();
+
+  if (flags & _CUPS_DEST_FLAGS_REFRESH)
+  {
+    cups_dnssd_cache_load(&data, 1);
+  }
+  else if (cg->dinfo_cache && cups_dnssd_cache_load(&data, 0) > 0)
+  {
+    for (device = (_cups_dnssd_device_t *)cupsArrayFirst(data.devices); device && (!cancel || !*cancel); device = (_cups_dnssd_device_t *)cupsArrayNext(data.devices))
+    {
+      if (device->state == _CUPS_DNSSD_PENDING && !cups_dnssd_add_dest(&data, device))
+        goto enum_finished;
+    }
+
+    if (msec >= 0)
+    {
+      _cupsMutexLock(&dnssd_cache_mutex);
+      if (!dnssd_refreshing)
+      {
+        _cups_thread_t	thread;		/* Refresh thread */
+
+        if ((thread = _cupsThreadCreate((_cups_thread_func_t)cups_dnssd_refresh, NULL)) != 0)
+        {
+          dnssd_refreshing = 1;
+          _cupsThreadDetach(thread);
+        }
+      }
+      _cupsMutexUnlock(&dnssd_cache_mutex);
+
+      goto enum_finished;
+    }
+  }
+
  /*
   * Get Bonjour-shared printers...
   */
@@ -3693,6 +4218,8 @@ cups_enum_dests(
   else
     remaining = msec;
 
+  write_cache = (flags & _CUPS_DEST_FLAGS_REFRESH) || cg->dinfo_cache;
+
   while (remaining > 0 && (!cancel || !*cancel))
   {
    /*
@@ -3751,11 +4278,27 @@ cups_enum_dests(
       if (device->ref)
         count ++;
 
-      if (device->state == _CUPS_DNSSD_ACTIVE)
+      if (device->state == _CUPS_DNSSD_ACTIVE || device->state == _CUPS_DNSSD_INCOMPATIBLE || device->state == _CUPS_DNSSD_ERROR)
         completed ++;
 
-      if (!device->ref && device->state == _CUPS_DNSSD_NEW)
+      if (device->state == _CUPS_DNSSD_INCOMPATIBLE)
       {
+       /*
+        * Free the query slot for another device...
+        */
+
+        cups_dnssd_release_query(&data, device);
+      }
+      else if (!device->ref && device->state == _CUPS_DNSSD_NEW)
+      {
+       /*
+        * Limit the number of queries in progress so that large networks
+        * don't flood the responder...
+        */
+
+        if (data.num_queries >= _CUPS_DNSSD_MAXQUERIES)
+          continue;
+
         DEBUG_printf(("1cups_enum_dests: Querying '%s'.", device->fullName));
 
 #  ifdef HAVE_DNSSD
@@ -3764,6 +4307,7 @@ cups_enum_dests(
         if (DNSServiceQueryRecord(&(device->ref), kDNSServiceFlagsShareConnection, 0, device->fullName, kDNSServiceType_TXT, kDNSServiceClass_IN, (DNSServiceQueryRecordReply)cups_dnssd_query_cb, &data) == kDNSServiceErr_NoError)
         {
           count ++;
+          data.num_queries ++;
         }
         else
         {
@@ -3778,6 +4322,7 @@ cups_enum_dests(
         {
           DEBUG_printf(("1cups_enum_dests: Query ref=%p", device->ref));
           count ++;
+          data.num_queries ++;
         }
         else
         {
@@ -3787,55 +4332,31 @@ cups_enum_dests(
         }
 #  endif /* HAVE_DNSSD */
       }
-      else if (device->ref && device->state == _CUPS_DNSSD_PENDING)
+      else if (device->state == _CUPS_DNSSD_PENDING)
       {
         completed ++;
 
         DEBUG_printf(("1cups_enum_dests: Query for \"%s\" is complete.", device->fullName));
 
-        if ((device->type & mask) == type)
-        {
-          cups_dest_t	*user_dest;	/* Destination from lpoptions */
-
-          dest = &device->dest;
-
-	  if ((user_dest = cupsGetDest(dest->name, dest->instance, data.num_dests, data.dests)) != NULL)
-	  {
-	   /*
-	    * Apply user defaults to this destination...
-	    */
-
-	    for (j = user_dest->num_options, option = user_dest->options; j > 0; j --, option ++)
-	      dest->num_options = cupsAddOption(option->name, option->value, dest->num_options, &dest->options);
-	  }
-
-          if (!strcasecmp(dest->name, data.def_name) && !data.def_instance)
-	  {
-	    DEBUG_printf(("1cups_enum_dests: Setting is_default on discovered \"%s\".", dest->name));
-            dest->is_default = 1;
-	  }
+        cups_dnssd_release_query(&data, device);
 
-          DEBUG_printf(("1cups_enum_dests: Add callback for \"%s\".", device->dest.name));
-          if (!(*cb)(user_data, CUPS_DEST_FLAGS_NONE, dest))
-          {
-            remaining = -1;
-            break;
-          }
+        if (!cups_dnssd_add_dest(&data, device))
+        {
+          remaining = -1;
+          break;
         }
-
-        device->state = _CUPS_DNSSD_ACTIVE;
       }
     }
 
 #  ifdef HAVE_AVAHI
     DEBUG_printf(("1cups_enum_dests: remaining=%d, browsers=%d, completed=%d, count=%d, devices count=%d", remaining, data.browsers, completed, count, cupsArrayCount(data.devices)));
 
-    if (data.browsers == 0 && completed == cupsArrayCount(data.devices))
+    if (data.browsers == 0 && completed == cupsArrayCount(data.devices) && !(flags & _CUPS_DEST_FLAGS_REFRESH))
       break;
 #  else
     DEBUG_printf(("1cups_enum_dests: remaining=%d, completed=%d, count=%d, devices count=%d", remaining, completed, count, cupsArrayCount(data.devices)));
 
-    if (completed == cupsArrayCount(data.devices))
+    if (completed == cupsArrayCount(data.devices) && !(flags & _CUPS_DEST_FLAGS_REFRESH))
       break;
 #  endif /* HAVE_AVAHI */
   }
@@ -3850,6 +4371,9 @@ cups_enum_dests(
   cupsFreeDests(data.num_dests, data.dests);
 
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
+  if (write_cache)
+    cups_dnssd_cache_write(&data);
+
   cupsArrayDelete(data.devices);
 
 #  ifdef HAVE_DNSSD
@@ -64,10 +64,22 @@ cupsGetDevices(
     return (IPP_STATUS_ERROR_INTERNAL);
 
   if (!http)
-    http = _cupsConnect();
+  {
+    ipp_status_t	ipp_status;	/* Status of request */
 
-  if (!http)
-    return (IPP_STATUS_ERROR_SERVICE_UNAVAILABLE);
+    if ((http = _cupsConnect()) == NULL)
+      return (IPP_STATUS_ERROR_SERVICE_UNAVAILABLE);
+
+   /*
+    * Use the default connection, then hand it back to the pool (if any)...
+    */
+
+    ipp_status = cupsGetDevices(http, timeout, include_schemes, exclude_schemes, callback, user_data);
+
+    _cupsConnectRelease();
+
+    return (ipp_status);
+  }
 
  /*
   * Create a CUPS-Get-Devices request...
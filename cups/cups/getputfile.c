@@ -60,9 +60,21 @@ cupsGetFd(http_t     *http,		/* I - Connection to server or @code CUPS_HTTP_DEFA
   }
 
   if (!http)
+  {
     if ((http = _cupsConnect()) == NULL)
       return (HTTP_STATUS_SERVICE_UNAVAILABLE);
 
+   /*
+    * Use the default connection, then hand it back to the pool (if any)...
+    */
+
+    status = cupsGetFd(http, resource, fd);
+
+    _cupsConnectRelease();
+
+    return (status);
+  }
+
  /*
   * Then send GET requests to the HTTP server...
   */
@@ -312,9 +324,21 @@ cupsPutFd(http_t     *http,		/* I - Connection to server or @code CUPS_HTTP_DEFA
   }
 
   if (!http)
+  {
     if ((http = _cupsConnect()) == NULL)
       return (HTTP_STATUS_SERVICE_UNAVAILABLE);
 
+   /*
+    * Use the default connection, then hand it back to the pool (if any)...
+    */
+
+    status = cupsPutFd(http, resource, fd);
+
+    _cupsConnectRelease();
+
+    return (status);
+  }
+
  /*
   * Then send PUT requests to the HTTP server...
   */
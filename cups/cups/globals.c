@@ -204,6 +204,7 @@ cups_globals_alloc(void)
   cg->any_root       = -1;
   cg->expired_certs  = -1;
   cg->validate_certs = -1;
+  cg->dinfo_cache    = -1;
 
 #ifdef DEBUG
  /*
@@ -360,8 +361,7 @@ cups_globals_free(_cups_globals_t *cg)	/* I - Pointer to global data */
   cupsArrayDelete(cg->ppd_size_lut);
   cupsArrayDelete(cg->pwg_size_lut);
 
-  httpClose(cg->http);
-  cg->http = NULL;
+  _cupsDisconnect(cg);
 
 #ifdef HAVE_SSL
   _httpFreeCredentials(cg->tls_credentials);
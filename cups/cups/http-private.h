@@ -116,7 +116,10 @@ extern "C" {
  * Constants...
  */
 
+#  define _HTTP_MAX_BUFFER_SIZE	262144	/* Maximum size of read/write buffers */
 #  define _HTTP_MAX_SBUFFER	65536	/* Size of (de)compression buffer */
+#  define _HTTP_MAX_ZBLOCK	131072	/* Size of parallel compression blocks */
+#  define _HTTP_MAX_ZTHREADS	8	/* Maximum compression threads */
 #  define _HTTP_RESOLVE_DEFAULT	0	/* Just resolve with default options */
 #  define _HTTP_RESOLVE_STDERR	1	/* Log resolve progress to stderr */
 #  define _HTTP_RESOLVE_FQDN	2	/* Resolve to a FQDN */
@@ -197,8 +200,10 @@ typedef enum _http_coding_e		/**** HTTP content coding enumeration ****/
   _HTTP_CODING_IDENTITY,		/* No content coding */
   _HTTP_CODING_GZIP,			/* LZ77+gzip decompression */
   _HTTP_CODING_DEFLATE,			/* LZ77+zlib compression */
+  _HTTP_CODING_ZSTD,			/* Zstandard compression */
   _HTTP_CODING_GUNZIP,			/* LZ77+gzip decompression */
-  _HTTP_CODING_INFLATE			/* LZ77+zlib decompression */
+  _HTTP_CODING_INFLATE,			/* LZ77+zlib decompression */
+  _HTTP_CODING_UNZSTD			/* Zstandard decompression */
 } _http_coding_t;
 
 typedef enum _http_mode_e		/**** HTTP mode enumeration ****/
@@ -323,6 +328,18 @@ struct _http_s				/**** HTTP connection structure ****/
 
   /* when setting up the tls context, if this is set we disable dh */
   bool                      disableDH;
+
+  /**** Larger buffers ****/
+  char			*inbuf,		/* Read buffer (buffer or allocated) */
+			*inptr;		/* Start of unread data in inbuf */
+  size_t		insize;		/* Size of read buffer */
+  char			*outbuf;	/* Write buffer (wbuffer or allocated) */
+  size_t		outsize;	/* Size of write buffer */
+
+  /**** Content coding extensions ****/
+  int			coding_threads;	/* Threads to use for compression */
+  void			*coding_ctx;	/* zstd or parallel deflate context */
+  int			coding_pending;	/* Decompressed data pending in context? */
 };
 #  endif /* !_HTTP_NO_PRIVATE */
 
@@ -354,8 +371,11 @@ extern const char	*_httpResolveURI(const char *uri, char *resolved_uri,
 			                 size_t resolved_size, int options,
 					 int (*cb)(void *context),
 					 void *context) _CUPS_PRIVATE;
+extern int		_httpSetBufferSize(http_t *http, size_t rsize, size_t wsize) _CUPS_PRIVATE;
+extern void		_httpSetCodingThreads(http_t *http, int threads) _CUPS_PRIVATE;
 extern int		_httpSetDigestAuthString(http_t *http, const char *nonce, const char *method, const char *resource) _CUPS_PRIVATE;
 extern const char	*_httpStatus(cups_lang_t *lang, http_status_t status) _CUPS_PRIVATE;
+extern void		_httpTLSGetStatistics(size_t *full, size_t *resumed) _CUPS_PRIVATE;
 extern void		_httpTLSInitialize(void) _CUPS_PRIVATE;
 extern size_t		_httpTLSPending(http_t *http) _CUPS_PRIVATE;
 extern int		_httpTLSRead(http_t *http, char *buf, int len) _CUPS_PRIVATE;
@@ -26,6 +26,7 @@
 #  include <signal.h>
 #  include <sys/time.h>
 #  include <sys/resource.h>
+#  include <sys/uio.h>
 #endif /* _WIN32 */
 #ifdef HAVE_POLL
 #  include <poll.h>
@@ -33,12 +34,60 @@
 #  ifdef HAVE_LIBZ
 #    include <zlib.h>
 #  endif /* HAVE_LIBZ */
+#  ifdef HAVE_ZSTD
+#    include <zstd.h>
+#  endif /* HAVE_ZSTD */
 
 #if __has_include("/usr/local/include/traken_client.h")
 #define __IMPLEMENT_TRAKEN__
 #include "/usr/local/include/traken_client.h"
 #endif
 
+
+/*
+ * Local types...
+ */
+
+#ifdef _WIN32
+struct iovec				/**** Vectored I/O segment ****/
+{
+  void		*iov_base;		/* Data */
+  size_t	iov_len;		/* Length of data */
+};
+#endif /* _WIN32 */
+
+#ifdef HAVE_LIBZ
+typedef struct _http_zblock_s		/**** Parallel deflate block ****/
+{
+  const unsigned char	*data,		/* Uncompressed data */
+			*dict;		/* Preset dictionary */
+  size_t		datalen,	/* Length of uncompressed data */
+			dictlen;	/* Length of preset dictionary */
+  int			last;		/* Last block in stream? */
+  unsigned char		*out;		/* Compressed data */
+  size_t		outlen,		/* Length of compressed data */
+			outsize;	/* Size of compressed data buffer */
+  uLong			crc;		/* CRC-32 of uncompressed data */
+  int			status;		/* 0 on success, -1 on error */
+} _http_zblock_t;
+
+typedef struct _http_zpar_s		/**** Parallel deflate state ****/
+{
+  int			gzip,		/* Write gzip header and trailer? */
+			header;		/* Header written? */
+  unsigned char		*input;		/* Uncompressed data for next batch */
+  size_t		inused,		/* Bytes in input buffer */
+			insize;		/* Size of input buffer */
+  unsigned char		dict[2048];	/* End of previous batch */
+  size_t		dictlen;	/* Length of dictionary */
+  uLong			crc,		/* CRC-32 of uncompressed data */
+			total;		/* Length of uncompressed data */
+  int			num_blocks;	/* Number of blocks per batch */
+  _http_zblock_t	blocks[_HTTP_MAX_ZTHREADS];
+					/* Blocks in batch */
+} _http_zpar_t;
+#endif /* HAVE_LIBZ */
+
 /*
  * Local functions...
  */
@@ -46,8 +95,10 @@
 static void		http_add_field(http_t *http, http_field_t field, const char *value, int append);
 #ifdef HAVE_LIBZ
 static void		http_content_coding_finish(http_t *http);
+static int		http_content_coding_inflate(http_t *http);
 static void		http_content_coding_start(http_t *http,
 						  const char *value);
+static int		http_content_coding_write(http_t *http, const char *buffer, size_t length, int finish);
 #endif /* HAVE_LIBZ */
 static http_t		*http_create(const char *host, int port,
 			             http_addrlist_t *addrlist, int family,
@@ -57,6 +108,11 @@ static http_t		*http_create(const char *host, int port,
 static void		http_debug_hex(const char *prefix, const char *buffer,
 			               int bytes);
 #endif /* DEBUG */
+#ifdef HAVE_LIBZ
+static int		http_deflate_batch(http_t *http, int last);
+static void		*http_deflate_block(_http_zblock_t *block);
+#endif /* HAVE_LIBZ */
+static char		*http_get_line(http_t *http, size_t maxlen);
 static ssize_t		http_read(http_t *http, char *buffer, size_t length);
 static ssize_t		http_read_buffered(http_t *http, char *buffer, size_t length);
 static ssize_t		http_read_chunk(http_t *http, char *buffer, size_t length);
@@ -64,8 +120,12 @@ static int		http_send(http_t *http, http_state_t request,
 			          const char *uri);
 static ssize_t		http_write(http_t *http, const char *buffer,
 			           size_t length);
+static ssize_t		http_write_buffered(http_t *http, const char *buffer,
+			                    size_t length);
 static ssize_t		http_write_chunk(http_t *http, const char *buffer,
 			                 size_t length);
+static ssize_t		http_writev(http_t *http, struct iovec *iov,
+			            int iovcnt);
 static off_t		http_set_length(http_t *http);
 static void		http_set_timeout(int fd, double timeout);
 static void		http_set_wait(http_t *http);
@@ -146,6 +206,17 @@ static const char * const http_fields[] =
 			  "Server",
 			  "Authentication-Info"
 			};
+static const signed char http_fields_hash[128] =
+			{		/* Field index for each hash value */
+			  -1, -1, -1, -1, -1, -1,  1, -1, -1, -1, -1, -1, -1, 17, -1, -1,
+			  -1, -1, -1,  2, -1,  4, -1, 14, -1, 15, -1, 26, -1, -1, -1, -1,
+			  30, -1, -1, 27, -1, -1, -1, -1,  5,  6, -1, -1, -1, -1, -1, -1,
+			  -1,  7, -1, -1,  3, -1, 16,  9, -1, -1, -1, 25, 10, -1, 22, -1,
+			  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 12, 20, -1, -1, 11, -1,
+			  -1, -1, -1, -1, -1, -1, -1, -1, 18, -1, -1, -1, 24, 29, 21, -1,
+			  -1, -1, -1, -1, -1, 19, -1, 13, 28, -1, -1, -1, -1, -1, -1, -1,
+			  -1, 23, -1, -1, -1, -1,  8, -1, -1, -1,  0, -1, -1, -1, -1, -1
+			};
 
 
 /*
@@ -364,6 +435,9 @@ httpClearFields(http_t *http)		/* I - HTTP connection */
 	httpSetField(http, HTTP_FIELD_HOST, http->hostname);
     }
 
+    if (http->extra_headers)
+      cupsArrayClear(http->extra_headers);
+
     http->expect = (http_status_t)0;
   }
 }
@@ -423,6 +497,12 @@ httpClose(http_t *http)			/* I - HTTP connection */
   if (http->authstring && http->authstring != http->_authstring)
     free(http->authstring);
 
+  if (http->inbuf != http->buffer)
+    free(http->inbuf);
+
+  if (http->outbuf != http->wbuffer)
+    free(http->outbuf);
+
 #if __BLOCKS__
   if (http->_telemetryCallbacks) {
     CFRelease(http->_telemetryCallbacks);
@@ -664,12 +744,22 @@ httpError(http_t *http)			/* I - HTTP connection */
 http_field_t				/* O - Field index */
 httpFieldValue(const char *name)	/* I - String name */
 {
-  int	i;				/* Looping var */
+  size_t	len;			/* Length of name */
+  int		field;			/* Field index */
 
 
-  for (i = 0; i < HTTP_FIELD_MAX; i ++)
-    if (!_cups_strcasecmp(name, http_fields[i]))
-      return ((http_field_t)i);
+ /*
+  * The length and the 2nd, 9th, and last characters of the known field names
+  * form a perfect hash, so at most one string comparison is needed...
+  */
+
+  if (!name || (len = strlen(name)) < 2)
+    return (HTTP_FIELD_UNKNOWN);
+
+  field = http_fields_hash[(len + (size_t)_cups_tolower(name[1]) + 3 * (size_t)(len > 8 ? _cups_tolower(name[8]) : 0) + (size_t)_cups_tolower(name[len - 1])) & 127];
+
+  if (field >= 0 && !_cups_strcasecmp(name, http_fields[field]))
+    return ((http_field_t)field);
 
   return (HTTP_FIELD_UNKNOWN);
 }
@@ -767,9 +857,9 @@ httpFlushWrite(http_t *http)		/* I - HTTP connection */
   }
 
   if (http->data_encoding == HTTP_ENCODING_CHUNKED)
-    bytes = http_write_chunk(http, http->wbuffer, (size_t)http->wused);
+    bytes = http_write_chunk(http, http->outbuf, (size_t)http->wused);
   else
-    bytes = http_write(http, http->wbuffer, (size_t)http->wused);
+    bytes = http_write(http, http->outbuf, (size_t)http->wused);
 
   http->wused = 0;
 
@@ -895,7 +985,10 @@ httpGetContentEncoding(http_t *http)	/* I - HTTP connection */
       "deflate",
       "gzip",
       "x-deflate",
-      "x-gzip"
+      "x-gzip",
+#  ifdef HAVE_ZSTD
+      "zstd"
+#  endif /* HAVE_ZSTD */
     };
 
     strlcpy(temp, http->fields[HTTP_FIELD_ACCEPT_ENCODING], sizeof(temp));
@@ -1254,7 +1347,9 @@ httpGets(char   *line,			/* I - Line to read into */
         return (NULL);
       }
 
-      bytes = http_read(http, http->buffer + http->used, (size_t)(HTTP_MAX_BUFFER - http->used));
+      http->inptr = http->inbuf;
+
+      bytes = http_read(http, http->inbuf, http->insize);
 
       DEBUG_printf(("4httpGets: read " CUPS_LLFMT " bytes.", CUPS_LLCAST bytes));
 
@@ -1323,7 +1418,7 @@ httpGets(char   *line,			/* I - Line to read into */
     * Now copy as much of the current line as possible...
     */
 
-    for (bufptr = http->buffer, bufend = http->buffer + http->used;
+    for (bufptr = http->inptr, bufend = http->inptr + http->used;
          lineptr < lineend && bufptr < bufend;)
     {
       if (*bufptr == 0x0a)
@@ -1338,9 +1433,8 @@ httpGets(char   *line,			/* I - Line to read into */
 	*lineptr++ = *bufptr++;
     }
 
-    http->used -= (int)(bufptr - http->buffer);
-    if (http->used > 0)
-      memmove(http->buffer, bufptr, (size_t)http->used);
+    http->used  -= (int)(bufptr - http->inptr);
+    http->inptr = bufptr;
 
     if (eol)
     {
@@ -1761,7 +1855,7 @@ httpPeek(http_t *http,			/* I - HTTP connection */
 #ifdef HAVE_LIBZ
   if (http->used == 0 &&
       (http->coding == _HTTP_CODING_IDENTITY ||
-       (http->coding >= _HTTP_CODING_GUNZIP && ((z_stream *)http->stream)->avail_in == 0)))
+       (http->coding >= _HTTP_CODING_GUNZIP && ((z_stream *)http->stream)->avail_in == 0 && !http->coding_pending)))
 #else
   if (http->used == 0)
 #endif /* HAVE_LIBZ */
@@ -1783,20 +1877,22 @@ httpPeek(http_t *http,			/* I - HTTP connection */
       }
     }
 
-    if ((size_t)http->data_remaining > sizeof(http->buffer))
-      buflen = sizeof(http->buffer);
+    if ((size_t)http->data_remaining > http->insize)
+      buflen = (ssize_t)http->insize;
     else
       buflen = (ssize_t)http->data_remaining;
 
+    http->inptr = http->inbuf;
+
     DEBUG_printf(("2httpPeek: Reading %d bytes into buffer.", (int)buflen));
-    bytes = http_read(http, http->buffer, (size_t)buflen);
+    bytes = http_read(http, http->inbuf, (size_t)buflen);
 
     DEBUG_printf(("2httpPeek: Read " CUPS_LLFMT " bytes into buffer.",
                   CUPS_LLCAST bytes));
     if (bytes > 0)
     {
 #ifdef DEBUG
-      http_debug_hex("httpPeek", http->buffer, (int)bytes);
+      http_debug_hex("httpPeek", http->inbuf, (int)bytes);
 #endif /* DEBUG */
 
       http->used = (int)bytes;
@@ -1810,6 +1906,12 @@ httpPeek(http_t *http,			/* I - HTTP connection */
     int		zerr;			/* Decompressor error */
     z_stream	stream;			/* Copy of decompressor stream */
 
+    if (http->coding == _HTTP_CODING_UNZSTD)
+    {
+      DEBUG_puts("2httpPeek: httpPeek does not work with zstd streams.");
+      return (-1);
+    }
+
     if (http->used > 0 && ((z_stream *)http->stream)->avail_in < HTTP_MAX_BUFFER)
     {
       size_t buflen = HTTP_MAX_BUFFER - ((z_stream *)http->stream)->avail_in;
@@ -1830,13 +1932,11 @@ httpPeek(http_t *http,			/* I - HTTP connection */
       DEBUG_printf(("1httpPeek: Copying %d more bytes of data into "
 		    "decompression buffer.", (int)buflen));
 
-      memcpy(http->sbuffer + ((z_stream *)http->stream)->avail_in, http->buffer, buflen);
+      memcpy(http->sbuffer + ((z_stream *)http->stream)->avail_in, http->inptr, buflen);
       ((z_stream *)http->stream)->avail_in += buflen;
       http->used            -= (int)buflen;
+      http->inptr           += buflen;
       http->data_remaining  -= (off_t)buflen;
-
-      if (http->used > 0)
-        memmove(http->buffer, http->buffer + buflen, (size_t)http->used);
     }
 
     DEBUG_printf(("2httpPeek: length=%d, avail_in=%d", (int)length,
@@ -1886,7 +1986,7 @@ httpPeek(http_t *http,			/* I - HTTP connection */
     DEBUG_printf(("2httpPeek: grabbing %d bytes from input buffer...",
                   (int)bytes));
 
-    memcpy(buffer, http->buffer, length);
+    memcpy(buffer, http->inptr, length);
   }
   else
     bytes = 0;
@@ -2038,7 +2138,7 @@ httpRead2(http_t *http,			/* I - HTTP connection */
   {
     do
     {
-      if (((z_stream *)http->stream)->avail_in > 0)
+      if (((z_stream *)http->stream)->avail_in > 0 || http->coding_pending)
       {
 	int	zerr;			/* Decompressor error */
 
@@ -2048,7 +2148,7 @@ httpRead2(http_t *http,			/* I - HTTP connection */
 	((z_stream *)http->stream)->next_out  = (Bytef *)buffer;
 	((z_stream *)http->stream)->avail_out = (uInt)length;
 
-	if ((zerr = inflate((z_stream *)http->stream, Z_SYNC_FLUSH)) < Z_OK)
+	if ((zerr = http_content_coding_inflate(http)) < Z_OK)
 	{
 	  DEBUG_printf(("2httpRead2: zerr=%d", zerr));
 #ifdef DEBUG
@@ -2184,7 +2284,7 @@ httpRead2(http_t *http,			/* I - HTTP connection */
   if (
 #ifdef HAVE_LIBZ
       (http->coding == _HTTP_CODING_IDENTITY ||
-       (http->coding >= _HTTP_CODING_GUNZIP && ((z_stream *)http->stream)->avail_in == 0)) &&
+       (http->coding >= _HTTP_CODING_GUNZIP && ((z_stream *)http->stream)->avail_in == 0 && !http->coding_pending)) &&
 #endif /* HAVE_LIBZ */
       ((http->data_remaining <= 0 &&
         http->data_encoding == HTTP_ENCODING_LENGTH) ||
@@ -2449,6 +2549,7 @@ _httpReconnect2_inner(http_t *http,	/* I - HTTP connection */
   http->data_encoding   = HTTP_ENCODING_FIELDS;
   http->_data_remaining = 0;
   http->used            = 0;
+  http->inptr           = http->inbuf;
   http->data_remaining  = 0;
   http->hostaddr        = NULL;
   http->wused           = 0;
@@ -2598,6 +2699,130 @@ httpSetAuthString(http_t     *http,	/* I - HTTP connection */
 }
 
 
+/*
+ * '_httpSetBufferSize()' - Set the size of the read and write buffers.
+ *
+ * Larger buffers mean fewer system calls (and TLS records) when streaming
+ * large amounts of data.  Sizes are limited to HTTP_MAX_BUFFER through
+ * _HTTP_MAX_BUFFER_SIZE bytes, and a size of 0 leaves that buffer alone.
+ * The read buffer is never made smaller than the amount of unread data.
+ */
+
+int					/* O - 1 on success, 0 on error */
+_httpSetBufferSize(http_t *http,	/* I - HTTP connection */
+                   size_t rsize,	/* I - Read buffer size or 0 */
+		   size_t wsize)	/* I - Write buffer size or 0 */
+{
+  char	*temp;				/* New buffer */
+
+
+  DEBUG_printf(("_httpSetBufferSize(http=%p, rsize=" CUPS_LLFMT ", wsize=" CUPS_LLFMT ")", (void *)http, CUPS_LLCAST rsize, CUPS_LLCAST wsize));
+
+  if (!http)
+    return (0);
+
+  if (rsize > 0)
+  {
+    if (rsize < sizeof(http->buffer))
+      rsize = sizeof(http->buffer);
+    else if (rsize > _HTTP_MAX_BUFFER_SIZE)
+      rsize = _HTTP_MAX_BUFFER_SIZE;
+
+    if (rsize < (size_t)http->used)
+      rsize = http->insize;
+
+    if (rsize != http->insize)
+    {
+      if (rsize == sizeof(http->buffer))
+        temp = http->buffer;
+      else if ((temp = malloc(rsize)) == NULL)
+        return (0);
+
+      if (http->used > 0)
+        memmove(temp, http->inptr, (size_t)http->used);
+
+      if (http->inbuf != http->buffer)
+        free(http->inbuf);
+
+      http->inbuf  = temp;
+      http->inptr  = temp;
+      http->insize = rsize;
+    }
+  }
+
+  if (wsize > 0)
+  {
+    if (wsize < sizeof(http->wbuffer))
+      wsize = sizeof(http->wbuffer);
+    else if (wsize > _HTTP_MAX_BUFFER_SIZE)
+      wsize = _HTTP_MAX_BUFFER_SIZE;
+
+    if (wsize != http->outsize)
+    {
+      if (wsize < (size_t)http->wused && httpFlushWrite(http) < 0)
+        return (0);
+
+      if (wsize == sizeof(http->wbuffer))
+        temp = http->wbuffer;
+      else if ((temp = malloc(wsize)) == NULL)
+        return (0);
+
+      if (http->wused > 0)
+        memcpy(temp, http->outbuf, (size_t)http->wused);
+
+      if (http->outbuf != http->wbuffer)
+        free(http->outbuf);
+
+      http->outbuf  = temp;
+      http->outsize = wsize;
+    }
+  }
+
+  return (1);
+}
+
+
+/*
+ * '_httpSetCodingThreads()' - Set the number of threads used to compress
+ *                             request and response data.
+ *
+ * Data sent with the "gzip" or "deflate" content codings is compressed in
+ * blocks on up to _HTTP_MAX_ZTHREADS threads, and "zstd" uses the worker
+ * threads in libzstd.  A value of 0 uses one thread per online processor and
+ * a value of 1 compresses on the calling thread, which is the default.  The
+ * new value is used the next time a content coding is started.
+ */
+
+void
+_httpSetCodingThreads(http_t *http,	/* I - HTTP connection */
+                      int    threads)	/* I - Number of threads or 0 for automatic */
+{
+  DEBUG_printf(("_httpSetCodingThreads(http=%p, threads=%d)", (void *)http, threads));
+
+  if (!http)
+    return;
+
+  if (threads <= 0)
+  {
+#ifdef _WIN32
+    SYSTEM_INFO	info;			/* System information */
+
+    GetSystemInfo(&info);
+    threads = (int)info.dwNumberOfProcessors;
+#else
+    threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif /* _WIN32 */
+  }
+
+  if (threads < 1)
+    threads = 1;
+  else if (threads > _HTTP_MAX_ZTHREADS)
+    threads = _HTTP_MAX_ZTHREADS;
+
+  http->coding_threads = threads;
+}
+
+
 /*
  * 'httpSetCredentials()' - Set the credentials associated with an encrypted
  *			    connection.
@@ -2839,7 +3064,8 @@ int					/* O - 1 to continue, 0 to stop */
 _httpUpdate(http_t        *http,	/* I - HTTP connection */
             http_status_t *status)	/* O - Current HTTP status */
 {
-  char		line[32768],		/* Line from connection... */
+  char		buffer[32768],		/* Line from connection... */
+		*line,			/* Line to parse */
 		*value;			/* Pointer to value on line */
   http_field_t	field;			/* Field index */
   int		major, minor;		/* HTTP version numbers */
@@ -2848,10 +3074,11 @@ _httpUpdate(http_t        *http,	/* I - HTTP connection */
   DEBUG_printf(("_httpUpdate(http=%p, status=%p), state=%s", (void *)http, (void *)status, httpStateString(http->state)));
 
  /*
-  * Grab a single line from the connection...
+  * Grab a single line from the connection, parsing it in place when the
+  * whole line is already in the input buffer...
   */
 
-  if (!httpGets(line, sizeof(line), http))
+  if ((line = http_get_line(http, sizeof(buffer) - 1)) == NULL && (line = httpGets(buffer, sizeof(buffer), http)) == NULL)
   {
     *status = HTTP_STATUS_ERROR;
     return (0);
@@ -2969,7 +3196,14 @@ _httpUpdate(http_t        *http,	/* I - HTTP connection */
     * Be tolerants of servers that send unknown attribute fields...
     */
 
-    if (!_cups_strcasecmp(line, "expect"))
+    if ((field = httpFieldValue(line)) != HTTP_FIELD_UNKNOWN)
+    {
+      http_add_field(http, field, value, 1);
+
+      if (field == HTTP_FIELD_AUTHENTICATION_INFO)
+        httpGetSubField2(http, HTTP_FIELD_AUTHENTICATION_INFO, "nextnonce", http->nextnonce, (int)sizeof(http->nextnonce));
+    }
+    else if (!_cups_strcasecmp(line, "expect"))
     {
      /*
       * "Expect: 100-continue" or similar...
@@ -2985,13 +3219,6 @@ _httpUpdate(http_t        *http,	/* I - HTTP connection */
 
       httpSetCookie(http, value);
     }
-    else if ((field = httpFieldValue(line)) != HTTP_FIELD_UNKNOWN)
-    {
-      http_add_field(http, field, value, 1);
-
-      if (field == HTTP_FIELD_AUTHENTICATION_INFO)
-        httpGetSubField2(http, HTTP_FIELD_AUTHENTICATION_INFO, "nextnonce", http->nextnonce, (int)sizeof(http->nextnonce));
-    }
     else {
       DEBUG_printf(("1_httpUpdate: unknown field %s seen!", line));
       if (http->extra_headers == nil) {
@@ -3189,7 +3416,7 @@ httpWait(http_t *http,			/* I - HTTP connection */
   }
 
 #ifdef HAVE_LIBZ
-  if (http->coding >= _HTTP_CODING_GUNZIP && ((z_stream *)http->stream)->avail_in > 0)
+  if (http->coding >= _HTTP_CODING_GUNZIP && (((z_stream *)http->stream)->avail_in > 0 || http->coding_pending))
   {
     DEBUG_puts("3httpWait: Returning 1 since there is buffered data ready.");
     return (1);
@@ -3271,7 +3498,7 @@ httpWrite2(http_t     *http,		/* I - HTTP connection */
   */
 
 #ifdef HAVE_LIBZ
-  if (http->coding == _HTTP_CODING_GZIP || http->coding == _HTTP_CODING_DEFLATE)
+  if (http->coding == _HTTP_CODING_GZIP || http->coding == _HTTP_CODING_DEFLATE || http->coding == _HTTP_CODING_ZSTD)
   {
     DEBUG_printf(("1httpWrite2: http->coding=%d", http->coding));
 
@@ -3280,6 +3507,20 @@ httpWrite2(http_t     *http,		/* I - HTTP connection */
       http_content_coding_finish(http);
       bytes = 0;
     }
+    else if (http->coding_ctx)
+    {
+     /*
+      * zstd and parallel deflate have their own buffering...
+      */
+
+      if (http_content_coding_write(http, buffer, length, 0) < 0)
+      {
+	DEBUG_puts("1httpWrite2: Unable to write, returning -1.");
+	return (-1);
+      }
+
+      bytes = (ssize_t)length;
+    }
     else
     {
       size_t	slen;			/* Bytes to write */
@@ -3323,15 +3564,31 @@ httpWrite2(http_t     *http,		/* I - HTTP connection */
 #endif /* HAVE_LIBZ */
   if (length > 0)
   {
-    if (http->wused && (length + (size_t)http->wused) > sizeof(http->wbuffer))
+    if (http->wused && (length + (size_t)http->wused) > http->outsize)
     {
+      if (length >= http->outsize)
+      {
+       /*
+        * Write the buffered data and the new data together...
+	*/
+
+	DEBUG_printf(("2httpWrite2: Writing buffer and " CUPS_LLFMT " bytes to socket (wused=%d)...", CUPS_LLCAST length, http->wused));
+
+        bytes = http_write_buffered(http, buffer, length);
+
+	if (http->data_encoding == HTTP_ENCODING_LENGTH && bytes > 0)
+	  http->data_remaining -= bytes;
+
+	goto finish;
+      }
+
       DEBUG_printf(("2httpWrite2: Flushing buffer (wused=%d, length="
                     CUPS_LLFMT ")", http->wused, CUPS_LLCAST length));
 
       httpFlushWrite(http);
     }
 
-    if ((length + (size_t)http->wused) <= sizeof(http->wbuffer) && length < sizeof(http->wbuffer))
+    if ((length + (size_t)http->wused) <= http->outsize && length < http->outsize)
     {
      /*
       * Write to buffer...
@@ -3340,7 +3597,7 @@ httpWrite2(http_t     *http,		/* I - HTTP connection */
       DEBUG_printf(("2httpWrite2: Copying " CUPS_LLFMT " bytes to wbuffer...",
                     CUPS_LLCAST length));
 
-      memcpy(http->wbuffer + http->wused, buffer, length);
+      memcpy(http->outbuf + http->wused, buffer, length);
       http->wused += (int)length;
       bytes = (ssize_t)length;
     }
@@ -3372,6 +3629,8 @@ httpWrite2(http_t     *http,		/* I - HTTP connection */
   * Handle end-of-request processing...
   */
 
+  finish:
+
   if ((http->data_encoding == HTTP_ENCODING_CHUNKED && length == 0) ||
       (http->data_encoding == HTTP_ENCODING_LENGTH && http->data_remaining == 0))
   {
@@ -3381,7 +3640,7 @@ httpWrite2(http_t     *http,		/* I - HTTP connection */
     */
 
 #ifdef HAVE_LIBZ
-    if (http->coding == _HTTP_CODING_GZIP || http->coding == _HTTP_CODING_DEFLATE)
+    if (http->coding == _HTTP_CODING_GZIP || http->coding == _HTTP_CODING_DEFLATE || http->coding == _HTTP_CODING_ZSTD)
       http_content_coding_finish(http);
 #endif /* HAVE_LIBZ */
 
@@ -3502,7 +3761,9 @@ httpWriteResponse(http_t        *http,	/* I - HTTP connection */
 
   if (!http->fields[HTTP_FIELD_ACCEPT_ENCODING])
     httpSetField(http, HTTP_FIELD_ACCEPT_ENCODING, http->default_fields[HTTP_FIELD_ACCEPT_ENCODING] ? http->default_fields[HTTP_FIELD_ACCEPT_ENCODING] :
-#ifdef HAVE_LIBZ
+#if defined(HAVE_LIBZ) && defined(HAVE_ZSTD)
+                                                 "zstd, gzip, deflate, identity");
+#elif defined(HAVE_LIBZ)
                                                  "gzip, deflate, identity");
 #else
                                                  "identity");
@@ -3798,7 +4059,8 @@ static void
 http_content_coding_finish(
     http_t *http)			/* I - HTTP connection */
 {
-  int		zerr;			/* Compression status */
+  int		i,			/* Looping var */
+		zerr;			/* Compression status */
   Byte		dummy[1];		/* Dummy read buffer */
   size_t	bytes;			/* Number of bytes to write */
 
@@ -3810,30 +4072,52 @@ http_content_coding_finish(
   {
     case _HTTP_CODING_DEFLATE :
     case _HTTP_CODING_GZIP :
-        ((z_stream *)http->stream)->next_in  = dummy;
-        ((z_stream *)http->stream)->avail_in = 0;
+    case _HTTP_CODING_ZSTD :
+        if (http->coding_ctx)
+        {
+          http_content_coding_write(http, NULL, 0, 1);
 
-        do
+#ifdef HAVE_ZSTD
+          if (http->coding == _HTTP_CODING_ZSTD)
+            ZSTD_freeCCtx((ZSTD_CCtx *)http->coding_ctx);
+          else
+#endif /* HAVE_ZSTD */
+          {
+            free(((_http_zpar_t *)http->coding_ctx)->input);
+            for (i = 0; i < ((_http_zpar_t *)http->coding_ctx)->num_blocks; i ++)
+              free(((_http_zpar_t *)http->coding_ctx)->blocks[i].out);
+            free(http->coding_ctx);
+          }
+
+          http->coding_ctx = NULL;
+        }
+        else
         {
-          zerr  = deflate((z_stream *)http->stream, Z_FINISH);
-	  bytes = _HTTP_MAX_SBUFFER - ((z_stream *)http->stream)->avail_out;
+          ((z_stream *)http->stream)->next_in  = dummy;
+          ((z_stream *)http->stream)->avail_in = 0;
 
-          if (bytes > 0)
-	  {
-	    DEBUG_printf(("1http_content_coding_finish: Writing trailing chunk, len=%d", (int)bytes));
+          do
+          {
+            zerr  = deflate((z_stream *)http->stream, Z_FINISH);
+	    bytes = _HTTP_MAX_SBUFFER - ((z_stream *)http->stream)->avail_out;
 
-	    if (http->data_encoding == HTTP_ENCODING_CHUNKED)
-	      http_write_chunk(http, (char *)http->sbuffer, bytes);
-	    else
-	      http_write(http, (char *)http->sbuffer, bytes);
-          }
+            if (bytes > 0)
+	    {
+	      DEBUG_printf(("1http_content_coding_finish: Writing trailing chunk, len=%d", (int)bytes));
 
-          ((z_stream *)http->stream)->next_out  = (Bytef *)http->sbuffer;
-          ((z_stream *)http->stream)->avail_out = (uInt)_HTTP_MAX_SBUFFER;
-	}
-        while (zerr == Z_OK);
+	      if (http->data_encoding == HTTP_ENCODING_CHUNKED)
+	        http_write_chunk(http, (char *)http->sbuffer, bytes);
+	      else
+	        http_write(http, (char *)http->sbuffer, bytes);
+            }
 
-        deflateEnd((z_stream *)http->stream);
+            ((z_stream *)http->stream)->next_out  = (Bytef *)http->sbuffer;
+            ((z_stream *)http->stream)->avail_out = (uInt)_HTTP_MAX_SBUFFER;
+	  }
+          while (zerr == Z_OK);
+
+          deflateEnd((z_stream *)http->stream);
+        }
 
         free(http->sbuffer);
         free(http->stream);
@@ -3847,13 +4131,21 @@ http_content_coding_finish(
 
     case _HTTP_CODING_INFLATE :
     case _HTTP_CODING_GUNZIP :
-        inflateEnd((z_stream *)http->stream);
+    case _HTTP_CODING_UNZSTD :
+#ifdef HAVE_ZSTD
+        if (http->coding == _HTTP_CODING_UNZSTD)
+          ZSTD_freeDCtx((ZSTD_DCtx *)http->coding_ctx);
+        else
+#endif /* HAVE_ZSTD */
+          inflateEnd((z_stream *)http->stream);
 
         free(http->sbuffer);
         free(http->stream);
 
-        http->sbuffer = NULL;
-        http->stream  = NULL;
+        http->sbuffer        = NULL;
+        http->stream         = NULL;
+        http->coding_ctx     = NULL;
+        http->coding_pending = 0;
         break;
 
     default :
@@ -3864,6 +4156,64 @@ http_content_coding_finish(
 }
 
 
+/*
+ * 'http_content_coding_inflate()' - Decompress data from the decompression
+ *                                   buffer.
+ *
+ * The z_stream holds the input and output buffers for every coding, and zlib
+ * status codes are returned for zstd as well.
+ */
+
+static int				/* O - Z_OK, Z_STREAM_END, or error */
+http_content_coding_inflate(
+    http_t *http)			/* I - HTTP connection */
+{
+  z_stream	*stream = (z_stream *)http->stream;
+					/* Decompression buffers */
+
+
+#ifdef HAVE_ZSTD
+  if (http->coding == _HTTP_CODING_UNZSTD)
+  {
+    size_t		zerr;		/* zstd status */
+    ZSTD_inBuffer	in;		/* Input buffer */
+    ZSTD_outBuffer	out;		/* Output buffer */
+
+    in.src   = stream->next_in;
+    in.size  = stream->avail_in;
+    in.pos   = 0;
+    out.dst  = stream->next_out;
+    out.size = stream->avail_out;
+    out.pos  = 0;
+
+    zerr = ZSTD_decompressStream((ZSTD_DCtx *)http->coding_ctx, &out, &in);
+
+    stream->next_in   += in.pos;
+    stream->avail_in  -= (uInt)in.pos;
+    stream->next_out  += out.pos;
+    stream->avail_out -= (uInt)out.pos;
+
+    if (ZSTD_isError(zerr))
+    {
+      DEBUG_printf(("2http_content_coding_inflate: %s", ZSTD_getErrorName(zerr)));
+      return (Z_DATA_ERROR);
+    }
+
+   /*
+    * zstd decodes whole blocks, so a full output buffer may leave more data
+    * in the context after all of the input has been consumed...
+    */
+
+    http->coding_pending = zerr != 0 && out.pos == out.size;
+
+    return (zerr == 0 ? Z_STREAM_END : Z_OK);
+  }
+#endif /* HAVE_ZSTD */
+
+  return (inflate(stream, Z_SYNC_FLUSH));
+}
+
+
 /*
  * 'http_content_coding_start()' - Start doing content encoding.
  */
@@ -3917,6 +4267,24 @@ http_content_coding_start(
       return;
     }
   }
+#ifdef HAVE_ZSTD
+  else if (!strcmp(value, "zstd"))
+  {
+    if (http->state == HTTP_STATE_GET_SEND ||
+        http->state == HTTP_STATE_POST_SEND)
+      coding = http->mode == _HTTP_MODE_SERVER ? _HTTP_CODING_ZSTD :
+                                                 _HTTP_CODING_UNZSTD;
+    else if (http->state == HTTP_STATE_POST_RECV ||
+             http->state == HTTP_STATE_PUT_RECV)
+      coding = http->mode == _HTTP_MODE_CLIENT ? _HTTP_CODING_ZSTD :
+                                                 _HTTP_CODING_UNZSTD;
+    else
+    {
+      DEBUG_puts("1http_content_coding_start: Not doing content coding.");
+      return;
+    }
+  }
+#endif /* HAVE_ZSTD */
   else
   {
     DEBUG_puts("1http_content_coding_start: Not doing content coding.");
@@ -3930,6 +4298,33 @@ http_content_coding_start(
         if (http->wused)
           httpFlushWrite(http);
 
+        if (http->coding_threads > 1)
+        {
+	  _http_zpar_t	*zpar;		/* Parallel deflate state */
+
+         /*
+	  * Compress blocks of input on multiple threads, using the end of the
+	  * previous block as the dictionary so the result is about as small
+	  * as a single stream...
+	  */
+
+          if ((zpar = calloc(1, sizeof(_http_zpar_t))) == NULL || (zpar->input = malloc((size_t)http->coding_threads * _HTTP_MAX_ZBLOCK)) == NULL)
+          {
+            free(zpar);
+
+	    http->status = HTTP_STATUS_ERROR;
+	    http->error  = errno;
+	    return;
+          }
+
+          zpar->gzip       = coding == _HTTP_CODING_GZIP;
+          zpar->insize     = (size_t)http->coding_threads * _HTTP_MAX_ZBLOCK;
+          zpar->crc        = crc32(0L, Z_NULL, 0);
+          zpar->num_blocks = http->coding_threads;
+          http->coding_ctx = zpar;
+          break;
+        }
+
         if ((http->sbuffer = malloc(_HTTP_MAX_SBUFFER)) == NULL)
         {
           http->status = HTTP_STATUS_ERROR;
@@ -3969,8 +4364,41 @@ http_content_coding_start(
 	((z_stream *)http->stream)->avail_out = (uInt)_HTTP_MAX_SBUFFER;
         break;
 
+#ifdef HAVE_ZSTD
+    case _HTTP_CODING_ZSTD :
+        if (http->wused)
+          httpFlushWrite(http);
+
+        if ((http->sbuffer = malloc(_HTTP_MAX_SBUFFER)) == NULL)
+        {
+          http->status = HTTP_STATUS_ERROR;
+          http->error  = errno;
+          return;
+        }
+
+        if ((http->coding_ctx = ZSTD_createCCtx()) == NULL)
+        {
+          free(http->sbuffer);
+
+          http->sbuffer = NULL;
+          http->status  = HTTP_STATUS_ERROR;
+          http->error   = ENOMEM;
+          return;
+        }
+
+       /*
+        * Let libzstd compress on worker threads when asked - this is silently
+        * ignored when libzstd was built without threading support...
+        */
+
+        if (http->coding_threads > 1)
+          ZSTD_CCtx_setParameter((ZSTD_CCtx *)http->coding_ctx, ZSTD_c_nbWorkers, http->coding_threads);
+        break;
+#endif /* HAVE_ZSTD */
+
     case _HTTP_CODING_INFLATE :
     case _HTTP_CODING_GUNZIP :
+    case _HTTP_CODING_UNZSTD :
         if ((http->sbuffer = malloc(_HTTP_MAX_SBUFFER)) == NULL)
         {
           http->status = HTTP_STATUS_ERROR;
@@ -3993,6 +4421,27 @@ http_content_coding_start(
           return;
 	}
 
+#ifdef HAVE_ZSTD
+        if (coding == _HTTP_CODING_UNZSTD)
+        {
+         /*
+          * The z_stream only tracks the buffered input for zstd...
+          */
+
+          if ((http->coding_ctx = ZSTD_createDCtx()) == NULL)
+          {
+            free(http->sbuffer);
+            free(http->stream);
+
+            http->sbuffer = NULL;
+            http->stream  = NULL;
+            http->status  = HTTP_STATUS_ERROR;
+            http->error   = ENOMEM;
+            return;
+          }
+        }
+        else
+#endif /* HAVE_ZSTD */
         if ((zerr = inflateInit2((z_stream *)http->stream, coding == _HTTP_CODING_INFLATE ? -15 : 31)) < Z_OK)
         {
           free(http->sbuffer);
@@ -4018,6 +4467,100 @@ http_content_coding_start(
   DEBUG_printf(("1http_content_coding_start: http->coding now %d.",
 		http->coding));
 }
+
+
+/*
+ * 'http_content_coding_write()' - Compress and write data with zstd or
+ *                                 parallel deflate.
+ *
+ * Pass a @code NULL@ buffer and a non-zero "finish" value to write any
+ * buffered data and end the compressed stream.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+http_content_coding_write(
+    http_t     *http,			/* I - HTTP connection */
+    const char *buffer,			/* I - Data to compress */
+    size_t     length,			/* I - Length of data */
+    int        finish)			/* I - Finish the stream? */
+{
+  _http_zpar_t	*zpar;			/* Parallel deflate state */
+  size_t	bytes;			/* Bytes to copy */
+
+
+#ifdef HAVE_ZSTD
+  if (http->coding == _HTTP_CODING_ZSTD)
+  {
+    size_t		zerr;		/* zstd status */
+    ssize_t		sret;		/* Bytes written */
+    ZSTD_inBuffer	in;		/* Input buffer */
+    ZSTD_outBuffer	out;		/* Output buffer */
+
+    in.src  = buffer;
+    in.size = length;
+    in.pos  = 0;
+
+    do
+    {
+      out.dst  = http->sbuffer;
+      out.size = _HTTP_MAX_SBUFFER;
+      out.pos  = 0;
+
+      zerr = ZSTD_compressStream2((ZSTD_CCtx *)http->coding_ctx, &out, &in, finish ? ZSTD_e_end : ZSTD_e_continue);
+
+      if (ZSTD_isError(zerr))
+      {
+        DEBUG_printf(("2http_content_coding_write: %s", ZSTD_getErrorName(zerr)));
+        http->error = EIO;
+        return (-1);
+      }
+
+      if (out.pos > 0)
+      {
+        DEBUG_printf(("2http_content_coding_write: Writing chunk, len=%d", (int)out.pos));
+
+	if (http->data_encoding == HTTP_ENCODING_CHUNKED)
+	  sret = http_write_chunk(http, (char *)http->sbuffer, out.pos);
+	else
+	  sret = http_write(http, (char *)http->sbuffer, out.pos);
+
+        if (sret < 0)
+          return (-1);
+      }
+    }
+    while (finish ? zerr > 0 : in.pos < in.size);
+
+    return (0);
+  }
+#endif /* HAVE_ZSTD */
+
+ /*
+  * Parallel deflate - fill the input buffer and compress it as a batch of
+  * blocks whenever it is full...
+  */
+
+  zpar = (_http_zpar_t *)http->coding_ctx;
+
+  while (length > 0)
+  {
+    if ((bytes = zpar->insize - zpar->inused) > length)
+      bytes = length;
+
+    memcpy(zpar->input + zpar->inused, buffer, bytes);
+
+    zpar->inused += bytes;
+    buffer       += bytes;
+    length       -= bytes;
+
+    if (zpar->inused == zpar->insize && http_deflate_batch(http, 0) < 0)
+      return (-1);
+  }
+
+  if (finish)
+    return (http_deflate_batch(http, 1));
+
+  return (0);
+}
 #endif /* HAVE_LIBZ */
 
 
@@ -4091,6 +4634,11 @@ http_create(
 #endif /* HAVE_GSSAPI */
   http->status   = HTTP_STATUS_CONTINUE;
   http->version  = HTTP_VERSION_1_1;
+  http->inbuf    = http->buffer;
+  http->inptr    = http->buffer;
+  http->insize   = sizeof(http->buffer);
+  http->outbuf   = http->wbuffer;
+  http->outsize  = sizeof(http->wbuffer);
 
   if (host)
     strlcpy(http->hostname, host, sizeof(http->hostname));
@@ -4228,6 +4776,277 @@ static void cupsDumpHex(const char* leader, const char* base, size_t len)
   }
 }
 
+
+#ifdef HAVE_LIBZ
+/*
+ * 'http_deflate_batch()' - Compress and write a batch of parallel deflate
+ *                          blocks.
+ *
+ * Each block is compressed on its own thread as a separate raw deflate
+ * stream that ends on a byte boundary, so the blocks can simply be written
+ * in order.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+http_deflate_batch(http_t *http,	/* I - HTTP connection */
+                   int    last)		/* I - Last batch in stream? */
+{
+  _http_zpar_t	*zpar = (_http_zpar_t *)http->coding_ctx;
+					/* Parallel deflate state */
+  _http_zblock_t *block;		/* Current block */
+  _cups_thread_t threads[_HTTP_MAX_ZTHREADS];
+					/* Compression threads */
+  int		i,			/* Looping var */
+		count,			/* Number of blocks */
+		num_pieces;		/* Number of pieces to write */
+  size_t	offset;			/* Offset in input buffer */
+  ssize_t	sret;			/* Bytes written */
+  struct iovec	pieces[_HTTP_MAX_ZTHREADS + 2];
+					/* Header, blocks, and trailer */
+  unsigned char	trailer[8];		/* gzip trailer */
+  static const unsigned char header[10] =
+  {					/* gzip header */
+    0x1f, 0x8b, Z_DEFLATED, 0, 0, 0, 0, 0, 0, 3
+  };
+
+
+  DEBUG_printf(("3http_deflate_batch(http=%p, last=%d) inused=" CUPS_LLFMT, (void *)http, last, CUPS_LLCAST zpar->inused));
+
+ /*
+  * Split the input into blocks, using the end of the previous block as the
+  * dictionary for each one...
+  */
+
+  if ((count = (int)((zpar->inused + _HTTP_MAX_ZBLOCK - 1) / _HTTP_MAX_ZBLOCK)) == 0)
+    count = 1;
+
+  for (i = 0, offset = 0, block = zpar->blocks; i < count; i ++, block ++, offset += _HTTP_MAX_ZBLOCK)
+  {
+    block->data    = zpar->input + offset;
+    block->datalen = zpar->inused - offset;
+    block->last    = last && i == (count - 1);
+
+    if (block->datalen > _HTTP_MAX_ZBLOCK)
+      block->datalen = _HTTP_MAX_ZBLOCK;
+
+    if (i == 0)
+    {
+      block->dict    = zpar->dict;
+      block->dictlen = zpar->dictlen;
+    }
+    else
+    {
+      block->dict    = block->data - sizeof(zpar->dict);
+      block->dictlen = sizeof(zpar->dict);
+    }
+  }
+
+  for (i = 1; i < count; i ++)
+    threads[i] = _cupsThreadCreate((_cups_thread_func_t)http_deflate_block, zpar->blocks + i);
+
+  http_deflate_block(zpar->blocks);
+
+  for (i = 1; i < count; i ++)
+  {
+    if (threads[i])
+      _cupsThreadWait(threads[i]);
+    else
+      http_deflate_block(zpar->blocks + i);
+  }
+
+ /*
+  * Write the compressed blocks in order...
+  */
+
+  num_pieces = 0;
+
+  if (zpar->gzip && !zpar->header)
+  {
+    pieces[num_pieces].iov_base = (void *)header;
+    pieces[num_pieces].iov_len  = sizeof(header);
+    num_pieces ++;
+
+    zpar->header = 1;
+  }
+
+  for (i = 0, block = zpar->blocks; i < count; i ++, block ++)
+  {
+    if (block->status)
+    {
+      DEBUG_printf(("4http_deflate_batch: Unable to compress block %d.", i));
+      http->error = EIO;
+      return (-1);
+    }
+
+    pieces[num_pieces].iov_base = block->out;
+    pieces[num_pieces].iov_len  = block->outlen;
+    num_pieces ++;
+
+    zpar->crc   = crc32_combine(zpar->crc, block->crc, (z_off_t)block->datalen);
+    zpar->total += (uLong)block->datalen;
+  }
+
+  if (last && zpar->gzip)
+  {
+    trailer[0] = (unsigned char)zpar->crc;
+    trailer[1] = (unsigned char)(zpar->crc >> 8);
+    trailer[2] = (unsigned char)(zpar->crc >> 16);
+    trailer[3] = (unsigned char)(zpar->crc >> 24);
+    trailer[4] = (unsigned char)zpar->total;
+    trailer[5] = (unsigned char)(zpar->total >> 8);
+    trailer[6] = (unsigned char)(zpar->total >> 16);
+    trailer[7] = (unsigned char)(zpar->total >> 24);
+
+    pieces[num_pieces].iov_base = trailer;
+    pieces[num_pieces].iov_len  = sizeof(trailer);
+    num_pieces ++;
+  }
+
+  for (i = 0; i < num_pieces; i ++)
+  {
+    if (pieces[i].iov_len == 0)
+      continue;
+
+    DEBUG_printf(("4http_deflate_batch: Writing chunk, len=%d", (int)pieces[i].iov_len));
+
+    if (http->data_encoding == HTTP_ENCODING_CHUNKED)
+      sret = http_write_chunk(http, (char *)pieces[i].iov_base, pieces[i].iov_len);
+    else
+      sret = http_write(http, (char *)pieces[i].iov_base, pieces[i].iov_len);
+
+    if (sret < 0)
+      return (-1);
+  }
+
+ /*
+  * Save the end of this batch as the dictionary for the next one...
+  */
+
+  if (zpar->inused >= sizeof(zpar->dict))
+  {
+    memcpy(zpar->dict, zpar->input + zpar->inused - sizeof(zpar->dict), sizeof(zpar->dict));
+    zpar->dictlen = sizeof(zpar->dict);
+  }
+
+  zpar->inused = 0;
+
+  return (0);
+}
+
+
+/*
+ * 'http_deflate_block()' - Compress a single parallel deflate block.
+ */
+
+static void *				/* O - Thread exit status (unused) */
+http_deflate_block(
+    _http_zblock_t *block)		/* I - Block to compress */
+{
+  z_stream	stream;			/* Compression stream */
+  size_t	bound;			/* Maximum compressed size */
+  int		zerr;			/* Compression status */
+
+
+  block->status = -1;
+  block->outlen = 0;
+
+  memset(&stream, 0, sizeof(stream));
+
+ /*
+  * Use the same 11-bit window as a single stream; -11 is raw deflate...
+  */
+
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -11, 7, Z_DEFAULT_STRATEGY) < Z_OK)
+    return (NULL);
+
+  if (block->dictlen > 0)
+    deflateSetDictionary(&stream, block->dict, (uInt)block->dictlen);
+
+ /*
+  * A sync flush adds an empty stored block after the data...
+  */
+
+  bound = deflateBound(&stream, (uLong)block->datalen) + 16;
+
+  if (bound > block->outsize)
+  {
+    unsigned char *out;			/* New output buffer */
+
+    if ((out = realloc(block->out, bound)) == NULL)
+    {
+      deflateEnd(&stream);
+      return (NULL);
+    }
+
+    block->out     = out;
+    block->outsize = bound;
+  }
+
+  stream.next_in   = (Bytef *)block->data;
+  stream.avail_in  = (uInt)block->datalen;
+  stream.next_out  = block->out;
+  stream.avail_out = (uInt)block->outsize;
+
+  zerr = deflate(&stream, block->last ? Z_FINISH : Z_SYNC_FLUSH);
+
+  if ((block->last && zerr == Z_STREAM_END) || (!block->last && zerr == Z_OK && stream.avail_in == 0))
+  {
+    block->outlen = block->outsize - stream.avail_out;
+    block->crc    = crc32(0L, block->data, (uInt)block->datalen);
+    block->status = 0;
+  }
+
+  deflateEnd(&stream);
+
+  return (NULL);
+}
+#endif /* HAVE_LIBZ */
+
+
+/*
+ * 'http_get_line()' - Get a line from the input buffer without copying it.
+ *
+ * The line is nul-terminated in place and removed from the buffer.  @code NULL@
+ * is returned when the buffer does not hold a complete line, so the caller
+ * must fall back to @link httpGets@.
+ */
+
+static char *				/* O - Line or @code NULL@ */
+http_get_line(http_t *http,		/* I - HTTP connection */
+              size_t maxlen)		/* I - Maximum length of line */
+{
+  char	*line = http->inptr,		/* Start of line */
+	*eol,				/* End of line */
+	*cr;				/* Carriage return, if any */
+
+
+  if (http->used <= 0 || (eol = memchr(line, '\n', (size_t)http->used)) == NULL || (size_t)(eol - line) > maxlen)
+    return (NULL);
+
+ /*
+  * httpGets drops carriage returns anywhere in the line, so only handle the
+  * usual CR LF and LF line endings here...
+  */
+
+  if ((cr = memchr(line, '\r', (size_t)(eol - line))) != NULL)
+  {
+    if (cr != (eol - 1))
+      return (NULL);
+
+    *cr = '\0';
+  }
+  else
+    *eol = '\0';
+
+  http->used     -= (int)(eol + 1 - line);
+  http->inptr    = eol + 1;
+  http->error    = 0;
+  http->activity = time(NULL);
+
+  return (line);
+}
+
+
 /*
  * 'http_read()' - Read a buffer from a HTTP connection.
  *
@@ -4380,11 +5199,9 @@ http_read_buffered(http_t *http,	/* I - HTTP connection */
     DEBUG_printf(("2http_read: Grabbing %d bytes from input buffer.",
                   (int)bytes));
 
-    memcpy(buffer, http->buffer, (size_t)bytes);
-    http->used -= (int)bytes;
-
-    if (http->used > 0)
-      memmove(http->buffer, http->buffer + bytes, (size_t)http->used);
+    memcpy(buffer, http->inptr, (size_t)bytes);
+    http->used  -= (int)bytes;
+    http->inptr += bytes;
   }
   else
     bytes = http_read(http, buffer, length);
@@ -4999,6 +5816,60 @@ http_write(http_t     *http,		/* I - HTTP connection */
 }
 
 
+/*
+ * 'http_write_buffered()' - Write the buffered data followed by new data.
+ *
+ * Both are sent with a single http_writev() call, as one chunk when using
+ * chunked encoding.
+ */
+
+static ssize_t				/* O - Number of new bytes written or -1 on error */
+http_write_buffered(http_t     *http,	/* I - HTTP connection */
+                    const char *buffer,	/* I - New data */
+		    size_t     length)	/* I - Length of new data */
+{
+  char		header[16];		/* Chunk header */
+  struct iovec	iov[4];			/* Chunk header, data, and trailer */
+  int		iovcnt = 0;		/* Number of buffers */
+  size_t	wused = (size_t)http->wused;
+					/* Number of buffered bytes */
+
+
+  DEBUG_printf(("7http_write_buffered(http=%p, buffer=%p, length=" CUPS_LLFMT ") wused=%d", (void *)http, (void *)buffer, CUPS_LLCAST length, http->wused));
+
+  http->wused = 0;
+
+  if (http->data_encoding == HTTP_ENCODING_CHUNKED)
+  {
+    snprintf(header, sizeof(header), "%x\r\n", (unsigned)(wused + length));
+
+    iov[iovcnt].iov_base = header;
+    iov[iovcnt].iov_len  = strlen(header);
+    iovcnt ++;
+  }
+
+  iov[iovcnt].iov_base = http->outbuf;
+  iov[iovcnt].iov_len  = wused;
+  iovcnt ++;
+
+  iov[iovcnt].iov_base = (void *)buffer;
+  iov[iovcnt].iov_len  = length;
+  iovcnt ++;
+
+  if (http->data_encoding == HTTP_ENCODING_CHUNKED)
+  {
+    iov[iovcnt].iov_base = (void *)"\r\n";
+    iov[iovcnt].iov_len  = 2;
+    iovcnt ++;
+  }
+
+  if (http_writev(http, iov, iovcnt) < 0)
+    return (-1);
+
+  return ((ssize_t)length);
+}
+
+
 /*
  * 'http_write_chunk()' - Write a chunked buffer.
  */
@@ -5009,7 +5880,7 @@ http_write_chunk(http_t     *http,	/* I - HTTP connection */
 		 size_t        length)	/* I - Length of buffer */
 {
   char		header[16];		/* Chunk header */
-  ssize_t	bytes;			/* Bytes written */
+  struct iovec	iov[3];			/* Chunk header, data, and trailer */
 
 
   DEBUG_printf(("7http_write_chunk(http=%p, buffer=%p, length=" CUPS_LLFMT ")", (void *)http, (void *)buffer, CUPS_LLCAST length));
@@ -5019,25 +5890,85 @@ http_write_chunk(http_t     *http,	/* I - HTTP connection */
   */
 
   snprintf(header, sizeof(header), "%x\r\n", (unsigned)length);
-  if (http_write(http, header, strlen(header)) < 0)
+
+  iov[0].iov_base = header;
+  iov[0].iov_len  = strlen(header);
+  iov[1].iov_base = (void *)buffer;
+  iov[1].iov_len  = length;
+  iov[2].iov_base = (void *)"\r\n";
+  iov[2].iov_len  = 2;
+
+  if (http_writev(http, iov, 3) < 0)
   {
-    DEBUG_puts("8http_write_chunk: http_write of length failed.");
+    DEBUG_puts("8http_write_chunk: http_writev failed.");
     return (-1);
   }
 
-  if ((bytes = http_write(http, buffer, length)) < 0)
+  return ((ssize_t)length);
+}
+
+
+/*
+ * 'http_writev()' - Write several buffers to a HTTP connection.
+ *
+ * Plain sockets get a single non-blocking sendmsg() call for all of the
+ * buffers; anything it doesn't send (and all TLS data) goes through
+ * http_write(), which handles timeouts and errors.
+ */
+
+static ssize_t				/* O - Number of bytes written or -1 on error */
+http_writev(http_t       *http,		/* I - HTTP connection */
+            struct iovec *iov,		/* I - Buffers to write */
+	    int          iovcnt)	/* I - Number of buffers */
+{
+  int		i;			/* Looping var */
+  size_t	total;			/* Total bytes to write */
+  ssize_t	bytes = 0;		/* Bytes sent by sendmsg() */
+
+
+  if (iovcnt <= 0)
+    return (0);
+
+  for (i = 0, total = 0; i < iovcnt; i ++)
+    total += iov[i].iov_len;
+
+#if !defined(_WIN32) && defined(MSG_DONTWAIT)
+  if (!http->tls && !getenv("CUPS_HTTP_TRACE")
+#  if __BLOCKS__
+      && !http->_telemetryCallbacks
+#  endif /* __BLOCKS__ */
+      )
   {
-    DEBUG_puts("8http_write_chunk: http_write of buffer failed.");
-    return (-1);
+    struct msghdr	msg;		/* Message to send */
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov    = iov;
+    msg.msg_iovlen = (size_t)iovcnt;
+
+    while ((bytes = sendmsg(http->fd, &msg, MSG_DONTWAIT)) < 0 && errno == EINTR);
+
+    DEBUG_printf(("3http_writev: sendmsg of " CUPS_LLFMT " bytes returned " CUPS_LLFMT ".", CUPS_LLCAST total, CUPS_LLCAST bytes));
+
+    if (bytes < 0)
+      bytes = 0;			/* Let http_write() wait or report the error */
   }
+#endif /* !_WIN32 && MSG_DONTWAIT */
 
-  if (http_write(http, "\r\n", 2) < 0)
+  for (i = 0; i < iovcnt; i ++)
   {
-    DEBUG_puts("8http_write_chunk: http_write of CR LF failed.");
-    return (-1);
+    if ((size_t)bytes >= iov[i].iov_len)
+    {
+      bytes -= (ssize_t)iov[i].iov_len;
+      continue;
+    }
+
+    if (http_write(http, (char *)iov[i].iov_base + bytes, iov[i].iov_len - (size_t)bytes) < 0)
+      return (-1);
+
+    bytes = 0;
   }
 
-  return (bytes);
+  return ((ssize_t)total);
 }
 
 #if __BLOCKS__
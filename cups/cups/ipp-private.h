@@ -33,6 +33,11 @@ extern "C" {
 
 #  define IPP_BUF_SIZE	(IPP_MAX_LENGTH + 2)
 					/* Size of buffer */
+#  define _IPP_TAG_ENCODED	(ipp_tag_t)0x7ffffffe
+					/* Value tag for pre-encoded attributes */
+#  define IPP_INDEX_MIN	32		/* Minimum attributes for name index */
+#  define IPP_ARENA_MIN	4096		/* Size of first arena chunk */
+#  define IPP_ARENA_MAX	65536		/* Maximum size of arena chunks */
 
 
 /*
@@ -115,9 +120,25 @@ struct _ipp_attribute_s			/**** IPP attribute ****/
 		value_tag;		/* What type of value is it? */
   char		*name;			/* Name of attribute */
   int		num_values;		/* Number of values */
+  int		arena;			/* Allocated from message arena? */
   _ipp_value_t	values[1];		/* Values */
 };
 
+typedef struct _ipp_arena_s		/**** Message memory arena chunk ****/
+{
+  struct _ipp_arena_s	*next;		/* Next (older) chunk */
+  size_t		used,		/* Bytes used */
+			size;		/* Bytes available */
+  _ipp_value_t		data[1];	/* Start of chunk memory */
+} _ipp_arena_t;
+
+typedef struct _ipp_index_s		/**** Attribute name index ****/
+{
+  size_t		size,		/* Number of slots (power of 2) */
+			used;		/* Number of used and deleted slots */
+  ipp_attribute_t	**slots;	/* Attributes in list order by name hash */
+} _ipp_index_t;
+
 struct _ipp_s				/**** IPP Request/Response/Notification ****/
 {
   ipp_state_t		state;		/* State of request */
@@ -135,6 +156,14 @@ struct _ipp_s				/**** IPP Request/Response/Notification ****/
 /**** New in CUPS 2.0 ****/
   int			atend,		/* At end of list? */
 			curindex;	/* Current attribute index for hierarchical search */
+/**** Private ****/
+  _ipp_index_t		*index;		/* Attribute name index, if any */
+  _ipp_arena_t		*arena;		/* Memory arena, if any */
+  ipp_attribute_t	*stream_group,	/* First attribute of current group for streamed reads */
+			*stream_last,	/* Last attribute returned for streamed reads */
+			*stream_current,/* Attribute being read for streamed reads */
+			*stream_prev;	/* Attribute before it for streamed reads */
+  int			stream_more;	/* More attributes follow for streamed writes? */
 };
 
 typedef struct _ipp_option_s		/**** Attribute mapping data ****/
@@ -196,6 +225,15 @@ extern const char	*_ippCheckOptions(void) _CUPS_PRIVATE;
 #endif /* DEBUG */
 extern _ipp_option_t	*_ippFindOption(const char *name) _CUPS_PRIVATE;
 
+/* ipp.c */
+extern ipp_attribute_t	*_ippAddEncoded(ipp_t *ipp, ipp_tag_t group, const void *data, size_t datalen) _CUPS_PRIVATE;
+extern void		*_ippEncodeAttributes(ipp_t *ipp, size_t *datalen) _CUPS_PRIVATE;
+extern ipp_t		*_ippNewArena(void) _CUPS_PRIVATE;
+extern ipp_attribute_t	*_ippReadAttribute(http_t *http, ipp_t *ipp) _CUPS_PRIVATE;
+extern ipp_attribute_t	*_ippReadAttributeIO(void *src, ipp_iocb_t cb, ipp_t *ipp) _CUPS_PRIVATE;
+extern void		_ippResetIndex(ipp_t *ipp) _CUPS_PRIVATE;
+extern ipp_state_t	_ippWriteAttributes(void *dst, ipp_iocb_t cb, ipp_t *ipp, int more) _CUPS_PRIVATE;
+
 /* ipp-file.c */
 extern ipp_t		*_ippFileParse(_ipp_vars_t *v, const char *filename, void *user_data) _CUPS_PRIVATE;
 extern int		_ippFileReadToken(_ipp_file_t *f, char *token, size_t tokensize) _CUPS_PRIVATE;
@@ -20,6 +20,26 @@
 #endif /* _WIN32 */
 
 
+/*
+ * Local types...
+ */
+
+typedef struct _ipp_encode_s		/**** Encoding buffer ****/
+{
+  ipp_uchar_t	*data;			/* Encoded data */
+  size_t	length,			/* Bytes written */
+		size;			/* Size of buffer */
+} _ipp_encode_t;
+
+
+/*
+ * Local globals...
+ */
+
+static ipp_attribute_t	ipp_index_deleted;
+					/* Deleted index slot marker */
+
+
 /*
  * Local functions...
  */
@@ -27,9 +47,19 @@
 static ipp_attribute_t	*ipp_add_attr(ipp_t *ipp, const char *name,
 			              ipp_tag_t  group_tag, ipp_tag_t value_tag,
 			              int num_values);
-static void		ipp_free_values(ipp_attribute_t *attr, int element,
-			                int count);
+static void		*ipp_arena_alloc(ipp_t *ipp, size_t size);
+static int		ipp_arena_owns(ipp_t *ipp, const char *s);
+static void		ipp_free_values(ipp_t *ipp, ipp_attribute_t *attr,
+			                int element, int count);
 static char		*ipp_get_code(const char *locale, char *buffer, size_t bufsize) _CUPS_NONNULL(1,2);
+static void		ipp_index_add(ipp_t *ipp, ipp_attribute_t *attr);
+static void		ipp_index_build(ipp_t *ipp);
+static void		ipp_index_delete(ipp_t *ipp, ipp_attribute_t *attr);
+static ipp_attribute_t	*ipp_index_find(ipp_t *ipp, const char *name,
+			                ipp_tag_t type);
+static size_t		ipp_index_hash(const char *name);
+static void		ipp_index_replace(ipp_t *ipp, ipp_attribute_t *oldattr,
+			                  ipp_attribute_t *newattr);
 static char		*ipp_lang_code(const char *locale, char *buffer, size_t bufsize) _CUPS_NONNULL(1,2);
 static size_t		ipp_length(ipp_t *ipp, int collection);
 static ssize_t		ipp_read_http(http_t *http, ipp_uchar_t *buffer,
@@ -41,6 +71,12 @@ static void		ipp_set_error(ipp_status_t status, const char *format,
 			              ...);
 static _ipp_value_t	*ipp_set_value(ipp_t *ipp, ipp_attribute_t **attr,
 			               int element);
+static char		*ipp_strdup(ipp_t *ipp, ipp_attribute_t *attr,
+			            const char *s);
+static void		ipp_strfree(ipp_t *ipp, ipp_attribute_t *attr,
+			            char *s);
+static ssize_t		ipp_write_encode(_ipp_encode_t *enc,
+			                 ipp_uchar_t *buffer, size_t length);
 static ssize_t		ipp_write_file(int *fd, ipp_uchar_t *buffer,
 			               size_t length);
 
@@ -96,6 +132,322 @@ _cupsBufferRelease(char *b)		/* I - Buffer to release */
 }
 
 
+/*
+ * '_ippAddEncoded()' - Add pre-encoded attributes to an IPP message.
+ *
+ * The data comes from @link _ippEncodeAttributes@ and is written as-is by
+ * @link ippWrite@ in the specified group.  The returned attribute has no name
+ * and cannot be found with @link ippFindAttribute@.
+ */
+
+ipp_attribute_t *			/* O - New attribute */
+_ippAddEncoded(ipp_t      *ipp,		/* I - IPP message */
+               ipp_tag_t  group,	/* I - IPP group */
+	       const void *data,	/* I - Encoded attributes */
+	       size_t     datalen)	/* I - Length of encoded attributes */
+{
+  ipp_attribute_t	*attr;		/* New attribute */
+
+
+  DEBUG_printf(("_ippAddEncoded(ipp=%p, group=%02x(%s), data=%p, datalen=" CUPS_LLFMT ")", (void *)ipp, group, ippTagString(group), data, CUPS_LLCAST datalen));
+
+  if (!ipp || group <= IPP_TAG_ZERO || group == IPP_TAG_END || group >= IPP_TAG_UNSUPPORTED_VALUE || !data || datalen == 0 || datalen > INT_MAX)
+    return (NULL);
+
+  if ((attr = ipp_add_attr(ipp, NULL, group, _IPP_TAG_ENCODED, 1)) == NULL)
+    return (NULL);
+
+  if ((attr->values[0].unknown.data = malloc(datalen)) == NULL)
+  {
+    ippDeleteAttribute(ipp, attr);
+    return (NULL);
+  }
+
+  memcpy(attr->values[0].unknown.data, data, datalen);
+  attr->values[0].unknown.length = (int)datalen;
+
+  return (attr);
+}
+
+
+/*
+ * '_ippEncodeAttributes()' - Encode the attributes in an IPP message.
+ *
+ * All of the attributes must be in the same group.  The returned buffer holds
+ * the attributes without the message header, group tag, or end tag, and must
+ * be freed using free().
+ */
+
+void *					/* O - Encoded attributes or @code NULL@ */
+_ippEncodeAttributes(ipp_t  *ipp,	/* I - IPP message */
+                     size_t *datalen)	/* O - Length of encoded attributes */
+{
+  ipp_attribute_t	*attr;		/* Current attribute */
+  _ipp_encode_t		enc;		/* Encoding buffer */
+  ipp_state_t		state;		/* Write state */
+
+
+  *datalen = 0;
+
+  if (!ipp || !ipp->attrs)
+    return (NULL);
+
+  for (attr = ipp->attrs; attr; attr = attr->next)
+    if (!attr->name || attr->group_tag != ipp->attrs->group_tag || attr->group_tag == IPP_TAG_ZERO)
+      return (NULL);
+
+ /*
+  * Write the message to memory, with 8 bytes of header, 1 group tag, and 1
+  * end tag...
+  */
+
+  enc.size   = ippLength(ipp);
+  enc.length = 0;
+
+  if (enc.size <= 10 || (enc.data = malloc(enc.size)) == NULL)
+    return (NULL);
+
+  ipp->state = IPP_STATE_IDLE;
+
+  while ((state = ippWriteIO(&enc, (ipp_iocb_t)ipp_write_encode, 1, NULL, ipp)) != IPP_STATE_DATA)
+    if (state == IPP_STATE_ERROR)
+      break;
+
+  ipp->state = IPP_STATE_IDLE;
+
+  if (state != IPP_STATE_DATA || enc.length != enc.size)
+  {
+    free(enc.data);
+    return (NULL);
+  }
+
+  *datalen = enc.size - 10;
+
+  memmove(enc.data, enc.data + 9, *datalen);
+
+  return (enc.data);
+}
+
+
+/*
+ * '_ippNewArena()' - Allocate a new IPP message using a memory arena.
+ *
+ * Attributes, values, and strings added to the message are allocated from
+ * large chunks of memory that are freed all at once by @link ippDelete@.
+ * Memory is not reclaimed when attributes or values are deleted, so this is
+ * best suited for messages that are read once and mostly left alone, such as
+ * requests.  Strings that grow with @link ippSetString@ are moved to the
+ * string pool so repeated updates don't keep consuming arena memory.
+ */
+
+ipp_t *					/* O - New IPP message */
+_ippNewArena(void)
+{
+  ipp_t		*ipp;			/* New IPP message */
+
+
+  if ((ipp = ippNew()) == NULL)
+    return (NULL);
+
+  if ((ipp->arena = calloc(1, sizeof(_ipp_arena_t) - sizeof(_ipp_value_t) + IPP_ARENA_MIN)) == NULL)
+  {
+    ippDelete(ipp);
+    return (NULL);
+  }
+
+  ipp->arena->size = IPP_ARENA_MIN;
+
+  return (ipp);
+}
+
+
+/*
+ * '_ippReadAttribute()' - Read the next attribute of an IPP message from a HTTP
+ *                         connection.
+ *
+ * See @code _ippReadAttributeIO@ for details.
+ */
+
+ipp_attribute_t *			/* O - Attribute or @code NULL@ at end */
+_ippReadAttribute(http_t *http,		/* I - HTTP connection */
+                  ipp_t  *ipp)		/* I - IPP message */
+{
+  if (!http)
+    return (NULL);
+
+  return (_ippReadAttributeIO(http, (ipp_iocb_t)ipp_read_http, ipp));
+}
+
+
+/*
+ * '_ippReadAttributeIO()' - Read the next attribute of an IPP message.
+ *
+ * Attributes are returned one at a time as they are read, with separators
+ * (attributes without a name) between groups of the same type.  Each group of
+ * attributes stays in the message until the group after it has started and
+ * @code _ippReadAttributeIO@ is called again, so attributes from the current
+ * and previous group can be used while the rest of the message is read.  This
+ * keeps memory use bounded by the largest group rather than the whole message.
+ *
+ * @code NULL@ is returned at the end of the message, in which case
+ * @link ippGetState@ returns @code IPP_STATE_DATA@, or on error, in which case
+ * @link ippGetState@ returns @code IPP_STATE_ERROR@ and @link cupsLastError@
+ * is set.
+ */
+
+ipp_attribute_t *			/* O - Attribute or @code NULL@ at end */
+_ippReadAttributeIO(void       *src,	/* I - Data source */
+                    ipp_iocb_t cb,	/* I - Read callback function */
+		    ipp_t      *ipp)	/* I - IPP message */
+{
+  ipp_attribute_t	*attr,		/* Next attribute */
+			*last;		/* Last attribute returned */
+
+
+  if (!src || !cb || !ipp || ipp->state == IPP_STATE_ERROR)
+    return (NULL);
+
+ /*
+  * Read until the attribute after the last one we returned is complete...
+  */
+
+  for (;;)
+  {
+    last = ipp->stream_last;
+    attr = last ? last->next : ipp->attrs;
+
+    if (attr && (attr != ipp->stream_current || ipp->state == IPP_STATE_DATA))
+      break;
+    else if (ipp->state == IPP_STATE_DATA)
+      return (NULL);
+
+   /*
+    * ippReadIO adds extra values to ipp->current and relinks it through
+    * ipp->prev when it grows, but the find and iteration APIs also change
+    * them, so keep our own copies between reads...
+    */
+
+    ipp->current = ipp->stream_current;
+    ipp->prev    = ipp->stream_prev;
+
+    if (ippReadIO(src, cb, 0, NULL, ipp) == IPP_STATE_ERROR)
+    {
+      if (cupsLastError() <= IPP_STATUS_OK_CONFLICTING)
+        _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(EIO), 0);
+
+      ipp->state = IPP_STATE_ERROR;
+      return (NULL);
+    }
+
+    ipp->stream_current = ipp->current;
+    ipp->stream_prev    = ipp->prev;
+  }
+
+ /*
+  * If this attribute starts a new group, free the group before the one that
+  * just ended...
+  */
+
+  if (!ipp->stream_group)
+    ipp->stream_group = attr;
+  else if (attr->group_tag == IPP_TAG_ZERO || (last->group_tag != IPP_TAG_ZERO && last->group_tag != attr->group_tag))
+  {
+    ipp_attribute_t	*temp;		/* Attribute to free */
+
+    while ((temp = ipp->attrs) != NULL && temp != ipp->stream_group)
+    {
+      if (ipp->prev == temp)
+        ipp->prev = NULL;
+      if (ipp->stream_prev == temp)
+        ipp->stream_prev = NULL;
+
+      ippDeleteAttribute(ipp, temp);
+    }
+
+    ipp->stream_group = attr;
+  }
+
+  return (ipp->stream_last = attr);
+}
+
+
+/*
+ * '_ippResetIndex()' - Discard the attribute name index of an IPP message.
+ *
+ * This must be called after changing the attribute list of a message directly
+ * instead of using the IPP API.  The index is rebuilt as needed.
+ */
+
+void
+_ippResetIndex(ipp_t *ipp)		/* I - IPP message */
+{
+  if (ipp && ipp->index)
+  {
+    free(ipp->index->slots);
+    free(ipp->index);
+    ipp->index = NULL;
+  }
+}
+
+
+/*
+ * '_ippWriteAttributes()' - Write the attributes added to an IPP message so far.
+ *
+ * The message header is written on the first call, followed by any attributes
+ * that have been added since the last call.  Written attributes are then freed
+ * so that a large response can be produced a little at a time with bounded
+ * memory.  The end-of-attributes tag is written once "more" is 0.
+ *
+ * Returns @code IPP_STATE_ATTRIBUTE@ when more attributes can be added,
+ * @code IPP_STATE_DATA@ when the message is complete, or
+ * @code IPP_STATE_ERROR@ on error.
+ */
+
+ipp_state_t				/* O - Current state */
+_ippWriteAttributes(void       *dst,	/* I - Destination */
+                    ipp_iocb_t cb,	/* I - Write callback function */
+		    ipp_t      *ipp,	/* I - IPP message */
+		    int        more)	/* I - 1 if more attributes follow, 0 otherwise */
+{
+  ipp_state_t		state;		/* Write state */
+  ipp_attribute_t	*attr;		/* Attribute to free */
+
+
+  if (!dst || !cb || !ipp)
+    return (IPP_STATE_ERROR);
+
+  if (ipp->state == IPP_STATE_ATTRIBUTE)
+  {
+   /*
+    * Everything still in the message was added since the last call; the
+    * ippSet functions may have moved the current pointer in the meantime...
+    */
+
+    ipp->current = ipp->attrs;
+  }
+
+  ipp->stream_more = more;
+  state            = ippWriteIO(dst, cb, 1, NULL, ipp);
+  ipp->stream_more = 0;
+
+  if (state == IPP_STATE_ATTRIBUTE)
+  {
+   /*
+    * Free the attributes we have written, keeping the current group tag so
+    * that the next attributes continue the same group...
+    */
+
+    while ((attr = ipp->attrs) != NULL)
+      ippDeleteAttribute(ipp, attr);
+
+    ipp->current = NULL;
+    ipp->prev    = NULL;
+  }
+
+  return (state);
+}
+
+
 /*
  * 'ippAddBoolean()' - Add a boolean attribute to an IPP message.
  *
@@ -943,19 +1295,16 @@ ippAddString(ipp_t      *ipp,		/* I - IPP message */
   else
   {
     if (language)
-      attr->values[0].string.language = _cupsStrAlloc(ipp_lang_code(language, code,
-						      sizeof(code)));
+      attr->values[0].string.language = ipp_strdup(ipp, attr, ipp_lang_code(language, code, sizeof(code)));
 
     if (value)
     {
       if (value_tag == IPP_TAG_CHARSET)
-	attr->values[0].string.text = _cupsStrAlloc(ipp_get_code(value, code,
-								 sizeof(code)));
+	attr->values[0].string.text = ipp_strdup(ipp, attr, ipp_get_code(value, code, sizeof(code)));
       else if (value_tag == IPP_TAG_LANGUAGE)
-	attr->values[0].string.text = _cupsStrAlloc(ipp_lang_code(value, code,
-								  sizeof(code)));
+	attr->values[0].string.text = ipp_strdup(ipp, attr, ipp_lang_code(value, code, sizeof(code)));
       else
-	attr->values[0].string.text = _cupsStrAlloc(value);
+	attr->values[0].string.text = ipp_strdup(ipp, attr, value);
     }
   }
 
@@ -1292,8 +1641,7 @@ ippAddStrings(
         if ((int)value_tag & IPP_TAG_CUPS_CONST)
           value->string.language = (char *)language;
         else
-          value->string.language = _cupsStrAlloc(ipp_lang_code(language, code,
-                                                               sizeof(code)));
+          value->string.language = ipp_strdup(ipp, attr, ipp_lang_code(language, code, sizeof(code)));
       }
       else
 	value->string.language = attr->values[0].string.language;
@@ -1304,11 +1652,11 @@ ippAddStrings(
       if ((int)value_tag & IPP_TAG_CUPS_CONST)
         value->string.text = (char *)*values++;
       else if (value_tag == IPP_TAG_CHARSET)
-	value->string.text = _cupsStrAlloc(ipp_get_code(*values++, code, sizeof(code)));
+	value->string.text = ipp_strdup(ipp, attr, ipp_get_code(*values++, code, sizeof(code)));
       else if (value_tag == IPP_TAG_LANGUAGE)
-	value->string.text = _cupsStrAlloc(ipp_lang_code(*values++, code, sizeof(code)));
+	value->string.text = ipp_strdup(ipp, attr, ipp_lang_code(*values++, code, sizeof(code)));
       else
-	value->string.text = _cupsStrAlloc(*values++);
+	value->string.text = ipp_strdup(ipp, attr, *values++);
     }
   }
 
@@ -1551,7 +1899,7 @@ ippCopyAttribute(
 	  */
 
 	  for (i = srcattr->num_values, srcval = srcattr->values, dstval = dstattr->values; i > 0; i --, srcval ++, dstval ++)
-	    dstval->string.text = _cupsStrAlloc(srcval->string.text);
+	    dstval->string.text = ipp_strdup(dst, dstattr, srcval->string.text);
 	}
         break;
 
@@ -1577,11 +1925,11 @@ ippCopyAttribute(
 	  for (i = srcattr->num_values, srcval = srcattr->values, dstval = dstattr->values; i > 0; i --, srcval ++, dstval ++)
 	  {
 	    if (srcval == srcattr->values)
-              dstval->string.language = _cupsStrAlloc(srcval->string.language);
+              dstval->string.language = ipp_strdup(dst, dstattr, srcval->string.language);
 	    else
               dstval->string.language = dstattr->values[0].string.language;
 
-	    dstval->string.text = _cupsStrAlloc(srcval->string.text);
+	    dstval->string.text = ipp_strdup(dst, dstattr, srcval->string.text);
           }
         }
         break;
@@ -1753,12 +2101,25 @@ ippDelete(ipp_t *ipp)			/* I - IPP message */
 
     DEBUG_printf(("4debug_free: %p %s %s%s (%d values)", (void *)attr, attr->name, attr->num_values > 1 ? "1setOf " : "", ippTagString(attr->value_tag), attr->num_values));
 
-    ipp_free_values(attr, 0, attr->num_values);
+    ipp_free_values(ipp, attr, 0, attr->num_values);
 
-    if (attr->name)
-      _cupsStrFree(attr->name);
+    if (!attr->arena)
+    {
+      if (attr->name)
+	_cupsStrFree(attr->name);
 
-    free(attr);
+      free(attr);
+    }
+  }
+
+  _ippResetIndex(ipp);
+
+  while (ipp->arena)
+  {
+    _ipp_arena_t *chunk = ipp->arena;	/* Current arena chunk */
+
+    ipp->arena = chunk->next;
+    free(chunk);
   }
 
   free(ipp);
@@ -1814,6 +2175,7 @@ ippDeleteAttribute(
 	if (current == ipp->last)
 	  ipp->last = prev;
 
+        ipp_index_delete(ipp, current);
         break;
       }
 
@@ -1825,7 +2187,10 @@ ippDeleteAttribute(
   * Free memory used by the attribute...
   */
 
-  ipp_free_values(attr, 0, attr->num_values);
+  ipp_free_values(ipp, attr, 0, attr->num_values);
+
+  if (attr->arena)
+    return;
 
   if (attr->name)
     _cupsStrFree(attr->name);
@@ -1878,7 +2243,7 @@ ippDeleteValues(
   * Otherwise free the values in question and return.
   */
 
-  ipp_free_values(*attr, element, count);
+  ipp_free_values(ipp, *attr, element, count);
 
   return (1);
 }
@@ -1935,6 +2300,7 @@ ippFindNextAttribute(ipp_t      *ipp,	/* I - IPP message */
   ipp_tag_t		value_tag;	/* Value tag */
   char			parent[1024],	/* Parent attribute name */
 			*child = NULL;	/* Child attribute name */
+  int			count = -1;	/* Number of attributes searched */
 
 
   DEBUG_printf(("2ippFindNextAttribute(ipp=%p, name=\"%s\", type=%02x(%s))", (void *)ipp, name, type, ippTagString(type)));
@@ -2000,14 +2366,35 @@ ippFindNextAttribute(ipp_t      *ipp,	/* I - IPP message */
     ipp->prev = ipp->current;
     attr      = ipp->current->next;
   }
+  else if (ipp->index)
+  {
+   /*
+    * Use the name index, which doesn't track the previous attribute...
+    */
+
+    ipp->current = ipp_index_find(ipp, name, type);
+    ipp->prev    = NULL;
+    ipp->atend   = ipp->current == NULL;
+
+    return (ipp->current);
+  }
   else
   {
+   /*
+    * Search from the start, counting attributes to see if the message is
+    * large enough to index...
+    */
+
     ipp->prev = NULL;
     attr      = ipp->attrs;
+    count     = 0;
   }
 
   for (; attr != NULL; ipp->prev = attr, attr = attr->next)
   {
+    if (count >= 0 && ++ count == IPP_INDEX_MIN)
+      ipp_index_build(ipp);
+
     DEBUG_printf(("4ippFindAttribute: attr=%p, name=\"%s\"", (void *)attr, attr->name));
 
     value_tag = (ipp_tag_t)(attr->value_tag & IPP_TAG_CUPS_MASK);
@@ -3375,7 +3762,7 @@ ippReadIO(void       *src,		/* I - Data source */
 		}
 
 		buffer[n] = '\0';
-		value->string.text = _cupsStrAlloc((char *)buffer);
+		value->string.text = ipp_strdup(ipp, attr, (char *)buffer);
 		DEBUG_printf(("2ippReadIO: value=\"%s\"", value->string.text));
 	        break;
 
@@ -3513,7 +3900,7 @@ ippReadIO(void       *src,		/* I - Data source */
 		memcpy(string, bufptr + 2, (size_t)n);
 		string[n] = '\0';
 
-		value->string.language = _cupsStrAlloc((char *)string);
+		value->string.language = ipp_strdup(ipp, attr, (char *)string);
 
                 bufptr += 2 + n;
 		n = (bufptr[0] << 8) | bufptr[1];
@@ -3528,7 +3915,7 @@ ippReadIO(void       *src,		/* I - Data source */
 		}
 
 		bufptr[2 + n] = '\0';
-                value->string.text = _cupsStrAlloc((char *)bufptr + 2);
+                value->string.text = ipp_strdup(ipp, attr, (char *)bufptr + 2);
 	        break;
 
             case IPP_TAG_BEGIN_COLLECTION :
@@ -3601,7 +3988,9 @@ ippReadIO(void       *src,		/* I - Data source */
 		}
 
 		buffer[n] = '\0';
-		attr->name = _cupsStrAlloc((char *)buffer);
+		attr->name = ipp_strdup(ipp, attr, (char *)buffer);
+
+		ipp_index_add(ipp, attr);
 
                /*
 	        * Since collection members are encoded differently than
@@ -3939,12 +4328,19 @@ ippSetName(ipp_t           *ipp,	/* I  - IPP message */
   * Set the value and return...
   */
 
-  if ((temp = _cupsStrAlloc(name)) != NULL)
+  if ((temp = ipp_strdup(ipp, *attr, name)) != NULL)
   {
     if ((*attr)->name)
-      _cupsStrFree((*attr)->name);
+      ipp_strfree(ipp, *attr, (*attr)->name);
 
     (*attr)->name = temp;
+
+   /*
+    * Renaming can change the order of same-named attributes, so just drop the
+    * name index...
+    */
+
+    _ippResetIndex(ipp);
   }
 
   return (temp != NULL);
@@ -4307,10 +4703,18 @@ ippSetString(ipp_t           *ipp,	/* I  - IPP message */
 
     if ((int)((*attr)->value_tag) & IPP_TAG_CUPS_CONST)
       value->string.text = (char *)strvalue;
+    else if ((*attr)->arena && value->string.text && strlen(value->string.text) >= strlen(strvalue) && ipp_arena_owns(ipp, value->string.text))
+    {
+     /*
+      * Reuse arena memory for the new value since it can't be freed...
+      */
+
+      memmove(value->string.text, strvalue, strlen(strvalue) + 1);
+    }
     else if ((temp = _cupsStrAlloc(strvalue)) != NULL)
     {
       if (value->string.text)
-        _cupsStrFree(value->string.text);
+        ipp_strfree(ipp, *attr, value->string.text);
 
       value->string.text = temp;
     }
@@ -4578,7 +4982,7 @@ ippSetValueTag(
         */
 
         if ((*attr)->num_values > 0)
-          ipp_free_values(*attr, 0, (*attr)->num_values);
+          ipp_free_values(ipp, *attr, 0, (*attr)->num_values);
 
        /*
         * Set out-of-band value...
@@ -4625,7 +5029,7 @@ ippSetValueTag(
           */
 
 	  (*attr)->values[0].string.language =
-	      _cupsStrAlloc(ipp->attrs->next->values[0].string.text);
+	      ipp_strdup(ipp, *attr, ipp->attrs->next->values[0].string.text);
         }
         else
         {
@@ -4634,9 +5038,7 @@ ippSetValueTag(
           */
 
 	  language = cupsLangDefault();
-	  (*attr)->values[0].string.language = _cupsStrAlloc(ipp_lang_code(language->language,
-									code,
-									sizeof(code)));
+	  (*attr)->values[0].string.language = ipp_strdup(ipp, *attr, ipp_lang_code(language->language, code, sizeof(code)));
         }
 
         for (i = (*attr)->num_values - 1, value = (*attr)->values + 1;
@@ -4653,7 +5055,7 @@ ippSetValueTag(
 	  for (i = (*attr)->num_values, value = (*attr)->values;
 	       i > 0;
 	       i --, value ++)
-	    value->string.text = _cupsStrAlloc(value->string.text);
+	    value->string.text = ipp_strdup(ipp, *attr, value->string.text);
         }
 
         (*attr)->value_tag = IPP_TAG_NAMELANG;
@@ -5467,6 +5869,25 @@ ippWriteIO(void       *dst,		/* I - Destination */
 	    }
 	    else if (attr->group_tag == IPP_TAG_ZERO)
 	      continue;
+
+	    if (attr->value_tag == _IPP_TAG_ENCODED)
+	    {
+	     /*
+	      * Write pre-encoded attributes as-is...
+	      */
+
+	      if ((bufptr > buffer && (*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0) || (*cb)(dst, attr->values[0].unknown.data, (size_t)attr->values[0].unknown.length) < 0)
+	      {
+		DEBUG_puts("1ippWriteIO: Could not write encoded IPP attributes...");
+		_cupsBufferRelease((char *)buffer);
+		return (IPP_STATE_ERROR);
+	      }
+
+	      if (!blocking && ipp->current)
+		break;
+
+	      continue;
+	    }
 	  }
 
 	  DEBUG_printf(("1ippWriteIO: %s (%s%s)", attr->name,
@@ -6196,7 +6617,7 @@ ippWriteIO(void       *dst,		/* I - Destination */
 	    break;
 	}
 
-	if (ipp->current == NULL)
+	if (ipp->current == NULL && !ipp->stream_more)
 	{
          /*
 	  * Done with all of the attributes; add the end-of-attributes
@@ -6275,8 +6696,11 @@ ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
   else
     alloc_values = (num_values + IPP_MAX_VALUES - 1) & ~(IPP_MAX_VALUES - 1);
 
-  attr = calloc(sizeof(ipp_attribute_t) +
-                (size_t)(alloc_values - 1) * sizeof(_ipp_value_t), 1);
+  if (ipp->arena)
+    attr = ipp_arena_alloc(ipp, sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t));
+  else
+    attr = calloc(sizeof(ipp_attribute_t) +
+                  (size_t)(alloc_values - 1) * sizeof(_ipp_value_t), 1);
 
   if (attr)
   {
@@ -6286,8 +6710,10 @@ ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
 
     DEBUG_printf(("4debug_alloc: %p %s %s%s (%d values)", (void *)attr, name, num_values > 1 ? "1setOf " : "", ippTagString(value_tag), num_values));
 
+    attr->arena = ipp->arena != NULL;
+
     if (name)
-      attr->name = _cupsStrAlloc(name);
+      attr->name = ipp_strdup(ipp, attr, name);
 
     attr->group_tag  = group_tag;
     attr->value_tag  = value_tag;
@@ -6304,6 +6730,8 @@ ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
 
     ipp->prev = ipp->last;
     ipp->last = ipp->current = attr;
+
+    ipp_index_add(ipp, attr);
   }
 
   DEBUG_printf(("5ipp_add_attr: Returning %p", (void *)attr));
@@ -6312,12 +6740,94 @@ ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
 }
 
 
+/*
+ * 'ipp_arena_alloc()' - Allocate zeroed memory from a message arena.
+ */
+
+static void *				/* O - Memory or `NULL` on error */
+ipp_arena_alloc(ipp_t  *ipp,		/* I - IPP message */
+                size_t size)		/* I - Number of bytes */
+{
+  _ipp_arena_t	*chunk = ipp->arena;	/* Current chunk */
+  size_t	chunksize;		/* Size of new chunk */
+  void		*ptr;			/* Allocated memory */
+
+
+ /*
+  * Keep everything aligned for the values in attributes...
+  */
+
+  size = (size + sizeof(_ipp_value_t) - 1) / sizeof(_ipp_value_t) * sizeof(_ipp_value_t);
+
+  if (size > (chunk->size - chunk->used))
+  {
+   /*
+    * Add a new chunk, doubling the chunk size each time up to IPP_ARENA_MAX;
+    * anything bigger than a quarter of that gets its own chunk behind the
+    * current one...
+    */
+
+    if ((chunksize = 2 * chunk->size) > IPP_ARENA_MAX)
+      chunksize = IPP_ARENA_MAX;
+
+    if (size > IPP_ARENA_MAX / 4 || chunksize < size)
+      chunksize = size;
+
+    if ((chunk = calloc(1, sizeof(_ipp_arena_t) - sizeof(_ipp_value_t) + chunksize)) == NULL)
+      return (NULL);
+
+    chunk->size = chunksize;
+
+    if (size > IPP_ARENA_MAX / 4)
+    {
+      chunk->next       = ipp->arena->next;
+      ipp->arena->next  = chunk;
+    }
+    else
+    {
+      chunk->next = ipp->arena;
+      ipp->arena  = chunk;
+    }
+  }
+
+ /*
+  * Chunks are allocated with calloc() and never reused, so the memory is
+  * already zeroed...
+  */
+
+  ptr         = (char *)chunk->data + chunk->used;
+  chunk->used += size;
+
+  return (ptr);
+}
+
+
+/*
+ * 'ipp_arena_owns()' - Determine whether a string lives in a message arena.
+ */
+
+static int				/* O - 1 if in the arena, 0 otherwise */
+ipp_arena_owns(ipp_t      *ipp,		/* I - IPP message */
+               const char *s)		/* I - String */
+{
+  _ipp_arena_t	*chunk;			/* Current chunk */
+
+
+  for (chunk = ipp->arena; chunk; chunk = chunk->next)
+    if (s >= (char *)chunk->data && s < (char *)chunk->data + chunk->size)
+      return (1);
+
+  return (0);
+}
+
+
 /*
  * 'ipp_free_values()' - Free attribute values.
  */
 
 static void
-ipp_free_values(ipp_attribute_t *attr,	/* I - Attribute to free values from */
+ipp_free_values(ipp_t           *ipp,	/* I - IPP message */
+                ipp_attribute_t *attr,	/* I - Attribute to free values from */
                 int             element,/* I - First value to free */
                 int             count)	/* I - Number of values to free */
 {
@@ -6340,7 +6850,7 @@ ipp_free_values(ipp_attribute_t *attr,	/* I - Attribute to free values from */
 	  if (element == 0 && count == attr->num_values &&
 	      attr->values[0].string.language)
 	  {
-	    _cupsStrFree(attr->values[0].string.language);
+	    ipp_strfree(ipp, attr, attr->values[0].string.language);
 	    attr->values[0].string.language = NULL;
 	  }
 	  /* Fall through to other string values */
@@ -6358,7 +6868,7 @@ ipp_free_values(ipp_attribute_t *attr,	/* I - Attribute to free values from */
 	       i > 0;
 	       i --, value ++)
 	  {
-	    _cupsStrFree(value->string.text);
+	    ipp_strfree(ipp, attr, value->string.text);
 	    value->string.text = NULL;
 	  }
 	  break;
@@ -6454,6 +6964,187 @@ ipp_get_code(const char *value,		/* I - Locale/charset string */
 }
 
 
+/*
+ * 'ipp_index_add()' - Add an attribute to the name index.
+ *
+ * Attributes are only ever added at the end of the list, so adding them to the
+ * end of the probe sequence keeps same-named attributes in list order.
+ */
+
+static void
+ipp_index_add(ipp_t           *ipp,	/* I - IPP message */
+              ipp_attribute_t *attr)	/* I - Attribute */
+{
+  _ipp_index_t	*index = ipp->index;	/* Name index */
+  size_t	i;			/* Current slot */
+
+
+  if (!index || !attr->name)
+    return;
+
+  if ((index->used + 1) * 2 > index->size)
+  {
+   /*
+    * Index is full, rebuild it on the next lookup...
+    */
+
+    _ippResetIndex(ipp);
+    return;
+  }
+
+  for (i = ipp_index_hash(attr->name) & (index->size - 1); index->slots[i]; i = (i + 1) & (index->size - 1));
+
+  index->slots[i] = attr;
+  index->used ++;
+}
+
+
+/*
+ * 'ipp_index_build()' - Build the name index for a message.
+ */
+
+static void
+ipp_index_build(ipp_t *ipp)		/* I - IPP message */
+{
+  ipp_attribute_t	*attr;		/* Current attribute */
+  size_t		count = 0;	/* Number of named attributes */
+  _ipp_index_t		*index;		/* Name index */
+
+
+  for (attr = ipp->attrs; attr; attr = attr->next)
+    if (attr->name)
+      count ++;
+
+  if ((index = calloc(1, sizeof(_ipp_index_t))) == NULL)
+    return;
+
+ /*
+  * Use a power of 2 with room to grow before rebuilding...
+  */
+
+  for (index->size = 64; index->size < 4 * count; index->size *= 2);
+
+  if ((index->slots = calloc(index->size, sizeof(ipp_attribute_t *))) == NULL)
+  {
+    free(index);
+    return;
+  }
+
+  ipp->index = index;
+
+  for (attr = ipp->attrs; attr; attr = attr->next)
+    ipp_index_add(ipp, attr);
+}
+
+
+/*
+ * 'ipp_index_delete()' - Remove an attribute from the name index.
+ */
+
+static void
+ipp_index_delete(ipp_t           *ipp,	/* I - IPP message */
+                 ipp_attribute_t *attr)	/* I - Attribute */
+{
+  _ipp_index_t	*index = ipp->index;	/* Name index */
+  size_t	i;			/* Current slot */
+
+
+  if (!index || !attr->name)
+    return;
+
+  for (i = ipp_index_hash(attr->name) & (index->size - 1); index->slots[i]; i = (i + 1) & (index->size - 1))
+  {
+    if (index->slots[i] == attr)
+    {
+     /*
+      * Leave a marker so that lookups continue past this slot...
+      */
+
+      index->slots[i] = &ipp_index_deleted;
+      break;
+    }
+  }
+}
+
+
+/*
+ * 'ipp_index_find()' - Find the first matching attribute using the name index.
+ */
+
+static ipp_attribute_t *		/* O - Matching attribute or `NULL` */
+ipp_index_find(ipp_t      *ipp,		/* I - IPP message */
+               const char *name,	/* I - Name of attribute */
+               ipp_tag_t  type)		/* I - Type of attribute */
+{
+  _ipp_index_t		*index = ipp->index;
+					/* Name index */
+  size_t		i;		/* Current slot */
+  ipp_attribute_t	*attr;		/* Current attribute */
+  ipp_tag_t		value_tag;	/* Value tag */
+
+
+  for (i = ipp_index_hash(name) & (index->size - 1); (attr = index->slots[i]) != NULL; i = (i + 1) & (index->size - 1))
+  {
+    if (attr == &ipp_index_deleted || _cups_strcasecmp(attr->name, name))
+      continue;
+
+    value_tag = (ipp_tag_t)(attr->value_tag & IPP_TAG_CUPS_MASK);
+
+    if (value_tag == type || type == IPP_TAG_ZERO ||
+        (value_tag == IPP_TAG_TEXTLANG && type == IPP_TAG_TEXT) ||
+        (value_tag == IPP_TAG_NAMELANG && type == IPP_TAG_NAME))
+      return (attr);
+  }
+
+  return (NULL);
+}
+
+
+/*
+ * 'ipp_index_hash()' - Compute the case-insensitive hash of an attribute name.
+ */
+
+static size_t				/* O - Hash value */
+ipp_index_hash(const char *name)	/* I - Attribute name */
+{
+  size_t	hash = 2166136261U;	/* FNV-1a hash */
+
+
+  for (; *name; name ++)
+    hash = (hash ^ (size_t)_cups_tolower(*name)) * 16777619U;
+
+  return (hash);
+}
+
+
+/*
+ * 'ipp_index_replace()' - Replace a reallocated attribute in the name index.
+ */
+
+static void
+ipp_index_replace(
+    ipp_t           *ipp,		/* I - IPP message */
+    ipp_attribute_t *oldattr,		/* I - Old attribute pointer */
+    ipp_attribute_t *newattr)		/* I - New attribute */
+{
+  _ipp_index_t	*index = ipp->index;	/* Name index */
+  size_t	i;			/* Current slot */
+
+
+  if (!index || !newattr->name)
+    return;
+
+  for (i = ipp_index_hash(newattr->name) & (index->size - 1); index->slots[i]; i = (i + 1) & (index->size - 1))
+  {
+    if (index->slots[i] == oldattr)
+    {
+      index->slots[i] = newattr;
+      break;
+    }
+  }
+}
+
+
 /*
  * 'ipp_lang_code()' - Convert a C locale name into an IPP language code.
  *
@@ -6526,6 +7217,12 @@ ipp_length(ipp_t *ipp,			/* I - IPP message or collection */
       bytes ++;	/* Group tag */
     }
 
+    if (attr->value_tag == _IPP_TAG_ENCODED)
+    {
+      bytes += (size_t)attr->values[0].unknown.length;
+      continue;
+    }
+
     if (!attr->name)
       continue;
 
@@ -6824,7 +7521,19 @@ ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
   * Reallocate memory...
   */
 
-  if ((temp = realloc(temp, sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t))) == NULL)
+  if (temp->arena)
+  {
+   /*
+    * Arena memory can't grow, so copy to a new block...
+    */
+
+    if ((temp = ipp_arena_alloc(ipp, sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t))) != NULL)
+      memcpy(temp, *attr, sizeof(ipp_attribute_t) + (size_t)((*attr)->num_values > 1 ? (*attr)->num_values - 1 : 0) * sizeof(_ipp_value_t));
+  }
+  else
+    temp = realloc(temp, sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t));
+
+  if (!temp)
   {
     _cupsSetHTTPError(HTTP_STATUS_ERROR);
     DEBUG_puts("4ipp_set_value: Unable to resize attribute.");
@@ -6891,6 +7600,8 @@ ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
     if (ipp->last == *attr)
       ipp->last = temp;
 
+    ipp_index_replace(ipp, *attr, temp);
+
     *attr = temp;
   }
 
@@ -6905,6 +7616,70 @@ ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
 }
 
 
+/*
+ * 'ipp_strdup()' - Copy a string for an IPP message.
+ *
+ * Strings for attributes in a message arena are copied into the arena,
+ * otherwise they come from the shared string pool.
+ */
+
+static char *				/* O - Copy of string or `NULL` */
+ipp_strdup(ipp_t           *ipp,	/* I - IPP message */
+           ipp_attribute_t *attr,	/* I - Attribute */
+           const char      *s)		/* I - String */
+{
+  char		*temp;			/* Copy of string */
+  size_t	length;			/* Length of string */
+
+
+  if (!s)
+    return (NULL);
+
+  if (!attr->arena)
+    return (_cupsStrAlloc(s));
+
+  length = strlen(s) + 1;
+
+  if ((temp = ipp_arena_alloc(ipp, length)) != NULL)
+    memcpy(temp, s, length);
+
+  return (temp);
+}
+
+
+/*
+ * 'ipp_strfree()' - Free a string from an IPP attribute.
+ */
+
+static void
+ipp_strfree(ipp_t           *ipp,	/* I - IPP message */
+            ipp_attribute_t *attr,	/* I - Attribute */
+            char            *s)		/* I - String */
+{
+  if (!attr->arena || !ipp_arena_owns(ipp, s))
+    _cupsStrFree(s);
+}
+
+
+/*
+ * 'ipp_write_encode()' - Write IPP data to an encoding buffer.
+ */
+
+static ssize_t				/* O - Number of bytes written */
+ipp_write_encode(_ipp_encode_t *enc,	/* I - Encoding buffer */
+                 ipp_uchar_t   *buffer,	/* I - Data to write */
+                 size_t        length)	/* I - Number of bytes to write */
+{
+  if (length > (enc->size - enc->length))
+    return (-1);
+
+  memcpy(enc->data + enc->length, buffer, length);
+  enc->length += length;
+
+  return ((ssize_t)length);
+}
+
+
 /*
  * 'ipp_write_file()' - Write IPP data to a file.
  */
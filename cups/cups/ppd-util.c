@@ -325,6 +325,17 @@ cupsGetPPD3(http_t     *http,		/* I  - HTTP connection or @code CUPS_HTTP_DEFAUL
       DEBUG_puts("2cupsGetPPD3: Unable to connect to scheduler.");
       return (HTTP_STATUS_SERVICE_UNAVAILABLE);
     }
+
+   /*
+    * Copy using the default connection, then hand it back to the pool (if
+    * any)...
+    */
+
+    status = cupsGetPPD3(http, name, modtime, buffer, bufsize);
+
+    _cupsConnectRelease();
+
+    return (status);
   }
 
   if (!cups_get_printer_uri(http, name, hostname, sizeof(hostname), &port, resource, sizeof(resource), 0))
@@ -495,10 +506,6 @@ cupsGetServerPPD(http_t     *http,	/* I - Connection to server or @code CUPS_HTT
     return (NULL);
   }
 
-  if (!http)
-    if ((http = _cupsConnect()) == NULL)
-      return (NULL);
-
  /*
   * Get a temp file...
   */
@@ -36,6 +36,18 @@ extern "C" {
  * Structure...
  */
 
+typedef struct _cups_raster_kernel_s	/**** Raster kernel functions ****/
+{
+  const char	*name;			/* Name of kernels */
+  int		(*supported)(void);	/* Does the CPU support them? */
+  void		(*swap)(unsigned char *dst, const unsigned char *src, size_t bytes);
+					/* Copy and swap 16-bit samples */
+  size_t	(*repeat)(const unsigned char *a, const unsigned char *b, size_t bytes);
+					/* Count leading matching bytes */
+  size_t	(*literal)(const unsigned char *p, size_t bpp, size_t count);
+					/* Count pixels that differ from the next */
+} _cups_raster_kernel_t;
+
 struct _cups_raster_s			/**** Raster stream data ****/
 {
   unsigned		sync;		/* Sync word from start of stream */
@@ -61,6 +73,7 @@ struct _cups_raster_s			/**** Raster stream data ****/
 			iocount;	/* Number of bytes read/written */
 #  endif /* DEBUG */
   unsigned		apple_page_count;/* Apple raster page count */
+  const _cups_raster_kernel_t *kernel;	/* Swap and compression kernels */
 };
 
 
@@ -87,10 +100,12 @@ extern void		_cupsRasterClearError(void) _CUPS_PRIVATE;
 extern const char	*_cupsRasterColorSpaceString(cups_cspace_t cspace) _CUPS_PRIVATE;
 extern void		_cupsRasterDelete(cups_raster_t *r) _CUPS_PRIVATE;
 extern const char	*_cupsRasterErrorString(void) _CUPS_PRIVATE;
+extern const char	*_cupsRasterGetKernel(void) _CUPS_PRIVATE;
 extern int		_cupsRasterInitPWGHeader(cups_page_header2_t *h, pwg_media_t *media, const char *type, int xdpi, int ydpi, const char *sides, const char *sheet_back) _CUPS_PRIVATE;
 extern cups_raster_t	*_cupsRasterNew(cups_raster_iocb_t iocb, void *ctx, cups_mode_t mode) _CUPS_PRIVATE;
 extern unsigned		_cupsRasterReadHeader(cups_raster_t *r) _CUPS_PRIVATE;
 extern unsigned		_cupsRasterReadPixels(cups_raster_t *r, unsigned char *p, unsigned len) _CUPS_PRIVATE;
+extern int		_cupsRasterSetKernel(const char *name) _CUPS_PRIVATE;
 extern unsigned		_cupsRasterWriteHeader(cups_raster_t *r) _CUPS_PRIVATE;
 extern unsigned		_cupsRasterWritePixels(cups_raster_t *r, unsigned char *p, unsigned len) _CUPS_PRIVATE;
 
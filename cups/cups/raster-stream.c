@@ -16,10 +16,28 @@
 
 #include "raster-private.h"
 #include "debug-internal.h"
+#include "thread-private.h"
 #ifdef HAVE_STDINT_H
 #  include <stdint.h>
 #endif /* HAVE_STDINT_H */
 
+/*
+ * SIMD kernels are built with GCC and Clang; AVX2 is selected at runtime when
+ * the CPU supports it, while SSE2 and NEON are always available on the
+ * architectures that define them...
+ */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  include <immintrin.h>
+#  define CUPS_RASTER_AVX2 1
+#  ifdef __SSE2__
+#    define CUPS_RASTER_SSE2 1
+#  endif /* __SSE2__ */
+#elif defined(__GNUC__) && defined(__aarch64__) && defined(__ARM_NEON)
+#  include <arm_neon.h>
+#  define CUPS_RASTER_NEON 1
+#endif /* __GNUC__ && (__x86_64__ || __i386__) */
+
 
 /*
  * Private structures...
@@ -66,12 +84,54 @@ static const char * const cups_modes[] =
  * Local functions...
  */
 
+#ifdef CUPS_RASTER_AVX2
+static size_t	cups_avx2_literal(const unsigned char *p, size_t bpp, size_t count);
+static size_t	cups_avx2_repeat(const unsigned char *a, const unsigned char *b, size_t bytes);
+static int	cups_avx2_supported(void);
+static void	cups_avx2_swap(unsigned char *dst, const unsigned char *src, size_t bytes);
+#endif /* CUPS_RASTER_AVX2 */
+static size_t	cups_generic_literal(const unsigned char *p, size_t bpp, size_t count);
+static size_t	cups_generic_repeat(const unsigned char *a, const unsigned char *b, size_t bytes);
+static void	cups_generic_swap(unsigned char *dst, const unsigned char *src, size_t bytes);
+#ifdef CUPS_RASTER_NEON
+static size_t	cups_neon_literal(const unsigned char *p, size_t bpp, size_t count);
+static size_t	cups_neon_repeat(const unsigned char *a, const unsigned char *b, size_t bytes);
+static void	cups_neon_swap(unsigned char *dst, const unsigned char *src, size_t bytes);
+#endif /* CUPS_RASTER_NEON */
 static ssize_t	cups_raster_io(cups_raster_t *r, unsigned char *buf, size_t bytes);
+static const _cups_raster_kernel_t *cups_raster_kernel(const char *name);
 static ssize_t	cups_raster_read(cups_raster_t *r, unsigned char *buf, size_t bytes);
 static int	cups_raster_update(cups_raster_t *r);
 static ssize_t	cups_raster_write(cups_raster_t *r, const unsigned char *pixels);
-static void	cups_swap(unsigned char *buf, size_t bytes);
-static void	cups_swap_copy(unsigned char *dst, const unsigned char *src, size_t bytes);
+#ifdef CUPS_RASTER_SSE2
+static size_t	cups_sse2_literal(const unsigned char *p, size_t bpp, size_t count);
+static size_t	cups_sse2_repeat(const unsigned char *a, const unsigned char *b, size_t bytes);
+static void	cups_sse2_swap(unsigned char *dst, const unsigned char *src, size_t bytes);
+#endif /* CUPS_RASTER_SSE2 */
+
+
+/*
+ * Swap and compression kernels, fastest first...
+ */
+
+static const _cups_raster_kernel_t cups_kernels[] =
+{
+#ifdef CUPS_RASTER_AVX2
+  { "avx2", cups_avx2_supported, cups_avx2_swap, cups_avx2_repeat, cups_avx2_literal },
+#endif /* CUPS_RASTER_AVX2 */
+#ifdef CUPS_RASTER_SSE2
+  { "sse2", NULL, cups_sse2_swap, cups_sse2_repeat, cups_sse2_literal },
+#endif /* CUPS_RASTER_SSE2 */
+#ifdef CUPS_RASTER_NEON
+  { "neon", NULL, cups_neon_swap, cups_neon_repeat, cups_neon_literal },
+#endif /* CUPS_RASTER_NEON */
+  { "generic", NULL, cups_generic_swap, cups_generic_repeat, cups_generic_literal }
+};
+
+static _cups_mutex_t	cups_kernel_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for current kernels */
+static const _cups_raster_kernel_t *cups_kernel = NULL;
+					/* Current kernels */
 
 
 /*
@@ -180,6 +240,29 @@ _cupsRasterDelete(cups_raster_t *r)	/* I - Stream to free */
 }
 
 
+/*
+ * '_cupsRasterGetKernel()' - Get the name of the current raster kernels.
+ */
+
+const char *				/* O - Name of kernels */
+_cupsRasterGetKernel(void)
+{
+  const char	*name;			/* Name of kernels */
+
+
+  _cupsMutexLock(&cups_kernel_mutex);
+
+  if (!cups_kernel)
+    cups_kernel = cups_raster_kernel(NULL);
+
+  name = cups_kernel->name;
+
+  _cupsMutexUnlock(&cups_kernel_mutex);
+
+  return (name);
+}
+
+
 /*
  * '_cupsRasterInitPWGHeader()' - Initialize a page header for PWG Raster output.
  *
@@ -460,6 +543,15 @@ _cupsRasterNew(
   r->iocb = iocb;
   r->mode = mode;
 
+  _cupsMutexLock(&cups_kernel_mutex);
+
+  if (!cups_kernel)
+    cups_kernel = cups_raster_kernel(NULL);
+
+  r->kernel = cups_kernel;
+
+  _cupsMutexUnlock(&cups_kernel_mutex);
+
   if (mode == CUPS_RASTER_READ)
   {
    /*
@@ -797,7 +889,7 @@ _cupsRasterReadPixels(
         (r->header.cupsBitsPerColor == 16 ||
          r->header.cupsBitsPerPixel == 12 ||
          r->header.cupsBitsPerPixel == 16))
-      cups_swap(p, len);
+      (r->kernel->swap)(p, p, len);
 
    /*
     * Return...
@@ -945,7 +1037,7 @@ _cupsRasterReadPixels(
           r->swapped)
       {
         DEBUG_puts("1_cupsRasterReadPixels: Swapping bytes.");
-        cups_swap(ptr, (size_t)cupsBytesPerLine);
+        (r->kernel->swap)(ptr, ptr, (size_t)cupsBytesPerLine);
       }
 
      /*
@@ -1002,6 +1094,30 @@ _cupsRasterReadPixels(
 }
 
 
+/*
+ * '_cupsRasterSetKernel()' - Select the raster kernels for new streams.
+ *
+ * The "name" argument is "avx2", "sse2", "neon", or "generic", or @code NULL@
+ * to select the fastest kernels supported by the CPU.
+ */
+
+int					/* O - 1 on success, 0 if not supported */
+_cupsRasterSetKernel(const char *name)	/* I - Name of kernels or @code NULL@ */
+{
+  const _cups_raster_kernel_t *kernel;	/* Matching kernels */
+
+
+  if ((kernel = cups_raster_kernel(name)) == NULL)
+    return (0);
+
+  _cupsMutexLock(&cups_kernel_mutex);
+  cups_kernel = kernel;
+  _cupsMutexUnlock(&cups_kernel_mutex);
+
+  return (1);
+}
+
+
 /*
  * '_cupsRasterWriteHeader()' - Write a raster page header.
  */
@@ -1238,7 +1354,7 @@ _cupsRasterWritePixels(
       * Byte swap the pixels and write them...
       */
 
-      cups_swap_copy(r->buffer, p, len);
+      (r->kernel->swap)(r->buffer, p, len);
 
       bytes = cups_raster_io(r, r->buffer, len);
     }
@@ -1358,6 +1474,281 @@ _cupsRasterWritePixels(
 }
 
 
+#ifdef CUPS_RASTER_AVX2
+/*
+ * 'cups_avx2_literal()' - Count pixels that differ from the next using AVX2.
+ */
+
+__attribute__((target("avx2")))
+static size_t				/* O - Number of differing pixels */
+cups_avx2_literal(
+    const unsigned char *p,		/* I - First pixel */
+    size_t              bpp,		/* I - Bytes per pixel */
+    size_t              count)		/* I - Maximum number of pixels */
+{
+  size_t		i = 0,		/* Current pixel */
+			j,		/* Pixel in vector */
+			n;		/* Pixels per vector */
+  unsigned long long	mask,		/* Matching bytes */
+			pmask;		/* Mask for one pixel */
+
+
+  if (bpp <= 32)
+  {
+   /*
+    * Compare each vector of whole pixels with the following pixels, and only
+    * look at individual pixels when some bytes match...
+    */
+
+    n     = 32 / bpp;
+    pmask = (1ULL << bpp) - 1;
+
+    for (; (i * bpp + 32) <= count * bpp; i += n)
+    {
+      __m256i a = _mm256_loadu_si256((const __m256i *)(p + i * bpp));
+      __m256i b = _mm256_loadu_si256((const __m256i *)(p + i * bpp + bpp));
+
+      mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)) & ((1ULL << (n * bpp)) - 1);
+
+      if (!mask)
+        continue;
+
+      for (j = 0; j < n; j ++, mask >>= bpp)
+        if ((mask & pmask) == pmask)
+          return (i + j);
+    }
+  }
+
+  return (i + cups_generic_literal(p + i * bpp, bpp, count - i));
+}
+
+
+/*
+ * 'cups_avx2_repeat()' - Count leading matching bytes using AVX2.
+ */
+
+__attribute__((target("avx2")))
+static size_t				/* O - Number of matching bytes */
+cups_avx2_repeat(
+    const unsigned char *a,		/* I - First buffer */
+    const unsigned char *b,		/* I - Second buffer */
+    size_t              bytes)		/* I - Number of bytes */
+{
+  size_t	i;			/* Current byte */
+  unsigned	mask;			/* Matching bytes */
+
+
+  for (i = 0; (i + 32) <= bytes; i += 32)
+  {
+    mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(a + i)), _mm256_loadu_si256((const __m256i *)(b + i))));
+
+    if (mask != 0xffffffff)
+      return (i + (size_t)__builtin_ctz(~mask));
+  }
+
+  return (i + cups_generic_repeat(a + i, b + i, bytes - i));
+}
+
+
+/*
+ * 'cups_avx2_supported()' - Determine whether the CPU supports AVX2.
+ */
+
+static int				/* O - 1 if supported, 0 otherwise */
+cups_avx2_supported(void)
+{
+  __builtin_cpu_init();
+
+  return (__builtin_cpu_supports("avx2") != 0);
+}
+
+
+/*
+ * 'cups_avx2_swap()' - Copy and swap 16-bit samples using AVX2.
+ */
+
+__attribute__((target("avx2")))
+static void
+cups_avx2_swap(
+    unsigned char       *dst,		/* I - Destination */
+    const unsigned char *src,		/* I - Source */
+    size_t              bytes)		/* I - Number of bytes to swap */
+{
+  for (; bytes >= 32; bytes -= 32, dst += 32, src += 32)
+  {
+    __m256i v = _mm256_loadu_si256((const __m256i *)src);
+
+    _mm256_storeu_si256((__m256i *)dst, _mm256_or_si256(_mm256_slli_epi16(v, 8), _mm256_srli_epi16(v, 8)));
+  }
+
+  cups_generic_swap(dst, src, bytes);
+}
+#endif /* CUPS_RASTER_AVX2 */
+
+
+/*
+ * 'cups_generic_literal()' - Count pixels that differ from the next pixel.
+ */
+
+static size_t				/* O - Number of differing pixels */
+cups_generic_literal(
+    const unsigned char *p,		/* I - First pixel */
+    size_t              bpp,		/* I - Bytes per pixel */
+    size_t              count)		/* I - Maximum number of pixels */
+{
+  size_t	i;			/* Current pixel */
+
+
+  for (i = 0; i < count; i ++, p += bpp)
+    if (!memcmp(p, p + bpp, bpp))
+      break;
+
+  return (i);
+}
+
+
+/*
+ * 'cups_generic_repeat()' - Count leading matching bytes.
+ */
+
+static size_t				/* O - Number of matching bytes */
+cups_generic_repeat(
+    const unsigned char *a,		/* I - First buffer */
+    const unsigned char *b,		/* I - Second buffer */
+    size_t              bytes)		/* I - Number of bytes */
+{
+  size_t	i;			/* Current byte */
+
+
+  for (i = 0; i < bytes; i ++)
+    if (a[i] != b[i])
+      break;
+
+  return (i);
+}
+
+
+/*
+ * 'cups_generic_swap()' - Copy and swap 16-bit samples.
+ *
+ * The source and destination may be the same buffer.
+ */
+
+static void
+cups_generic_swap(
+    unsigned char       *dst,		/* I - Destination */
+    const unsigned char *src,		/* I - Source */
+    size_t              bytes)		/* I - Number of bytes to swap */
+{
+  unsigned char	even, odd;		/* Temporary variables */
+
+
+  bytes /= 2;
+
+  while (bytes > 0)
+  {
+    even   = src[0];
+    odd    = src[1];
+    dst[0] = odd;
+    dst[1] = even;
+
+    dst += 2;
+    src += 2;
+    bytes --;
+  }
+}
+
+
+#ifdef CUPS_RASTER_NEON
+/*
+ * 'cups_neon_literal()' - Count pixels that differ from the next using NEON.
+ */
+
+static size_t				/* O - Number of differing pixels */
+cups_neon_literal(
+    const unsigned char *p,		/* I - First pixel */
+    size_t              bpp,		/* I - Bytes per pixel */
+    size_t              count)		/* I - Maximum number of pixels */
+{
+  size_t	i = 0,			/* Current pixel */
+		j,			/* Pixel in vector */
+		n;			/* Pixels per vector */
+  unsigned char	lanes[16];		/* Lanes holding whole pixels */
+  uint8x16_t	lmask,			/* Mask for whole pixels */
+		eq;			/* Matching bytes */
+
+
+  if (bpp <= 16)
+  {
+   /*
+    * Compare each vector of whole pixels with the following pixels, and only
+    * look at individual pixels when some bytes match...
+    */
+
+    n = 16 / bpp;
+
+    memset(lanes, 0xff, n * bpp);
+    memset(lanes + n * bpp, 0, sizeof(lanes) - n * bpp);
+
+    lmask = vld1q_u8(lanes);
+
+    for (; (i * bpp + 16) <= count * bpp; i += n)
+    {
+      eq = vceqq_u8(vld1q_u8(p + i * bpp), vld1q_u8(p + i * bpp + bpp));
+
+      if (!vmaxvq_u8(vandq_u8(eq, lmask)))
+        continue;
+
+      if ((j = cups_generic_literal(p + i * bpp, bpp, n)) < n)
+        return (i + j);
+    }
+  }
+
+  return (i + cups_generic_literal(p + i * bpp, bpp, count - i));
+}
+
+
+/*
+ * 'cups_neon_repeat()' - Count leading matching bytes using NEON.
+ */
+
+static size_t				/* O - Number of matching bytes */
+cups_neon_repeat(
+    const unsigned char *a,		/* I - First buffer */
+    const unsigned char *b,		/* I - Second buffer */
+    size_t              bytes)		/* I - Number of bytes */
+{
+  size_t	i;			/* Current byte */
+
+
+  for (i = 0; (i + 16) <= bytes; i += 16)
+  {
+    if (vminvq_u8(vceqq_u8(vld1q_u8(a + i), vld1q_u8(b + i))) != 0xff)
+      return (i + cups_generic_repeat(a + i, b + i, 16));
+  }
+
+  return (i + cups_generic_repeat(a + i, b + i, bytes - i));
+}
+
+
+/*
+ * 'cups_neon_swap()' - Copy and swap 16-bit samples using NEON.
+ */
+
+static void
+cups_neon_swap(
+    unsigned char       *dst,		/* I - Destination */
+    const unsigned char *src,		/* I - Source */
+    size_t              bytes)		/* I - Number of bytes to swap */
+{
+  for (; bytes >= 16; bytes -= 16, dst += 16, src += 16)
+    vst1q_u8(dst, vrev16q_u8(vld1q_u8(src)));
+
+  cups_generic_swap(dst, src, bytes);
+}
+#endif /* CUPS_RASTER_NEON */
+
+
 /*
  * 'cups_raster_io()' - Read/write bytes from a context, handling interruptions.
  */
@@ -1402,6 +1793,29 @@ cups_raster_io(cups_raster_t *r,	/* I - Raster stream */
 }
 
 
+/*
+ * 'cups_raster_kernel()' - Find raster kernels supported by the CPU.
+ */
+
+static const _cups_raster_kernel_t *	/* O - Kernels or @code NULL@ */
+cups_raster_kernel(const char *name)	/* I - Name of kernels or @code NULL@ for the fastest */
+{
+  size_t	i;			/* Looping var */
+
+
+  for (i = 0; i < (sizeof(cups_kernels) / sizeof(cups_kernels[0])); i ++)
+  {
+    if (name && strcmp(name, cups_kernels[i].name))
+      continue;
+
+    if (!cups_kernels[i].supported || (cups_kernels[i].supported)())
+      return (cups_kernels + i);
+  }
+
+  return (NULL);
+}
+
+
 /*
  * 'cups_raster_read()' - Read through the raster buffer.
  */
@@ -1725,7 +2139,7 @@ cups_raster_write(
   if (r->swapped && (r->header.cupsBitsPerColor == 16 || r->header.cupsBitsPerPixel == 12 || r->header.cupsBitsPerPixel == 16))
   {
     DEBUG_puts("4cups_raster_write: Swapping bytes when writing.");
-    cf = (_cups_copyfunc_t)cups_swap_copy;
+    cf = (_cups_copyfunc_t)r->kernel->swap;
   }
   else
     cf = (_cups_copyfunc_t)memcpy;
@@ -1787,12 +2201,15 @@ cups_raster_write(
     else if (!memcmp(start, ptr, bpp))
     {
      /*
-      * Encode a sequence of repeating pixels...
+      * Encode a sequence of repeating pixels, up to 128 pixels - the first
+      * differing byte ends the run...
       */
 
-      for (count = 2; count < 128 && ptr < plast; count ++, ptr += bpp)
-        if (memcmp(ptr, ptr + bpp, bpp))
-	  break;
+      if ((count = (unsigned)((size_t)(plast - start) / bpp)) > 127)
+        count = 127;
+
+      count = (unsigned)((r->kernel->repeat)(start, ptr, count * bpp) / bpp) + 1;
+      ptr   = start + (count - 1) * bpp;
 
       *wptr++ = (unsigned char)(count - 1);
       (*cf)(wptr, ptr, bpp);
@@ -1802,12 +2219,16 @@ cups_raster_write(
     else
     {
      /*
-      * Encode a sequence of non-repeating pixels...
+      * Encode a sequence of non-repeating pixels, up to 128 pixels - the run
+      * ends before the first pixel that matches the next one...
       */
 
-      for (count = 1; count < 128 && ptr < plast; count ++, ptr += bpp)
-        if (!memcmp(ptr, ptr + bpp, bpp))
-	  break;
+      if ((count = (unsigned)((size_t)(plast - ptr) / bpp)) > 127)
+        count = 127;
+
+      count = (unsigned)(r->kernel->literal)(ptr, bpp, count);
+      ptr   += count * bpp;
+      count ++;
 
       if (ptr >= plast && count < 128)
       {
@@ -1828,52 +2249,97 @@ cups_raster_write(
   return (cups_raster_io(r, r->buffer, (size_t)(wptr - r->buffer)));
 }
 
-
+#ifdef CUPS_RASTER_SSE2
 /*
- * 'cups_swap()' - Swap bytes in raster data...
+ * 'cups_sse2_literal()' - Count pixels that differ from the next using SSE2.
  */
 
-static void
-cups_swap(unsigned char *buf,		/* I - Buffer to swap */
-          size_t        bytes)		/* I - Number of bytes to swap */
+static size_t				/* O - Number of differing pixels */
+cups_sse2_literal(
+    const unsigned char *p,		/* I - First pixel */
+    size_t              bpp,		/* I - Bytes per pixel */
+    size_t              count)		/* I - Maximum number of pixels */
 {
-  unsigned char	even, odd;		/* Temporary variables */
+  size_t	i = 0,			/* Current pixel */
+		j,			/* Pixel in vector */
+		n;			/* Pixels per vector */
+  unsigned	mask,			/* Matching bytes */
+		pmask;			/* Mask for one pixel */
 
 
-  bytes /= 2;
+  if (bpp <= 16)
+  {
+   /*
+    * Compare each vector of whole pixels with the following pixels, and only
+    * look at individual pixels when some bytes match...
+    */
 
-  while (bytes > 0)
+    n     = 16 / bpp;
+    pmask = (1U << bpp) - 1;
+
+    for (; (i * bpp + 16) <= count * bpp; i += n)
+    {
+      __m128i a = _mm_loadu_si128((const __m128i *)(p + i * bpp));
+      __m128i b = _mm_loadu_si128((const __m128i *)(p + i * bpp + bpp));
+
+      mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) & ((1U << (n * bpp)) - 1);
+
+      if (!mask)
+        continue;
+
+      for (j = 0; j < n; j ++, mask >>= bpp)
+        if ((mask & pmask) == pmask)
+          return (i + j);
+    }
+  }
+
+  return (i + cups_generic_literal(p + i * bpp, bpp, count - i));
+}
+
+
+/*
+ * 'cups_sse2_repeat()' - Count leading matching bytes using SSE2.
+ */
+
+static size_t				/* O - Number of matching bytes */
+cups_sse2_repeat(
+    const unsigned char *a,		/* I - First buffer */
+    const unsigned char *b,		/* I - Second buffer */
+    size_t              bytes)		/* I - Number of bytes */
+{
+  size_t	i;			/* Current byte */
+  unsigned	mask;			/* Matching bytes */
+
+
+  for (i = 0; (i + 16) <= bytes; i += 16)
   {
-    even   = buf[0];
-    odd    = buf[1];
-    buf[0] = odd;
-    buf[1] = even;
+    mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + i)), _mm_loadu_si128((const __m128i *)(b + i))));
 
-    buf += 2;
-    bytes --;
+    if (mask != 0xffff)
+      return (i + (size_t)__builtin_ctz(~mask));
   }
+
+  return (i + cups_generic_repeat(a + i, b + i, bytes - i));
 }
 
 
 /*
- * 'cups_swap_copy()' - Copy and swap bytes in raster data...
+ * 'cups_sse2_swap()' - Copy and swap 16-bit samples using SSE2.
  */
 
 static void
-cups_swap_copy(
+cups_sse2_swap(
     unsigned char       *dst,		/* I - Destination */
     const unsigned char *src,		/* I - Source */
     size_t              bytes)		/* I - Number of bytes to swap */
 {
-  bytes /= 2;
-
-  while (bytes > 0)
+  for (; bytes >= 16; bytes -= 16, dst += 16, src += 16)
   {
-    dst[0] = src[1];
-    dst[1] = src[0];
+    __m128i v = _mm_loadu_si128((const __m128i *)src);
 
-    dst += 2;
-    src += 2;
-    bytes --;
+    _mm_storeu_si128((__m128i *)dst, _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
   }
+
+  cups_generic_swap(dst, src, bytes);
 }
+#endif /* CUPS_RASTER_SSE2 */
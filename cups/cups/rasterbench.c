@@ -12,7 +12,7 @@
  */
 
 #include <config.h>
-#include <cups/raster.h>
+#include <cups/raster-private.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/time.h>
@@ -30,13 +30,35 @@
 #define TEST_PAGES	16
 #define TEST_PASSES	20
 
+#define KERNEL_WIDTH	5100		/* 8.5 inches at 600 dpi */
+#define KERNEL_HEIGHT	256
+#define KERNEL_PAGES	4
+#define KERNEL_PASSES	3
+
+
+/*
+ * Local types...
+ */
+
+typedef struct bench_buffer_s		/**** Memory buffer for kernel tests ****/
+{
+  unsigned char	*data;			/* Buffer data */
+  size_t	used,			/* Bytes used */
+		alloc,			/* Bytes allocated */
+		pos;			/* Current read position */
+} bench_buffer_t;
+
 
 /*
  * Local functions...
  */
 
+static ssize_t	buffer_read(bench_buffer_t *b, unsigned char *data, size_t bytes);
+static ssize_t	buffer_write(bench_buffer_t *b, unsigned char *data, size_t bytes);
 static double	compute_median(double *secs);
+static void	fill_data(unsigned char *data, size_t bytes, unsigned lines);
 static double	get_time(void);
+static int	kernel_test(void);
 static void	read_test(int fd);
 static int	run_read_test(void);
 static void	write_test(int fd, cups_mode_t mode);
@@ -64,12 +86,15 @@ main(int  argc,				/* I - Number of command-line args */
   * See if we have anything on the command-line...
   */
 
-  if (argc > 2 || (argc == 2 && strcmp(argv[1], "-z")))
+  if (argc > 2 || (argc == 2 && strcmp(argv[1], "-k") && strcmp(argv[1], "-z")))
   {
-    puts("Usage: rasterbench [-z]");
+    puts("Usage: rasterbench [-k] [-z]");
     return (1);
   }
 
+  if (argc == 2 && !strcmp(argv[1], "-k"))
+    return (kernel_test());
+
   mode = argc > 1 ? CUPS_RASTER_WRITE_COMPRESSED : CUPS_RASTER_WRITE;
 
  /*
@@ -113,6 +138,55 @@ main(int  argc,				/* I - Number of command-line args */
 }
 
 
+/*
+ * 'buffer_read()' - Read raster data from a memory buffer.
+ */
+
+static ssize_t				/* O - Bytes read */
+buffer_read(bench_buffer_t *b,		/* I - Buffer */
+            unsigned char  *data,	/* I - Data to read */
+            size_t         bytes)	/* I - Number of bytes to read */
+{
+  if (bytes > (b->used - b->pos))
+    bytes = b->used - b->pos;
+
+  memcpy(data, b->data + b->pos, bytes);
+  b->pos += bytes;
+
+  return ((ssize_t)bytes);
+}
+
+
+/*
+ * 'buffer_write()' - Write raster data to a memory buffer.
+ */
+
+static ssize_t				/* O - Bytes written or -1 on error */
+buffer_write(bench_buffer_t *b,		/* I - Buffer */
+             unsigned char  *data,	/* I - Data to write */
+             size_t         bytes)	/* I - Number of bytes to write */
+{
+  if ((b->used + bytes) > b->alloc)
+  {
+    size_t		alloc;		/* New allocation */
+    unsigned char	*temp;		/* New buffer */
+
+    for (alloc = b->alloc ? b->alloc : 1048576; alloc < (b->used + bytes); alloc *= 2);
+
+    if ((temp = realloc(b->data, alloc)) == NULL)
+      return (-1);
+
+    b->data  = temp;
+    b->alloc = alloc;
+  }
+
+  memcpy(b->data + b->used, data, bytes);
+  b->used += bytes;
+
+  return ((ssize_t)bytes);
+}
+
+
 /*
  * 'compute_median()' - Compute the median time for a test.
  */
@@ -145,6 +219,44 @@ compute_median(double *secs)		/* I - Array of time samples */
 }
 
 
+/*
+ * 'fill_data()' - Create a combination of random data and repeated data to
+ *                 simulate text with some whitespace.
+ */
+
+static void
+fill_data(unsigned char *data,		/* I - Lines of raster data */
+          size_t        bytes,		/* I - Bytes per line */
+          unsigned      lines)		/* I - Number of lines */
+{
+  unsigned	y;			/* Looping var */
+  size_t	x;			/* Looping var */
+  unsigned	count;			/* Number of bytes to set */
+
+
+  memset(data, 0, bytes * lines);
+
+  for (y = 0; y < (lines - lines / 8); y ++, data += bytes)
+  {
+    for (x = CUPS_RAND() & 127, count = (CUPS_RAND() & 15) + 1;
+         x < bytes;
+         x ++, count --)
+    {
+      if (count <= 0)
+      {
+	x     += (CUPS_RAND() & 15) + 1;
+	count = (CUPS_RAND() & 15) + 1;
+
+        if (x >= bytes)
+	  break;
+      }
+
+      data[x] = (unsigned char)CUPS_RAND();
+    }
+  }
+}
+
+
 /*
  * 'get_time()' - Get the current time in seconds.
  */
@@ -160,6 +272,171 @@ get_time(void)
 }
 
 
+/*
+ * 'kernel_test()' - Benchmark the raster kernels for each color space and bit
+ *                   depth.
+ */
+
+static int				/* O - Exit status */
+kernel_test(void)
+{
+  int			i, j, k, pass;	/* Looping vars */
+  unsigned		page, y;	/* Looping vars */
+  int			status = 0;	/* Exit status */
+  cups_raster_t		*r;		/* Raster stream */
+  cups_page_header2_t	header;		/* Page header */
+  bench_buffer_t	buffer;		/* Encoded raster data */
+  unsigned char		*data,		/* Raster data to write */
+			*line;		/* Line of raster data read */
+  double		start_secs,	/* Start time */
+			write_secs,	/* Best write time */
+			read_secs,	/* Best read time */
+			secs,		/* Elapsed time */
+			mbytes;		/* Megabytes of raster data */
+  int			errors;		/* Number of lines that differ */
+  static const char * const kernels[] =	/* Kernels to test */
+  {
+    "generic",
+    "sse2",
+    "avx2",
+    "neon"
+  };
+  static const struct
+  {
+    const char		*name;		/* Name of color space */
+    cups_cspace_t	cspace;		/* Color space */
+    unsigned		colors;		/* Number of colors */
+  }			cspaces[] =	/* Color spaces to test */
+  {
+    { "sgray", CUPS_CSPACE_SW,   1 },
+    { "srgb",  CUPS_CSPACE_SRGB, 3 },
+    { "cmyk",  CUPS_CSPACE_CMYK, 4 }
+  };
+  static const unsigned	depths[] =	/* Bit depths to test */
+  {
+    8,
+    16
+  };
+
+
+  printf("Test kernel speed of %d PWG raster pages, %dx%d pixels...\n\n", KERNEL_PAGES, KERNEL_WIDTH, KERNEL_HEIGHT);
+  printf("Kernel  Space  Depth  Write MB/s   Read MB/s\n");
+
+  CUPS_SRAND(time(NULL));
+
+  memset(&buffer, 0, sizeof(buffer));
+
+  for (i = 0; i < (int)(sizeof(kernels) / sizeof(kernels[0])); i ++)
+  {
+    if (!_cupsRasterSetKernel(kernels[i]))
+      continue;
+
+    for (j = 0; j < (int)(sizeof(cspaces) / sizeof(cspaces[0])); j ++)
+    {
+      for (k = 0; k < (int)(sizeof(depths) / sizeof(depths[0])); k ++)
+      {
+        memset(&header, 0, sizeof(header));
+	header.cupsWidth        = KERNEL_WIDTH;
+	header.cupsHeight       = KERNEL_HEIGHT;
+	header.HWResolution[0]  = 600;
+	header.HWResolution[1]  = 600;
+	header.cupsColorSpace   = cspaces[j].cspace;
+	header.cupsColorOrder   = CUPS_ORDER_CHUNKED;
+	header.cupsNumColors    = cspaces[j].colors;
+	header.cupsBitsPerColor = depths[k];
+	header.cupsBitsPerPixel = depths[k] * cspaces[j].colors;
+	header.cupsBytesPerLine = KERNEL_WIDTH * header.cupsBitsPerPixel / 8;
+
+        if ((data = malloc(32 * header.cupsBytesPerLine)) == NULL || (line = malloc(header.cupsBytesPerLine)) == NULL)
+        {
+          perror("Unable to allocate memory for raster data");
+          return (1);
+        }
+
+        fill_data(data, header.cupsBytesPerLine, 32);
+
+        mbytes     = (double)header.cupsBytesPerLine * KERNEL_HEIGHT * KERNEL_PAGES / 1048576.0;
+        write_secs = read_secs = 0.0;
+        errors     = 0;
+
+        for (pass = 0; pass < KERNEL_PASSES; pass ++)
+        {
+         /*
+          * Write the pages to memory...
+          */
+
+          buffer.used = 0;
+          start_secs  = get_time();
+
+	  if ((r = cupsRasterOpenIO((cups_raster_iocb_t)buffer_write, &buffer, CUPS_RASTER_WRITE_PWG)) == NULL)
+	  {
+	    perror("Unable to create raster output stream");
+	    return (1);
+	  }
+
+	  for (page = 0; page < KERNEL_PAGES; page ++)
+	  {
+	    cupsRasterWriteHeader2(r, &header);
+
+	    for (y = 0; y < KERNEL_HEIGHT; y ++)
+	      cupsRasterWritePixels(r, data + (y & 31) * header.cupsBytesPerLine, header.cupsBytesPerLine);
+	  }
+
+	  cupsRasterClose(r);
+
+	  secs = get_time() - start_secs;
+	  if (pass == 0 || secs < write_secs)
+	    write_secs = secs;
+
+         /*
+          * Then read them back and compare...
+          */
+
+          buffer.pos = 0;
+          start_secs = get_time();
+
+	  if ((r = cupsRasterOpenIO((cups_raster_iocb_t)buffer_read, &buffer, CUPS_RASTER_READ)) == NULL)
+	  {
+	    perror("Unable to create raster input stream");
+	    return (1);
+	  }
+
+          for (page = 0; page < KERNEL_PAGES && cupsRasterReadHeader2(r, &header); page ++)
+	  {
+	    for (y = 0; y < KERNEL_HEIGHT; y ++)
+	    {
+	      if (cupsRasterReadPixels(r, line, header.cupsBytesPerLine) != header.cupsBytesPerLine || memcmp(line, data + (y & 31) * header.cupsBytesPerLine, header.cupsBytesPerLine))
+	        errors ++;
+	    }
+	  }
+
+	  if (page < KERNEL_PAGES)
+	    errors ++;
+
+	  cupsRasterClose(r);
+
+	  secs = get_time() - start_secs;
+	  if (pass == 0 || secs < read_secs)
+	    read_secs = secs;
+        }
+
+        printf("%-7s %-6s %2u-bit %11.1f %11.1f%s\n", kernels[i], cspaces[j].name, depths[k], mbytes / write_secs, mbytes / read_secs, errors ? "  FAIL" : "");
+
+        if (errors)
+          status = 1;
+
+        free(data);
+        free(line);
+      }
+    }
+  }
+
+  free(buffer.data);
+
+  return (status);
+}
+
+
 /*
  * 'read_test()' - Benchmark the raster read functions.
  */
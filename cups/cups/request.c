@@ -23,11 +23,437 @@
 #ifndef O_BINARY
 #  define O_BINARY 0
 #endif /* O_BINARY */
+#ifdef HAVE_POLL
+#  include <poll.h>
+#endif /* HAVE_POLL */
 #ifndef MSG_DONTWAIT
 #  define MSG_DONTWAIT 0
 #endif /* !MSG_DONTWAIT */
 
 
+/*
+ * Local types...
+ */
+
+typedef struct _cups_areq_s		/**** Asynchronous request ****/
+{
+  struct _cups_areq_s	*next;		/* Next request on connection */
+  int			id;		/* Request ID */
+  ipp_t			*request;	/* IPP request */
+  char			*resource;	/* Resource path */
+  int			retries,	/* Number of times resent */
+			auth_tries;	/* Number of authentication attempts */
+  _cups_async_cb_t	cb;		/* Response callback */
+  void			*user_data;	/* User data for callback */
+} _cups_areq_t;
+
+typedef struct _cups_aconn_s		/**** Connection with requests ****/
+{
+  http_t		*http;		/* HTTP connection */
+  _cups_areq_t		*first,		/* First (oldest) request */
+			*last,		/* Last (newest) request */
+			*unsent;	/* First unsent request */
+  int			num_sent;	/* Number of requests awaiting response */
+} _cups_aconn_t;
+
+struct _cups_async_s			/**** Asynchronous request context ****/
+{
+  int			depth,		/* Maximum requests sent per connection */
+			last_id,	/* Last request ID */
+			num_pending,	/* Number of pending requests */
+			num_conns,	/* Number of connections */
+			alloc_conns;	/* Allocated connections */
+  _cups_aconn_t		*conns;		/* Connections */
+#ifdef HAVE_POLL
+  struct pollfd		*pfds;		/* Poll file descriptors */
+#endif /* HAVE_POLL */
+};
+
+typedef struct _cups_phost_s		/**** Pooled host ****/
+{
+  char			host[256];	/* Hostname or domain socket */
+  int			port;		/* Port number */
+  http_encryption_t	encryption;	/* Encryption setting */
+  char			user[256];	/* User the connection authenticates as */
+  int			num_conns;	/* Number of connections, idle or in use */
+} _cups_phost_t;
+
+typedef struct _cups_pconn_s		/**** Pooled connection ****/
+{
+  http_t		*http;		/* HTTP connection */
+  _cups_phost_t		*host;		/* Host for connection */
+  time_t		idle_time;	/* Time connection became idle, 0 if in use */
+} _cups_pconn_t;
+
+struct _cups_pool_s			/**** Connection pool ****/
+{
+  _cups_mutex_t		mutex;		/* Mutex for pool */
+  _cups_cond_t		cond;		/* Signaled when a connection is released */
+  int			max_per_host,	/* Maximum connections per host, 0 for no limit */
+			idle_timeout;	/* Seconds before idle connections are closed */
+  cups_array_t		*hosts,		/* Hosts */
+			*conns;		/* Connections */
+  _cups_pool_stats_t	stats;		/* Statistics */
+};
+
+
+/*
+ * Local globals...
+ */
+
+static _cups_mutex_t	pool_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for default pool */
+static _cups_pool_t	*pool_default = NULL;
+					/* Default pool for cupsDoRequest, etc. */
+
+
+/*
+ * Local functions...
+ */
+
+static void	async_finish(_cups_async_t *async, _cups_aconn_t *conn, http_status_t status, ipp_t *response);
+static void	async_read(_cups_async_t *async, int connidx);
+static void	async_requeue(_cups_async_t *async, _cups_aconn_t *conn, int retry);
+static void	async_send(_cups_async_t *async, _cups_aconn_t *conn);
+static int	connection_alive(http_t *http);
+static ipp_t	*cups_get_response(http_t *http, const char *resource, ipp_attribute_t **attr);
+static void	pool_close(_cups_pool_t *pool, _cups_pconn_t *conn);
+static int	pool_compare_hosts(_cups_phost_t *a, _cups_phost_t *b, void *data);
+
+
+/*
+ * '_cupsAsyncDelete()' - Free an asynchronous request context.
+ *
+ * Requests that have not completed are discarded without calling their
+ * callbacks.  The HTTP connections are not closed.
+ */
+
+void
+_cupsAsyncDelete(_cups_async_t *async)	/* I - Request context */
+{
+  int		i;			/* Looping var */
+  _cups_areq_t	*req,			/* Current request */
+		*next;			/* Next request */
+
+
+  if (!async)
+    return;
+
+  for (i = 0; i < async->num_conns; i ++)
+  {
+    for (req = async->conns[i].first; req; req = next)
+    {
+      next = req->next;
+
+      ippDelete(req->request);
+      free(req->resource);
+      free(req);
+    }
+  }
+
+  free(async->conns);
+#ifdef HAVE_POLL
+  free(async->pfds);
+#endif /* HAVE_POLL */
+  free(async);
+}
+
+
+/*
+ * '_cupsAsyncNew()' - Create an asynchronous request context.
+ *
+ * Requests submitted with @link _cupsAsyncSubmit@ are sent and their
+ * responses read by @link _cupsAsyncPoll@, which multiplexes any number of
+ * connections.  Up to "depth" requests are pipelined on each connection; a
+ * depth of 1 sends the next request only after the previous response has been
+ * read.
+ *
+ * A context must only be used from one thread at a time.
+ */
+
+_cups_async_t *				/* O - Request context or @code NULL@ on error */
+_cupsAsyncNew(int depth)		/* I - Maximum pipelined requests per connection or 0 for default */
+{
+  _cups_async_t	*async;			/* Request context */
+
+
+  if ((async = calloc(1, sizeof(_cups_async_t))) == NULL)
+    return (NULL);
+
+  async->depth = depth > 0 ? depth : 4;
+
+  return (async);
+}
+
+
+/*
+ * '_cupsAsyncPending()' - Return the number of pending requests.
+ */
+
+int					/* O - Number of pending requests */
+_cupsAsyncPending(_cups_async_t *async)	/* I - Request context */
+{
+  return (async ? async->num_pending : 0);
+}
+
+
+/*
+ * '_cupsAsyncPoll()' - Send queued requests and read available responses.
+ *
+ * This function sends as many queued requests as the pipeline depth allows,
+ * waits up to "msec" milliseconds for responses, and calls the callback for
+ * each response that is read.  Call it in a loop until it returns 0.
+ *
+ * Once a response starts arriving it is read completely, so a slow server can
+ * still delay the other connections by up to the connection timeout.
+ */
+
+int					/* O - Number of pending requests or -1 on error */
+_cupsAsyncPoll(_cups_async_t *async,	/* I - Request context */
+               int           msec)	/* I - Milliseconds to wait or -1 for forever */
+{
+  int		i,			/* Looping var */
+		nfds,			/* Number of file descriptors */
+		ready;			/* Number of ready descriptors */
+  _cups_aconn_t	*conn;			/* Current connection */
+#ifndef HAVE_POLL
+  int		maxfd = -1;		/* Highest file descriptor */
+  fd_set	input;			/* Input set */
+  struct timeval timeout;		/* Timeout */
+#endif /* !HAVE_POLL */
+
+
+  DEBUG_printf(("_cupsAsyncPoll(async=%p, msec=%d)", (void *)async, msec));
+
+  if (!async)
+    return (-1);
+
+ /*
+  * Send queued requests...
+  */
+
+  for (i = 0; i < async->num_conns; i ++)
+    async_send(async, async->conns + i);
+
+ /*
+  * Wait for responses...
+  */
+
+#ifndef HAVE_POLL
+  FD_ZERO(&input);
+#endif /* !HAVE_POLL */
+
+  for (i = 0, nfds = 0, conn = async->conns; i < async->num_conns; i ++, conn ++)
+  {
+    if (conn->num_sent == 0)
+      continue;
+
+    if (httpGetReady(conn->http))
+      msec = 0;
+
+#ifdef HAVE_POLL
+    async->pfds[nfds].fd      = httpGetFd(conn->http);
+    async->pfds[nfds].events  = POLLIN;
+    async->pfds[nfds].revents = 0;
+#else
+    FD_SET(httpGetFd(conn->http), &input);
+    if (httpGetFd(conn->http) > maxfd)
+      maxfd = httpGetFd(conn->http);
+#endif /* HAVE_POLL */
+
+    nfds ++;
+  }
+
+  if (nfds > 0)
+  {
+#ifdef HAVE_POLL
+    ready = poll(async->pfds, (nfds_t)nfds, msec);
+#else
+    timeout.tv_sec  = msec / 1000;
+    timeout.tv_usec = (msec % 1000) * 1000;
+
+    ready = select(maxfd + 1, &input, NULL, NULL, msec < 0 ? NULL : &timeout);
+#endif /* HAVE_POLL */
+
+    if (ready < 0 && errno != EINTR && errno != EAGAIN)
+      return (-1);
+
+   /*
+    * Read the responses that are available, in the same order the
+    * descriptors were added.  Callbacks may submit new requests, which can
+    * grow (and move) the connection and poll arrays, so always index them...
+    */
+
+    for (i = 0, nfds = 0; i < async->num_conns; i ++)
+    {
+      int	revents;		/* Returned events */
+
+      if (async->conns[i].num_sent == 0)
+        continue;
+
+#ifdef HAVE_POLL
+      revents = async->pfds[nfds].revents;
+#else
+      revents = FD_ISSET(httpGetFd(async->conns[i].http), &input);
+#endif /* HAVE_POLL */
+
+      nfds ++;
+
+      if (revents || httpGetReady(async->conns[i].http))
+      {
+        do
+	{
+	  async_read(async, i);
+	}
+	while (async->conns[i].num_sent > 0 && httpGetReady(async->conns[i].http));
+
+        async_send(async, async->conns + i);
+      }
+    }
+  }
+
+ /*
+  * Forget connections that have nothing left to do...
+  */
+
+  for (i = 0, conn = async->conns; i < async->num_conns; i ++, conn ++)
+  {
+    if (!conn->first)
+    {
+      async->num_conns --;
+      if (i < async->num_conns)
+        memmove(conn, conn + 1, (size_t)(async->num_conns - i) * sizeof(_cups_aconn_t));
+
+      i --;
+      conn --;
+    }
+  }
+
+  return (async->num_pending);
+}
+
+
+/*
+ * '_cupsAsyncSubmit()' - Queue an IPP request on a connection.
+ *
+ * The request is sent by a later call to @link _cupsAsyncPoll@ and freed when
+ * the response has been received.  The callback gets the HTTP status and the
+ * response, which it must free with @link ippDelete@.  Requests on the same
+ * connection complete in the order they are submitted.
+ *
+ * Document data cannot be sent with asynchronous requests.
+ */
+
+int					/* O - Request ID or 0 on error */
+_cupsAsyncSubmit(
+    _cups_async_t    *async,		/* I - Request context */
+    http_t           *http,		/* I - Connection to server */
+    ipp_t            *request,		/* I - IPP request */
+    const char       *resource,		/* I - Resource path */
+    _cups_async_cb_t cb,		/* I - Response callback */
+    void             *user_data)	/* I - User data for callback */
+{
+  int		i;			/* Looping var */
+  _cups_aconn_t	*conn;			/* Connection */
+  _cups_areq_t	*req;			/* New request */
+
+
+  DEBUG_printf(("_cupsAsyncSubmit(async=%p, http=%p, request=%p(%s), resource=\"%s\", cb=%p, user_data=%p)", (void *)async, (void *)http, (void *)request, request ? ippOpString(request->request.op.operation_id) : "?", resource, (void *)cb, user_data));
+
+  if (!async || !http || !request || !resource || !cb)
+  {
+    ippDelete(request);
+    _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(EINVAL), 0);
+    return (0);
+  }
+
+ /*
+  * Find or add the connection...
+  */
+
+  for (i = 0, conn = async->conns; i < async->num_conns; i ++, conn ++)
+    if (conn->http == http)
+      break;
+
+  if (i >= async->num_conns)
+  {
+    if (async->num_conns >= async->alloc_conns)
+    {
+      int		alloc_conns = async->alloc_conns + 16;
+					/* New allocation */
+      _cups_aconn_t	*conns;		/* New connections */
+#ifdef HAVE_POLL
+      struct pollfd	*pfds;		/* New poll file descriptors */
+#endif /* HAVE_POLL */
+
+      if ((conns = realloc(async->conns, (size_t)alloc_conns * sizeof(_cups_aconn_t))) == NULL)
+      {
+        ippDelete(request);
+        _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(errno), 0);
+	return (0);
+      }
+
+      async->conns = conns;
+
+#ifdef HAVE_POLL
+     /*
+      * Grow the poll array in place, since a callback may submit a request
+      * while _cupsAsyncPoll is still reading the returned events...
+      */
+
+      if ((pfds = realloc(async->pfds, (size_t)alloc_conns * sizeof(struct pollfd))) == NULL)
+      {
+        ippDelete(request);
+        _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(errno), 0);
+	return (0);
+      }
+
+      async->pfds = pfds;
+#endif /* HAVE_POLL */
+
+      async->alloc_conns = alloc_conns;
+    }
+
+    conn = async->conns + async->num_conns;
+    async->num_conns ++;
+
+    memset(conn, 0, sizeof(_cups_aconn_t));
+    conn->http = http;
+  }
+
+ /*
+  * Add the request...
+  */
+
+  if ((req = calloc(1, sizeof(_cups_areq_t))) == NULL || (req->resource = strdup(resource)) == NULL)
+  {
+    free(req);
+    ippDelete(request);
+    _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(errno), 0);
+    return (0);
+  }
+
+  req->id        = ++ async->last_id;
+  req->request   = request;
+  req->cb        = cb;
+  req->user_data = user_data;
+
+  if (conn->last)
+    conn->last->next = req;
+  else
+    conn->first = req;
+
+  conn->last = req;
+
+  if (!conn->unsent)
+    conn->unsent = req;
+
+  async->num_pending ++;
+
+  return (req->id);
+}
+
+
 /*
  * 'cupsDoFileRequest()' - Do an IPP request with a file.
  *
@@ -105,6 +531,7 @@ cupsDoIORequest(http_t     *http,	/* I - Connection to server or @code CUPS_HTTP
   struct stat	fileinfo;		/* File information */
   ssize_t	bytes;			/* Number of bytes read/written */
   char		buffer[32768];		/* Output buffer */
+  _cups_globals_t *cg = NULL;		/* Globals if using a pooled connection */
 
 
   DEBUG_printf(("cupsDoIORequest(http=%p, request=%p(%s), resource=\"%s\", infile=%d, outfile=%d)", (void *)http, (void *)request, request ? ippOpString(request->request.op.operation_id) : "?", resource, infile, outfile));
@@ -126,11 +553,22 @@ cupsDoIORequest(http_t     *http,	/* I - Connection to server or @code CUPS_HTTP
   * Get the default connection as needed...
   */
 
-  if (!http && (http = _cupsConnect()) == NULL)
+  if (!http)
   {
-    ippDelete(request);
+    if ((http = _cupsConnect()) == NULL)
+    {
+      ippDelete(request);
 
-    return (NULL);
+      return (NULL);
+    }
+
+   /*
+    * Hand pooled connections back when we are done so other threads can use
+    * them...
+    */
+
+    if ((cg = _cupsGlobals())->http_pool == NULL)
+      cg = NULL;
   }
 
  /*
@@ -148,6 +586,9 @@ cupsDoIORequest(http_t     *http,	/* I - Connection to server or @code CUPS_HTTP
       _cupsSetError(errno == EBADF ? IPP_STATUS_ERROR_NOT_FOUND : IPP_STATUS_ERROR_NOT_AUTHORIZED, NULL, 0);
       ippDelete(request);
 
+      if (cg)
+        _cupsDisconnect(cg);
+
       return (NULL);
     }
 
@@ -164,6 +605,9 @@ cupsDoIORequest(http_t     *http,	/* I - Connection to server or @code CUPS_HTTP
       _cupsSetError(IPP_STATUS_ERROR_NOT_POSSIBLE, strerror(EISDIR), 0);
       ippDelete(request);
 
+      if (cg)
+        _cupsDisconnect(cg);
+
       return (NULL);
     }
 
@@ -266,6 +710,9 @@ cupsDoIORequest(http_t     *http,	/* I - Connection to server or @code CUPS_HTTP
 
   ippDelete(request);
 
+  if (cg)
+    _cupsDisconnect(cg);
+
   return (response);
 }
 
@@ -303,212 +750,397 @@ ipp_t *					/* O - Response or @code NULL@ on HTTP error */
 cupsGetResponse(http_t     *http,	/* I - Connection to server or @code CUPS_HTTP_DEFAULT@ */
                 const char *resource)	/* I - HTTP resource for POST */
 {
-  http_status_t	status;			/* HTTP status */
-  ipp_state_t	state;			/* IPP read state */
-  ipp_t		*response = NULL;	/* IPP response */
+  ipp_t		*response;		/* IPP response */
+  _cups_globals_t *cg;			/* Pointer to library globals */
+  char		ch;			/* Peeked response data */
 
 
   DEBUG_printf(("cupsGetResponse(http=%p, resource=\"%s\")", (void *)http, resource));
-  DEBUG_printf(("1cupsGetResponse: http->state=%d", http ? http->state : HTTP_STATE_ERROR));
 
- /*
-  * Connect to the default server as needed...
-  */
-
-  if (!http)
-  {
-    _cups_globals_t *cg = _cupsGlobals();
-					/* Pointer to library globals */
-
-    if ((http = cg->http) == NULL)
-    {
-      _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("No active connection."), 1);
-      DEBUG_puts("1cupsGetResponse: No active connection - returning NULL.");
-      return (NULL);
-    }
-  }
-
-  if (http->state != HTTP_STATE_POST_RECV && http->state != HTTP_STATE_POST_SEND)
-  {
-    _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("No request sent."), 1);
-    DEBUG_puts("1cupsGetResponse: Not in POST state - returning NULL.");
-    return (NULL);
-  }
-
- /*
-  * Check for an unfinished chunked request...
-  */
+  response = cups_get_response(http, resource, NULL);
 
-  if (http->data_encoding == HTTP_ENCODING_CHUNKED)
+  if (!http && (cg = _cupsGlobals())->http_pool && (http = cg->http) != NULL)
   {
    /*
-    * Send a 0-length chunk to finish off the request...
+    * A chunked response ends with a zero-length chunk that ippRead leaves
+    * unread - finish the response if that is all that follows the IPP
+    * message, then hand the pooled default connection back unless response
+    * data follows...
     */
 
-    DEBUG_puts("2cupsGetResponse: Finishing chunked POST...");
+    if (response && http->state == HTTP_STATE_POST_SEND && http->data_encoding == HTTP_ENCODING_CHUNKED && http->data_remaining <= 0 && !httpPeek(http, &ch, 1) && http->data_encoding == HTTP_ENCODING_FIELDS)
+      http->state = HTTP_STATE_WAITING;
 
-    if (httpWrite2(http, "", 0) < 0)
-      return (NULL);
+    if (http->state == HTTP_STATE_WAITING)
+      _cupsConnectRelease();
   }
 
- /*
-  * Wait for a response from the server...
-  */
+  return (response);
+}
 
-  DEBUG_printf(("2cupsGetResponse: Update loop, http->status=%d...",
-                http->status));
 
-  do
-  {
-    status = httpUpdate(http);
-  }
-  while (status == HTTP_STATUS_CONTINUE);
+/*
+ * 'cupsLastError()' - Return the last IPP status code received on the current
+ *                     thread.
+ */
 
-  DEBUG_printf(("2cupsGetResponse: status=%d", status));
+ipp_status_t				/* O - IPP status code from last request */
+cupsLastError(void)
+{
+  return (_cupsGlobals()->last_error);
+}
 
-  if (status == HTTP_STATUS_OK)
-  {
-   /*
-    * Get the IPP response...
-    */
 
-    response = ippNew();
+/*
+ * 'cupsLastErrorString()' - Return the last IPP status-message received on the
+ *                           current thread.
+ *
+ * @since CUPS 1.2/macOS 10.5@
+ */
 
-    while ((state = ippRead(http, response)) != IPP_STATE_DATA)
-      if (state == IPP_STATE_ERROR)
-	break;
+const char *				/* O - status-message text from last request */
+cupsLastErrorString(void)
+{
+  return (_cupsGlobals()->last_status_message);
+}
 
-    if (state == IPP_STATE_ERROR)
-    {
-     /*
-      * Flush remaining data and delete the response...
-      */
 
-      DEBUG_puts("1cupsGetResponse: IPP read error!");
+/*
+ * '_cupsNextDelay()' - Return the next retry delay value.
+ *
+ * This function currently returns the Fibonacci sequence 1 1 2 3 5 8.
+ *
+ * Pass 0 for the current delay value to initialize the sequence.
+ */
 
-      httpFlush(http);
+int					/* O  - Next delay value */
+_cupsNextDelay(int current,		/* I  - Current delay value or 0 */
+               int *previous)		/* IO - Previous delay value */
+{
+  int	next;				/* Next delay value */
 
-      ippDelete(response);
-      response = NULL;
 
-      http->status = status = HTTP_STATUS_ERROR;
-      http->error  = EINVAL;
+  if (current > 0)
+  {
+    next      = (current + *previous) % 12;
+    *previous = next < current ? 0 : current;
+  }
+  else
+  {
+    next      = 1;
+    *previous = 0;
+  }
+
+  return (next);
+}
+
+
+/*
+ * '_cupsPoolAcquire()' - Get a connection from a pool.
+ *
+ * An idle connection to the same host, port, and encryption that was used by
+ * the same user is reused when one is still established, since connections
+ * keep their authentication state.  Otherwise a new connection is made unless
+ * the host already has the maximum number of connections for that user, in
+ * which case this function waits up to 30 seconds for another thread to
+ * release one.
+ *
+ * The connection must be returned with @link _cupsPoolRelease@.
+ */
+
+http_t *				/* O - HTTP connection or @code NULL@ on error */
+_cupsPoolAcquire(
+    _cups_pool_t      *pool,		/* I - Connection pool */
+    const char        *host,		/* I - Hostname or domain socket */
+    int               port,		/* I - Port number */
+    http_encryption_t encryption,	/* I - Encryption setting */
+    const char        *user)		/* I - Username or @code NULL@ for none */
+{
+  _cups_phost_t	key,			/* Search key */
+		*phost;			/* Pooled host */
+  _cups_pconn_t	*conn;			/* Pooled connection */
+  http_t	*http = NULL;		/* HTTP connection */
+  time_t	curtime,		/* Current time */
+		endtime;		/* Time to stop waiting */
+  int		waited = 0;		/* Did we wait for a connection? */
+
+
+  DEBUG_printf(("_cupsPoolAcquire(pool=%p, host=\"%s\", port=%d, encryption=%d, user=\"%s\")", (void *)pool, host, port, encryption, user));
+
+  if (!pool || !host)
+  {
+    _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(EINVAL), 0);
+    return (NULL);
+  }
+
+  memset(&key, 0, sizeof(key));
+  strlcpy(key.host, host, sizeof(key.host));
+  key.port       = port;
+  key.encryption = encryption;
+  if (user)
+    strlcpy(key.user, user, sizeof(key.user));
+
+  _cupsMutexLock(&pool->mutex);
+
+  if ((phost = (_cups_phost_t *)cupsArrayFind(pool->hosts, &key)) == NULL)
+  {
+    if ((phost = (_cups_phost_t *)calloc(1, sizeof(_cups_phost_t))) == NULL)
+    {
+      _cupsMutexUnlock(&pool->mutex);
+      _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(errno), 0);
+      return (NULL);
     }
+
+    *phost = key;
+    cupsArrayAdd(pool->hosts, phost);
   }
-  else if (status != HTTP_STATUS_ERROR)
+
+  endtime = time(NULL) + 30;
+
+  for (;;)
   {
    /*
-    * Flush any error message...
+    * Close expired connections and look for an idle one we can reuse...
     */
 
-    httpFlush(http);
+    curtime = time(NULL);
 
-   /*
-    * Then handle encryption and authentication...
-    */
+    for (conn = (_cups_pconn_t *)cupsArrayFirst(pool->conns); conn; conn = (_cups_pconn_t *)cupsArrayNext(pool->conns))
+    {
+      if (!conn->idle_time)
+        continue;
 
-    if (status == HTTP_STATUS_UNAUTHORIZED)
+      if ((curtime - conn->idle_time) >= pool->idle_timeout)
+      {
+        pool_close(pool, conn);
+      }
+      else if (conn->host == phost)
+      {
+        if (connection_alive(conn->http))
+        {
+          conn->idle_time = 0;
+          http            = conn->http;
+          pool->stats.hits ++;
+          break;
+        }
+
+        pool_close(pool, conn);
+      }
+    }
+
+    if (http)
+      break;
+
+    if (!pool->max_per_host || phost->num_conns < pool->max_per_host)
     {
      /*
-      * See if we can do authentication...
+      * Make a new connection, reserving its slot while the lock is dropped...
       */
 
-      DEBUG_puts("2cupsGetResponse: Need authorization...");
+      phost->num_conns ++;
+      pool->stats.misses ++;
 
-      if (!cupsDoAuthentication(http, "POST", resource))
-        httpReconnect2(http, 30000, NULL);
+      _cupsMutexUnlock(&pool->mutex);
+      http = httpConnect2(host, port, NULL, AF_UNSPEC, encryption, 1, 30000, NULL);
+      _cupsMutexLock(&pool->mutex);
+
+      if (http && (conn = (_cups_pconn_t *)calloc(1, sizeof(_cups_pconn_t))) != NULL)
+      {
+        conn->http = http;
+        conn->host = phost;
+
+        cupsArrayAdd(pool->conns, conn);
+      }
       else
-        http->status = status = HTTP_STATUS_CUPS_AUTHORIZATION_CANCELED;
-    }
+      {
+        httpClose(http);
+        http = NULL;
 
-#ifdef HAVE_SSL
-    else if (status == HTTP_STATUS_UPGRADE_REQUIRED)
-    {
-     /*
-      * Force a reconnect with encryption...
-      */
+        phost->num_conns --;
+        _cupsCondBroadcast(&pool->cond);
+      }
+      break;
+    }
 
-      DEBUG_puts("2cupsGetResponse: Need encryption...");
+    if (curtime >= endtime)
+      break;
 
-      if (!httpReconnect2(http, 30000, NULL))
-        httpEncryption(http, HTTP_ENCRYPTION_REQUIRED);
+    if (!waited)
+    {
+      waited = 1;
+      pool->stats.waits ++;
     }
-#endif /* HAVE_SSL */
+
+    _cupsCondWait(&pool->cond, &pool->mutex, (double)(endtime - curtime));
   }
 
-  if (response)
+  _cupsMutexUnlock(&pool->mutex);
+
+  if (!http)
   {
-    ipp_attribute_t	*attr;		/* status-message attribute */
+    if (errno)
+      _cupsSetError(IPP_STATUS_ERROR_SERVICE_UNAVAILABLE, NULL, 0);
+    else
+      _cupsSetError(IPP_STATUS_ERROR_SERVICE_UNAVAILABLE, _("Unable to connect to host."), 1);
+  }
 
+  DEBUG_printf(("1_cupsPoolAcquire: Returning %p.", (void *)http));
 
-    attr = ippFindAttribute(response, "status-message", IPP_TAG_TEXT);
+  return (http);
+}
 
-    DEBUG_printf(("1cupsGetResponse: status-code=%s, status-message=\"%s\"",
-                  ippErrorString(response->request.status.status_code),
-                  attr ? attr->values[0].string.text : ""));
 
-    _cupsSetError(response->request.status.status_code,
-                  attr ? attr->values[0].string.text :
-		      ippErrorString(response->request.status.status_code), 0);
+/*
+ * '_cupsPoolDelete()' - Close all connections and free a pool.
+ *
+ * The pool must not be the default pool and none of its connections may
+ * still be in use.
+ */
+
+void
+_cupsPoolDelete(_cups_pool_t *pool)	/* I - Connection pool */
+{
+  _cups_pconn_t	*conn;			/* Pooled connection */
+  _cups_phost_t	*phost;			/* Pooled host */
+
+
+  if (!pool)
+    return;
+
+  for (conn = (_cups_pconn_t *)cupsArrayFirst(pool->conns); conn; conn = (_cups_pconn_t *)cupsArrayNext(pool->conns))
+  {
+    httpClose(conn->http);
+    free(conn);
   }
 
-  return (response);
+  for (phost = (_cups_phost_t *)cupsArrayFirst(pool->hosts); phost; phost = (_cups_phost_t *)cupsArrayNext(pool->hosts))
+    free(phost);
+
+  cupsArrayDelete(pool->conns);
+  cupsArrayDelete(pool->hosts);
+
+  free(pool);
 }
 
 
 /*
- * 'cupsLastError()' - Return the last IPP status code received on the current
- *                     thread.
+ * '_cupsPoolGetStats()' - Get the connection statistics for a pool.
+ *
+ * "hits" counts connections that were reused, "misses" new connections,
+ * "waits" requests that had to wait for a connection, and "closed" connections
+ * that were closed because they expired, failed, or were dropped by the server.
  */
 
-ipp_status_t				/* O - IPP status code from last request */
-cupsLastError(void)
+void
+_cupsPoolGetStats(
+    _cups_pool_t       *pool,		/* I - Connection pool */
+    _cups_pool_stats_t *stats)		/* O - Statistics */
 {
-  return (_cupsGlobals()->last_error);
+  if (!stats)
+    return;
+
+  if (!pool)
+  {
+    memset(stats, 0, sizeof(_cups_pool_stats_t));
+    return;
+  }
+
+  _cupsMutexLock(&pool->mutex);
+  *stats = pool->stats;
+  _cupsMutexUnlock(&pool->mutex);
 }
 
 
 /*
- * 'cupsLastErrorString()' - Return the last IPP status-message received on the
- *                           current thread.
+ * '_cupsPoolNew()' - Create a connection pool.
  *
- * @since CUPS 1.2/macOS 10.5@
+ * Connections are keyed by host, port, encryption, and user.  Pass 0 for
+ * "max_per_host" to allow any number of connections per host and 0 for
+ * "idle_timeout" to close idle connections after 60 seconds.
  */
 
-const char *				/* O - status-message text from last request */
-cupsLastErrorString(void)
+_cups_pool_t *				/* O - Connection pool or @code NULL@ on error */
+_cupsPoolNew(int max_per_host,		/* I - Maximum connections per host or 0 for no limit */
+             int idle_timeout)		/* I - Seconds to keep idle connections or 0 for default */
 {
-  return (_cupsGlobals()->last_status_message);
+  _cups_pool_t	*pool;			/* Connection pool */
+
+
+  if ((pool = (_cups_pool_t *)calloc(1, sizeof(_cups_pool_t))) == NULL)
+    return (NULL);
+
+  pool->max_per_host = max_per_host > 0 ? max_per_host : 0;
+  pool->idle_timeout = idle_timeout > 0 ? idle_timeout : 60;
+  pool->hosts        = cupsArrayNew((cups_array_func_t)pool_compare_hosts, NULL);
+  pool->conns        = cupsArrayNew(NULL, NULL);
+
+  if (!pool->hosts || !pool->conns)
+  {
+    cupsArrayDelete(pool->hosts);
+    cupsArrayDelete(pool->conns);
+    free(pool);
+    return (NULL);
+  }
+
+  _cupsMutexInit(&pool->mutex);
+  _cupsCondInit(&pool->cond);
+
+  return (pool);
 }
 
 
 /*
- * '_cupsNextDelay()' - Return the next retry delay value.
- *
- * This function currently returns the Fibonacci sequence 1 1 2 3 5 8.
+ * '_cupsPoolRelease()' - Return a connection to a pool.
  *
- * Pass 0 for the current delay value to initialize the sequence.
+ * Connections that are in the middle of a request or have an error are
+ * closed, everything else stays open for reuse until the idle timeout.
  */
 
-int					/* O  - Next delay value */
-_cupsNextDelay(int current,		/* I  - Current delay value or 0 */
-               int *previous)		/* IO - Previous delay value */
+void
+_cupsPoolRelease(_cups_pool_t *pool,	/* I - Connection pool */
+                 http_t       *http)	/* I - HTTP connection */
 {
-  int	next;				/* Next delay value */
+  _cups_pconn_t	*conn;			/* Pooled connection */
 
 
-  if (current > 0)
-  {
-    next      = (current + *previous) % 12;
-    *previous = next < current ? 0 : current;
-  }
+  DEBUG_printf(("_cupsPoolRelease(pool=%p, http=%p)", (void *)pool, (void *)http));
+
+  if (!pool || !http)
+    return;
+
+  _cupsMutexLock(&pool->mutex);
+
+  for (conn = (_cups_pconn_t *)cupsArrayFirst(pool->conns); conn; conn = (_cups_pconn_t *)cupsArrayNext(pool->conns))
+    if (conn->http == http)
+      break;
+
+  if (!conn)
+    httpClose(http);
+  else if (http->state != HTTP_STATE_WAITING || http->error)
+    pool_close(pool, conn);
   else
-  {
-    next      = 1;
-    *previous = 0;
-  }
+    conn->idle_time = time(NULL);
 
-  return (next);
+  _cupsCondBroadcast(&pool->cond);
+  _cupsMutexUnlock(&pool->mutex);
+}
+
+
+/*
+ * '_cupsPoolSetDefault()' - Set the pool used for the default connection.
+ *
+ * When a default pool is set, @code CUPS_HTTP_DEFAULT@ requests from every
+ * thread share its connections instead of keeping one per thread.  Pass
+ * @code NULL@ to go back to per-thread connections.  The pool must stay
+ * around until every thread has stopped using it.
+ */
+
+void
+_cupsPoolSetDefault(_cups_pool_t *pool)	/* I - Connection pool or @code NULL@ */
+{
+  _cupsMutexLock(&pool_mutex);
+  pool_default = pool;
+  _cupsMutexUnlock(&pool_mutex);
 }
 
 
@@ -538,12 +1170,22 @@ cupsReadResponseData(
   {
     _cups_globals_t *cg = _cupsGlobals();
 					/* Pointer to library globals */
+    ssize_t	bytes;			/* Bytes read */
 
     if ((http = cg->http) == NULL)
     {
       _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("No active connection"), 1);
       return (-1);
     }
+
+   /*
+    * Hand a pooled default connection back once the response has been read...
+    */
+
+    if ((bytes = httpRead2(http, buffer, length)) <= 0)
+      _cupsConnectRelease();
+
+    return (bytes);
   }
 
  /*
@@ -603,8 +1245,21 @@ cupsSendRequest(http_t     *http,	/* I - Connection to server or @code CUPS_HTTP
   * Get the default connection as needed...
   */
 
-  if (!http && (http = _cupsConnect()) == NULL)
-    return (HTTP_STATUS_SERVICE_UNAVAILABLE);
+  if (!http)
+  {
+    if ((http = _cupsConnect()) == NULL)
+      return (HTTP_STATUS_SERVICE_UNAVAILABLE);
+
+   /*
+    * Hand a pooled default connection back if the request was not sent,
+    * otherwise cupsGetResponse does it...
+    */
+
+    if ((status = cupsSendRequest(http, request, resource, length)) != HTTP_STATUS_CONTINUE && status != HTTP_STATUS_OK)
+      _cupsConnectRelease();
+
+    return (status);
+  }
 
  /*
   * If the prior request was not flushed out, do so now...
@@ -891,65 +1546,149 @@ cupsSendRequest(http_t     *http,	/* I - Connection to server or @code CUPS_HTTP
 
 
 /*
- * 'cupsWriteRequestData()' - Write additional data after an IPP request.
- *
- * This function is used after @link cupsSendRequest@ to provide a PPD and
- * after @link cupsStartDocument@ to provide a document file.
+ * '_cupsStreamRequest()' - Do an IPP request and start reading the response.
  *
- * @since CUPS 1.4/macOS 10.6@
+ * This function works like @link cupsDoRequest@ except that only the
+ * operation attributes of the response are read.  The first attribute after
+ * them, if any, is returned in "attr" and the rest are read one at a time with
+ * @code _ippReadAttribute@, so large responses such as job lists don't need to
+ * be held in memory.  Because the response is read from the connection, no
+ * other requests can be sent on it until the response has been read or
+ * flushed.  The request is freed with @link ippDelete@.
  */
 
-http_status_t				/* O - @code HTTP_STATUS_CONTINUE@ if OK or HTTP status on error */
-cupsWriteRequestData(
-    http_t     *http,			/* I - Connection to server or @code CUPS_HTTP_DEFAULT@ */
-    const char *buffer,			/* I - Bytes to write */
-    size_t     length)			/* I - Number of bytes to write */
+ipp_t *					/* O - Response or @code NULL@ on error */
+_cupsStreamRequest(
+    http_t          *http,		/* I - Connection to server */
+    ipp_t           *request,		/* I - IPP request */
+    const char      *resource,		/* I - HTTP resource for POST */
+    ipp_attribute_t **attr)		/* O - First attribute after the operation attributes */
 {
-  int	wused;				/* Previous bytes in buffer */
+  ipp_t		*response = NULL;	/* IPP response data */
+  http_status_t	status;			/* Status of HTTP request */
 
 
- /*
-  * Get the default connection as needed...
-  */
+  DEBUG_printf(("_cupsStreamRequest(http=%p, request=%p(%s), resource=\"%s\", attr=%p)", (void *)http, (void *)request, request ? ippOpString(request->request.op.operation_id) : "?", resource, (void *)attr));
 
-  DEBUG_printf(("cupsWriteRequestData(http=%p, buffer=%p, length=" CUPS_LLFMT ")", (void *)http, (void *)buffer, CUPS_LLCAST length));
+  if (attr)
+    *attr = NULL;
 
-  if (!http)
+  if (!http || !request || !resource || !attr)
   {
-    _cups_globals_t *cg = _cupsGlobals();
-					/* Pointer to library globals */
+    ippDelete(request);
 
-    if ((http = cg->http) == NULL)
-    {
-      _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("No active connection"), 1);
-      DEBUG_puts("1cupsWriteRequestData: Returning HTTP_STATUS_ERROR.");
-      return (HTTP_STATUS_ERROR);
-    }
+    _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(EINVAL), 0);
+
+    return (NULL);
   }
 
  /*
-  * Then write to the HTTP connection...
+  * Clear any "Local" authentication data since it is probably stale...
   */
 
-  wused = http->wused;
-
-  if (httpWrite2(http, buffer, length) < 0)
-  {
-    DEBUG_puts("1cupsWriteRequestData: Returning HTTP_STATUS_ERROR.");
-    _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(http->error), 0);
-    return (HTTP_STATUS_ERROR);
-  }
+  if (http->authstring && !strncmp(http->authstring, "Local ", 6))
+    httpSetAuthString(http, NULL, NULL);
 
  /*
-  * Finally, check if we have any pending data from the server...
+  * Loop until we can send the request without authorization problems.
   */
 
-  if (length >= HTTP_MAX_BUFFER ||
-      http->wused < wused ||
-      (wused > 0 && (size_t)http->wused == length))
+  while (response == NULL)
   {
-   /*
-    * We've written something to the server, so check for response data...
+    status = cupsSendRequest(http, request, resource, ippLength(request));
+
+    if (status <= HTTP_STATUS_CONTINUE || status == HTTP_STATUS_OK)
+    {
+      response = cups_get_response(http, resource, attr);
+      status   = httpGetStatus(http);
+    }
+
+    DEBUG_printf(("2_cupsStreamRequest: status=%d", status));
+
+    if (status == HTTP_STATUS_ERROR ||
+        (status >= HTTP_STATUS_BAD_REQUEST && status != HTTP_STATUS_UNAUTHORIZED &&
+	 status != HTTP_STATUS_UPGRADE_REQUIRED))
+    {
+      _cupsSetHTTPError(status);
+      break;
+    }
+
+    if (!response && http->state != HTTP_STATE_WAITING)
+    {
+     /*
+      * Flush any remaining data...
+      */
+
+      httpFlush(http);
+    }
+  }
+
+  ippDelete(request);
+
+  return (response);
+}
+
+
+/*
+ * 'cupsWriteRequestData()' - Write additional data after an IPP request.
+ *
+ * This function is used after @link cupsSendRequest@ to provide a PPD and
+ * after @link cupsStartDocument@ to provide a document file.
+ *
+ * @since CUPS 1.4/macOS 10.6@
+ */
+
+http_status_t				/* O - @code HTTP_STATUS_CONTINUE@ if OK or HTTP status on error */
+cupsWriteRequestData(
+    http_t     *http,			/* I - Connection to server or @code CUPS_HTTP_DEFAULT@ */
+    const char *buffer,			/* I - Bytes to write */
+    size_t     length)			/* I - Number of bytes to write */
+{
+  int	wused;				/* Previous bytes in buffer */
+
+
+ /*
+  * Get the default connection as needed...
+  */
+
+  DEBUG_printf(("cupsWriteRequestData(http=%p, buffer=%p, length=" CUPS_LLFMT ")", (void *)http, (void *)buffer, CUPS_LLCAST length));
+
+  if (!http)
+  {
+    _cups_globals_t *cg = _cupsGlobals();
+					/* Pointer to library globals */
+
+    if ((http = cg->http) == NULL)
+    {
+      _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("No active connection"), 1);
+      DEBUG_puts("1cupsWriteRequestData: Returning HTTP_STATUS_ERROR.");
+      return (HTTP_STATUS_ERROR);
+    }
+  }
+
+ /*
+  * Then write to the HTTP connection...
+  */
+
+  wused = http->wused;
+
+  if (httpWrite2(http, buffer, length) < 0)
+  {
+    DEBUG_puts("1cupsWriteRequestData: Returning HTTP_STATUS_ERROR.");
+    _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(http->error), 0);
+    return (HTTP_STATUS_ERROR);
+  }
+
+ /*
+  * Finally, check if we have any pending data from the server...
+  */
+
+  if (length >= HTTP_MAX_BUFFER ||
+      http->wused < wused ||
+      (wused > 0 && (size_t)http->wused == length))
+  {
+   /*
+    * We've written something to the server, so check for response data...
     */
 
     if (_httpWait(http, 0, 1))
@@ -1015,33 +1754,15 @@ _cupsConnect(void)
       * Need to close the current connection because something has changed...
       */
 
-      httpClose(cg->http);
-      cg->http = NULL;
+      _cupsDisconnect(cg);
     }
-    else
+    else if (!connection_alive(cg->http))
     {
      /*
-      * Same server, see if the connection is still established...
+      * Same server but the connection is no longer established...
       */
 
-      char	ch;			/* Connection check byte */
-      ssize_t	n;			/* Number of bytes */
-
-#ifdef _WIN32
-      if ((n = recv(cg->http->fd, &ch, 1, MSG_PEEK)) == 0 ||
-          (n < 0 && WSAGetLastError() != WSAEWOULDBLOCK))
-#else
-      if ((n = recv(cg->http->fd, &ch, 1, MSG_PEEK | MSG_DONTWAIT)) == 0 ||
-          (n < 0 && errno != EWOULDBLOCK))
-#endif /* _WIN32 */
-      {
-       /*
-        * Nope, close the connection...
-        */
-
-	httpClose(cg->http);
-	cg->http = NULL;
-      }
+      _cupsDisconnect(cg);
     }
   }
 
@@ -1051,8 +1772,19 @@ _cupsConnect(void)
 
   if (!cg->http)
   {
-    if ((cg->http = httpConnect2(cupsServer(), ippPort(), NULL, AF_UNSPEC,
-				 cupsEncryption(), 1, 30000, NULL)) == NULL)
+    _cups_pool_t	*pool;			/* Default connection pool */
+
+    _cupsMutexLock(&pool_mutex);
+    pool = pool_default;
+    _cupsMutexUnlock(&pool_mutex);
+
+    if (pool)
+    {
+      if ((cg->http = _cupsPoolAcquire(pool, cupsServer(), ippPort(), cupsEncryption(), cupsUser())) != NULL)
+        cg->http_pool = pool;
+    }
+    else if ((cg->http = httpConnect2(cupsServer(), ippPort(), NULL, AF_UNSPEC,
+				      cupsEncryption(), 1, 30000, NULL)) == NULL)
     {
       if (errno)
         _cupsSetError(IPP_STATUS_ERROR_SERVICE_UNAVAILABLE, NULL, 0);
@@ -1070,6 +1802,43 @@ _cupsConnect(void)
 }
 
 
+/*
+ * '_cupsConnectRelease()' - Return a pooled default server connection.
+ *
+ * Functions that get the default connection with @link _cupsConnect@ call
+ * this when they are done with it so other threads can use a pooled
+ * connection.  Connections that are not pooled stay open for the next
+ * request.
+ */
+
+void
+_cupsConnectRelease(void)
+{
+  _cups_globals_t *cg = _cupsGlobals();	/* Pointer to library globals */
+
+
+  if (cg->http_pool)
+    _cupsDisconnect(cg);
+}
+
+
+/*
+ * '_cupsDisconnect()' - Close or release the default server connection.
+ */
+
+void
+_cupsDisconnect(_cups_globals_t *cg)	/* I - Pointer to library globals */
+{
+  if (cg->http_pool)
+    _cupsPoolRelease(cg->http_pool, cg->http);
+  else
+    httpClose(cg->http);
+
+  cg->http      = NULL;
+  cg->http_pool = NULL;
+}
+
+
 /*
  * '_cupsSetError()' - Set the last IPP status code and status-message.
  */
@@ -1181,3 +1950,545 @@ _cupsSetHTTPError(http_status_t status)	/* I - HTTP status code */
 	break;
   }
 }
+
+
+/*
+ * 'async_finish()' - Complete the oldest request on a connection.
+ */
+
+static void
+async_finish(_cups_async_t *async,	/* I - Request context */
+             _cups_aconn_t *conn,	/* I - Connection */
+             http_status_t status,	/* I - HTTP status */
+             ipp_t         *response)	/* I - Response or `NULL` */
+{
+  _cups_areq_t	*req = conn->first;	/* Request */
+
+
+  DEBUG_printf(("4async_finish(async=%p, conn=%p, status=%d, response=%p) id=%d", (void *)async, (void *)conn, status, (void *)response, req->id));
+
+  if ((conn->first = req->next) == NULL)
+    conn->last = NULL;
+
+  if (conn->unsent == req)
+    conn->unsent = req->next;
+  else
+    conn->num_sent --;
+
+  async->num_pending --;
+
+  if (response)
+  {
+    ipp_attribute_t	*attr;		/* status-message attribute */
+
+    attr = ippFindAttribute(response, "status-message", IPP_TAG_TEXT);
+
+    _cupsSetError(response->request.status.status_code, attr ? attr->values[0].string.text : ippErrorString(response->request.status.status_code), 0);
+  }
+  else
+    _cupsSetHTTPError(status);
+
+  ippDelete(req->request);
+  free(req->resource);
+
+ /*
+  * The callback may submit new requests, so call it last...
+  */
+
+  (req->cb)(req->user_data, req->id, status, response);
+
+  free(req);
+}
+
+
+/*
+ * 'async_read()' - Read the next response on a connection.
+ */
+
+static void
+async_read(_cups_async_t *async,	/* I - Request context */
+           int           connidx)	/* I - Connection index */
+{
+  _cups_aconn_t	*conn = async->conns + connidx;
+					/* Connection */
+  http_t	*http = conn->http;	/* HTTP connection */
+  _cups_areq_t	*req = conn->first;	/* Request for this response */
+  http_status_t	status;			/* HTTP status */
+  ipp_state_t	state;			/* IPP read state */
+  ipp_t		*response;		/* IPP response */
+
+
+  DEBUG_printf(("4async_read(async=%p, connidx=%d) id=%d", (void *)async, connidx, req->id));
+
+ /*
+  * Each response leaves the connection in the waiting state; pipelined
+  * responses follow it directly...
+  */
+
+  if (http->state == HTTP_STATE_WAITING)
+    http->state = HTTP_STATE_POST_SEND;
+
+  do
+  {
+    status = httpUpdate(http);
+  }
+  while (status == HTTP_STATUS_CONTINUE);
+
+  DEBUG_printf(("5async_read: status=%d", status));
+
+  if (status == HTTP_STATUS_ERROR)
+  {
+   /*
+    * Connection was closed or reset, send the requests again...
+    */
+
+    async_requeue(async, conn, 1);
+    return;
+  }
+  else if (status == HTTP_STATUS_OK)
+  {
+    response = ippNew();
+
+    while ((state = ippRead(http, response)) != IPP_STATE_DATA)
+      if (state == IPP_STATE_ERROR)
+	break;
+
+    if (state == IPP_STATE_ERROR)
+    {
+      DEBUG_puts("5async_read: IPP read error.");
+
+      ippDelete(response);
+
+      http->status = HTTP_STATUS_ERROR;
+      http->error  = EINVAL;
+
+      async_finish(async, conn, HTTP_STATUS_ERROR, NULL);
+
+      conn = async->conns + connidx;
+      if (conn->first)
+        async_requeue(async, conn, 0);
+      return;
+    }
+
+    async_finish(async, conn, status, response);
+
+    conn = async->conns + connidx;
+    if (conn->first && !_cups_strcasecmp(httpGetField(conn->http, HTTP_FIELD_CONNECTION), "close"))
+      async_requeue(async, conn, 0);
+    return;
+  }
+
+ /*
+  * HTTP error; flush any error message...
+  */
+
+  httpFlush(http);
+
+  if (status == HTTP_STATUS_UNAUTHORIZED && !req->auth_tries)
+  {
+    DEBUG_puts("5async_read: Need authorization...");
+
+    req->auth_tries ++;
+
+    if (!cupsDoAuthentication(http, "POST", req->resource))
+    {
+      async_requeue(async, conn, 0);
+      return;
+    }
+
+    status = HTTP_STATUS_CUPS_AUTHORIZATION_CANCELED;
+  }
+#ifdef HAVE_SSL
+  else if (status == HTTP_STATUS_UPGRADE_REQUIRED && !http->tls)
+  {
+    DEBUG_puts("5async_read: Need encryption...");
+
+    async_requeue(async, conn, 0);
+
+    if (conn->first)
+      httpEncryption(http, HTTP_ENCRYPTION_REQUIRED);
+    return;
+  }
+#endif /* HAVE_SSL */
+
+  async_finish(async, conn, status, NULL);
+
+ /*
+  * The HTTP library reconnects after an error status, so resend any other
+  * requests...
+  */
+
+  conn = async->conns + connidx;
+  if (conn->first)
+    async_requeue(async, conn, 0);
+}
+
+
+/*
+ * 'async_requeue()' - Reconnect and queue sent requests to be sent again.
+ */
+
+static void
+async_requeue(_cups_async_t *async,	/* I - Request context */
+              _cups_aconn_t *conn,	/* I - Connection */
+              int           retry)	/* I - Count as a retry? */
+{
+  _cups_areq_t	*req;			/* Current request */
+
+
+  DEBUG_printf(("4async_requeue(async=%p, conn=%p, retry=%d) num_sent=%d", (void *)async, (void *)conn, retry, conn->num_sent));
+
+ /*
+  * Fail requests that have already been resent...
+  */
+
+  if (retry)
+  {
+    for (req = conn->first; req && req != conn->unsent; req = req->next)
+      req->retries ++;
+
+    while (conn->first && conn->first != conn->unsent && conn->first->retries > 1)
+      async_finish(async, conn, HTTP_STATUS_ERROR, NULL);
+  }
+
+  conn->unsent   = conn->first;
+  conn->num_sent = 0;
+
+  if (!conn->first)
+    return;
+
+  httpClearFields(conn->http);
+
+  if (httpReconnect2(conn->http, 30000, NULL))
+  {
+    DEBUG_puts("5async_requeue: Unable to reconnect.");
+
+    while (conn->first)
+      async_finish(async, conn, HTTP_STATUS_SERVICE_UNAVAILABLE, NULL);
+  }
+}
+
+
+/*
+ * 'async_send()' - Send queued requests on a connection.
+ */
+
+static void
+async_send(_cups_async_t *async,	/* I - Request context */
+           _cups_aconn_t *conn)		/* I - Connection */
+{
+  http_t	*http = conn->http;	/* HTTP connection */
+  _cups_areq_t	*req;			/* Current request */
+  ipp_state_t	state;			/* IPP write state */
+  char		date[256];		/* Date: header value */
+
+
+  while ((req = conn->unsent) != NULL && conn->num_sent < async->depth)
+  {
+    DEBUG_printf(("4async_send(async=%p, conn=%p) id=%d, num_sent=%d", (void *)async, (void *)conn, req->id, conn->num_sent));
+
+   /*
+    * Send the HTTP POST...
+    */
+
+    httpClearFields(http);
+    httpSetExpect(http, (http_status_t)0);
+    httpSetField(http, HTTP_FIELD_CONTENT_TYPE, "application/ipp");
+    httpSetField(http, HTTP_FIELD_DATE, httpGetDateString2(time(NULL), date, (int)sizeof(date)));
+    httpSetLength(http, ippLength(req->request));
+
+    if (http->authstring && !strncmp(http->authstring, "Digest ", 7))
+      _httpSetDigestAuthString(http, http->nextnonce, "POST", req->resource);
+
+    httpSetField(http, HTTP_FIELD_AUTHORIZATION, http->authstring);
+
+    if (httpPost(http, req->resource))
+    {
+      DEBUG_puts("5async_send: POST failed.");
+
+      conn->unsent = req->next;
+      conn->num_sent ++;
+
+      async_requeue(async, conn, 1);
+      continue;
+    }
+
+   /*
+    * Then the IPP message...
+    */
+
+    req->request->state = IPP_STATE_IDLE;
+
+    while ((state = ippWrite(http, req->request)) != IPP_STATE_DATA)
+      if (state == IPP_STATE_ERROR)
+        break;
+
+    if (state == IPP_STATE_ERROR)
+    {
+      DEBUG_puts("5async_send: Unable to write IPP request.");
+
+      conn->unsent = req->next;
+      conn->num_sent ++;
+
+      async_requeue(async, conn, 1);
+      continue;
+    }
+
+    conn->unsent = req->next;
+    conn->num_sent ++;
+  }
+}
+
+
+/*
+ * 'connection_alive()' - See if a connection is still established.
+ */
+
+static int				/* O - 1 if established, 0 otherwise */
+connection_alive(http_t *http)		/* I - HTTP connection */
+{
+  char		ch;			/* Connection check byte */
+  ssize_t	n;			/* Number of bytes */
+
+
+#ifdef _WIN32
+  if ((n = recv(http->fd, &ch, 1, MSG_PEEK)) == 0 ||
+      (n < 0 && WSAGetLastError() != WSAEWOULDBLOCK))
+#else
+  if ((n = recv(http->fd, &ch, 1, MSG_PEEK | MSG_DONTWAIT)) == 0 ||
+      (n < 0 && errno != EWOULDBLOCK))
+#endif /* _WIN32 */
+    return (0);
+
+  return (1);
+}
+
+
+/*
+ * 'cups_get_response()' - Get a response to an IPP request.
+ */
+
+static ipp_t *				/* O - Response or @code NULL@ on HTTP error */
+cups_get_response(
+    http_t          *http,		/* I - Connection to server or @code CUPS_HTTP_DEFAULT@ */
+    const char      *resource,		/* I - HTTP resource for POST */
+    ipp_attribute_t **attr)		/* O - First attribute after the operation group or @code NULL@ to read the whole response */
+{
+  http_status_t	status;			/* HTTP status */
+  ipp_state_t	state;			/* IPP read state */
+  ipp_t		*response = NULL;	/* IPP response */
+
+
+  DEBUG_printf(("3cups_get_response(http=%p, resource=\"%s\", attr=%p)", (void *)http, resource, (void *)attr));
+  DEBUG_printf(("4cups_get_response: http->state=%d", http ? http->state : HTTP_STATE_ERROR));
+
+ /*
+  * Connect to the default server as needed...
+  */
+
+  if (!http)
+  {
+    _cups_globals_t *cg = _cupsGlobals();
+					/* Pointer to library globals */
+
+    if ((http = cg->http) == NULL)
+    {
+      _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("No active connection."), 1);
+      DEBUG_puts("4cups_get_response: No active connection - returning NULL.");
+      return (NULL);
+    }
+  }
+
+  if (http->state != HTTP_STATE_POST_RECV && http->state != HTTP_STATE_POST_SEND)
+  {
+    _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("No request sent."), 1);
+    DEBUG_puts("4cups_get_response: Not in POST state - returning NULL.");
+    return (NULL);
+  }
+
+ /*
+  * Check for an unfinished chunked request...
+  */
+
+  if (http->data_encoding == HTTP_ENCODING_CHUNKED)
+  {
+   /*
+    * Send a 0-length chunk to finish off the request...
+    */
+
+    DEBUG_puts("4cups_get_response: Finishing chunked POST...");
+
+    if (httpWrite2(http, "", 0) < 0)
+      return (NULL);
+  }
+
+ /*
+  * Wait for a response from the server...
+  */
+
+  DEBUG_printf(("4cups_get_response: Update loop, http->status=%d...",
+                http->status));
+
+  do
+  {
+    status = httpUpdate(http);
+  }
+  while (status == HTTP_STATUS_CONTINUE);
+
+  DEBUG_printf(("4cups_get_response: status=%d", status));
+
+  if (status == HTTP_STATUS_OK)
+  {
+   /*
+    * Get the IPP response...
+    */
+
+    response = ippNew();
+
+    if (attr)
+    {
+     /*
+      * Only read the operation attributes, the caller reads the rest with
+      * _ippReadAttribute...
+      */
+
+      while ((*attr = _ippReadAttribute(http, response)) != NULL && (*attr)->group_tag == IPP_TAG_OPERATION);
+
+      state = ippGetState(response);
+    }
+    else
+    {
+      while ((state = ippRead(http, response)) != IPP_STATE_DATA)
+	if (state == IPP_STATE_ERROR)
+	  break;
+    }
+
+    if (state == IPP_STATE_ERROR)
+    {
+     /*
+      * Flush remaining data and delete the response...
+      */
+
+      DEBUG_puts("4cups_get_response: IPP read error!");
+
+      httpFlush(http);
+
+      ippDelete(response);
+      response = NULL;
+
+      if (attr)
+        *attr = NULL;
+
+      http->status = status = HTTP_STATUS_ERROR;
+      http->error  = EINVAL;
+    }
+  }
+  else if (status != HTTP_STATUS_ERROR)
+  {
+   /*
+    * Flush any error message...
+    */
+
+    httpFlush(http);
+
+   /*
+    * Then handle encryption and authentication...
+    */
+
+    if (status == HTTP_STATUS_UNAUTHORIZED)
+    {
+     /*
+      * See if we can do authentication...
+      */
+
+      DEBUG_puts("4cups_get_response: Need authorization...");
+
+      if (!cupsDoAuthentication(http, "POST", resource))
+        httpReconnect2(http, 30000, NULL);
+      else
+        http->status = status = HTTP_STATUS_CUPS_AUTHORIZATION_CANCELED;
+    }
+
+#ifdef HAVE_SSL
+    else if (status == HTTP_STATUS_UPGRADE_REQUIRED)
+    {
+     /*
+      * Force a reconnect with encryption...
+      */
+
+      DEBUG_puts("4cups_get_response: Need encryption...");
+
+      if (!httpReconnect2(http, 30000, NULL))
+        httpEncryption(http, HTTP_ENCRYPTION_REQUIRED);
+    }
+#endif /* HAVE_SSL */
+  }
+
+  if (response)
+  {
+    ipp_attribute_t	*status_message;/* status-message attribute */
+
+
+   /*
+    * This is safe while streaming since _ippReadAttribute keeps its own read
+    * position...
+    */
+
+    status_message = ippFindAttribute(response, "status-message", IPP_TAG_TEXT);
+
+    DEBUG_printf(("4cups_get_response: status-code=%s, status-message=\"%s\"",
+                  ippErrorString(response->request.status.status_code),
+                  status_message ? status_message->values[0].string.text : ""));
+
+    _cupsSetError(response->request.status.status_code,
+                  status_message ? status_message->values[0].string.text :
+		      ippErrorString(response->request.status.status_code), 0);
+  }
+
+  return (response);
+}
+
+
+/*
+ * 'pool_close()' - Close a pooled connection.
+ *
+ * The pool mutex must be held.
+ */
+
+static void
+pool_close(_cups_pool_t  *pool,		/* I - Connection pool */
+           _cups_pconn_t *conn)		/* I - Pooled connection */
+{
+  cupsArrayRemove(pool->conns, conn);
+
+  conn->host->num_conns --;
+  pool->stats.closed ++;
+
+  httpClose(conn->http);
+  free(conn);
+}
+
+
+/*
+ * 'pool_compare_hosts()' - Compare two pooled hosts.
+ */
+
+static int				/* O - Result of comparison */
+pool_compare_hosts(_cups_phost_t *a,	/* I - First host */
+                   _cups_phost_t *b,	/* I - Second host */
+                   void          *data)	/* I - Callback data (unused) */
+{
+  int	result;				/* Result of comparison */
+
+
+  (void)data;
+
+  if ((result = strcmp(a->host, b->host)) != 0)
+    return (result);
+  else if (a->port != b->port)
+    return (a->port - b->port);
+  else if (a->encryption != b->encryption)
+    return ((int)a->encryption - (int)b->encryption);
+  else
+    return (strcmp(a->user, b->user));
+}
@@ -19,14 +19,31 @@
 #include <limits.h>
 
 
+/*
+ * Local types...
+ */
+
+#define _CUPS_SP_SHARDS	32		/* Number of string pool shards (power of 2) */
+
+typedef struct _cups_sp_shard_s		/**** String Pool Shard ****/
+{
+  _cups_mutex_t	mutex;			/* Mutex to control access to shard */
+  cups_array_t	*pool;			/* Strings in shard */
+} _cups_sp_shard_t;
+
+
 /*
  * Local globals...
  */
 
-static _cups_mutex_t	sp_mutex = _CUPS_MUTEX_INITIALIZER;
-					/* Mutex to control access to pool */
-static cups_array_t	*stringpool = NULL;
-					/* Global string pool */
+#define _CUPS_SP_SHARD	{ _CUPS_MUTEX_INITIALIZER, NULL }
+#define _CUPS_SP_SHARD4	_CUPS_SP_SHARD, _CUPS_SP_SHARD, _CUPS_SP_SHARD, _CUPS_SP_SHARD
+
+static _cups_sp_shard_t	stringpool[_CUPS_SP_SHARDS] =
+{
+  _CUPS_SP_SHARD4, _CUPS_SP_SHARD4, _CUPS_SP_SHARD4, _CUPS_SP_SHARD4,
+  _CUPS_SP_SHARD4, _CUPS_SP_SHARD4, _CUPS_SP_SHARD4, _CUPS_SP_SHARD4
+};					/* Global string pool, sharded by hash */
 
 
 /*
@@ -34,6 +51,7 @@ static cups_array_t	*stringpool = NULL;
  */
 
 static int	compare_sp_items(_cups_sp_item_t *a, _cups_sp_item_t *b);
+static _cups_sp_shard_t *sp_shard(const char *s);
 
 
 /*
@@ -44,6 +62,7 @@ char *					/* O - String pointer */
 _cupsStrAlloc(const char *s)		/* I - String */
 {
   size_t		slen;		/* Length of string */
+  _cups_sp_shard_t	*shard;		/* String pool shard */
   _cups_sp_item_t	*item,		/* String pool item */
 			*key;		/* Search key */
 
@@ -56,17 +75,19 @@ _cupsStrAlloc(const char *s)		/* I - String */
     return (NULL);
 
  /*
-  * Get the string pool...
+  * Get the string pool shard...
   */
 
-  _cupsMutexLock(&sp_mutex);
+  shard = sp_shard(s);
 
-  if (!stringpool)
-    stringpool = cupsArrayNew((cups_array_func_t)compare_sp_items, NULL);
+  _cupsMutexLock(&shard->mutex);
 
-  if (!stringpool)
+  if (!shard->pool)
+    shard->pool = cupsArrayNew((cups_array_func_t)compare_sp_items, NULL);
+
+  if (!shard->pool)
   {
-    _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&shard->mutex);
 
     return (NULL);
   }
@@ -77,7 +98,7 @@ _cupsStrAlloc(const char *s)		/* I - String */
 
   key = (_cups_sp_item_t *)(s - offsetof(_cups_sp_item_t, str));
 
-  if ((item = (_cups_sp_item_t *)cupsArrayFind(stringpool, key)) != NULL)
+  if ((item = (_cups_sp_item_t *)cupsArrayFind(shard->pool, key)) != NULL)
   {
    /*
     * Found it, return the cached string...
@@ -94,7 +115,7 @@ _cupsStrAlloc(const char *s)		/* I - String */
       abort();
 #endif /* DEBUG_GUARDS */
 
-    _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&shard->mutex);
 
     return (item->str);
   }
@@ -107,7 +128,7 @@ _cupsStrAlloc(const char *s)		/* I - String */
   item = (_cups_sp_item_t *)calloc(1, sizeof(_cups_sp_item_t) + slen);
   if (!item)
   {
-    _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&shard->mutex);
 
     return (NULL);
   }
@@ -127,9 +148,9 @@ _cupsStrAlloc(const char *s)		/* I - String */
   * Add the string to the pool and return it...
   */
 
-  cupsArrayAdd(stringpool, item);
+  cupsArrayAdd(shard->pool, item);
 
-  _cupsMutexUnlock(&sp_mutex);
+  _cupsMutexUnlock(&shard->mutex);
 
   return (item->str);
 }
@@ -175,23 +196,26 @@ _cupsStrDate(char   *buf,		/* I - Buffer */
 void
 _cupsStrFlush(void)
 {
+  _cups_sp_shard_t	*shard;		/* Current shard */
   _cups_sp_item_t	*item;		/* Current item */
 
 
-  DEBUG_printf(("4_cupsStrFlush: %d strings in array",
-                cupsArrayCount(stringpool)));
+  for (shard = stringpool; shard < (stringpool + _CUPS_SP_SHARDS); shard ++)
+  {
+    _cupsMutexLock(&shard->mutex);
 
-  _cupsMutexLock(&sp_mutex);
+    DEBUG_printf(("4_cupsStrFlush: %d strings in shard %d", cupsArrayCount(shard->pool), (int)(shard - stringpool)));
 
-  for (item = (_cups_sp_item_t *)cupsArrayFirst(stringpool);
-       item;
-       item = (_cups_sp_item_t *)cupsArrayNext(stringpool))
-    free(item);
+    for (item = (_cups_sp_item_t *)cupsArrayFirst(shard->pool);
+	 item;
+	 item = (_cups_sp_item_t *)cupsArrayNext(shard->pool))
+      free(item);
 
-  cupsArrayDelete(stringpool);
-  stringpool = NULL;
+    cupsArrayDelete(shard->pool);
+    shard->pool = NULL;
 
-  _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&shard->mutex);
+  }
 }
 
 
@@ -282,6 +306,7 @@ _cupsStrFormatd(char         *buf,	/* I - String */
 void
 _cupsStrFree(const char *s)		/* I - String to free */
 {
+  _cups_sp_shard_t	*shard;		/* String pool shard */
   _cups_sp_item_t	*item,		/* String pool item */
 			*key;		/* Search key */
 
@@ -294,25 +319,27 @@ _cupsStrFree(const char *s)		/* I - String to free */
     return;
 
  /*
-  * Check the string pool...
+  * Check the string pool shard...
   *
   * We don't need to lock the mutex yet, as we only want to know if
-  * the stringpool is initialized.  The rest of the code will still
+  * the shard is initialized.  The rest of the code will still
   * work if it is initialized before we lock...
   */
 
-  if (!stringpool)
+  shard = sp_shard(s);
+
+  if (!shard->pool)
     return;
 
  /*
   * See if the string is already in the pool...
   */
 
-  _cupsMutexLock(&sp_mutex);
+  _cupsMutexLock(&shard->mutex);
 
   key = (_cups_sp_item_t *)(s - offsetof(_cups_sp_item_t, str));
 
-  if ((item = (_cups_sp_item_t *)cupsArrayFind(stringpool, key)) != NULL &&
+  if ((item = (_cups_sp_item_t *)cupsArrayFind(shard->pool, key)) != NULL &&
       item == key)
   {
    /*
@@ -335,13 +362,13 @@ _cupsStrFree(const char *s)		/* I - String to free */
       * Remove and free...
       */
 
-      cupsArrayRemove(stringpool, item);
+      cupsArrayRemove(shard->pool, item);
 
       free(item);
     }
   }
 
-  _cupsMutexUnlock(&sp_mutex);
+  _cupsMutexUnlock(&shard->mutex);
 }
 
 
@@ -356,6 +383,7 @@ _cupsStrFree(const char *s)		/* I - String to free */
 char *					/* O - Pointer to string */
 _cupsStrRetain(const char *s)		/* I - String to retain */
 {
+  _cups_sp_shard_t	*shard;		/* String pool shard */
   _cups_sp_item_t	*item;		/* Pointer to string pool item */
 
 
@@ -372,11 +400,13 @@ _cupsStrRetain(const char *s)		/* I - String to retain */
     }
 #endif /* DEBUG_GUARDS */
 
-    _cupsMutexLock(&sp_mutex);
+    shard = sp_shard(s);
+
+    _cupsMutexLock(&shard->mutex);
 
     item->ref_count ++;
 
-    _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&shard->mutex);
   }
 
   return ((char *)s);
@@ -533,31 +563,34 @@ _cupsStrStatistics(size_t *alloc_bytes,	/* O - Allocated bytes */
 			abytes,		/* Allocated string bytes */
 			tbytes,		/* Total string bytes */
 			len;		/* Length of string */
+  _cups_sp_shard_t	*shard;		/* Current shard */
   _cups_sp_item_t	*item;		/* Current item */
 
 
  /*
-  * Loop through strings in pool, counting everything up...
+  * Loop through strings in each shard, counting everything up...
   */
 
-  _cupsMutexLock(&sp_mutex);
-
-  for (count = 0, abytes = 0, tbytes = 0,
-           item = (_cups_sp_item_t *)cupsArrayFirst(stringpool);
-       item;
-       item = (_cups_sp_item_t *)cupsArrayNext(stringpool))
+  for (count = 0, abytes = 0, tbytes = 0, shard = stringpool; shard < (stringpool + _CUPS_SP_SHARDS); shard ++)
   {
-   /*
-    * Count allocated memory, using a 64-bit aligned buffer as a basis.
-    */
+    _cupsMutexLock(&shard->mutex);
 
-    count  += item->ref_count;
-    len    = (strlen(item->str) + 8) & (size_t)~7;
-    abytes += sizeof(_cups_sp_item_t) + len;
-    tbytes += item->ref_count * len;
-  }
+    for (item = (_cups_sp_item_t *)cupsArrayFirst(shard->pool);
+	 item;
+	 item = (_cups_sp_item_t *)cupsArrayNext(shard->pool))
+    {
+     /*
+      * Count allocated memory, using a 64-bit aligned buffer as a basis.
+      */
 
-  _cupsMutexUnlock(&sp_mutex);
+      count  += item->ref_count;
+      len    = (strlen(item->str) + 8) & (size_t)~7;
+      abytes += sizeof(_cups_sp_item_t) + len;
+      tbytes += item->ref_count * len;
+    }
+
+    _cupsMutexUnlock(&shard->mutex);
+  }
 
  /*
   * Return values...
@@ -763,3 +796,23 @@ compare_sp_items(_cups_sp_item_t *a,	/* I - First item */
 {
   return (strcmp(a->str, b->str));
 }
+
+
+/*
+ * 'sp_shard()' - Return the string pool shard for a string.
+ *
+ * Strings are spread over the shards using a FNV-1a hash so that threads
+ * working with different strings rarely wait on the same lock.
+ */
+
+static _cups_sp_shard_t *		/* O - String pool shard */
+sp_shard(const char *s)			/* I - String */
+{
+  unsigned	hash = 2166136261U;	/* Hash value */
+
+
+  while (*s)
+    hash = (hash ^ (unsigned char)*s++) * 16777619U;
+
+  return (stringpool + (hash & (_CUPS_SP_SHARDS - 1)));
+}
@@ -15,14 +15,51 @@
 #include "cups-private.h"
 #include "ppd.h"
 #include <stdlib.h>
+#ifndef _WIN32
+#  include <sys/time.h>
+#endif /* !_WIN32 */
 
 
+/*
+ * Local types...
+ */
+
+typedef struct _async_grow_s		/**** Callback submit test data ****/
+{
+  _cups_async_t	*async;			/* Asynchronous requests */
+  http_t	*http;			/* Connection for the extra request */
+  ipp_t		*request;		/* Extra request or NULL once submitted */
+  char		resource[256];		/* Resource for the extra request */
+  int		good;			/* Number of good responses */
+} _async_grow_t;
+
+typedef struct _pool_data_s		/**** Connection pool test data ****/
+{
+  int		num_servers;		/* Number of servers */
+  char		**servers;		/* Servers */
+  int		count;			/* Requests per thread */
+  int		good;			/* Number of good responses */
+} _pool_data_t;
+
+
+/*
+ * Local globals...
+ */
+
+static _cups_mutex_t	pool_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for pool test data */
+
 /*
  * Local functions...
  */
 
+static void	async_cb(void *user_data, int id, http_status_t status, ipp_t *response);
+static void	async_grow_cb(void *user_data, int id, http_status_t status, ipp_t *response);
+static int	async_test(int num_uris, char *uris[], int count, int depth);
 static int	dests_equal(cups_dest_t *a, cups_dest_t *b);
 static int	enum_cb(void *user_data, unsigned flags, cups_dest_t *dest);
+static void	*pool_thread(_pool_data_t *data);
+static int	pool_test(int num_servers, char *servers[], int num_threads, int count, int max_per_host);
 static void	show_diffs(cups_dest_t *a, cups_dest_t *b);
 
 
@@ -52,7 +89,34 @@ main(int  argc,				/* I - Number of command-line arguments */
 
   if (argc > 1)
   {
-    if (!strcmp(argv[1], "enum"))
+    if (!strcmp(argv[1], "async") && argc > 2)
+    {
+     /*
+      * ./testcups async [-d depth] [-n count] printer-uri [... printer-uri]
+      */
+
+      int	count = 10,		/* Requests per printer */
+		depth = 4;		/* Pipeline depth */
+
+      for (i = 2; i < argc && argv[i][0] == '-'; i ++)
+      {
+        if (!strcmp(argv[i], "-d") && (i + 1) < argc)
+          depth = atoi(argv[++ i]);
+        else if (!strcmp(argv[i], "-n") && (i + 1) < argc)
+          count = atoi(argv[++ i]);
+        else
+          break;
+      }
+
+      if (i >= argc || count <= 0 || depth <= 0)
+      {
+        puts("Usage: ./testcups async [-d depth] [-n count] printer-uri [... printer-uri]");
+        return (1);
+      }
+
+      return (async_test(argc - i, argv + i, count, depth));
+    }
+    else if (!strcmp(argv[1], "enum"))
     {
       cups_ptype_t	mask = CUPS_PRINTER_LOCAL,
 					/* Printer type mask */
@@ -161,6 +225,36 @@ main(int  argc,				/* I - Number of command-line arguments */
       else
 	puts("No password entered.");
     }
+    else if (!strcmp(argv[1], "pool") && argc > 2)
+    {
+     /*
+      * ./testcups pool [-m max-per-host] [-n count] [-t threads] server [... server]
+      */
+
+      int	count = 100,		/* Requests per thread */
+		max_per_host = 0,	/* Maximum connections per host */
+		num_threads = 4;	/* Number of threads */
+
+      for (i = 2; i < argc && argv[i][0] == '-'; i ++)
+      {
+        if (!strcmp(argv[i], "-m") && (i + 1) < argc)
+          max_per_host = atoi(argv[++ i]);
+        else if (!strcmp(argv[i], "-n") && (i + 1) < argc)
+          count = atoi(argv[++ i]);
+        else if (!strcmp(argv[i], "-t") && (i + 1) < argc)
+          num_threads = atoi(argv[++ i]);
+        else
+          break;
+      }
+
+      if (i >= argc || count <= 0 || num_threads <= 0 || max_per_host < 0)
+      {
+        puts("Usage: ./testcups pool [-m max-per-host] [-n count] [-t threads] server [... server]");
+        return (1);
+      }
+
+      return (pool_test(argc - i, argv + i, num_threads, count, max_per_host));
+    }
     else if (!strcmp(argv[1], "ppd") && argc == 3)
     {
      /*
@@ -248,6 +342,15 @@ main(int  argc,				/* I - Number of command-line arguments */
       puts("");
       puts("    ./testcups enum [seconds]");
       puts("");
+      puts("Send Get-Printer-Attributes requests one at a time and asynchronously:");
+      puts("");
+      puts("    ./testcups async [-d depth] [-n count] printer-uri [... printer-uri]");
+      puts("");
+      puts("Send CUPS-Get-Printers requests from several threads with and without a");
+      puts("connection pool, alternating between the listed servers:");
+      puts("");
+      puts("    ./testcups pool [-m max-per-host] [-n count] [-t threads] server [... server]");
+      puts("");
       puts("Ask for a password:");
       puts("");
       puts("    ./testcups password");
@@ -497,6 +600,241 @@ main(int  argc,				/* I - Number of command-line arguments */
 }
 
 
+/*
+ * 'async_cb()' - Count asynchronous responses.
+ */
+
+static void
+async_cb(void          *user_data,	/* I - Number of good responses */
+         int           id,		/* I - Request ID (unused) */
+         http_status_t status,		/* I - HTTP status */
+         ipp_t         *response)	/* I - IPP response */
+{
+  (void)id;
+
+  if (status == HTTP_STATUS_OK && response && ippGetStatusCode(response) <= IPP_STATUS_OK_CONFLICTING)
+    (*(int *)user_data) ++;
+
+  ippDelete(response);
+}
+
+
+/*
+ * 'async_grow_cb()' - Count responses and submit one more request on a new
+ *                     connection from the first callback.
+ */
+
+static void
+async_grow_cb(void          *user_data,	/* I - Test data */
+              int           id,		/* I - Request ID (unused) */
+              http_status_t status,	/* I - HTTP status */
+              ipp_t         *response)	/* I - IPP response */
+{
+  _async_grow_t	*data = (_async_grow_t *)user_data;
+					/* Test data */
+  ipp_t		*request = data->request;
+					/* Extra request */
+
+
+  async_cb(&data->good, id, status, response);
+
+  if (request)
+  {
+    data->request = NULL;
+
+    if (!_cupsAsyncSubmit(data->async, data->http, request, data->resource, async_grow_cb, data))
+      printf("\n_cupsAsyncSubmit: %s\n", cupsLastErrorString());
+  }
+}
+
+
+/*
+ * 'async_test()' - Compare synchronous and asynchronous requests.
+ */
+
+static int				/* O - Exit status */
+async_test(int  num_uris,		/* I - Number of printer URIs */
+           char *uris[],		/* I - Printer URIs */
+           int  count,			/* I - Requests per printer */
+           int  depth)			/* I - Pipeline depth */
+{
+  int		i, j;			/* Looping vars */
+  http_t	**https;		/* Connections to printers */
+  char		scheme[32],		/* URI scheme */
+		userpass[256],		/* URI username:password */
+		host[256],		/* URI hostname */
+		resource[256];		/* URI resource */
+  int		port;			/* URI port */
+  ipp_t		*request,		/* IPP request */
+		*response;		/* IPP response */
+  _cups_async_t	*async;			/* Asynchronous requests */
+  int		good,			/* Number of good responses */
+		status;			/* Exit status */
+  http_t	*grow_https[17];	/* Connections for callback submit test */
+  _async_grow_t	grow;			/* Callback submit test data */
+  double	start,			/* Start time */
+		secs;			/* Elapsed time */
+  struct timeval curtime;		/* Current time */
+  static const char * const pattrs[] =	/* Requested attributes */
+  {
+    "printer-state",
+    "printer-state-reasons",
+    "marker-levels"
+  };
+
+
+  if ((https = calloc((size_t)num_uris, sizeof(http_t *))) == NULL)
+    return (1);
+
+  for (i = 0; i < num_uris; i ++)
+  {
+    if (httpSeparateURI(HTTP_URI_CODING_ALL, uris[i], scheme, sizeof(scheme), userpass, sizeof(userpass), host, sizeof(host), &port, resource, sizeof(resource)) < HTTP_URI_STATUS_OK || (https[i] = httpConnect2(host, port, NULL, AF_UNSPEC, !strcmp(scheme, "ipps") ? HTTP_ENCRYPTION_ALWAYS : HTTP_ENCRYPTION_IF_REQUESTED, 1, 30000, NULL)) == NULL)
+    {
+      printf("Unable to connect to \"%s\": %s\n", uris[i], cupsLastErrorString());
+      return (1);
+    }
+  }
+
+ /*
+  * One request at a time...
+  */
+
+  printf("cupsDoRequest(%d printers, %d requests each): ", num_uris, count);
+  fflush(stdout);
+
+  gettimeofday(&curtime, NULL);
+  start = curtime.tv_sec + 0.000001 * curtime.tv_usec;
+
+  for (j = 0, good = 0; j < count; j ++)
+  {
+    for (i = 0; i < num_uris; i ++)
+    {
+      request = ippNewRequest(IPP_OP_GET_PRINTER_ATTRIBUTES);
+      ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uris[i]);
+      ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", (int)(sizeof(pattrs) / sizeof(pattrs[0])), NULL, pattrs);
+
+      httpSeparateURI(HTTP_URI_CODING_ALL, uris[i], scheme, sizeof(scheme), userpass, sizeof(userpass), host, sizeof(host), &port, resource, sizeof(resource));
+
+      response = cupsDoRequest(https[i], request, resource);
+      if (response && ippGetStatusCode(response) <= IPP_STATUS_OK_CONFLICTING)
+        good ++;
+      ippDelete(response);
+    }
+  }
+
+  gettimeofday(&curtime, NULL);
+  secs = curtime.tv_sec + 0.000001 * curtime.tv_usec - start;
+
+  printf("%s (%d of %d OK, %.1f requests/sec)\n", good == num_uris * count ? "PASS" : "FAIL", good, num_uris * count, num_uris * count / secs);
+
+ /*
+  * Asynchronous and pipelined...
+  */
+
+  printf("_cupsAsyncPoll(%d printers, %d requests each, depth %d): ", num_uris, count, depth);
+  fflush(stdout);
+
+  gettimeofday(&curtime, NULL);
+  start = curtime.tv_sec + 0.000001 * curtime.tv_usec;
+
+  async = _cupsAsyncNew(depth);
+  good  = 0;
+
+  for (j = 0; j < count; j ++)
+  {
+    for (i = 0; i < num_uris; i ++)
+    {
+      request = ippNewRequest(IPP_OP_GET_PRINTER_ATTRIBUTES);
+      ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uris[i]);
+      ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", (int)(sizeof(pattrs) / sizeof(pattrs[0])), NULL, pattrs);
+
+      httpSeparateURI(HTTP_URI_CODING_ALL, uris[i], scheme, sizeof(scheme), userpass, sizeof(userpass), host, sizeof(host), &port, resource, sizeof(resource));
+
+      if (!_cupsAsyncSubmit(async, https[i], request, resource, async_cb, &good))
+        printf("\n_cupsAsyncSubmit: %s\n", cupsLastErrorString());
+    }
+  }
+
+  while (_cupsAsyncPoll(async, 1000) > 0);
+
+  _cupsAsyncDelete(async);
+
+  gettimeofday(&curtime, NULL);
+  secs = curtime.tv_sec + 0.000001 * curtime.tv_usec - start;
+
+  printf("%s (%d of %d OK, %.1f requests/sec)\n", good == num_uris * count ? "PASS" : "FAIL", good, num_uris * count, num_uris * count / secs);
+
+  status = good != num_uris * count;
+
+ /*
+  * Submit from a callback when the connection array is full, which grows the
+  * connection and poll arrays while _cupsAsyncPoll is reading responses...
+  */
+
+  printf("_cupsAsyncSubmit from callback (%d connections): ", (int)(sizeof(grow_https) / sizeof(grow_https[0])));
+  fflush(stdout);
+
+  memset(&grow, 0, sizeof(grow));
+  grow.async = _cupsAsyncNew(depth);
+
+  for (j = 0; j < (int)(sizeof(grow_https) / sizeof(grow_https[0])); j ++)
+  {
+    httpSeparateURI(HTTP_URI_CODING_ALL, uris[j % num_uris], scheme, sizeof(scheme), userpass, sizeof(userpass), host, sizeof(host), &port, resource, sizeof(resource));
+
+    if ((grow_https[j] = httpConnect2(host, port, NULL, AF_UNSPEC, !strcmp(scheme, "ipps") ? HTTP_ENCRYPTION_ALWAYS : HTTP_ENCRYPTION_IF_REQUESTED, 1, 30000, NULL)) == NULL)
+    {
+      printf("FAIL (unable to connect to \"%s\": %s)\n", uris[j % num_uris], cupsLastErrorString());
+      return (1);
+    }
+
+    request = ippNewRequest(IPP_OP_GET_PRINTER_ATTRIBUTES);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uris[j % num_uris]);
+    ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", (int)(sizeof(pattrs) / sizeof(pattrs[0])), NULL, pattrs);
+
+    if (j == (int)(sizeof(grow_https) / sizeof(grow_https[0])) - 1)
+    {
+     /*
+      * The last connection is only used from the callback...
+      */
+
+      grow.http    = grow_https[j];
+      grow.request = request;
+      strlcpy(grow.resource, resource, sizeof(grow.resource));
+    }
+    else if (!_cupsAsyncSubmit(grow.async, grow_https[j], request, resource, async_grow_cb, &grow))
+      printf("\n_cupsAsyncSubmit: %s\n", cupsLastErrorString());
+  }
+
+  while (_cupsAsyncPoll(grow.async, 1000) > 0);
+
+  _cupsAsyncDelete(grow.async);
+
+  if (grow.request)
+  {
+    ippDelete(grow.request);
+    puts("FAIL (callback not called)");
+    status = 1;
+  }
+  else if (grow.good != (int)(sizeof(grow_https) / sizeof(grow_https[0])))
+  {
+    printf("FAIL (%d of %d OK)\n", grow.good, (int)(sizeof(grow_https) / sizeof(grow_https[0])));
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+  for (j = 0; j < (int)(sizeof(grow_https) / sizeof(grow_https[0])); j ++)
+    httpClose(grow_https[j]);
+
+  for (i = 0; i < num_uris; i ++)
+    httpClose(https[i]);
+
+  free(https);
+
+  return (status);
+}
+
+
 /*
  * 'dests_equal()' - Determine whether two destinations are equal.
  */
@@ -562,6 +900,149 @@ enum_cb(void        *user_data,		/* I - User data (unused) */
 }
 
 
+/*
+ * 'pool_thread()' - Send requests on the default connection.
+ *
+ * Requests rotate between cupsDoRequest, cupsSendRequest/cupsGetResponse, and
+ * cupsGetJobs2 so that every way of using the default connection has to give
+ * it back to the pool.
+ */
+
+static void *				/* O - Thread exit status (unused) */
+pool_thread(_pool_data_t *data)		/* I - Test data */
+{
+  int		i,			/* Looping var */
+		good = 0;		/* Number of good responses */
+  ipp_t		*request,		/* IPP request */
+		*response;		/* IPP response */
+  cups_job_t	*jobs;			/* Jobs */
+  int		num_jobs;		/* Number of jobs */
+
+
+  for (i = 0; i < data->count; i ++)
+  {
+    cupsSetServer(data->servers[i % data->num_servers]);
+
+    switch (i % 3)
+    {
+      case 0 :
+          request = ippNewRequest(IPP_OP_CUPS_GET_PRINTERS);
+          ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", NULL, "printer-name");
+
+          response = cupsDoRequest(CUPS_HTTP_DEFAULT, request, "/");
+          if (response && ippGetStatusCode(response) <= IPP_STATUS_OK_CONFLICTING)
+            good ++;
+          ippDelete(response);
+          break;
+
+      case 1 :
+          request = ippNewRequest(IPP_OP_CUPS_GET_PRINTERS);
+          ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", NULL, "printer-name");
+
+          if (cupsSendRequest(CUPS_HTTP_DEFAULT, request, "/", ippLength(request)) == HTTP_STATUS_CONTINUE)
+          {
+            response = cupsGetResponse(CUPS_HTTP_DEFAULT, "/");
+            if (response && ippGetStatusCode(response) <= IPP_STATUS_OK_CONFLICTING)
+              good ++;
+            ippDelete(response);
+          }
+          ippDelete(request);
+          break;
+
+      default :
+          if ((num_jobs = cupsGetJobs2(CUPS_HTTP_DEFAULT, &jobs, NULL, 0, CUPS_WHICHJOBS_ALL)) >= 0)
+          {
+            good ++;
+            cupsFreeJobs(num_jobs, jobs);
+          }
+          break;
+    }
+  }
+
+  _cupsMutexLock(&pool_mutex);
+  data->good += good;
+  _cupsMutexUnlock(&pool_mutex);
+
+  return (NULL);
+}
+
+
+/*
+ * 'pool_test()' - Compare per-thread and pooled default connections.
+ */
+
+static int				/* O - Exit status */
+pool_test(int  num_servers,		/* I - Number of servers */
+          char *servers[],		/* I - Servers */
+          int  num_threads,		/* I - Number of threads */
+          int  count,			/* I - Requests per thread */
+          int  max_per_host)		/* I - Maximum connections per host */
+{
+  int			i,		/* Looping var */
+			pass,		/* Current pass */
+			status = 0;	/* Exit status */
+  _cups_thread_t	*threads;	/* Threads */
+  _pool_data_t		data;		/* Test data */
+  _cups_pool_t		*pool = NULL;	/* Connection pool */
+  _cups_pool_stats_t	stats;		/* Pool statistics */
+  double		start,		/* Start time */
+			secs;		/* Elapsed time */
+  struct timeval	curtime;	/* Current time */
+
+
+  if ((threads = calloc((size_t)num_threads, sizeof(_cups_thread_t))) == NULL)
+    return (1);
+
+  data.num_servers = num_servers;
+  data.servers     = servers;
+  data.count       = count;
+
+  for (pass = 0; pass < 2; pass ++)
+  {
+    if (pass)
+    {
+      pool = _cupsPoolNew(max_per_host, 0);
+      _cupsPoolSetDefault(pool);
+    }
+
+    printf("Default connection (%d threads, %d requests each%s): ", num_threads, count, pass ? ", pooled" : "");
+    fflush(stdout);
+
+    data.good = 0;
+
+    gettimeofday(&curtime, NULL);
+    start = curtime.tv_sec + 0.000001 * curtime.tv_usec;
+
+    for (i = 0; i < num_threads; i ++)
+      threads[i] = _cupsThreadCreate((_cups_thread_func_t)pool_thread, &data);
+
+    for (i = 0; i < num_threads; i ++)
+      _cupsThreadWait(threads[i]);
+
+    gettimeofday(&curtime, NULL);
+    secs = curtime.tv_sec + 0.000001 * curtime.tv_usec - start;
+
+    printf("%s (%d of %d OK, %.1f requests/sec)\n", data.good == num_threads * count ? "PASS" : "FAIL", data.good, num_threads * count, num_threads * count / secs);
+
+    if (data.good != num_threads * count)
+      status = 1;
+
+    if (pool)
+    {
+      _cupsPoolGetStats(pool, &stats);
+      printf("    %lu hits, %lu misses, %lu waits, %lu closed (%.1f%% hit rate)\n", stats.hits, stats.misses, stats.waits, stats.closed, 100.0 * stats.hits / (stats.hits + stats.misses));
+
+      _cupsPoolSetDefault(NULL);
+      _cupsPoolDelete(pool);
+    }
+  }
+
+  free(threads);
+
+  return (status);
+}
+
+
 /*
  * 'show_diffs()' - Show differences between two destinations.
  */
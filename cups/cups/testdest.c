@@ -12,13 +12,14 @@
 
 #include <stdio.h>
 #include <errno.h>
-#include "cups.h"
+#include "cups-private.h"
 
 
 /*
  * Local functions...
  */
 
+static int	cache_test(void);
 static int	enum_cb(void *user_data, unsigned flags, cups_dest_t *dest);
 static void	localize(http_t *http, cups_dest_t *dest, cups_dinfo_t *dinfo, const char *option, const char *value);
 static void	print_file(http_t *http, cups_dest_t *dest, cups_dinfo_t *dinfo, const char *filename, int num_options, cups_option_t *options);
@@ -48,7 +49,11 @@ main(int  argc,				/* I - Number of command-line arguments */
   if (argc < 2)
     return (0);
 
-  if (!strcmp(argv[1], "--get"))
+  if (!strcmp(argv[1], "--cache"))
+  {
+    return (cache_test());
+  }
+  else if (!strcmp(argv[1], "--get"))
   {
     cups_dest_t	*dests;			/* Destinations */
     int		num_dests = cupsGetDests2(CUPS_HTTP_DEFAULT, &dests);
@@ -231,6 +236,216 @@ main(int  argc,				/* I - Number of command-line arguments */
 }
 
 
+/*
+ * 'cache_test()' - Write the discovery and capability caches and read them back.
+ */
+
+static int				/* O - Exit status */
+cache_test(void)
+{
+  int		status = 0;		/* Exit status */
+  const char	*filename = "testdest.ipp";
+					/* Cache filename */
+  char		expires[32],		/* dnssd-expires value */
+		path[1024];		/* Cache path */
+  int		num_dests = 0;		/* Number of printers */
+  cups_dest_t	*dests = NULL,		/* Printers */
+		*dest;			/* Current printer */
+  const char	*value;			/* Option value */
+  time_t	curtime = time(NULL);	/* Current time */
+  ipp_t		*attrs,			/* Printer attributes */
+		*current;		/* Current printer-config-change-time */
+  ipp_attribute_t *attr;		/* Current attribute */
+
+
+ /*
+  * Cache files go in ~/.cups/cache...
+  */
+
+  fputs("_cupsGetCachePath: ", stdout);
+  if (!_cupsGetCachePath("dnssd.ipp", path, sizeof(path), 0))
+  {
+    puts("FAIL (NULL)");
+    status = 1;
+  }
+  else if (strlen(path) < 22 || strcmp(path + strlen(path) - 22, "/.cups/cache/dnssd.ipp"))
+  {
+    printf("FAIL (got \"%s\")\n", path);
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+ /*
+  * Write one current printer, one expired printer, and one printer missing
+  * its domain - only the first should be read back...
+  */
+
+  num_dests = cupsAddDest("Current", NULL, num_dests, &dests);
+  dest      = cupsGetDest("Current", NULL, num_dests, dests);
+  snprintf(expires, sizeof(expires), "%ld", (long)curtime + 3600);
+  dest->num_options = cupsAddOption("dnssd-full-name", "Current._ipp._tcp.local.", dest->num_options, &dest->options);
+  dest->num_options = cupsAddOption("dnssd-regtype", "_ipp._tcp", dest->num_options, &dest->options);
+  dest->num_options = cupsAddOption("dnssd-domain", "local.", dest->num_options, &dest->options);
+  dest->num_options = cupsAddOption("dnssd-expires", expires, dest->num_options, &dest->options);
+  dest->num_options = cupsAddOption("printer-info", "Current Printer", dest->num_options, &dest->options);
+
+  num_dests = cupsAddDest("Expired", NULL, num_dests, &dests);
+  dest      = cupsGetDest("Expired", NULL, num_dests, dests);
+  snprintf(expires, sizeof(expires), "%ld", (long)curtime - 1);
+  dest->num_options = cupsAddOption("dnssd-full-name", "Expired._ipp._tcp.local.", dest->num_options, &dest->options);
+  dest->num_options = cupsAddOption("dnssd-regtype", "_ipp._tcp", dest->num_options, &dest->options);
+  dest->num_options = cupsAddOption("dnssd-domain", "local.", dest->num_options, &dest->options);
+  dest->num_options = cupsAddOption("dnssd-expires", expires, dest->num_options, &dest->options);
+
+  num_dests = cupsAddDest("Partial", NULL, num_dests, &dests);
+  dest      = cupsGetDest("Partial", NULL, num_dests, dests);
+  snprintf(expires, sizeof(expires), "%ld", (long)curtime + 3600);
+  dest->num_options = cupsAddOption("dnssd-full-name", "Partial._ipp._tcp.local.", dest->num_options, &dest->options);
+  dest->num_options = cupsAddOption("dnssd-regtype", "_ipp._tcp", dest->num_options, &dest->options);
+  dest->num_options = cupsAddOption("dnssd-expires", expires, dest->num_options, &dest->options);
+
+  fputs("_cupsWriteDNSSDCache: ", stdout);
+  if (_cupsWriteDNSSDCache(filename, num_dests, dests))
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+  cupsFreeDests(num_dests, dests);
+
+  fputs("_cupsReadDNSSDCache: ", stdout);
+  num_dests = _cupsReadDNSSDCache(filename, &dests);
+  snprintf(expires, sizeof(expires), "%ld", (long)curtime + 3600);
+
+  if (num_dests != 1)
+  {
+    printf("FAIL (got %d printers, expected 1)\n", num_dests);
+    status = 1;
+  }
+  else if (strcmp(dests[0].name, "Current"))
+  {
+    printf("FAIL (got \"%s\", expected \"Current\")\n", dests[0].name);
+    status = 1;
+  }
+  else if ((value = cupsGetOption("printer-info", dests[0].num_options, dests[0].options)) == NULL || strcmp(value, "Current Printer"))
+  {
+    printf("FAIL (got printer-info=\"%s\")\n", value ? value : "(null)");
+    status = 1;
+  }
+  else if ((value = cupsGetOption("dnssd-expires", dests[0].num_options, dests[0].options)) == NULL || strcmp(value, expires))
+  {
+    printf("FAIL (got dnssd-expires=\"%s\", expected \"%s\")\n", value ? value : "(null)", expires);
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+  cupsFreeDests(num_dests, dests);
+
+ /*
+  * Printers that expire after the cache is written must not be read back...
+  */
+
+  num_dests = 0;
+  dests     = NULL;
+
+  num_dests = cupsAddDest("Soon", NULL, num_dests, &dests);
+  dest      = cupsGetDest("Soon", NULL, num_dests, dests);
+  snprintf(expires, sizeof(expires), "%ld", (long)time(NULL) + 1);
+  dest->num_options = cupsAddOption("dnssd-full-name", "Soon._ipp._tcp.local.", dest->num_options, &dest->options);
+  dest->num_options = cupsAddOption("dnssd-regtype", "_ipp._tcp", dest->num_options, &dest->options);
+  dest->num_options = cupsAddOption("dnssd-domain", "local.", dest->num_options, &dest->options);
+  dest->num_options = cupsAddOption("dnssd-expires", expires, dest->num_options, &dest->options);
+
+  _cupsWriteDNSSDCache(filename, num_dests, dests);
+  cupsFreeDests(num_dests, dests);
+
+  sleep(2);
+
+  fputs("_cupsReadDNSSDCache(expired): ", stdout);
+  if ((num_dests = _cupsReadDNSSDCache(filename, &dests)) != 0)
+  {
+    printf("FAIL (got %d printers, expected 0)\n", num_dests);
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+  cupsFreeDests(num_dests, dests);
+  unlink(filename);
+
+ /*
+  * Write printer capabilities and read them back...
+  */
+
+  attrs = ippNew();
+  ippAddInteger(attrs, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "printer-config-change-time", 12345);
+  ippAddString(attrs, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "media-default", NULL, "iso_a4_210x297mm");
+
+  fputs("_cupsWriteDInfoCache: ", stdout);
+  if (_cupsWriteDInfoCache(filename, attrs))
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+  ippDelete(attrs);
+
+  fputs("_cupsReadDInfoCache: ", stdout);
+  if ((attrs = _cupsReadDInfoCache(filename)) == NULL)
+  {
+    puts("FAIL (NULL)");
+    status = 1;
+  }
+  else if ((value = ippGetString(ippFindAttribute(attrs, "media-default", IPP_TAG_KEYWORD), 0, NULL)) == NULL || strcmp(value, "iso_a4_210x297mm"))
+  {
+    printf("FAIL (got media-default=\"%s\")\n", value ? value : "(null)");
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+ /*
+  * The cached capabilities are only used while printer-config-change-time
+  * is unchanged...
+  */
+
+  current = ippNew();
+  attr    = ippAddInteger(current, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "printer-config-change-time", 12345);
+
+  fputs("_cupsCheckDInfoCache: ", stdout);
+  if (!_cupsCheckDInfoCache(attrs, current))
+  {
+    puts("FAIL (cached attributes not current)");
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+  ippSetInteger(current, &attr, 0, 12346);
+
+  fputs("_cupsCheckDInfoCache(stale): ", stdout);
+  if (_cupsCheckDInfoCache(attrs, current))
+  {
+    puts("FAIL (stale attributes accepted)");
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+  ippDelete(current);
+  ippDelete(attrs);
+  unlink(filename);
+
+  return (status);
+}
+
+
 /*
  * 'enum_cb()' - Print the results from the enumeration of destinations.
  */
@@ -766,6 +981,7 @@ usage(const char *arg)			/* I - Argument for usage message */
   puts("  ./testdest [--device] name [operation ...]");
   puts("  ./testdest [--device] ipp://... [operation ...]");
   puts("  ./testdest [--device] ipps://... [operation ...]");
+  puts("  ./testdest --cache");
   puts("  ./testdest --get");
   puts("  ./testdest --enum [grayscale] [color] [duplex] [staple] [small]\n"
        "                    [medium] [large]");
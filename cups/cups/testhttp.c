@@ -13,6 +13,18 @@
  */
 
 #include "cups-private.h"
+#ifndef _WIN32
+#  include <sys/time.h>
+#  include <sys/wait.h>
+#endif /* !_WIN32 */
+
+
+/*
+ * Local macros...
+ */
+
+#define STREAM_DATA(k)	(char)(((k) / 16) * 7 + ((k) >> 12))
+					/* Generated body data at offset k */
 
 
 /*
@@ -32,6 +44,12 @@ typedef struct uri_test_s		/**** URI test cases ****/
   http_uri_coding_t	assemble_coding;/* Coding for httpAssembleURI() */
 } uri_test_t;
 
+typedef struct field_test_s		/**** Field name test cases ****/
+{
+  const char		*name;		/* Field name */
+  http_field_t		field;		/* Expected field value */
+} field_test_t;
+
 
 /*
  * Local globals...
@@ -206,6 +224,58 @@ static const char * const base64_tests[][2] =
 			  { "ABCDEF", "QUJDREVG" },
 			  /* 010000 010100 001001 000011 010001 000100 010101 000110 */
 			};
+static const field_test_t field_tests[] =
+			{		/* Field name test data */
+			  { "Accept-Language", HTTP_FIELD_ACCEPT_LANGUAGE },
+			  { "accept-ranges", HTTP_FIELD_ACCEPT_RANGES },
+			  { "Authorization", HTTP_FIELD_AUTHORIZATION },
+			  { "CONNECTION", HTTP_FIELD_CONNECTION },
+			  { "Content-Encoding", HTTP_FIELD_CONTENT_ENCODING },
+			  { "Content-Language", HTTP_FIELD_CONTENT_LANGUAGE },
+			  { "content-length", HTTP_FIELD_CONTENT_LENGTH },
+			  { "Content-Location", HTTP_FIELD_CONTENT_LOCATION },
+			  { "Content-MD5", HTTP_FIELD_CONTENT_MD5 },
+			  { "Content-Range", HTTP_FIELD_CONTENT_RANGE },
+			  { "Content-Type", HTTP_FIELD_CONTENT_TYPE },
+			  { "Content-Version", HTTP_FIELD_CONTENT_VERSION },
+			  { "Date", HTTP_FIELD_DATE },
+			  { "host", HTTP_FIELD_HOST },
+			  { "If-Modified-Since", HTTP_FIELD_IF_MODIFIED_SINCE },
+			  { "If-Unmodified-Since", HTTP_FIELD_IF_UNMODIFIED_SINCE },
+			  { "Keep-Alive", HTTP_FIELD_KEEP_ALIVE },
+			  { "Last-Modified", HTTP_FIELD_LAST_MODIFIED },
+			  { "Link", HTTP_FIELD_LINK },
+			  { "Location", HTTP_FIELD_LOCATION },
+			  { "Range", HTTP_FIELD_RANGE },
+			  { "Referer", HTTP_FIELD_REFERER },
+			  { "Retry-After", HTTP_FIELD_RETRY_AFTER },
+			  { "Transfer-Encoding", HTTP_FIELD_TRANSFER_ENCODING },
+			  { "Upgrade", HTTP_FIELD_UPGRADE },
+			  { "User-Agent", HTTP_FIELD_USER_AGENT },
+			  { "WWW-Authenticate", HTTP_FIELD_WWW_AUTHENTICATE },
+			  { "Accept-Encoding", HTTP_FIELD_ACCEPT_ENCODING },
+			  { "Allow", HTTP_FIELD_ALLOW },
+			  { "Server", HTTP_FIELD_SERVER },
+			  { "Authentication-Info", HTTP_FIELD_AUTHENTICATION_INFO },
+			  { "", HTTP_FIELD_UNKNOWN },
+			  { "X", HTTP_FIELD_UNKNOWN },
+			  { "Content", HTTP_FIELD_UNKNOWN },
+			  { "Content-Lengths", HTTP_FIELD_UNKNOWN },
+			  { "Cookie", HTTP_FIELD_UNKNOWN },
+			  { "Expect", HTTP_FIELD_UNKNOWN },
+			  { "X-Frame-Options", HTTP_FIELD_UNKNOWN }
+			};
+
+
+/*
+ * Local functions...
+ */
+
+#ifndef _WIN32
+static double	get_seconds(void);
+static int	header_test(int count);
+static int	stream_test(size_t bufsize, size_t wsize, const char *coding, int threads, int mbytes);
+#endif /* !_WIN32 */
 
 
 /*
@@ -547,6 +617,33 @@ main(int  argc,				/* I - Number of command-line arguments */
     else
       printf("PASS (%s)\n", buffer);
 
+   /*
+    * httpFieldValue
+    */
+
+    fputs("httpFieldValue: ", stdout);
+
+    for (i = 0, j = 0; i < (int)(sizeof(field_tests) / sizeof(field_tests[0])); i ++)
+    {
+      http_field_t field = httpFieldValue(field_tests[i].name);
+					/* Field value */
+
+      if (field != field_tests[i].field)
+      {
+        if (!j)
+	{
+	  puts("FAIL");
+	  j = 1;
+	}
+
+        printf("    \"%s\" returned %d, expected %d\n", field_tests[i].name, field, field_tests[i].field);
+        failures ++;
+      }
+    }
+
+    if (!j)
+      puts("PASS");
+
    /*
     * Show a summary and return...
     */
@@ -599,6 +696,71 @@ main(int  argc,				/* I - Number of command-line arguments */
       return (0);
     }
   }
+#ifndef _WIN32
+  else if (!strcmp(argv[1], "-p"))
+  {
+   /*
+    * Benchmark parsing response headers...
+    */
+
+    return (header_test(argc > 2 ? atoi(argv[2]) : 1000000) ? 0 : 1);
+  }
+  else if (!strcmp(argv[1], "-s"))
+  {
+   /*
+    * Benchmark streaming a chunked request body over the loopback interface
+    * with different buffer and write sizes...
+    */
+
+    int		mbytes = argc > 2 ? atoi(argv[2]) : 64;
+					/* Megabytes to send per test */
+    static const size_t bufsizes[] = { HTTP_MAX_BUFFER, 65536, 262144 };
+					/* Buffer sizes to test */
+    static const size_t wsizes[] = { 512, 4096, 32768 };
+					/* Write sizes to test */
+
+    if (mbytes < 1)
+      mbytes = 64;
+
+    for (failures = 0, i = 0; i < (int)(sizeof(wsizes) / sizeof(wsizes[0])); i ++)
+      for (j = 0; j < (int)(sizeof(bufsizes) / sizeof(bufsizes[0])); j ++)
+        if (!stream_test(bufsizes[j], wsizes[i], NULL, 1, mbytes))
+	  failures ++;
+
+    return (failures ? 1 : 0);
+  }
+  else if (!strcmp(argv[1], "-z"))
+  {
+   /*
+    * Benchmark compressing a request body with each content coding, on one
+    * thread and on four threads...
+    */
+
+    int		mbytes = argc > 2 ? atoi(argv[2]) : 64;
+					/* Megabytes to send per test */
+    static const char * const codings[] =
+    {					/* Content codings to test */
+      "deflate",
+      "gzip",
+#  ifdef HAVE_ZSTD
+      "zstd"
+#  endif /* HAVE_ZSTD */
+    };
+
+    if (mbytes < 1)
+      mbytes = 64;
+
+    for (failures = 0, i = 0; i < (int)(sizeof(codings) / sizeof(codings[0])); i ++)
+    {
+      if (!stream_test(65536, 32768, codings[i], 1, mbytes))
+        failures ++;
+      if (!stream_test(65536, 32768, codings[i], 4, mbytes))
+        failures ++;
+    }
+
+    return (failures ? 1 : 0);
+  }
+#endif /* !_WIN32 */
   else if (!strcmp(argv[1], "-u") && argc == 3)
   {
    /*
@@ -944,3 +1106,269 @@ main(int  argc,				/* I - Number of command-line arguments */
 
   return (0);
 }
+
+
+#ifndef _WIN32
+/*
+ * 'get_seconds()' - Get the current time in seconds.
+ */
+
+static double				/* O - Time in seconds */
+get_seconds(void)
+{
+  struct timeval	curtime;	/* Current time */
+
+
+  gettimeofday(&curtime, NULL);
+
+  return (curtime.tv_sec + 0.000001 * curtime.tv_usec);
+}
+
+
+/*
+ * 'header_test()' - Time parsing of a typical IPP response header.
+ *
+ * The header is copied into the input buffer of an unconnected client, so
+ * only the parsing code is measured.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+header_test(int count)			/* I - Number of responses to parse */
+{
+  int		i;			/* Looping var */
+  http_t	*http;			/* HTTP connection */
+  http_status_t	status;			/* HTTP status */
+  size_t	len;			/* Length of header */
+  double	start,			/* Start time */
+		secs;			/* Elapsed time */
+  static const char *header =		/* Response header from cupsd */
+    "HTTP/1.1 200 OK\r\n"
+    "Connection: Keep-Alive\r\n"
+    "Content-Language: en_US\r\n"
+    "Content-Length: 9876\r\n"
+    "Content-Type: application/ipp\r\n"
+    "Date: Sun, 18 Oct 2026 05:01:49 GMT\r\n"
+    "Keep-Alive: timeout=10\r\n"
+    "Accept-Encoding: gzip, deflate, identity\r\n"
+    "Server: CUPS/2.3 IPP/2.1\r\n"
+    "X-Frame-Options: DENY\r\n"
+    "Content-Security-Policy: frame-ancestors 'none'\r\n"
+    "\r\n";
+
+
+  if (count < 1)
+    count = 1000000;
+
+  printf("httpUpdate(%d responses): ", count);
+  fflush(stdout);
+
+  if ((http = httpConnect2("127.0.0.1", 631, NULL, AF_INET, HTTP_ENCRYPTION_NEVER, 1, 0, NULL)) == NULL)
+  {
+    printf("FAIL (%s)\n", cupsLastErrorString());
+    return (0);
+  }
+
+  len   = strlen(header);
+  start = get_seconds();
+
+  for (i = 0; i < count; i ++)
+  {
+    httpClearFields(http);
+
+    memcpy(http->inbuf, header, len);
+    http->inptr = http->inbuf;
+    http->used  = (int)len;
+    http->state = HTTP_STATE_POST_RECV;
+
+    while ((status = httpUpdate(http)) == HTTP_STATUS_CONTINUE);
+
+    if (status != HTTP_STATUS_OK || strcmp(httpGetField(http, HTTP_FIELD_CONTENT_TYPE), "application/ipp") || httpGetLength2(http) != 9876)
+    {
+      printf("FAIL (status %d)\n", status);
+      httpClose(http);
+      return (0);
+    }
+  }
+
+  secs = get_seconds() - start;
+
+  httpClose(http);
+
+  printf("PASS (%.0f ns/response)\n", 1000000000.0 * secs / count);
+
+  return (1);
+}
+
+
+/*
+ * 'stream_test()' - Stream a chunked request body to a child process.
+ *
+ * When a content coding is used the body is generated data that the child
+ * checks after decompressing it.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+stream_test(size_t     bufsize,		/* I - Connection buffer size */
+            size_t     wsize,		/* I - Size of each httpWrite2 call */
+            const char *coding,		/* I - Content coding or @code NULL@ */
+            int        threads,		/* I - Number of compression threads */
+            int        mbytes)		/* I - Megabytes to send */
+{
+  int		fd;			/* Listening socket */
+  http_addr_t	addr;			/* Listen address */
+  socklen_t	addrlen;		/* Length of address */
+  pid_t		pid;			/* Child process ID */
+  int		status;			/* Exit status of child */
+  http_t	*http;			/* HTTP connection */
+  http_status_t	hstatus;		/* HTTP status */
+  char		buffer[32768],		/* Data buffer */
+		resource[HTTP_MAX_URI];	/* Resource path */
+  off_t		total,			/* Total bytes */
+		bytes,			/* Bytes to send */
+		k;			/* Offset in body */
+  ssize_t	rbytes;			/* Bytes read */
+  int		bad = 0;		/* Bad data seen? */
+  double	start,			/* Start time */
+		secs;			/* Elapsed time */
+
+
+  if (coding)
+    printf("httpWrite2(%-7s, %d thread%s): ", coding, threads, threads == 1 ? " " : "s");
+  else
+    printf("httpWrite2(%5u bytes, %6u byte buffer): ", (unsigned)wsize, (unsigned)bufsize);
+  fflush(stdout);
+
+ /*
+  * Listen on an ephemeral loopback port...
+  */
+
+  memset(&addr, 0, sizeof(addr));
+  addr.ipv4.sin_family      = AF_INET;
+  addr.ipv4.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  if ((fd = httpAddrListen(&addr, 0)) < 0)
+  {
+    printf("FAIL (%s)\n", cupsLastErrorString());
+    return (0);
+  }
+
+  addrlen = sizeof(addr);
+  getsockname(fd, (struct sockaddr *)&addr, &addrlen);
+
+  if ((pid = fork()) < 0)
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    httpAddrClose(NULL, fd);
+    return (0);
+  }
+  else if (pid == 0)
+  {
+   /*
+    * Child reads and discards the request body, then responds...
+    */
+
+    if ((http = httpAcceptConnection(fd, 1)) == NULL)
+      exit(1);
+
+    if (httpReadRequest(http, resource, sizeof(resource)) != HTTP_STATE_POST)
+      exit(1);
+
+    while ((hstatus = httpUpdate(http)) == HTTP_STATUS_CONTINUE);
+
+    if (hstatus != HTTP_STATUS_OK)
+      exit(1);
+
+    for (total = 0; (rbytes = httpRead2(http, buffer, sizeof(buffer))) > 0; total += rbytes)
+    {
+      if (coding)
+      {
+        for (k = 0; k < rbytes; k ++)
+          if (buffer[k] != STREAM_DATA(total + k))
+	    bad = 1;
+      }
+    }
+
+    httpClearFields(http);
+    httpSetLength(http, 0);
+    httpWriteResponse(http, !bad && total == (off_t)mbytes * 1048576 ? HTTP_STATUS_OK : HTTP_STATUS_BAD_REQUEST);
+    httpFlushWrite(http);
+    httpClose(http);
+    exit(0);
+  }
+
+ /*
+  * Parent sends the request body...
+  */
+
+  httpAddrClose(NULL, fd);
+
+  if ((http = httpConnect2("127.0.0.1", httpAddrPort(&addr), NULL, AF_INET, HTTP_ENCRYPTION_NEVER, 1, 30000, NULL)) == NULL)
+  {
+    printf("FAIL (%s)\n", cupsLastErrorString());
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    return (0);
+  }
+
+  _httpSetBufferSize(http, bufsize, bufsize);
+  _httpSetCodingThreads(http, threads);
+
+  memset(buffer, 'x', sizeof(buffer));
+
+  httpClearFields(http);
+  httpSetField(http, HTTP_FIELD_TRANSFER_ENCODING, "chunked");
+  if (coding)
+    httpSetField(http, HTTP_FIELD_CONTENT_ENCODING, coding);
+
+  start = get_seconds();
+
+  if (httpPost(http, "/"))
+  {
+    printf("FAIL (%s)\n", cupsLastErrorString());
+    httpClose(http);
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    return (0);
+  }
+
+  if (coding)
+    httpSetField(http, HTTP_FIELD_CONTENT_ENCODING, coding);
+
+  for (total = (off_t)mbytes * 1048576; total > 0; total -= bytes)
+  {
+    bytes = total > (off_t)wsize ? (off_t)wsize : total;
+
+    if (coding)
+    {
+      off_t offset = (off_t)mbytes * 1048576 - total;
+					/* Offset of this write in body */
+
+      for (k = 0; k < bytes; k ++)
+        buffer[k] = STREAM_DATA(offset + k);
+    }
+
+    if (httpWrite2(http, buffer, (size_t)bytes) < bytes)
+      break;
+  }
+
+  httpWrite2(http, "", 0);
+
+  while ((hstatus = httpUpdate(http)) == HTTP_STATUS_CONTINUE);
+
+  secs = get_seconds() - start;
+
+  httpClose(http);
+
+  waitpid(pid, &status, 0);
+
+  if (total > 0 || hstatus != HTTP_STATUS_OK || status)
+  {
+    printf("FAIL (status %d, child %d)\n", hstatus, status);
+    return (0);
+  }
+
+  printf("PASS (%.1f MB/s)\n", mbytes / secs);
+
+  return (1);
+}
+#endif /* !_WIN32 */
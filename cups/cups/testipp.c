@@ -17,9 +17,11 @@
 #include "ipp-private.h"
 #ifdef _WIN32
 #  include <io.h>
+#  include <windows.h>
 #else
 #  include <unistd.h>
 #  include <fcntl.h>
+#  include <sys/time.h>
 #endif /* _WIN32 */
 
 
@@ -286,6 +288,8 @@ static ipp_uchar_t mixed[] =		/* Mixed value buffer */
  * Local functions...
  */
 
+ipp_attribute_t *find_linear(ipp_t *ipp, const char *name);
+double	get_seconds(void);
 void	hex_dump(const char *title, ipp_uchar_t *buffer, size_t bytes);
 void	print_attributes(ipp_t *ipp, int indent);
 ssize_t	read_cb(_ippdata_t *data, ipp_uchar_t *buffer, size_t bytes);
@@ -315,6 +319,21 @@ main(int  argc,			/* I - Number of command-line arguments */
   cups_file_t	*fp;		/* File pointer */
   size_t	i;		/* Looping var */
   int		status;		/* Status of tests (0 = success, 1 = fail) */
+  char		attrname[32];	/* Attribute name */
+  int		count;		/* Number of lookups */
+  double	start,		/* Start time */
+		indexed,	/* Indexed lookup time */
+		linear;		/* Linear lookup time */
+  ipp_t		*arena;		/* Arena-backed message */
+  _ipp_arena_t	*chunk;		/* Arena chunk */
+  ipp_attribute_t *arena_attr;	/* Arena attribute */
+  ipp_uchar_t	*large;		/* Large message buffer */
+  const char	*values[4];	/* String values */
+  char		strings[4][32];	/* String value buffers */
+  int		allocs,		/* Number of heap allocations */
+		chunks;		/* Number of arena allocations */
+  double	heap_time,	/* Heap message decode time */
+		arena_time;	/* Arena message decode time */
 #ifdef DEBUG
   const char	*name;		/* Option name */
 #endif /* DEBUG */
@@ -776,6 +795,346 @@ main(int  argc,			/* I - Number of command-line arguments */
       status = 1;
     }
 
+   /*
+    * Read a response one attribute at a time, looking up an attribute after
+    * each one, and confirm that multi-valued attributes are read intact...
+    */
+
+    fputs("_ippReadAttributeIO with ippFindAttribute: ", stdout);
+
+    request = ippNew();
+    ippSetVersion(request, 2, 0);
+    ippSetStatusCode(request, IPP_STATUS_OK);
+    ippSetRequestId(request, 1);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_CHARSET, "attributes-charset", NULL, "utf-8");
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_LANGUAGE, "attributes-natural-language", NULL, "en");
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_TEXT, "status-message", NULL, "successful-ok");
+
+    for (i = 0; i < 2; i ++)
+    {
+      static const char * const reasons[] = { "job-printing", "job-hold-until-specified" };
+
+      if (i)
+        ippAddSeparator(request);
+
+      ippAddInteger(request, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-id", (int)i + 1);
+      ippAddStrings(request, IPP_TAG_JOB, IPP_TAG_KEYWORD, "job-state-reasons", 2, NULL, reasons);
+      ippAddInteger(request, IPP_TAG_JOB, IPP_TAG_ENUM, "job-state", IPP_JSTATE_PROCESSING);
+    }
+
+    data.wused   = 0;
+    data.wsize   = sizeof(buffer);
+    data.wbuffer = buffer;
+
+    while ((state = ippWriteIO(&data, (ipp_iocb_t)write_cb, 1, NULL, request)) != IPP_STATE_DATA)
+      if (state == IPP_STATE_ERROR)
+	break;
+
+    ippDelete(request);
+
+    request    = ippNew();
+    data.rpos  = 0;
+    data.wsize = data.wused;
+    count      = 0;
+
+    while ((attr = _ippReadAttributeIO(&data, (ipp_iocb_t)read_cb, request)) != NULL)
+    {
+      ippFindAttribute(request, "status-message", IPP_TAG_TEXT);
+
+      if (attr->name && !strcmp(attr->name, "job-state-reasons") && ippGetCount(attr) == 2)
+        count ++;
+    }
+
+    if (ippGetState(request) != IPP_STATE_DATA)
+    {
+      printf("FAIL (%s)\n", cupsLastErrorString());
+      status = 1;
+    }
+    else if (count != 2)
+    {
+      printf("FAIL (%d of 2 job-state-reasons read intact)\n", count);
+      status = 1;
+    }
+    else
+      puts("PASS");
+
+    ippDelete(request);
+
+   /*
+    * Test the attribute name index using a large message...
+    */
+
+    fputs("ippFindAttribute(large message): ", stdout);
+    fflush(stdout);
+
+    request = ippNew();
+
+    for (i = 0; i < 256; i ++)
+    {
+      snprintf(attrname, sizeof(attrname), "attr-%03d", (int)i);
+      ippAddInteger(request, IPP_TAG_PRINTER, IPP_TAG_INTEGER, attrname, (int)i);
+    }
+
+    ippAddString(request, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "attr-010", NULL, "ten");
+
+    if (ippFindAttribute(request, "no-such-attribute", IPP_TAG_ZERO))
+    {
+      puts("FAIL (found no-such-attribute)");
+      status = 1;
+    }
+    else if (!request->index)
+    {
+      puts("FAIL (no index)");
+      status = 1;
+    }
+    else if ((attr = ippFindAttribute(request, "ATTR-100", IPP_TAG_ZERO)) == NULL || ippGetInteger(attr, 0) != 100)
+    {
+      puts("FAIL (ATTR-100 not found)");
+      status = 1;
+    }
+    else if ((attr = ippFindAttribute(request, "attr-010", IPP_TAG_KEYWORD)) == NULL || strcmp(ippGetString(attr, 0, NULL), "ten"))
+    {
+      puts("FAIL (attr-010 keyword not found)");
+      status = 1;
+    }
+    else if ((attr = ippFindNextAttribute(request, "attr-010", IPP_TAG_ZERO)) != NULL)
+    {
+      puts("FAIL (found another attr-010)");
+      status = 1;
+    }
+    else
+    {
+     /*
+      * Delete, grow, rename, and add attributes and make sure the index keeps
+      * up...
+      */
+
+      ippDeleteAttribute(request, ippFindAttribute(request, "attr-020", IPP_TAG_ZERO));
+
+      attr = ippFindAttribute(request, "attr-030", IPP_TAG_ZERO);
+      ippSetInteger(request, &attr, 1, 30);
+
+      media_col = ippFindAttribute(request, "attr-040", IPP_TAG_ZERO);
+      ippSetName(request, &media_col, "renamed-040");
+
+      ippAddInteger(request, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "attr-256", 256);
+
+      if (ippFindAttribute(request, "attr-020", IPP_TAG_ZERO))
+      {
+        puts("FAIL (found deleted attr-020)");
+        status = 1;
+      }
+      else if (ippFindAttribute(request, "attr-030", IPP_TAG_ZERO) != attr || ippGetCount(attr) != 2)
+      {
+        puts("FAIL (wrong attr-030 after resize)");
+        status = 1;
+      }
+      else if (ippFindAttribute(request, "attr-040", IPP_TAG_ZERO) || ippFindAttribute(request, "renamed-040", IPP_TAG_ZERO) != media_col)
+      {
+        puts("FAIL (wrong attr-040 after rename)");
+        status = 1;
+      }
+      else if ((attr = ippFindAttribute(request, "attr-256", IPP_TAG_INTEGER)) == NULL || ippGetInteger(attr, 0) != 256)
+      {
+        puts("FAIL (attr-256 not found)");
+        status = 1;
+      }
+      else
+      {
+       /*
+        * Compare the speed of indexed and linear lookups...
+	*/
+
+        for (i = 0; i < 256; i ++)
+	{
+	  snprintf(attrname, sizeof(attrname), "attr-%03d", (int)i);
+	  if (ippFindAttribute(request, attrname, IPP_TAG_ZERO) != find_linear(request, attrname))
+	    break;
+	}
+
+        if (i < 256)
+	{
+	  printf("FAIL (wrong attribute for %s)\n", attrname);
+	  status = 1;
+	}
+	else
+	{
+	  start = get_seconds();
+	  for (count = 0; count < 100000; count ++)
+	  {
+	    snprintf(attrname, sizeof(attrname), "attr-%03d", count & 255);
+	    ippFindAttribute(request, attrname, IPP_TAG_ZERO);
+	  }
+	  indexed = get_seconds() - start;
+
+	  start = get_seconds();
+	  for (count = 0; count < 100000; count ++)
+	  {
+	    snprintf(attrname, sizeof(attrname), "attr-%03d", count & 255);
+	    find_linear(request, attrname);
+	  }
+	  linear = get_seconds() - start;
+
+	  printf("PASS (%.0f indexed lookups/sec, %.0f linear lookups/sec)\n", count / indexed, count / linear);
+	}
+      }
+    }
+
+    ippDelete(request);
+
+   /*
+    * Test arena-backed messages by decoding a large request...
+    */
+
+    fputs("_ippNewArena(large message): ", stdout);
+    fflush(stdout);
+
+    request = ippNew();
+    allocs  = 1;
+
+    for (i = 0; i < 256; i ++)
+    {
+      snprintf(attrname, sizeof(attrname), "attr-%03d", (int)i);
+      for (count = 0; count < 4; count ++)
+      {
+        snprintf(strings[count], sizeof(strings[0]), "value-%03d-%d", (int)i, count);
+        values[count] = strings[count];
+      }
+
+      ippAddStrings(request, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, attrname, 4, NULL, values);
+      ippAddInteger(request, IPP_TAG_PRINTER, IPP_TAG_INTEGER, attrname, (int)i);
+
+      allocs += 1 + 1 + 4 + 1;		/* keyword attr, name, values, integer attr */
+    }
+
+    length = ippLength(request);
+    large  = malloc(length);
+
+    data.wused   = 0;
+    data.wsize   = length;
+    data.wbuffer = large;
+
+    while ((state = ippWriteIO(&data, (ipp_iocb_t)write_cb, 1, NULL, request)) != IPP_STATE_DATA)
+      if (state == IPP_STATE_ERROR)
+	break;
+
+    data.rpos = 0;
+    arena     = _ippNewArena();
+
+    while ((state = ippReadIO(&data, (ipp_iocb_t)read_cb, 1, NULL, arena)) != IPP_STATE_DATA)
+      if (state == IPP_STATE_ERROR)
+	break;
+
+    for (attr = ippFirstAttribute(request), arena_attr = ippFirstAttribute(arena); attr && arena_attr; attr = ippNextAttribute(request), arena_attr = ippNextAttribute(arena))
+    {
+      if (strcmp(ippGetName(attr), ippGetName(arena_attr)) || ippGetValueTag(attr) != ippGetValueTag(arena_attr) || ippGetCount(attr) != ippGetCount(arena_attr))
+        break;
+
+      if (ippGetValueTag(attr) == IPP_TAG_INTEGER)
+      {
+        if (ippGetInteger(attr, 0) != ippGetInteger(arena_attr, 0))
+	  break;
+      }
+      else
+      {
+        for (count = 0; count < ippGetCount(attr); count ++)
+	  if (strcmp(ippGetString(attr, count, NULL), ippGetString(arena_attr, count, NULL)))
+	    break;
+
+        if (count < ippGetCount(attr))
+	  break;
+      }
+    }
+
+    if (state != IPP_STATE_DATA)
+    {
+      puts("FAIL (unable to encode/decode)");
+      status = 1;
+    }
+    else if (attr || arena_attr)
+    {
+      printf("FAIL (%s does not match)\n", attr ? ippGetName(attr) : ippGetName(arena_attr));
+      status = 1;
+    }
+    else
+    {
+     /*
+      * Modify the arena-backed message and make sure the values stick...
+      */
+
+      attr = ippFindAttribute(arena, "attr-000", IPP_TAG_KEYWORD);
+      ippSetString(arena, &attr, 0, "short");
+      ippSetString(arena, &attr, 1, "a-much-longer-value-than-before");
+      ippSetString(arena, &attr, 4, "value-000-4");
+      ippSetString(arena, &attr, 1, "longer-value");
+
+      ippDeleteAttribute(arena, ippFindAttribute(arena, "attr-001", IPP_TAG_KEYWORD));
+      ippCopyAttribute(arena, ippFindAttribute(request, "attr-255", IPP_TAG_KEYWORD), 0);
+
+      arena_attr = ippFindAttribute(arena, "attr-002", IPP_TAG_INTEGER);
+      ippSetName(arena, &arena_attr, "renamed-002");
+
+      if (ippGetCount(attr) != 5 || strcmp(ippGetString(attr, 0, NULL), "short") || strcmp(ippGetString(attr, 1, NULL), "longer-value") || strcmp(ippGetString(attr, 4, NULL), "value-000-4"))
+      {
+        puts("FAIL (bad attr-000 after ippSetString)");
+        status = 1;
+      }
+      else if (ippFindAttribute(arena, "attr-001", IPP_TAG_KEYWORD))
+      {
+        puts("FAIL (found deleted attr-001)");
+        status = 1;
+      }
+      else if ((attr = arena->last) == NULL || strcmp(ippGetName(attr), "attr-255") || strcmp(ippGetString(attr, 3, NULL), "value-255-3"))
+      {
+        puts("FAIL (bad copy of attr-255)");
+        status = 1;
+      }
+      else if (!arena_attr || ippFindAttribute(arena, "renamed-002", IPP_TAG_ZERO) != arena_attr)
+      {
+        puts("FAIL (bad attr-002 after rename)");
+        status = 1;
+      }
+      else
+      {
+       /*
+        * Compare the speed and number of allocations for heap and arena
+	* messages...
+	*/
+
+	start = get_seconds();
+	for (count = 0; count < 1000; count ++)
+	{
+	  ipp_t *temp = ippNew();	/* Decoded message */
+
+	  data.rpos = 0;
+	  ippReadIO(&data, (ipp_iocb_t)read_cb, 1, NULL, temp);
+	  ippDelete(temp);
+	}
+	heap_time = get_seconds() - start;
+
+	start = get_seconds();
+	for (count = 0; count < 1000; count ++)
+	{
+	  ipp_t *temp = _ippNewArena();	/* Decoded message */
+
+	  data.rpos = 0;
+	  ippReadIO(&data, (ipp_iocb_t)read_cb, 1, NULL, temp);
+
+	  for (chunks = 1, chunk = temp->arena; chunk; chunk = chunk->next)
+	    chunks ++;
+
+	  ippDelete(temp);
+	}
+	arena_time = get_seconds() - start;
+
+        printf("PASS (%.0f heap messages/sec with %d allocations, %.0f arena messages/sec with %d allocations)\n", count / heap_time, allocs, count / arena_time, chunks);
+      }
+    }
+
+    ippDelete(arena);
+    ippDelete(request);
+    free(large);
+
    /*
     * Summarize...
     */
@@ -876,6 +1235,45 @@ main(int  argc,			/* I - Number of command-line arguments */
 }
 
 
+/*
+ * 'find_linear()' - Find an attribute by walking the attribute list.
+ */
+
+ipp_attribute_t *			/* O - Matching attribute */
+find_linear(ipp_t      *ipp,		/* I - IPP message */
+            const char *name)		/* I - Name of attribute */
+{
+  ipp_attribute_t	*attr;		/* Current attribute */
+
+
+  for (attr = ipp->attrs; attr; attr = attr->next)
+    if (attr->name && !_cups_strcasecmp(attr->name, name))
+      break;
+
+  return (attr);
+}
+
+
+/*
+ * 'get_seconds()' - Get the current time in seconds.
+ */
+
+double					/* O - Current time in seconds */
+get_seconds(void)
+{
+#ifdef _WIN32
+  return (GetTickCount() * 0.001);
+
+#else
+  struct timeval	curtime;	/* Current time */
+
+
+  gettimeofday(&curtime, NULL);
+  return (curtime.tv_sec + 0.000001 * curtime.tv_usec);
+#endif /* _WIN32 */
+}
+
+
 /*
  * 'hex_dump()' - Produce a hex dump of a buffer.
  */
@@ -13,17 +13,29 @@
 
 #include <stdio.h>
 #include <errno.h>
+#include <sys/time.h>
 #include <cups/cups.h>
+#include <cups/string-private.h>
 #include <cups/thread-private.h>
 
 
+/*
+ * Local globals...
+ */
+
+static char	pool_strings[256][32];	/* Shared strings for pool test */
+
+
 /*
  * Local functions...
  */
 
 static int	enum_dests_cb(void *_name, unsigned flags, cups_dest_t *dest);
+static double	get_seconds(void);
+static void	*run_pool(void *_id);
 static void	*run_query(cups_dest_t *dest);
 static void	show_supported(http_t *http, cups_dest_t *dest, cups_dinfo_t *dinfo, const char *option, const char *value);
+static int	test_pool(void);
 
 
 /*
@@ -38,7 +50,8 @@ main(int  argc,				/* I - Number of command-line arguments */
   * Go through all the available destinations to find the requested one...
   */
 
-  (void)argc;
+  if (argc > 1 && !strcmp(argv[1], "--pool"))
+    return (test_pool());
 
   cupsEnumDests(CUPS_DEST_FLAGS_NONE, -1, NULL, 0, 0, enum_dests_cb, argv[1]);
 
@@ -86,6 +99,57 @@ enum_dests_cb(void        *_name,	/* I - Printer name, if any */
 }
 
 
+/*
+ * 'get_seconds()' - Get the current time in seconds.
+ */
+
+static double				/* O - Time in seconds */
+get_seconds(void)
+{
+  struct timeval	curtime;	/* Current time */
+
+
+  gettimeofday(&curtime, NULL);
+
+  return (curtime.tv_sec + 0.000001 * curtime.tv_usec);
+}
+
+
+/*
+ * 'run_pool()' - Allocate and free strings from the string pool.
+ *
+ * Most lookups hit strings that are already pooled, like the attribute names
+ * and keywords in IPP messages, with every 16th string being new.
+ */
+
+static void *				/* O - Return value (not used) */
+run_pool(void *_id)			/* I - Thread number */
+{
+  int		id = (int)(intptr_t)_id;/* Thread number */
+  int		i;			/* Looping var */
+  char		temp[32],		/* Unique string */
+		*s;			/* Pooled string */
+
+
+  for (i = 0; i < 100000; i ++)
+  {
+    if (i & 15)
+    {
+      s = _cupsStrAlloc(pool_strings[(i * 7 + id) & 255]);
+    }
+    else
+    {
+      snprintf(temp, sizeof(temp), "thread-%d-%d", id, i);
+      s = _cupsStrAlloc(temp);
+    }
+
+    _cupsStrFree(s);
+  }
+
+  return (NULL);
+}
+
+
 /*
  * 'run_query()' - Query printer capabilities on a separate thread.
  */
@@ -266,3 +330,67 @@ show_supported(http_t       *http,	/* I - Connection to destination */
   else
     puts("NO");
 }
+
+
+/*
+ * 'test_pool()' - Measure string pool throughput with multiple threads.
+ */
+
+static int				/* O - Exit status */
+test_pool(void)
+{
+  int			i,		/* Looping var */
+			num_threads;	/* Number of threads */
+  _cups_thread_t	threads[8];	/* Threads */
+  char			*strings[256];	/* Pooled strings */
+  double		start,		/* Start time */
+			secs;		/* Elapsed time */
+  size_t		count;		/* Number of pooled strings */
+  int			status = 0;	/* Exit status */
+
+
+ /*
+  * Keep a reference to the shared strings so that they stay in the pool...
+  */
+
+  for (i = 0; i < 256; i ++)
+  {
+    snprintf(pool_strings[i], sizeof(pool_strings[0]), "keyword-value-%d", i);
+    strings[i] = _cupsStrAlloc(pool_strings[i]);
+  }
+
+  for (num_threads = 1; num_threads <= 8; num_threads *= 2)
+  {
+    printf("_cupsStrAlloc/_cupsStrFree(%d threads): ", num_threads);
+    fflush(stdout);
+
+    start = get_seconds();
+
+    for (i = 0; i < num_threads; i ++)
+      threads[i] = _cupsThreadCreate(run_pool, (void *)(intptr_t)i);
+
+    for (i = 0; i < num_threads; i ++)
+      _cupsThreadWait(threads[i]);
+
+    secs = get_seconds() - start;
+
+    if ((count = _cupsStrStatistics(NULL, NULL)) != 256)
+    {
+      printf("FAIL (%d strings in pool, expected 256)\n", (int)count);
+      status = 1;
+    }
+    else
+      printf("PASS (%.0f strings/sec)\n", 100000.0 * num_threads / secs);
+  }
+
+  for (i = 0; i < 256; i ++)
+    _cupsStrFree(strings[i]);
+
+  if ((count = _cupsStrStatistics(NULL, NULL)) != 0)
+  {
+    printf("_cupsStrFree: FAIL (%d strings left in pool)\n", (int)count);
+    status = 1;
+  }
+
+  return (status);
+}
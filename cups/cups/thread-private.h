@@ -95,6 +95,7 @@ extern void	_cupsRWUnlock(_cups_rwlock_t *rwlock) _CUPS_PRIVATE;
 extern void	_cupsThreadCancel(_cups_thread_t thread) _CUPS_PRIVATE;
 extern _cups_thread_t _cupsThreadCreate(_cups_thread_func_t func, void *arg) _CUPS_PRIVATE;
 extern void     _cupsThreadDetach(_cups_thread_t thread) _CUPS_PRIVATE;
+extern int	_cupsThreadIsSelf(_cups_thread_t thread) _CUPS_PRIVATE;
 extern void	*_cupsThreadWait(_cups_thread_t thread) _CUPS_PRIVATE;
 
 #  ifdef __cplusplus
@@ -186,6 +186,17 @@ _cupsThreadDetach(_cups_thread_t thread)/* I - Thread ID */
 }
 
 
+/*
+ * '_cupsThreadIsSelf()' - Determine whether a thread is the calling thread.
+ */
+
+int					/* O - 1 if current thread, 0 otherwise */
+_cupsThreadIsSelf(_cups_thread_t thread)/* I - Thread ID */
+{
+  return (pthread_equal(pthread_self(), thread) != 0);
+}
+
+
 /*
  * '_cupsThreadWait()' - Wait for a thread to exit.
  */
@@ -369,6 +380,20 @@ _cupsThreadDetach(_cups_thread_t thread)/* I - Thread ID */
 }
 
 
+/*
+ * '_cupsThreadIsSelf()' - Determine whether a thread is the calling thread.
+ */
+
+int					/* O - 1 if current thread, 0 otherwise */
+_cupsThreadIsSelf(_cups_thread_t thread)/* I - Thread ID */
+{
+  // TODO: Implement me
+  (void)thread;
+
+  return (0);
+}
+
+
 /*
  * '_cupsThreadWait()' - Wait for a thread to exit.
  */
@@ -536,6 +561,19 @@ _cupsThreadDetach(_cups_thread_t thread)/* I - Thread ID */
 }
 
 
+/*
+ * '_cupsThreadIsSelf()' - Determine whether a thread is the calling thread.
+ */
+
+int					/* O - 1 if current thread, 0 otherwise */
+_cupsThreadIsSelf(_cups_thread_t thread)/* I - Thread ID */
+{
+  (void)thread;
+
+  return (0);
+}
+
+
 /*
  * '_cupsThreadWait()' - Wait for a thread to exit.
  */
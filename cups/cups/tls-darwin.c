@@ -1185,6 +1185,23 @@ static void logSecError(const char *function, OSStatus err)
  }
 }
 
+/*
+ * '_httpTLSGetStatistics()' - Get the number of full and resumed handshakes.
+ *
+ * Handshakes are not currently counted for Secure Transport.
+ */
+
+void
+_httpTLSGetStatistics(size_t *full,	/* O - Full handshakes */
+                      size_t *resumed)	/* O - Resumed handshakes */
+{
+  if (full)
+    *full = 0;
+  if (resumed)
+    *resumed = 0;
+}
+
+
 /*
  * '_httpTLSInitialize()' - Initialize the TLS stack.
  */
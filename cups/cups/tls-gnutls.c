@@ -17,6 +17,21 @@
 #include <sys/stat.h>
 
 
+/*
+ * Local types...
+ */
+
+#define _HTTP_TLS_MAX_SESSIONS	16	/* Maximum cached client sessions */
+#define _HTTP_TLS_SESSION_LIFE	3600	/* Lifetime of cached sessions */
+
+typedef struct _http_tls_session_s	/**** Cached client session ****/
+{
+  char			name[288];	/* "hostname:port" */
+  gnutls_datum_t	data;		/* Session data */
+  time_t		expires;	/* Expiration time */
+} _http_tls_session_t;
+
+
 /*
  * Local globals...
  */
@@ -33,6 +48,14 @@ static _cups_mutex_t	tls_mutex = _CUPS_MUTEX_INITIALIZER;
 static int		tls_options = -1,/* Options for TLS connections */
 			tls_min_version = _HTTP_TLS_1_0,
 			tls_max_version = _HTTP_TLS_MAX;
+static _http_tls_session_t tls_sessions[_HTTP_TLS_MAX_SESSIONS];
+					/* Cached client sessions */
+static size_t		tls_full_handshakes = 0,
+					/* Number of full handshakes */
+			tls_resumed_handshakes = 0;
+					/* Number of resumed handshakes */
+static gnutls_datum_t	tls_ticket_key = { NULL, 0 };
+					/* Server session ticket key */
 
 
 /*
@@ -44,6 +67,7 @@ static const char	*http_gnutls_default_path(char *buffer, size_t bufsize);
 static void		http_gnutls_load_crl(void);
 static const char	*http_gnutls_make_path(char *buffer, size_t bufsize, const char *dirname, const char *filename, const char *ext);
 static ssize_t		http_gnutls_read(gnutls_transport_ptr_t ptr, void *data, size_t length);
+static void		http_gnutls_session_name(http_t *http, char *buffer, size_t bufsize);
 static ssize_t		http_gnutls_write(gnutls_transport_ptr_t ptr, const void *data, size_t length);
 
 
@@ -1151,6 +1175,21 @@ http_gnutls_read(
 }
 
 
+/*
+ * 'http_gnutls_session_name()' - Get the client session cache name for a
+ *                                connection.
+ */
+
+static void
+http_gnutls_session_name(
+    http_t *http,			/* I - HTTP connection */
+    char   *buffer,			/* I - Name buffer */
+    size_t bufsize)			/* I - Size of name buffer */
+{
+  snprintf(buffer, bufsize, "%s:%d", http->hostname, httpAddrPort(http->hostaddr));
+}
+
+
 /*
  * 'http_gnutls_write()' - Write function for the GNU TLS library.
  */
@@ -1173,6 +1212,25 @@ http_gnutls_write(
 }
 
 
+/*
+ * '_httpTLSGetStatistics()' - Get the number of full and resumed handshakes.
+ */
+
+void
+_httpTLSGetStatistics(size_t *full,	/* O - Full handshakes */
+                      size_t *resumed)	/* O - Resumed handshakes */
+{
+  _cupsMutexLock(&tls_mutex);
+
+  if (full)
+    *full = tls_full_handshakes;
+  if (resumed)
+    *resumed = tls_resumed_handshakes;
+
+  _cupsMutexUnlock(&tls_mutex);
+}
+
+
 /*
  * '_httpTLSInitialize()' - Initialize the TLS stack.
  */
@@ -1364,6 +1422,34 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
     }
 
     status = gnutls_server_name_set(http->tls, GNUTLS_NAME_DNS, hostname, strlen(hostname));
+
+   /*
+    * Then try to resume a previous session with the same host...
+    */
+
+    if (!status)
+    {
+      char		name[288];	/* Session name */
+      time_t		curtime = time(NULL);
+					/* Current time */
+      _http_tls_session_t *session;	/* Current session */
+
+      http_gnutls_session_name(http, name, sizeof(name));
+
+      _cupsMutexLock(&tls_mutex);
+
+      for (session = tls_sessions; session < (tls_sessions + _HTTP_TLS_MAX_SESSIONS); session ++)
+      {
+        if (session->data.data && session->expires > curtime && !strcmp(session->name, name))
+        {
+          DEBUG_printf(("4_httpTLSStart: Resuming session for \"%s\".", name));
+          gnutls_session_set_data(http->tls, session->data.data, session->data.size);
+          break;
+        }
+      }
+
+      _cupsMutexUnlock(&tls_mutex);
+    }
   }
   else
   {
@@ -1524,6 +1610,27 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
 
     if (!status)
       status = gnutls_certificate_set_x509_key_file(*credentials, crtfile, keyfile, GNUTLS_X509_FMT_PEM);
+
+   /*
+    * Enable session tickets so clients can resume sessions without a full
+    * handshake; the ticket key lasts for the life of the process...
+    */
+
+    if (!status)
+    {
+      _cupsMutexLock(&tls_mutex);
+
+      if (!tls_ticket_key.data && gnutls_session_ticket_key_generate(&tls_ticket_key))
+      {
+	DEBUG_puts("4_httpTLSStart: Unable to generate session ticket key.");
+	tls_ticket_key.data = NULL;
+      }
+
+      if (tls_ticket_key.data)
+        gnutls_session_ticket_enable_server(http->tls, &tls_ticket_key);
+
+      _cupsMutexUnlock(&tls_mutex);
+    }
   }
 
   if (!status)
@@ -1659,6 +1766,19 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
 
   http->tls_credentials = credentials;
 
+ /*
+  * Count full and resumed handshakes...
+  */
+
+  _cupsMutexLock(&tls_mutex);
+
+  if (gnutls_session_is_resumed(http->tls))
+    tls_resumed_handshakes ++;
+  else
+    tls_full_handshakes ++;
+
+  _cupsMutexUnlock(&tls_mutex);
+
   return (0);
 }
 
@@ -1673,6 +1793,49 @@ _httpTLSStop(http_t *http)		/* I - Connection to server */
   int	error;				/* Error code */
 
 
+  if (http->mode == _HTTP_MODE_CLIENT)
+  {
+   /*
+    * Save the session for the next connection to this host; with TLS 1.3 the
+    * session ticket arrives after the handshake so we do this here...
+    */
+
+    char		name[288];	/* Session name */
+    gnutls_datum_t	data;		/* Session data */
+    time_t		curtime = time(NULL);
+					/* Current time */
+    _http_tls_session_t	*session,	/* Current session */
+			*oldest = tls_sessions;
+					/* Oldest/matching session */
+
+    if (!gnutls_session_get_data2(http->tls, &data))
+    {
+      http_gnutls_session_name(http, name, sizeof(name));
+
+      _cupsMutexLock(&tls_mutex);
+
+      for (session = tls_sessions; session < (tls_sessions + _HTTP_TLS_MAX_SESSIONS); session ++)
+      {
+        if (!strcmp(session->name, name))
+        {
+          oldest = session;
+          break;
+        }
+        else if (session->expires < oldest->expires)
+          oldest = session;
+      }
+
+      if (oldest->data.data)
+        gnutls_free(oldest->data.data);
+
+      strlcpy(oldest->name, name, sizeof(oldest->name));
+      oldest->data    = data;
+      oldest->expires = curtime + _HTTP_TLS_SESSION_LIFE;
+
+      _cupsMutexUnlock(&tls_mutex);
+    }
+  }
+
   error = gnutls_bye(http->tls, http->mode == _HTTP_MODE_CLIENT ? GNUTLS_SHUT_RDWR : GNUTLS_SHUT_WR);
   if (error != GNUTLS_E_SUCCESS)
     _cupsSetError(IPP_STATUS_ERROR_INTERNAL, gnutls_strerror(errno), 0);
@@ -668,6 +668,23 @@ httpDeleteCredentials(const char *common_name)
  return -1;
 }
 
+/*
+ * '_httpTLSGetStatistics()' - Get the number of full and resumed handshakes.
+ *
+ * Handshakes are not currently counted for SSPI.
+ */
+
+void
+_httpTLSGetStatistics(size_t *full,	/* O - Full handshakes */
+                      size_t *resumed)	/* O - Resumed handshakes */
+{
+  if (full)
+    *full = 0;
+  if (resumed)
+    *resumed = 0;
+}
+
+
 /*
  * '_httpTLSInitialize()' - Initialize the TLS stack.
  */
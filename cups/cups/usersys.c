@@ -75,7 +75,8 @@ typedef struct _cups_client_conf_s	/**** client.conf config data ****/
   int			trust_first,	/* Trust on first use? */
 			any_root,	/* Allow any (e.g., self-signed) root */
 			expired_certs,	/* Allow expired certs */
-			validate_certs;	/* Validate certificates */
+			validate_certs,	/* Validate certificates */
+			dinfo_cache;	/* Cache destination information? */
   http_encryption_t	encryption;	/* Encryption setting */
   char			user[65],	/* User name */
 			server_name[256];
@@ -437,10 +438,7 @@ cupsSetServer(const char *server)	/* I - Server name */
   }
 
   if (cg->http)
-  {
-    httpClose(cg->http);
-    cg->http = NULL;
-  }
+    _cupsDisconnect(cg);
 }
 
 
@@ -1047,6 +1045,9 @@ _cupsSetDefaults(void)
   if (cg->validate_certs < 0)
     cg->validate_certs = cc.validate_certs;
 
+  if (cg->dinfo_cache < 0)
+    cg->dinfo_cache = cc.dinfo_cache;
+
 #ifdef HAVE_SSL
   _httpTLSSetOptions(cc.ssl_options | _HTTP_TLS_SET_DEFAULT, cc.ssl_min_version, cc.ssl_max_version);
 #endif /* HAVE_SSL */
@@ -1132,6 +1133,9 @@ cups_finalize_client_conf(
   if ((value = getenv("CUPS_ANYROOT")) != NULL)
     cc->any_root = cups_boolean_value(value);
 
+  if ((value = getenv("CUPS_DESTINFOCACHE")) != NULL)
+    cc->dinfo_cache = cups_boolean_value(value);
+
   if ((value = getenv("CUPS_ENCRYPTION")) != NULL)
     cups_set_encryption(cc, value);
 
@@ -1168,6 +1172,9 @@ cups_finalize_client_conf(
   if (cc->expired_certs < 0)
     cc->expired_certs = 0;
 
+  if (cc->dinfo_cache < 0)
+    cc->dinfo_cache = 0;
+
 #ifdef HAVE_GSSAPI
   if (!cc->gss_service_name[0])
     cups_set_gss_service_name(cc, CUPS_DEFAULT_GSSSERVICENAME);
@@ -1275,6 +1282,7 @@ cups_init_client_conf(
   cc->any_root        = -1;
   cc->expired_certs   = -1;
   cc->validate_certs  = -1;
+  cc->dinfo_cache     = -1;
 
  /*
   * Load settings from the org.cups.PrintingPrefs plist (which trump
@@ -1377,6 +1385,8 @@ cups_read_client_conf(
     else if (!_cups_strcasecmp(line, "AllowExpiredCerts") &&
              value)
       cc->expired_certs = cups_boolean_value(value);
+    else if (!_cups_strcasecmp(line, "DestInfoCache") && value)
+      cc->dinfo_cache = cups_boolean_value(value);
     else if (!_cups_strcasecmp(line, "ValidateCerts") && value)
       cc->validate_certs = cups_boolean_value(value);
 #ifdef HAVE_GSSAPI
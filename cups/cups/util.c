@@ -79,14 +79,6 @@ cupsCancelJob2(http_t     *http,	/* I - Connection to server or @code CUPS_HTTP_
     return (0);
   }
 
- /*
-  * Connect to the default server as needed...
-  */
-
-  if (!http)
-    if ((http = _cupsConnect()) == NULL)
-      return (IPP_STATUS_ERROR_SERVICE_UNAVAILABLE);
-
  /*
   * Build an IPP_CANCEL_JOB or IPP_PURGE_JOBS request, which requires the following
   * attributes:
@@ -335,14 +327,6 @@ cupsGetDefault2(http_t *http)		/* I - Connection to server or @code CUPS_HTTP_DE
   if (_cupsUserDefault(cg->def_printer, sizeof(cg->def_printer)))
     return (cg->def_printer);
 
- /*
-  * Connect to the server as needed...
-  */
-
-  if (!http)
-    if ((http = _cupsConnect()) == NULL)
-      return (NULL);
-
  /*
   * Build a CUPS_GET_DEFAULT request, which requires the following
   * attributes:
@@ -483,10 +467,6 @@ cupsGetJobs2(http_t     *http,		/* I - Connection to server or @code CUPS_HTTP_D
   else
     strlcpy(uri, "ipp://localhost/", sizeof(uri));
 
-  if (!http)
-    if ((http = _cupsConnect()) == NULL)
-      return (-1);
-
  /*
   * Build an IPP_GET_JOBS request, which requires the following
   * attributes:
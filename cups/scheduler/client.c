@@ -454,6 +454,15 @@ cupsdCloseClient(cupsd_client_t *con)	/* I - Client to close */
 
   cupsdLogClient(con, CUPSD_LOG_DEBUG, "Closing connection.");
 
+ /*
+  * Wait for any threaded IPP response so it no longer uses the client...
+  */
+
+  if (con->ipp_task)
+    cupsdWaitIPPThreads();
+
+  cupsdFreeIPPStream(con);
+
  /*
   * Flush pending writes before closing...
   */
@@ -542,6 +551,7 @@ cupsdCloseClient(cupsd_client_t *con)	/* I - Client to close */
     cupsdClearString(&con->command);
     cupsdClearString(&con->options);
     cupsdClearString(&con->query_string);
+    cupsdClearString(&con->jobs_cursor);
 
     if (con->request)
     {
@@ -1291,7 +1301,7 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 
 	    if (!strcmp(httpGetField(con->http, HTTP_FIELD_CONTENT_TYPE), "application/ipp"))
 	    {
-              con->request = ippNew();
+              con->request = _ippNewArena();
               break;
             }
             else if (!WebInterface)
@@ -1474,7 +1484,14 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 
 	    fchmod(con->file, 0640);
 	    fchown(con->file, RunUser, Group);
+
 	    fcntl(con->file, F_SETFD, fcntl(con->file, F_GETFD) | FD_CLOEXEC);
+
+           /*
+	    * Use a larger input buffer while we copy the request data...
+	    */
+
+	    _httpSetBufferSize(con->http, 65536, 0);
 	    break;
 
 	case HTTP_STATE_DELETE :
@@ -1760,7 +1777,14 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 
 	    fchmod(con->file, 0640);
 	    fchown(con->file, RunUser, Group);
+
             fcntl(con->file, F_SETFD, fcntl(con->file, F_GETFD) | FD_CLOEXEC);
+
+           /*
+	    * Use a larger input buffer while we copy the request data...
+	    */
+
+	    _httpSetBufferSize(con->http, 65536, 0);
 	  }
 
 	  if (httpGetState(con->http) != HTTP_STATE_POST_SEND)
@@ -1836,6 +1860,9 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 	  if (con->file >= 0)
 	  {
             struct stat    filestats;  /* File information */
+
+	    _httpSetBufferSize(con->http, HTTP_MAX_BUFFER, 0);
+
 	    fstat(con->file, &filestats);
 
 	    close(con->file);
@@ -2410,10 +2437,14 @@ cupsdWriteClient(cupsd_client_t *con)	/* I - Client connection */
     do
     {
      /*
-      * Write a single attribute or the IPP message header...
+      * Write a single attribute or the IPP message header, or for streamed
+      * responses the next job or printer...
       */
 
-      ipp_state = ippWrite(con->http, con->response);
+      if (con->ipp_stream)
+        ipp_state = _ippWriteAttributes(con->http, (ipp_iocb_t)httpWrite2, con->response, cupsdCopyIPPStream(con));
+      else
+        ipp_state = ippWrite(con->http, con->response);
 
      /*
       * If the write buffer has been flushed, stop buffering up attributes...
@@ -2665,6 +2696,14 @@ cupsdWriteClient(cupsd_client_t *con)	/* I - Client connection */
     {
       cupsArrayRemove(ActiveClients, con);
       cupsdSetBusyState(0);
+
+     /*
+      * A pipelined request may already be in the input buffer, in which case
+      * select() won't tell us about it...
+      */
+
+      if (httpGetReady(con->http))
+        cupsdReadClient(con);
     }
   }
 }
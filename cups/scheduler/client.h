@@ -17,6 +17,11 @@
  * HTTP client structure...
  */
 
+typedef struct cupsd_ipp_task_s cupsd_ipp_task_t;
+					/* Threaded IPP response */
+typedef struct cupsd_ipp_stream_s cupsd_ipp_stream_t;
+					/* Streamed IPP response */
+
 struct cupsd_client_s
 {
   int			number;		/* Connection number */
@@ -63,6 +68,11 @@ struct cupsd_client_s
 #ifdef HAVE_AUTHORIZATION_H
   AuthorizationRef	authref;	/* Authorization ref */
 #endif /* HAVE_AUTHORIZATION_H */
+  char			*jobs_cursor;	/* Get-Jobs filters and next first-index for paging cursor */
+  int			jobs_pos,	/* Job list position for paging cursor */
+			jobs_id;	/* Job ID at paging cursor position */
+  cupsd_ipp_task_t	*ipp_task;	/* Threaded IPP response, if any */
+  cupsd_ipp_stream_t	*ipp_stream;	/* Streamed IPP response, if any */
 
   uid_t                 peer_uid;       /* if non-zero, this is the uid of peer; it may be useful when we xpc back to get auth */
 };
@@ -122,7 +132,9 @@ VAR cupsd_statbuf_t	*CGIStatusBuffer VALUE(NULL);
 extern void	cupsdAcceptClient(cupsd_listener_t *lis);
 extern void	cupsdCloseAllClients(void);
 extern int	cupsdCloseClient(cupsd_client_t *con);
+extern int	cupsdCopyIPPStream(cupsd_client_t *con);
 extern void	cupsdDeleteAllListeners(void);
+extern void	cupsdFreeIPPStream(cupsd_client_t *con);
 extern void	cupsdPauseListening(void);
 extern int	cupsdProcessIPPRequest(cupsd_client_t *con);
 extern void	cupsdReadClient(cupsd_client_t *con);
@@ -134,9 +146,12 @@ extern int	cupsdSendError(cupsd_client_t *con, http_status_t code,
 extern int	cupsdSendHeader(cupsd_client_t *con, http_status_t code,
 		                char *type, int auth_type);
 extern void	cupsdShutdownClient(cupsd_client_t *con);
+extern void	cupsdStartIPPThreads(void);
 extern void	cupsdStartListening(void);
+extern void	cupsdStopIPPThreads(void);
 extern void	cupsdStopListening(void);
 extern void	cupsdUpdateCGI(void);
+extern void	cupsdWaitIPPThreads(void);
 extern void	cupsdWriteClient(cupsd_client_t *con);
 
 #ifdef HAVE_SSL
@@ -97,6 +97,7 @@ static const cupsd_var_t	cupsd_vars[] =
 #ifdef HAVE_ONDEMAND
   { "IdleExitTimeout",		&IdleExitTimeout,	CUPSD_VARTYPE_TIME },
 #endif /* HAVE_ONDEMAND */
+  { "IPPThreads",		&IPPThreads,		CUPSD_VARTYPE_INTEGER },
   { "JobKillDelay",		&JobKillDelay,		CUPSD_VARTYPE_TIME },
   { "JobRetryLimit",		&JobRetryLimit,		CUPSD_VARTYPE_INTEGER },
   { "JobRetryInterval",		&JobRetryInterval,	CUPSD_VARTYPE_TIME },
@@ -108,10 +109,12 @@ static const cupsd_var_t	cupsd_vars[] =
   { "LimitRequestBody",		&MaxRequestSize,	CUPSD_VARTYPE_INTEGER },
   { "ListenBackLog",		&ListenBackLog,		CUPSD_VARTYPE_INTEGER },
   { "LogDebugHistory",		&LogDebugHistory,	CUPSD_VARTYPE_INTEGER },
+  { "LogFlushInterval",		&LogFlushInterval,	CUPSD_VARTYPE_TIME },
   { "MaxActiveJobs",		&MaxActiveJobs,		CUPSD_VARTYPE_INTEGER },
   { "MaxClients",		&MaxClients,		CUPSD_VARTYPE_INTEGER },
   { "MaxClientsPerHost",	&MaxClientsPerHost,	CUPSD_VARTYPE_INTEGER },
   { "MaxCopies",		&MaxCopies,		CUPSD_VARTYPE_INTEGER },
+  { "MaxDebugHistorySize",	&MaxDebugHistorySize,	CUPSD_VARTYPE_INTEGER },
   { "MaxEvents",		&MaxEvents,		CUPSD_VARTYPE_INTEGER },
   { "MaxHoldTime",		&MaxHoldTime,		CUPSD_VARTYPE_TIME },
   { "MaxJobs",			&MaxJobs,		CUPSD_VARTYPE_INTEGER },
@@ -126,12 +129,14 @@ static const cupsd_var_t	cupsd_vars[] =
   { "MaxSubscriptionsPerPrinter",&MaxSubscriptionsPerPrinter,	CUPSD_VARTYPE_INTEGER },
   { "MaxSubscriptionsPerUser",	&MaxSubscriptionsPerUser,	CUPSD_VARTYPE_INTEGER },
   { "MultipleOperationTimeout",	&MultipleOperationTimeout,	CUPSD_VARTYPE_TIME },
+  { "OrphanPurgeBatch",		&OrphanPurgeBatch,	CUPSD_VARTYPE_INTEGER },
   { "PageLogFormat",		&PageLogFormat,		CUPSD_VARTYPE_STRING },
   { "PreserveJobFiles",		&JobFiles,		CUPSD_VARTYPE_TIME },
   { "PreserveJobHistory",	&JobHistory,		CUPSD_VARTYPE_TIME },
   { "ReloadTimeout",		&ReloadTimeout,		CUPSD_VARTYPE_TIME },
   { "RIPCache",			&RIPCache,		CUPSD_VARTYPE_STRING },
   { "RootCertDuration",		&RootCertDuration,	CUPSD_VARTYPE_TIME },
+  { "SelectBackend",		&SelectBackend,		CUPSD_VARTYPE_STRING },
   { "ServerAdmin",		&ServerAdmin,		CUPSD_VARTYPE_STRING },
   { "ServerName",		&ServerName,		CUPSD_VARTYPE_STRING },
   { "StrictConformance",	&StrictConformance,	CUPSD_VARTYPE_BOOLEAN },
@@ -723,11 +728,15 @@ cupsdReadConfiguration(void)
   FilterLimit              = 0;
   FilterNice               = 0;
   HostNameLookups          = FALSE;
+  IPPThreads               = 0;
   KeepAlive                = TRUE;
   KeepAliveTimeout         = DEFAULT_KEEPALIVE;
   ListenBackLog            = SOMAXCONN;
+  LogBufferFull            = CUPSD_LOGFULL_WAIT;
   LogDebugHistory          = 200;
+  LogFileFormat            = CUPSD_LOGFORMAT_TEXT;
   LogFilePerm              = CUPS_DEFAULT_LOG_FILE_PERM;
+  LogFlushInterval         = 0;
   LogLevel                 = CUPSD_LOG_WARN;
   LogTimeFormat            = CUPSD_TIME_STANDARD;
   MaxClients               = 100;
@@ -758,10 +767,12 @@ cupsdReadConfiguration(void)
   cupsdSetString(&SMBConfigFile, CUPS_DEFAULT_SMB_CONFIG_FILE);
 
   cupsdSetString(&ErrorPolicy, "stop-printer");
+  cupsdSetString(&SelectBackend, "auto");
 
   JobHistory          = DEFAULT_HISTORY;
   JobFiles            = DEFAULT_FILES;
   JobAutoPurge        = 0;
+  OrphanPurgeBatch    = 0;
   MaxHoldTime         = 0;
   MaxJobs             = 500;
   MaxActiveJobs       = 0;
@@ -769,6 +780,7 @@ cupsdReadConfiguration(void)
   MaxJobsPerPrinter   = 0;
   MaxJobTime          = 3 * 60 * 60;	/* 3 hours */
   MaxCopies           = CUPS_DEFAULT_MAX_COPIES;
+  MaxDebugHistorySize = 16 * 1024 * 1024;
 
   cupsdDeleteAllPolicies();
   cupsdClearString(&DefaultPolicy);
@@ -1245,6 +1257,17 @@ cupsdReadConfiguration(void)
     cupsdSetString(&ErrorPolicy, "stop-printer");
   }
 
+ /*
+  * Switch to the requested file polling backend...
+  */
+
+  if (!cupsdSetSelectBackend(SelectBackend))
+  {
+    cupsdLogMessage(CUPSD_LOG_WARN, "Unsupported SelectBackend \"%s\", resetting to \"auto\".", SelectBackend);
+    cupsdSetString(&SelectBackend, "auto");
+    cupsdSetSelectBackend(SelectBackend);
+  }
+
  /*
   * Update default paper size setting as needed...
   */
@@ -1313,6 +1336,25 @@ cupsdReadConfiguration(void)
   if (MaxActiveJobs > (MaxFDs / 3))
     MaxActiveJobs = MaxFDs / 3;
 
+ /*
+  * Check the IPPThreads setting...
+  */
+
+  if (IPPThreads < 0)
+    IPPThreads = 0;
+  else if (IPPThreads > 64)
+  {
+    cupsdLogMessage(CUPSD_LOG_INFO, "IPPThreads limited to 64.");
+    IPPThreads = 64;
+  }
+
+ /*
+  * Check the LogFlushInterval setting...
+  */
+
+  if (LogFlushInterval < 0)
+    LogFlushInterval = 0;
+
  /*
   * Update the MaxClientsPerHost value, as needed...
   */
@@ -3277,6 +3319,34 @@ read_cupsd_conf(cups_file_t *fp)	/* I - File to read from */
         cupsdLogMessage(CUPSD_LOG_WARN, "Unknown AccessLogLevel %s on line %d of %s.",
 	                value, linenum, ConfigurationFile);
     }
+    else if (!_cups_strcasecmp(line, "LogBufferFull") && value)
+    {
+     /*
+      * What to do when a log buffer is full...
+      */
+
+      if (!_cups_strcasecmp(value, "wait"))
+        LogBufferFull = CUPSD_LOGFULL_WAIT;
+      else if (!_cups_strcasecmp(value, "drop"))
+        LogBufferFull = CUPSD_LOGFULL_DROP;
+      else
+        cupsdLogMessage(CUPSD_LOG_WARN, "Unknown LogBufferFull %s on line %d of %s.",
+	                value, linenum, ConfigurationFile);
+    }
+    else if (!_cups_strcasecmp(line, "LogFileFormat") && value)
+    {
+     /*
+      * Format of access and page log files...
+      */
+
+      if (!_cups_strcasecmp(value, "text"))
+        LogFileFormat = CUPSD_LOGFORMAT_TEXT;
+      else if (!_cups_strcasecmp(value, "json"))
+        LogFileFormat = CUPSD_LOGFORMAT_JSON;
+      else
+        cupsdLogMessage(CUPSD_LOG_WARN, "Unknown LogFileFormat %s on line %d of %s.",
+	                value, linenum, ConfigurationFile);
+    }
     else if (!_cups_strcasecmp(line, "LogLevel") && value)
     {
      /*
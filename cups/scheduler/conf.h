@@ -40,6 +40,18 @@ typedef enum
   CUPSD_ACCESSLOG_ALL			/* Log everything */
 } cupsd_accesslog_t;
 
+typedef enum
+{
+  CUPSD_LOGFORMAT_TEXT,			/* Plain text lines */
+  CUPSD_LOGFORMAT_JSON			/* One JSON object per line */
+} cupsd_logformat_t;
+
+typedef enum
+{
+  CUPSD_LOGFULL_WAIT,			/* Wait for the log writer */
+  CUPSD_LOGFULL_DROP			/* Drop the log line */
+} cupsd_logfull_t;
+
 typedef enum
 {
   CUPSD_TIME_STANDARD,			/* "Standard" Apache/CLF format */
@@ -146,6 +158,8 @@ VAR char		*AccessLog		VALUE(NULL),
 					/* Default printer-error-policy */
 			*RIPCache		VALUE(NULL),
 					/* Amount of memory for RIPs */
+			*SelectBackend		VALUE(NULL),
+					/* File polling backend */
 			*TempDir		VALUE(NULL),
 					/* Temporary directory */
 			*Printcap		VALUE(NULL),
@@ -168,6 +182,8 @@ VAR int			ClassifyOverride	VALUE(0),
 					/* Allow overrides? */
 			LogDebugHistory		VALUE(200),
 					/* Amount of automatic debug history */
+			LogFlushInterval	VALUE(0),
+					/* Interval for flushing buffered logs */
 			FatalErrors		VALUE(CUPSD_FATAL_CONFIG),
 					/* Which errors are fatal? */
 			StrictConformance	VALUE(FALSE),
@@ -178,6 +194,10 @@ VAR mode_t		ConfigFilePerm		VALUE(0640U),
 					/* Permissions for config files */
 			LogFilePerm		VALUE(0644U);
 					/* Permissions for log files */
+VAR cupsd_logfull_t	LogBufferFull		VALUE(CUPSD_LOGFULL_WAIT);
+					/* What to do when a log buffer is full */
+VAR cupsd_logformat_t	LogFileFormat		VALUE(CUPSD_LOGFORMAT_TEXT);
+					/* Access and page log format */
 VAR cupsd_loglevel_t	LogLevel		VALUE(CUPSD_LOG_WARN);
 					/* Error log level */
 VAR cupsd_time_t	LogTimeFormat		VALUE(CUPSD_TIME_STANDARD);
@@ -214,6 +234,8 @@ VAR int			MaxClients		VALUE(100),
 					/* Current filter level */
 			FilterNice		VALUE(0),
 					/* Nice value for filters */
+			IPPThreads		VALUE(0),
+					/* Number of IPP worker threads */
 			ReloadTimeout		VALUE(DEFAULT_KEEPALIVE),
 					/* Timeout before reload from SIGHUP */
 			RootCertDuration	VALUE(300),
@@ -292,4 +314,6 @@ extern int	cupsdLogMessage(int level, const char *message, ...) _CUPS_FORMAT(2,
 extern int	cupsdLogPage(cupsd_job_t *job, const char *page);
 extern int	cupsdLogRequest(cupsd_client_t *con, http_status_t code);
 extern int	cupsdReadConfiguration(void);
+extern void	cupsdStartLogWriter(void);
+extern void	cupsdStopLogWriter(void);
 extern int	cupsdWriteErrorLog(int level, const char *message);
@@ -214,6 +214,7 @@ extern int		cupsdDoSelect(long timeout);
 extern int		cupsdIsSelecting(int fd);
 #endif /* CUPSD_IS_SELECTING */
 extern void		cupsdRemoveSelect(int fd);
+extern int		cupsdSetSelectBackend(const char *backend);
 extern void		cupsdStartSelect(void);
 extern void		cupsdStopSelect(void);
 
@@ -12,7 +12,7 @@
  */
 
 #include <cups/string-private.h>
-#include "mime.h"
+#include "mime-private.h"
 
 
 /*
@@ -33,16 +33,47 @@ typedef struct _mime_typelist_s		/**** List of source types ****/
   mime_type_t		*src;		/* Source type */
 } _mime_typelist_t;
 
+typedef struct _mime_path_s		/**** Cached filter path ****/
+{
+  mime_type_t		*src;		/* Source type */
+  int			mincost;	/* Lowest cost path (vs. first found)? */
+  size_t		minsize,	/* Minimum size of source file */
+			maxsize;	/* Maximum size of source file or 0 */
+  int			cost;		/* Cost of filters */
+  cups_array_t		*filters;	/* Filters to run or NULL */
+} _mime_path_t;
+
+typedef struct _mime_dstpaths_s		/**** Cached paths to a type ****/
+{
+  mime_type_t		*dst;		/* Destination type */
+  cups_array_t		*srcs,		/* Types that can be converted to dst */
+			*paths;		/* Cached filter paths */
+} _mime_dstpaths_t;
+
 
 /*
  * Local functions...
  */
 
+static _mime_path_t	*mime_add_path(mime_t *mime, _mime_dstpaths_t *dstpaths,
+			              mime_type_t *src, size_t srcsize,
+				      int mincost, cups_array_t *filters,
+				      int cost);
+static int		mime_compare_dstpaths(_mime_dstpaths_t *,
+			                      _mime_dstpaths_t *);
 static int		mime_compare_filters(mime_filter_t *, mime_filter_t *);
+static int		mime_compare_paths(_mime_path_t *, _mime_path_t *);
 static int		mime_compare_srcs(mime_filter_t *, mime_filter_t *);
+static int		mime_compare_types(mime_type_t *, mime_type_t *);
+static void		mime_delete_dstpaths(_mime_dstpaths_t *dstpaths);
 static cups_array_t	*mime_find_filters(mime_t *mime, mime_type_t *src,
 				      size_t srcsize, mime_type_t *dst,
-				      int *cost, _mime_typelist_t *visited);
+				      int *cost, _mime_typelist_t *visited,
+				      cups_array_t *dstsrcs);
+static _mime_path_t	*mime_find_path(_mime_dstpaths_t *dstpaths,
+			                mime_type_t *src, size_t srcsize,
+					int mincost);
+static _mime_dstpaths_t	*mime_get_dstpaths(mime_t *mime, mime_type_t *dst);
 
 
 /*
@@ -75,6 +106,13 @@ mimeAddFilter(mime_t      *mime,	/* I - MIME database */
     return (NULL);
   }
 
+ /*
+  * Adding or updating a filter invalidates the cached paths to any type that
+  * can be reached from the destination type...
+  */
+
+  _mimeFlushFilterPaths(mime, dst);
+
  /*
   * See if we already have an existing filter for the given source and
   * destination...
@@ -166,7 +204,9 @@ mimeFilter2(mime_t      *mime,		/* I - MIME database */
 	    mime_type_t *dst,		/* I - Destination file type */
 	    int         *cost)		/* O - Cost of filters */
 {
-  cups_array_t	*filters;		/* Array of filters to run */
+  cups_array_t		*filters;	/* Array of filters to run */
+  _mime_dstpaths_t	*dstpaths;	/* Cached paths to destination */
+  _mime_path_t		*path;		/* Cached path */
 
 
  /*
@@ -203,10 +243,36 @@ mimeFilter2(mime_t      *mime,		/* I - MIME database */
   }
 
  /*
-  * Find the filters...
+  * Find the filters, using the cached path if we have one.  Only the source
+  * types that can be converted to the destination type are searched...
   */
 
-  filters = mime_find_filters(mime, src, srcsize, dst, cost, NULL);
+  if ((dstpaths = mime_get_dstpaths(mime, dst)) == NULL)
+  {
+    filters = mime_find_filters(mime, src, srcsize, dst, cost, NULL, NULL);
+  }
+  else if (!cupsArrayFind(dstpaths->srcs, src))
+  {
+    DEBUG_puts("1mimeFilter2: No path to destination type.");
+    filters = NULL;
+  }
+  else if ((path = mime_find_path(dstpaths, src, srcsize, cost != NULL)) != NULL)
+  {
+    DEBUG_puts("1mimeFilter2: Using cached path.");
+
+    filters = cupsArrayDup(path->filters);
+
+    if (cost)
+      *cost = path->cost;
+  }
+  else
+  {
+    filters = mime_find_filters(mime, src, srcsize, dst, cost, NULL,
+                                dstpaths->srcs);
+
+    mime_add_path(mime, dstpaths, src, srcsize, cost != NULL, filters,
+                  cost ? *cost : 0);
+  }
 
   DEBUG_printf(("1mimeFilter2: Returning %d filter(s), cost %d:",
                 cupsArrayCount(filters), cost ? *cost : -1));
@@ -254,6 +320,124 @@ mimeFilterLookup(mime_t      *mime,	/* I - MIME database */
 }
 
 
+/*
+ * '_mimeFlushFilterPaths()' - Flush cached filter paths.
+ *
+ * The cached paths to any type that can be reached from the given type are
+ * removed; if the type is @code NULL@, all cached paths are removed.
+ */
+
+void
+_mimeFlushFilterPaths(
+    mime_t      *mime,			/* I - MIME database */
+    mime_type_t *type)			/* I - Changed type or @code NULL@ */
+{
+  _mime_dstpaths_t	*dstpaths;	/* Cached paths to destination */
+
+
+  if (!mime || !mime->paths)
+    return;
+
+  DEBUG_printf(("2_mimeFlushFilterPaths(mime=%p, type=%p(%s/%s))", mime,
+                type, type ? type->super : "???", type ? type->type : "???"));
+
+  for (dstpaths = (_mime_dstpaths_t *)cupsArrayFirst(mime->paths);
+       dstpaths;
+       dstpaths = (_mime_dstpaths_t *)cupsArrayNext(mime->paths))
+  {
+    if (!type || dstpaths->dst == type || cupsArrayFind(dstpaths->srcs, type))
+    {
+      cupsArrayRemove(mime->paths, dstpaths);
+      mime_delete_dstpaths(dstpaths);
+    }
+  }
+
+  if (!type)
+  {
+    cupsArrayDelete(mime->paths);
+    mime->paths = NULL;
+  }
+}
+
+
+/*
+ * 'mime_add_path()' - Add a filter path to the cache.
+ *
+ * The path is cached for the range of file sizes that compare the same as
+ * "srcsize" against the maxsize of every filter.
+ */
+
+static _mime_path_t *			/* O - New path */
+mime_add_path(
+    mime_t           *mime,		/* I - MIME database */
+    _mime_dstpaths_t *dstpaths,		/* I - Cached paths to destination */
+    mime_type_t      *src,		/* I - Source type */
+    size_t           srcsize,		/* I - Size of source file */
+    int              mincost,		/* I - Lowest cost path? */
+    cups_array_t     *filters,		/* I - Filters to run or @code NULL@ */
+    int              cost)		/* I - Cost of filters */
+{
+  _mime_path_t	*path;			/* New path */
+  mime_filter_t	*current;		/* Current filter */
+
+
+  if ((path = calloc(1, sizeof(_mime_path_t))) == NULL)
+    return (NULL);
+
+  path->src     = src;
+  path->mincost = mincost;
+  path->cost    = cost;
+
+  if (filters && (path->filters = cupsArrayDup(filters)) == NULL)
+  {
+    free(path);
+    return (NULL);
+  }
+
+  cupsArraySave(mime->filters);
+
+  for (current = (mime_filter_t *)cupsArrayFirst(mime->filters);
+       current;
+       current = (mime_filter_t *)cupsArrayNext(mime->filters))
+  {
+    if (current->maxsize == 0)
+      continue;
+
+    if (current->maxsize < srcsize)
+    {
+      if (current->maxsize >= path->minsize)
+        path->minsize = current->maxsize + 1;
+    }
+    else if (path->maxsize == 0 || current->maxsize < path->maxsize)
+      path->maxsize = current->maxsize;
+  }
+
+  cupsArrayRestore(mime->filters);
+
+  if (!cupsArrayAdd(dstpaths->paths, path))
+  {
+    cupsArrayDelete(path->filters);
+    free(path);
+    return (NULL);
+  }
+
+  return (path);
+}
+
+
+/*
+ * 'mime_compare_dstpaths()' - Compare the destination types of cached paths.
+ */
+
+static int				/* O - Comparison result */
+mime_compare_dstpaths(
+    _mime_dstpaths_t *d0,		/* I - First destination */
+    _mime_dstpaths_t *d1)		/* I - Second destination */
+{
+  return (mime_compare_types(d0->dst, d1->dst));
+}
+
+
 /*
  * 'mime_compare_filters()' - Compare two filters.
  */
@@ -274,6 +458,24 @@ mime_compare_filters(mime_filter_t *f0,	/* I - First filter */
 }
 
 
+/*
+ * 'mime_compare_paths()' - Compare two cached paths.
+ */
+
+static int				/* O - Comparison result */
+mime_compare_paths(_mime_path_t *p0,	/* I - First path */
+                   _mime_path_t *p1)	/* I - Second path */
+{
+  int	i;				/* Result of comparison */
+
+
+  if ((i = mime_compare_types(p0->src, p1->src)) == 0)
+    i = p0->mincost - p1->mincost;
+
+  return (i);
+}
+
+
 /*
  * 'mime_compare_srcs()' - Compare two filter source types.
  */
@@ -292,6 +494,46 @@ mime_compare_srcs(mime_filter_t *f0,	/* I - First filter */
 }
 
 
+/*
+ * 'mime_compare_types()' - Compare two type pointers.
+ */
+
+static int				/* O - Comparison result */
+mime_compare_types(mime_type_t *t0,	/* I - First type */
+                   mime_type_t *t1)	/* I - Second type */
+{
+  if (t0 < t1)
+    return (-1);
+  else
+    return (t0 > t1);
+}
+
+
+/*
+ * 'mime_delete_dstpaths()' - Free the cached paths to a type.
+ */
+
+static void
+mime_delete_dstpaths(
+    _mime_dstpaths_t *dstpaths)		/* I - Cached paths to destination */
+{
+  _mime_path_t	*path;			/* Current path */
+
+
+  for (path = (_mime_path_t *)cupsArrayFirst(dstpaths->paths);
+       path;
+       path = (_mime_path_t *)cupsArrayNext(dstpaths->paths))
+  {
+    cupsArrayDelete(path->filters);
+    free(path);
+  }
+
+  cupsArrayDelete(dstpaths->paths);
+  cupsArrayDelete(dstpaths->srcs);
+  free(dstpaths);
+}
+
+
 /*
  * 'mime_find_filters()' - Find the filters to convert from one type to another.
  */
@@ -303,7 +545,8 @@ mime_find_filters(
     size_t           srcsize,		/* I - Size of source file */
     mime_type_t      *dst,		/* I - Destination file type */
     int              *cost,		/* O - Cost of filters */
-    _mime_typelist_t *list)		/* I - Source types we've used */
+    _mime_typelist_t *list,		/* I - Source types we've used */
+    cups_array_t     *dstsrcs)		/* I - Types that can be converted to dst or @code NULL@ */
 {
   int			tempcost,	/* Temporary cost */
 			mincost;	/* Current minimum */
@@ -390,6 +633,14 @@ mime_find_filters(
     if (current->maxsize > 0 && srcsize > current->maxsize)
       continue;
 
+   /*
+    * Skip filters whose destination type can't be converted to the final
+    * type...
+    */
+
+    if (dstsrcs && !cupsArrayFind(dstsrcs, current->dst))
+      continue;
+
     for (listptr = list, current_dst = current->dst;
 	 listptr;
 	 listptr = listptr->next)
@@ -408,7 +659,7 @@ mime_find_filters(
 
     cupsArraySave(mime->srcs);
     temp = mime_find_filters(mime, current->dst, srcsize, dst, &tempcost,
-                             &listnode);
+                             &listnode, dstsrcs);
     cupsArrayRestore(mime->srcs);
 
     if (!temp)
@@ -485,3 +736,115 @@ mime_find_filters(
 
   return (NULL);
 }
+
+
+/*
+ * 'mime_find_path()' - Find a cached filter path.
+ */
+
+static _mime_path_t *			/* O - Cached path or @code NULL@ */
+mime_find_path(
+    _mime_dstpaths_t *dstpaths,		/* I - Cached paths to destination */
+    mime_type_t      *src,		/* I - Source type */
+    size_t           srcsize,		/* I - Size of source file */
+    int              mincost)		/* I - Lowest cost path? */
+{
+  _mime_path_t	key,			/* Search key */
+		*path;			/* Current path */
+
+
+  key.src     = src;
+  key.mincost = mincost;
+
+  for (path = (_mime_path_t *)cupsArrayFind(dstpaths->paths, &key);
+       path && !mime_compare_paths(path, &key);
+       path = (_mime_path_t *)cupsArrayNext(dstpaths->paths))
+    if (srcsize >= path->minsize && (path->maxsize == 0 || srcsize <= path->maxsize))
+      return (path);
+
+  return (NULL);
+}
+
+
+/*
+ * 'mime_get_dstpaths()' - Get the cached paths to a type.
+ *
+ * The first time a destination type is used, the types that can be converted
+ * to it are found by walking the filters backwards from the destination.
+ */
+
+static _mime_dstpaths_t *		/* O - Cached paths or @code NULL@ */
+mime_get_dstpaths(mime_t      *mime,	/* I - MIME database */
+                  mime_type_t *dst)	/* I - Destination type */
+{
+  _mime_dstpaths_t	key,		/* Search key */
+			*dstpaths;	/* Cached paths to destination */
+  cups_array_t		*pending;	/* Types to walk back from */
+  mime_type_t		*type;		/* Current type */
+  mime_filter_t		*current;	/* Current filter */
+  int			status = 1;	/* Result of walk */
+
+
+  if (!mime->paths &&
+      (mime->paths = cupsArrayNew((cups_array_func_t)mime_compare_dstpaths,
+                                  NULL)) == NULL)
+    return (NULL);
+
+  key.dst = dst;
+
+  if ((dstpaths = (_mime_dstpaths_t *)cupsArrayFind(mime->paths, &key)) != NULL)
+    return (dstpaths);
+
+  if ((dstpaths = calloc(1, sizeof(_mime_dstpaths_t))) == NULL)
+    return (NULL);
+
+  dstpaths->dst   = dst;
+  dstpaths->srcs  = cupsArrayNew((cups_array_func_t)mime_compare_types, NULL);
+  dstpaths->paths = cupsArrayNew((cups_array_func_t)mime_compare_paths, NULL);
+  pending         = cupsArrayNew(NULL, NULL);
+
+  if (!dstpaths->srcs || !dstpaths->paths || !pending ||
+      !cupsArrayAdd(dstpaths->srcs, dst) || !cupsArrayAdd(pending, dst))
+  {
+    cupsArrayDelete(pending);
+    mime_delete_dstpaths(dstpaths);
+    return (NULL);
+  }
+
+ /*
+  * Walk back from the destination; file sizes are ignored so that the list
+  * works for any file...
+  */
+
+  cupsArraySave(mime->filters);
+
+  while ((type = (mime_type_t *)cupsArrayFirst(pending)) != NULL)
+  {
+    cupsArrayRemove(pending, type);
+
+    for (current = (mime_filter_t *)cupsArrayFirst(mime->filters);
+         current;
+	 current = (mime_filter_t *)cupsArrayNext(mime->filters))
+      if (current->dst == type && !cupsArrayFind(dstpaths->srcs, current->src))
+      {
+        if (!cupsArrayAdd(dstpaths->srcs, current->src) ||
+	    !cupsArrayAdd(pending, current->src))
+	  status = 0;
+      }
+  }
+
+  cupsArrayRestore(mime->filters);
+  cupsArrayDelete(pending);
+
+  if (!status || !cupsArrayAdd(mime->paths, dstpaths))
+  {
+    DEBUG_puts("2mime_get_dstpaths: Returning NULL (out of memory).");
+    mime_delete_dstpaths(dstpaths);
+    return (NULL);
+  }
+
+  DEBUG_printf(("2mime_get_dstpaths: %d types can be converted to %s/%s.",
+                cupsArrayCount(dstpaths->srcs), dst->super, dst->type));
+
+  return (dstpaths);
+}
@@ -28,6 +28,72 @@ extern int mbr_check_membership_by_id(uuid_t user, gid_t group, int* ismember);
 #endif /* __APPLE__ */
 
 
+/*
+ * Local types...
+ */
+
+typedef struct cupsd_ipp_printer_s	/**** Printer for a threaded response ****/
+{
+  cupsd_printer_t	*printer;	/* Printer or class */
+  ipp_attribute_t	*after;		/* Response attribute to insert after */
+  ipp_t			*attrs;		/* Copied printer attributes */
+  char			*key;		/* Attribute cache key, if any */
+  int			gen;		/* Attribute cache generation */
+  void			*data;		/* Encoded attributes for cache */
+  size_t		datalen;	/* Length of encoded attributes */
+} cupsd_ipp_printer_t;
+
+struct cupsd_ipp_task_s			/**** Threaded printer attributes response ****/
+{
+  struct cupsd_ipp_task_s *next;	/* Next task in queue */
+  cupsd_client_t	*con;		/* Client connection */
+  ipp_attribute_t	*uri;		/* Request URI for logging */
+  cups_array_t		*ra;		/* Requested attributes array */
+  int			num_printers,	/* Number of printers */
+			alloc_printers;	/* Allocated printers */
+  cupsd_ipp_printer_t	*printers;	/* Printers to copy */
+};
+
+struct cupsd_ipp_stream_s		/**** Streamed response ****/
+{
+  cups_array_t		*ra;		/* Requested attributes array */
+  cupsd_policy_t	*policy;	/* Policy for jobs without a printer */
+  int			need_load_job,	/* Load jobs before copying them? */
+			count,		/* Number of jobs or printers copied */
+			next,		/* Next job or printer to copy */
+			num_jobs,	/* Number of jobs */
+			alloc_jobs,	/* Allocated jobs */
+			*jobs;		/* Job IDs */
+  cups_array_t		*printers;	/* Printer names */
+};
+
+
+/*
+ * Local globals...
+ */
+
+static _cups_mutex_t	ipp_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for worker threads */
+static _cups_cond_t	ipp_cond = _CUPS_COND_INITIALIZER;
+					/* Condition for worker threads */
+static cupsd_ipp_task_t	*ipp_queue = NULL,
+					/* Queued tasks */
+			*ipp_queue_last = NULL,
+					/* Last queued task */
+			*ipp_done = NULL,
+					/* Completed tasks */
+			*ipp_done_last = NULL;
+					/* Last completed task */
+static int		ipp_active = 0,	/* Number of tasks being processed */
+			ipp_stop = 0,	/* Stop worker threads? */
+			ipp_num_threads = 0,
+					/* Number of worker threads */
+			ipp_pipes[2] = { -1, -1 };
+					/* Completion pipe */
+static _cups_thread_t	*ipp_threads = NULL;
+					/* Worker threads */
+
+
 /*
  * Local functions...
  */
@@ -44,8 +110,12 @@ static void	add_printer(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	add_printer_state_reasons(cupsd_client_t *con,
 		                          cupsd_printer_t *p);
 static void	add_queued_job_count(cupsd_client_t *con, cupsd_printer_t *p);
+static void	add_stream_job(cupsd_client_t *con, cupsd_job_t *job);
+static void	add_stream_printer(cupsd_client_t *con,
+		                   cupsd_printer_t *printer);
 static void	apply_printer_defaults(cupsd_printer_t *printer,
 				       cupsd_job_t *job);
+static char	*attr_cache_key(cups_array_t *ra, int version);
 static void	authenticate_job(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	cancel_all_jobs(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	cancel_job(cupsd_client_t *con, ipp_attribute_t *uri);
@@ -58,6 +128,7 @@ static void	copy_attrs(ipp_t *to, ipp_t *from, cups_array_t *ra,
 			   cups_array_t *exclude);
 static int	copy_banner(cupsd_client_t *con, cupsd_job_t *job,
 		            const char *name);
+static ipp_t	*copy_collection(ipp_t *col, int quickcopy);
 static int	copy_file(const char *from, const char *to, mode_t mode);
 static int	copy_model(cupsd_client_t *con, const char *from,
 		           const char *to);
@@ -67,15 +138,22 @@ static void	copy_job_attrs(cupsd_client_t *con,
 static void	copy_printer_attrs(cupsd_client_t *con,
 		                   cupsd_printer_t *printer,
 				   cups_array_t *ra);
+static void	copy_static_attrs(ipp_t *to, ipp_t *from, cups_array_t *ra,
+		                  int version, int quickcopy);
 static void	copy_subscription_attrs(cupsd_client_t *con,
 		                        cupsd_subscription_t *sub,
 					cups_array_t *ra,
 					cups_array_t *exclude);
+static void	create_ipp_stream(cupsd_client_t *con, cups_array_t *ra,
+		                  cupsd_policy_t *policy, int need_load_job);
+static void	create_ipp_task(cupsd_client_t *con, cups_array_t *ra);
 static void	create_job(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	create_local_printer(cupsd_client_t *con);
 static cups_array_t *create_requested_array(ipp_t *request);
 static void	create_subscriptions(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	delete_printer(cupsd_client_t *con, ipp_attribute_t *uri);
+static void	finish_ipp_tasks(void);
+static void	free_ipp_task(cupsd_ipp_task_t *task);
 static void	get_default(cupsd_client_t *con);
 static void	get_devices(cupsd_client_t *con);
 static void	get_document(cupsd_client_t *con, ipp_attribute_t *uri);
@@ -92,10 +170,12 @@ static void	get_subscriptions(cupsd_client_t *con, ipp_attribute_t *uri);
 static const char *get_username(cupsd_client_t *con);
 static void	hold_job(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	hold_new_jobs(cupsd_client_t *con, ipp_attribute_t *uri);
+static void	*ipp_task_thread(void *data);
 static void	move_job(cupsd_client_t *con, ipp_attribute_t *uri);
 static int	ppd_parse_line(const char *line, char *option, int olen,
 		               char *choice, int clen);
 static void	print_job(cupsd_client_t *con, ipp_attribute_t *uri);
+static int	queue_ipp_task(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	read_job_ticket(cupsd_client_t *con);
 static void	reject_jobs(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	release_held_new_jobs(cupsd_client_t *con,
@@ -108,6 +188,7 @@ static void	save_auth_info(cupsd_client_t *con, cupsd_job_t *job,
 static void	send_document(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	send_http_error(cupsd_client_t *con, http_status_t status,
 		                cupsd_printer_t *printer);
+static int	send_ipp_response(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	send_ipp_status(cupsd_client_t *con, ipp_status_t status, const char *message, ...) _CUPS_FORMAT(3, 4);
 static void	set_default(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	set_job_attrs(cupsd_client_t *con, ipp_attribute_t *uri);
@@ -123,6 +204,112 @@ static int	validate_name(const char *name);
 static int	validate_user(cupsd_job_t *job, cupsd_client_t *con, const char *owner, char *username, size_t userlen);
 
 
+/*
+ * 'cupsdCopyIPPStream()' - Copy the next job or printer to a streamed response.
+ *
+ * The stream is freed once there are no more jobs or printers to copy.
+ */
+
+int					/* O - 1 if copied, 0 if no more */
+cupsdCopyIPPStream(cupsd_client_t *con)	/* I - Client connection */
+{
+  cupsd_ipp_stream_t	*stream = con->ipp_stream;
+					/* Streamed response */
+  cupsd_job_t		*job;		/* Current job */
+  cupsd_printer_t	*printer;	/* Current printer */
+  const char		*name;		/* Printer name */
+  cups_array_t		*exclude;	/* Private attributes array */
+
+
+  if (!stream)
+    return (0);
+
+ /*
+  * Jobs and printers are looked up again since they may have been deleted
+  * while the previous ones were being written...
+  */
+
+  if (stream->printers)
+  {
+    while ((name = (const char *)cupsArrayIndex(stream->printers, stream->next)) != NULL)
+    {
+      stream->next ++;
+
+      if ((printer = cupsdFindDest(name)) == NULL)
+        continue;
+
+      if (stream->count > 0)
+        ippAddSeparator(con->response);
+
+      stream->count ++;
+
+      copy_printer_attrs(con, printer, stream->ra);
+
+      return (1);
+    }
+  }
+  else
+  {
+    while (stream->next < stream->num_jobs)
+    {
+      if ((job = cupsdFindJob(stream->jobs[stream->next ++])) == NULL)
+        continue;
+
+      if (stream->need_load_job && !job->attrs)
+      {
+        cupsdLoadJob(job);
+
+	if (!job->attrs)
+	  continue;
+      }
+
+      if (stream->count > 0)
+        ippAddSeparator(con->response);
+
+      stream->count ++;
+
+      exclude = cupsdGetPrivateAttrs(job->printer ?
+                                         job->printer->op_policy_ptr :
+					 stream->policy, con, job->printer,
+					 job->username);
+
+      copy_job_attrs(con, job, stream->ra, exclude);
+
+      return (1);
+    }
+  }
+
+  cupsdLogClient(con, CUPSD_LOG_DEBUG, "Streamed %d job(s) or printer(s).", stream->count);
+
+  cupsdFreeIPPStream(con);
+
+  return (0);
+}
+
+
+/*
+ * 'cupsdFreeIPPStream()' - Free a streamed response.
+ */
+
+void
+cupsdFreeIPPStream(cupsd_client_t *con)	/* I - Client connection */
+{
+  cupsd_ipp_stream_t	*stream = con->ipp_stream;
+					/* Streamed response */
+
+
+  if (!stream)
+    return;
+
+  cupsArrayDelete(stream->ra);
+  cupsArrayDelete(stream->printers);
+  free(stream->jobs);
+  free(stream);
+
+  con->ipp_stream = NULL;
+}
+
+
 /*
  * 'cupsdProcessIPPRequest()' - Process an incoming IPP request.
  */
@@ -613,78 +800,109 @@ cupsdProcessIPPRequest(
     }
   }
 
-  if (con->response)
+  if (con->ipp_task && queue_ipp_task(con, uri))
   {
    /*
-    * Sending data from the scheduler...
+    * A worker thread is copying the printer attributes, the response is sent
+    * once it is done...
     */
 
-    cupsdLogClient(con, con->response->request.status.status_code >= IPP_STATUS_ERROR_BAD_REQUEST && con->response->request.status.status_code != IPP_STATUS_ERROR_NOT_FOUND ? CUPSD_LOG_ERROR : CUPSD_LOG_DEBUG, "Returning IPP %s for %s (%s) from %s.",  ippErrorString(con->response->request.status.status_code), ippOpString(con->request->request.op.operation_id), uri ? uri->values[0].string.text : "no URI", con->http->hostname);
+    return (1);
+  }
 
-    httpClearFields(con->http);
+  return (send_ipp_response(con, uri));
+}
 
-#ifdef CUPSD_USE_CHUNKING
-   /*
-    * Because older versions of CUPS (1.1.17 and older) and some IPP
-    * clients do not implement chunking properly, we cannot use
-    * chunking by default.  This may become the default in future
-    * CUPS releases, or we might add a configuration directive for
-    * it.
-    */
 
-    if (con->http->version == HTTP_1_1)
-    {
-      cupsdLogClient(con, CUPSD_LOG_DEBUG, "Transfer-Encoding: chunked");
-      cupsdSetLength(con->http, 0);
-    }
-    else
-#endif /* CUPSD_USE_CHUNKING */
-    {
-      size_t	length;			/* Length of response */
+/*
+ * 'cupsdStartIPPThreads()' - Start the IPP worker threads.
+ */
 
+void
+cupsdStartIPPThreads(void)
+{
+  int	i;				/* Looping var */
 
-      length = ippLength(con->response);
 
-      if (con->file >= 0 && !con->pipe_pid)
-      {
-	struct stat	fileinfo;	/* File information */
+  if (IPPThreads <= 0 || ipp_num_threads > 0)
+    return;
 
-	if (!fstat(con->file, &fileinfo))
-	  length += (size_t)fileinfo.st_size;
-      }
+  if (cupsdOpenPipe(ipp_pipes))
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to create pipes for IPP threads: %s", strerror(errno));
+    return;
+  }
 
-      cupsdLogClient(con, CUPSD_LOG_DEBUG, "Content-Length: " CUPS_LLFMT, CUPS_LLCAST length);
-      httpSetLength(con->http, length);
-    }
+  fcntl(ipp_pipes[0], F_SETFL, fcntl(ipp_pipes[0], F_GETFL) | O_NONBLOCK);
 
-    if (cupsdSendHeader(con, HTTP_OK, "application/ipp", CUPSD_AUTH_NONE))
-    {
-     /*
-      * Tell the caller the response header was sent successfully...
-      */
+  if ((ipp_threads = calloc((size_t)IPPThreads, sizeof(_cups_thread_t))) == NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to allocate memory for %d IPP threads.", IPPThreads);
+    cupsdClosePipe(ipp_pipes);
+    return;
+  }
 
-      cupsdAddSelect(httpGetFd(con->http), (cupsd_selfunc_t)cupsdReadClient, (cupsd_selfunc_t)cupsdWriteClient, con);
+  ipp_stop = 0;
 
-      return (1);
-    }
-    else
-    {
-     /*
-      * Tell the caller the response header could not be sent...
-      */
+  for (i = 0; i < IPPThreads; i ++)
+  {
+    if ((ipp_threads[i] = _cupsThreadCreate((_cups_thread_func_t)ipp_task_thread, NULL)) == 0)
+      break;
 
-      return (0);
-    }
+    ipp_num_threads ++;
   }
-  else
+
+  if (ipp_num_threads < IPPThreads)
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Only able to start %d of %d IPP threads.", ipp_num_threads, IPPThreads);
+
+  if (ipp_num_threads == 0)
   {
-   /*
-    * Sending data from a subprocess like cups-deviced; tell the caller
-    * everything is A-OK so far...
-    */
+    free(ipp_threads);
+    ipp_threads = NULL;
 
-    return (1);
+    cupsdClosePipe(ipp_pipes);
+    return;
   }
+
+  cupsdAddSelect(ipp_pipes[0], (cupsd_selfunc_t)finish_ipp_tasks, NULL, NULL);
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG, "Started %d IPP threads.", ipp_num_threads);
+}
+
+
+/*
+ * 'cupsdStopIPPThreads()' - Stop the IPP worker threads.
+ */
+
+void
+cupsdStopIPPThreads(void)
+{
+  int	i;				/* Looping var */
+
+
+  if (ipp_num_threads == 0)
+    return;
+
+ /*
+  * Finish any pending responses and then tell the threads to exit...
+  */
+
+  cupsdWaitIPPThreads();
+
+  _cupsMutexLock(&ipp_mutex);
+  ipp_stop = 1;
+  _cupsCondBroadcast(&ipp_cond);
+  _cupsMutexUnlock(&ipp_mutex);
+
+  for (i = 0; i < ipp_num_threads; i ++)
+    _cupsThreadWait(ipp_threads[i]);
+
+  free(ipp_threads);
+  ipp_threads     = NULL;
+  ipp_num_threads = 0;
+
+  cupsdRemoveSelect(ipp_pipes[0]);
+  cupsdClosePipe(ipp_pipes);
 }
 
 
@@ -732,6 +950,26 @@ cupsdTimeoutJob(cupsd_job_t *job)	/* I - Job to timeout */
 }
 
 
+/*
+ * 'cupsdWaitIPPThreads()' - Wait for the IPP worker threads to finish all
+ *                           queued responses and send them.
+ */
+
+void
+cupsdWaitIPPThreads(void)
+{
+  if (ipp_num_threads == 0)
+    return;
+
+  _cupsMutexLock(&ipp_mutex);
+  while (ipp_queue || ipp_active > 0)
+    _cupsCondWait(&ipp_cond, &ipp_mutex, 0.0);
+  _cupsMutexUnlock(&ipp_mutex);
+
+  finish_ipp_tasks();
+}
+
+
 /*
  * 'accept_jobs()' - Accept print jobs to a printer.
  */
@@ -1604,6 +1842,8 @@ add_job(cupsd_client_t  *con,		/* I - Client connection */
   else
     cupsdSetString(&job->username, "anonymous");
 
+  cupsdUpdateJobIndex(job);
+
   if (!attr)
     ippAddString(job->attrs, IPP_TAG_JOB, IPP_TAG_NAME,
                  "job-originating-user-name", NULL, job->username);
@@ -1950,8 +2190,7 @@ add_job_subscriptions(
     cupsd_job_t    *job)		/* I - Newly created job */
 {
   int			i;		/* Looping var */
-  ipp_attribute_t	*prev,		/* Previous attribute */
-			*next,		/* Next attribute */
+  ipp_attribute_t	*next,		/* Next attribute */
 			*attr;		/* Current attribute */
   cupsd_subscription_t	*sub;		/* Subscription object */
   const char		*recipient,	/* notify-recipient-uri */
@@ -2146,7 +2385,7 @@ add_job_subscriptions(
   * end of the request...
   */
 
-  for (attr = job->attrs->attrs, prev = NULL; attr; attr = next)
+  for (attr = job->attrs->attrs; attr; attr = next)
   {
     next = attr->next;
 
@@ -2157,19 +2396,11 @@ add_job_subscriptions(
       * Free and remove this attribute...
       */
 
-      ippDeleteAttribute(NULL, attr);
-
-      if (prev)
-        prev->next = next;
-      else
-        job->attrs->attrs = next;
+      ippDeleteAttribute(job->attrs, attr);
     }
-    else
-      prev = attr;
   }
 
-  job->attrs->last    = prev;
-  job->attrs->current = prev;
+  job->attrs->current = job->attrs->last;
 }
 
 
@@ -2919,6 +3150,53 @@ add_queued_job_count(
 }
 
 
+/*
+ * 'add_stream_job()' - Add a job to a streamed response.
+ */
+
+static void
+add_stream_job(cupsd_client_t *con,	/* I - Client connection */
+               cupsd_job_t    *job)	/* I - Job */
+{
+  cupsd_ipp_stream_t	*stream = con->ipp_stream;
+					/* Streamed response */
+
+
+  if (stream->num_jobs >= stream->alloc_jobs)
+  {
+    int	*temp;				/* New jobs array */
+
+    if ((temp = realloc(stream->jobs, (size_t)(stream->alloc_jobs + 1024) * sizeof(int))) == NULL)
+      return;
+
+    stream->jobs       = temp;
+    stream->alloc_jobs += 1024;
+  }
+
+  stream->jobs[stream->num_jobs ++] = job->id;
+}
+
+
+/*
+ * 'add_stream_printer()' - Add a printer to a streamed response.
+ */
+
+static void
+add_stream_printer(
+    cupsd_client_t  *con,		/* I - Client connection */
+    cupsd_printer_t *printer)		/* I - Printer */
+{
+  cupsd_ipp_stream_t	*stream = con->ipp_stream;
+					/* Streamed response */
+
+
+  if (!stream->printers)
+    stream->printers = cupsArrayNew3(NULL, NULL, NULL, 0, (cups_acopy_func_t)_cupsStrAlloc, (cups_afree_func_t)_cupsStrFree);
+
+  cupsArrayAdd(stream->printers, printer->name);
+}
+
+
 /*
  * 'apply_printer_defaults()' - Apply printer default options to a job.
  */
@@ -2964,6 +3242,61 @@ apply_printer_defaults(
 }
 
 
+/*
+ * 'attr_cache_key()' - Make the printer attribute cache key for a request.
+ *
+ * The requested attributes array is sorted, so the same set of attributes
+ * always gives the same key.  The returned string must be freed using free().
+ */
+
+static char *				/* O - Cache key or `NULL` on error */
+attr_cache_key(cups_array_t *ra,	/* I - Requested attributes array */
+               int          version)	/* I - Major IPP version of response */
+{
+  char		*key,			/* Cache key */
+		*keyptr;		/* Pointer into key */
+  const char	*name;			/* Current attribute name */
+  size_t	keysize;		/* Size of key */
+
+
+  keysize = 3;
+
+  for (name = (const char *)cupsArrayFirst(ra); name; name = (const char *)cupsArrayNext(ra))
+    keysize += strlen(name) + 1;
+
+  if ((key = malloc(keysize)) == NULL)
+    return (NULL);
+
+ /*
+  * "N" for all attributes, "N:name,name,..." for a list...
+  */
+
+  key[0] = (char)('0' + (version % 10));
+  key[1] = '\0';
+
+  if (ra)
+  {
+    keyptr    = key + 1;
+    *keyptr++ = ':';
+
+    for (name = (const char *)cupsArrayFirst(ra); name; name = (const char *)cupsArrayNext(ra))
+    {
+      size_t namelen = strlen(name);	/* Length of name */
+
+      if (keyptr > key + 2)
+        *keyptr++ = ',';
+
+      memcpy(keyptr, name, namelen);
+      keyptr += namelen;
+    }
+
+    *keyptr = '\0';
+  }
+
+  return (key);
+}
+
+
 /*
  * 'authenticate_job()' - Set job authentication info.
  */
@@ -4394,6 +4727,47 @@ copy_banner(cupsd_client_t *con,	/* I - Client connection */
 }
 
 
+/*
+ * 'copy_collection()' - Make a private copy of a collection value.
+ *
+ * Collection values are normally shared by reference, which is not safe
+ * to do from a worker thread.
+ */
+
+static ipp_t *				/* O - New collection */
+copy_collection(ipp_t *col,		/* I - Collection to copy */
+                int   quickcopy)	/* I - Do a quick copy? */
+{
+  int			i;		/* Looping var */
+  ipp_t			*newcol;	/* New collection */
+  ipp_attribute_t	*attr,		/* Current member attribute */
+			*newattr;	/* New member attribute */
+
+
+  if ((newcol = ippNew()) == NULL)
+    return (NULL);
+
+  for (attr = col->attrs; attr; attr = attr->next)
+  {
+    if (!attr->name)
+      continue;
+
+    if (attr->value_tag == IPP_TAG_BEGIN_COLLECTION)
+    {
+      if ((newattr = ippAddCollections(newcol, attr->group_tag, attr->name, attr->num_values, NULL)) != NULL)
+      {
+	for (i = 0; i < attr->num_values; i ++)
+	  newattr->values[i].collection = copy_collection(attr->values[i].collection, quickcopy);
+      }
+    }
+    else
+      ippCopyAttribute(newcol, attr, quickcopy);
+  }
+
+  return (newcol);
+}
+
+
 /*
  * 'copy_file()' - Copy a PPD file...
  */
@@ -4879,6 +5253,15 @@ copy_printer_attrs(
   int		i;			/* Looping var */
   int		is_encrypted = httpIsEncrypted(con->http);
 					/* Is the connection encrypted? */
+  cupsd_ipp_task_t *task;		/* Threaded response */
+  int		version = con->response->request.status.version[0];
+					/* Major IPP version of response */
+  char		*key;			/* Attribute cache key */
+  cupsd_attrcache_t *cache;		/* Cached attributes */
+  ipp_t		*attrs;			/* Attributes to cache */
+  void		*data;			/* Encoded attributes */
+  size_t	datalen;		/* Length of encoded attributes */
+  int		cached = 0;		/* Added from the cache? */
 
 
  /*
@@ -4890,6 +5273,30 @@ copy_printer_attrs(
 
   curtime = time(NULL);
 
+  if (ra && (cupsArrayFind(ra, "cups-debug-history-dropped") || cupsArrayFind(ra, "cups-debug-history-jobs") || cupsArrayFind(ra, "cups-debug-history-size") || cupsArrayFind(ra, "cups-debug-history-size-limit")))
+  {
+   /*
+    * Add the server-wide debug log history statistics, which are only
+    * reported when requested by name...
+    */
+
+    cupsd_joblogstats_t	stats;		/* Debug log history statistics */
+
+    cupsdGetJobLogStats(&stats);
+
+    if (cupsArrayFind(ra, "cups-debug-history-dropped"))
+      ippAddInteger(con->response, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "cups-debug-history-dropped", stats.dropped);
+
+    if (cupsArrayFind(ra, "cups-debug-history-jobs"))
+      ippAddInteger(con->response, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "cups-debug-history-jobs", stats.jobs);
+
+    if (cupsArrayFind(ra, "cups-debug-history-size"))
+      ippAddInteger(con->response, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "cups-debug-history-size", stats.size > (size_t)INT_MAX ? INT_MAX : (int)stats.size);
+
+    if (cupsArrayFind(ra, "cups-debug-history-size-limit"))
+      ippAddInteger(con->response, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "cups-debug-history-size-limit", MaxDebugHistorySize);
+  }
+
   if (!ra || cupsArrayFind(ra, "marker-change-time"))
     ippAddInteger(con->response, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "marker-change-time", printer->marker_time);
 
@@ -5045,6 +5452,92 @@ copy_printer_attrs(
   if (!ra || cupsArrayFind(ra, "queued-job-count"))
     add_queued_job_count(con, printer);
 
+  key = attr_cache_key(ra, version);
+
+  if (key && (cache = cupsdFindCachedPrinterAttrs(printer, key)) != NULL)
+  {
+   /*
+    * Use the cached encoding of the static attributes...
+    */
+
+    if (cache->datalen > 0)
+      _ippAddEncoded(con->response, IPP_TAG_PRINTER, cache->data, cache->datalen);
+
+    _cupsRWUnlock(&printer->lock);
+    free(key);
+    return;
+  }
+
+  if ((task = con->ipp_task) != NULL)
+  {
+   /*
+    * Let a worker thread copy and encode the static attributes...
+    */
+
+    if (task->num_printers >= task->alloc_printers)
+    {
+      cupsd_ipp_printer_t *temp;	/* New printers array */
+
+      if ((temp = realloc(task->printers, (size_t)(task->alloc_printers + 16) * sizeof(cupsd_ipp_printer_t))) != NULL)
+      {
+        task->printers       = temp;
+        task->alloc_printers += 16;
+      }
+    }
+
+    if (task->num_printers < task->alloc_printers)
+    {
+      task->printers[task->num_printers].printer = printer;
+      task->printers[task->num_printers].after   = con->response->last;
+      task->printers[task->num_printers].attrs   = NULL;
+      task->printers[task->num_printers].key     = key;
+      task->printers[task->num_printers].gen     = printer->attr_cache_gen;
+      task->printers[task->num_printers].data    = NULL;
+      task->printers[task->num_printers].datalen = 0;
+      task->num_printers ++;
+
+      _cupsRWUnlock(&printer->lock);
+      return;
+    }
+  }
+
+  if (key && (attrs = ippNew()) != NULL)
+  {
+   /*
+    * Encode the static attributes and add them to the cache...
+    */
+
+    attrs->request.status.version[0] = (ipp_uchar_t)version;
+
+    copy_attrs(attrs, printer->attrs, ra, IPP_TAG_ZERO, 0, NULL);
+    if (printer->ppd_attrs)
+      copy_attrs(attrs, printer->ppd_attrs, ra, IPP_TAG_ZERO, 0, NULL);
+    copy_attrs(attrs, CommonData, ra, IPP_TAG_ZERO, IPP_TAG_COPY, NULL);
+
+    if (!attrs->attrs)
+    {
+      cupsdCachePrinterAttrs(printer, key, NULL, 0);
+      cached = 1;
+    }
+    else if ((data = _ippEncodeAttributes(attrs, &datalen)) != NULL)
+    {
+      _ippAddEncoded(con->response, IPP_TAG_PRINTER, data, datalen);
+      cupsdCachePrinterAttrs(printer, key, data, datalen);
+      cached = 1;
+    }
+
+    ippDelete(attrs);
+    free(key);
+
+    if (cached)
+    {
+      _cupsRWUnlock(&printer->lock);
+      return;
+    }
+  }
+  else
+    free(key);
+
   copy_attrs(con->response, printer->attrs, ra, IPP_TAG_ZERO, 0, NULL);
   if (printer->ppd_attrs)
     copy_attrs(con->response, printer->ppd_attrs, ra, IPP_TAG_ZERO, 0, NULL);
@@ -5054,6 +5547,50 @@ copy_printer_attrs(
 }
 
 
+/*
+ * 'copy_static_attrs()' - Copy printer attributes from a worker thread.
+ *
+ * This is the same as copy_attrs() for printer attributes, without logging and
+ * with private copies of collection values.
+ */
+
+static void
+copy_static_attrs(ipp_t        *to,	/* I - Destination attributes */
+                  ipp_t        *from,	/* I - Source attributes */
+                  cups_array_t *ra,	/* I - Requested attributes */
+                  int          version,	/* I - Major IPP version of response */
+                  int          quickcopy)/* I - Do a quick copy? */
+{
+  int			i;		/* Looping var */
+  ipp_attribute_t	*fromattr,	/* Source attribute */
+			*toattr;	/* Destination attribute */
+
+
+  if (!to || !from)
+    return;
+
+  for (fromattr = from->attrs; fromattr; fromattr = fromattr->next)
+  {
+    if (!fromattr->name || (ra && !cupsArrayFind(ra, fromattr->name)))
+      continue;
+
+    if (fromattr->value_tag == IPP_TAG_BEGIN_COLLECTION)
+    {
+      if (!ra && (version == 1 || !strcmp(fromattr->name, "media-col-database")))
+        continue;
+
+      if ((toattr = ippAddCollections(to, fromattr->group_tag, fromattr->name, fromattr->num_values, NULL)) != NULL)
+      {
+	for (i = 0; i < fromattr->num_values; i ++)
+	  toattr->values[i].collection = copy_collection(fromattr->values[i].collection, quickcopy);
+      }
+    }
+    else
+      ippCopyAttribute(to, fromattr, quickcopy);
+  }
+}
+
+
 /*
  * 'copy_subscription_attrs()' - Copy subscription attributes.
  */
@@ -5169,6 +5706,58 @@ copy_subscription_attrs(
 }
 
 
+/*
+ * 'create_ipp_stream()' - Start a streamed response for a client.
+ *
+ * HTTP/1.1 clients get a chunked response that is written a job or printer at
+ * a time by cupsdWriteClient(), so the response never holds more than a few
+ * jobs or printers.  The stream takes ownership of the requested attributes
+ * array.  HTTP/1.0 clients need a Content-Length, so their responses are
+ * still built up front.
+ */
+
+static void
+create_ipp_stream(
+    cupsd_client_t *con,		/* I - Client connection */
+    cups_array_t   *ra,			/* I - Requested attributes array */
+    cupsd_policy_t *policy,		/* I - Policy for jobs without a printer */
+    int            need_load_job)	/* I - Load jobs before copying them? */
+{
+  if (httpGetVersion(con->http) < HTTP_VERSION_1_1)
+    return;
+
+  if ((con->ipp_stream = calloc(1, sizeof(cupsd_ipp_stream_t))) == NULL)
+    return;
+
+  con->ipp_stream->ra            = ra;
+  con->ipp_stream->policy        = policy;
+  con->ipp_stream->need_load_job = need_load_job;
+}
+
+
+/*
+ * 'create_ipp_task()' - Start a threaded response for a client.
+ *
+ * When worker threads are running, copy_printer_attrs() records each printer
+ * in the task instead of copying its static attributes, and the task takes
+ * ownership of the requested attributes array.
+ */
+
+static void
+create_ipp_task(cupsd_client_t *con,	/* I - Client connection */
+                cups_array_t   *ra)	/* I - Requested attributes array */
+{
+  if (ipp_num_threads == 0)
+    return;
+
+  if ((con->ipp_task = calloc(1, sizeof(cupsd_ipp_task_t))) == NULL)
+    return;
+
+  con->ipp_task->con = con;
+  con->ipp_task->ra  = ra;
+}
+
+
 /*
  * 'create_job()' - Print a file to a printer or class.
  */
@@ -6072,18 +6661,98 @@ delete_printer(cupsd_client_t  *con,	/* I - Client connection */
     if (cupsdDeletePrinter(printer, 0) && !temporary)
       cupsdMarkDirty(CUPSD_DIRTY_CLASSES);
 
-    if (!temporary)
-      cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
-  }
+    if (!temporary)
+      cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+  }
+
+  if (!temporary)
+    cupsdMarkDirty(CUPSD_DIRTY_PRINTCAP);
+
+ /*
+  * Return with no errors...
+  */
+
+  con->response->request.status.status_code = IPP_OK;
+}
+
+
+/*
+ * 'finish_ipp_tasks()' - Send the responses for completed worker tasks.
+ */
+
+static void
+finish_ipp_tasks(void)
+{
+  char			buffer[256];	/* Wakeup bytes from pipe */
+  int			i;		/* Looping var */
+  cupsd_ipp_task_t	*task,		/* Current task */
+			*next;		/* Next task */
+  cupsd_ipp_printer_t	*p;		/* Current printer */
+  cupsd_client_t	*con;		/* Client connection */
+
+
+  while (read(ipp_pipes[0], buffer, sizeof(buffer)) > 0);
+
+  _cupsMutexLock(&ipp_mutex);
+  task          = ipp_done;
+  ipp_done      = NULL;
+  ipp_done_last = NULL;
+  _cupsMutexUnlock(&ipp_mutex);
+
+  for (; task; task = next)
+  {
+    next          = task->next;
+    con           = task->con;
+    con->ipp_task = NULL;
+
+   /*
+    * Cache the encoded attributes unless the printer changed after the
+    * request was queued...
+    */
+
+    for (i = task->num_printers, p = task->printers; i > 0; i --, p ++)
+    {
+      if (p->data && p->gen == p->printer->attr_cache_gen && !cupsdFindCachedPrinterAttrs(p->printer, p->key))
+      {
+        cupsdCachePrinterAttrs(p->printer, p->key, p->data, p->datalen);
+	p->data = NULL;
+      }
+    }
+
+    if (!send_ipp_response(con, task->uri))
+    {
+     /*
+      * Let the client code notice the failed connection...
+      */
+
+      cupsdAddSelect(httpGetFd(con->http), (cupsd_selfunc_t)cupsdReadClient, NULL, con);
+    }
+
+    free_ipp_task(task);
+  }
+}
+
+
+/*
+ * 'free_ipp_task()' - Free a worker task.
+ */
+
+static void
+free_ipp_task(cupsd_ipp_task_t *task)	/* I - Task */
+{
+  int	i;				/* Looping var */
 
-  if (!temporary)
-    cupsdMarkDirty(CUPSD_DIRTY_PRINTCAP);
 
- /*
-  * Return with no errors...
-  */
+  for (i = 0; i < task->num_printers; i ++)
+  {
+    ippDelete(task->printers[i].attrs);
+    free(task->printers[i].key);
+    free(task->printers[i].data);
+  }
 
-  con->response->request.status.status_code = IPP_OK;
+  free(task->printers);
+  cupsArrayDelete(task->ra);
+  free(task);
 }
 
 
@@ -6507,7 +7176,10 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
 		first_index = 1,	/* First index */
 		limit = 0,		/* Maximum number of jobs to return */
 		count,			/* Number of jobs that match */
+		skip,			/* Number of matching jobs to skip */
 		need_load_job = 0;	/* Do we need to load the job? */
+  const char	*which_jobs;		/* which-jobs value */
+  char		cursor[1024];		/* Filters for paging cursor */
   const char	*job_attr;		/* Job attribute requested */
   ipp_attribute_t *job_ids;		/* job-ids attribute */
   cupsd_job_t	*job;			/* Current job pointer */
@@ -6603,58 +7275,61 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
                     "which-jobs");
     return;
   }
-  else if (!attr || !strcmp(attr->values[0].string.text, "not-completed"))
+
+  which_jobs = attr ? attr->values[0].string.text : "not-completed";
+
+  if (!strcmp(which_jobs, "not-completed"))
   {
     job_comparison = -1;
     job_state      = IPP_JOB_STOPPED;
     list           = ActiveJobs;
   }
-  else if (!strcmp(attr->values[0].string.text, "completed"))
+  else if (!strcmp(which_jobs, "completed"))
   {
     job_comparison = 1;
     job_state      = IPP_JOB_CANCELED;
     list           = cupsdGetCompletedJobs(printer);
     delete_list    = 1;
   }
-  else if (!strcmp(attr->values[0].string.text, "aborted"))
+  else if (!strcmp(which_jobs, "aborted"))
   {
     job_comparison = 0;
     job_state      = IPP_JOB_ABORTED;
     list           = cupsdGetCompletedJobs(printer);
     delete_list    = 1;
   }
-  else if (!strcmp(attr->values[0].string.text, "all"))
+  else if (!strcmp(which_jobs, "all"))
   {
     job_comparison = 1;
     job_state      = IPP_JOB_PENDING;
     list           = Jobs;
   }
-  else if (!strcmp(attr->values[0].string.text, "canceled"))
+  else if (!strcmp(which_jobs, "canceled"))
   {
     job_comparison = 0;
     job_state      = IPP_JOB_CANCELED;
     list           = cupsdGetCompletedJobs(printer);
     delete_list    = 1;
   }
-  else if (!strcmp(attr->values[0].string.text, "pending"))
+  else if (!strcmp(which_jobs, "pending"))
   {
     job_comparison = 0;
     job_state      = IPP_JOB_PENDING;
     list           = ActiveJobs;
   }
-  else if (!strcmp(attr->values[0].string.text, "pending-held"))
+  else if (!strcmp(which_jobs, "pending-held"))
   {
     job_comparison = 0;
     job_state      = IPP_JOB_HELD;
     list           = ActiveJobs;
   }
-  else if (!strcmp(attr->values[0].string.text, "processing"))
+  else if (!strcmp(which_jobs, "processing"))
   {
     job_comparison = 0;
     job_state      = IPP_JOB_PROCESSING;
     list           = PrintingJobs;
   }
-  else if (!strcmp(attr->values[0].string.text, "processing-stopped"))
+  else if (!strcmp(which_jobs, "processing-stopped"))
   {
     job_comparison = 0;
     job_state      = IPP_JOB_STOPPED;
@@ -6729,8 +7404,13 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
     username[0] = '\0';
 
   ra = create_requested_array(con->request);
+  if (!ra)
+    need_load_job = 1;
+
   for (job_attr = (char *)cupsArrayFirst(ra); job_attr; job_attr = (char *)cupsArrayNext(ra))
-    if (strcmp(job_attr, "job-id") &&
+    if (strcmp(job_attr, "date-time-at-completed") &&
+        strcmp(job_attr, "date-time-at-creation") &&
+        strcmp(job_attr, "job-id") &&
 	strcmp(job_attr, "job-k-octets") &&
 	strcmp(job_attr, "job-media-progress") &&
 	strcmp(job_attr, "job-more-info") &&
@@ -6815,11 +7495,39 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
   }
   else
   {
-    if (first_index > 1)
-      job = (cupsd_job_t *)cupsArrayIndex(list, first_index - 1);
+   /*
+    * Resume from the end of the previous page when the client asks for the
+    * next page with the same filters and starting job, otherwise skip
+    * matching jobs up to first-index...
+    */
+
+    snprintf(cursor, sizeof(cursor), "%s/%s/%d/%d/%s/%d/%d/%d", which_jobs,
+             dest ? dest : "", dtype, dmask, username, need_load_job,
+	     first_job_id, first_index);
+
+    skip = first_index > 1 ? first_index - 1 : 0;
+
+    if (skip && con->jobs_cursor && !strcmp(con->jobs_cursor, cursor) &&
+	(job = (cupsd_job_t *)cupsArrayIndex(list, con->jobs_pos)) != NULL &&
+	job->id == con->jobs_id)
+    {
+      cupsdLogMessage(CUPSD_LOG_DEBUG2, "get_jobs: Resuming at index %d.",
+                      con->jobs_pos);
+      skip = 0;
+    }
+    else if (first_job_id > 1 && list == Jobs)
+      job = cupsdFindFirstJob(first_job_id);
     else
       job = (cupsd_job_t *)cupsArrayFirst(list);
 
+   /*
+    * Job attributes are changed by the main loop without any locking, so
+    * Get-Jobs responses are never handed to the IPP worker threads; large
+    * responses are streamed instead...
+    */
+
+    create_ipp_stream(con, ra, policy, need_load_job);
+
     for (count = 0; (limit <= 0 || count < limit) && job; job = (cupsd_job_t *)cupsArrayNext(list))
     {
      /*
@@ -6852,6 +7560,15 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
       if (job->id < first_job_id)
 	continue;
 
+      if (username[0] && _cups_strcasecmp(username, job->username))
+	continue;
+
+      if (skip > 0)
+      {
+        skip --;
+	continue;
+      }
+
       if (need_load_job && !job->attrs)
       {
         cupsdLoadJob(job);
@@ -6863,8 +7580,16 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
 	}
       }
 
-      if (username[0] && _cups_strcasecmp(username, job->username))
+      if (con->ipp_stream)
+      {
+       /*
+        * Copy the job's attributes when the response is written...
+	*/
+
+        add_stream_job(con, job);
+	count ++;
 	continue;
+      }
 
       if (count > 0)
 	ippAddSeparator(con->response);
@@ -6880,9 +7605,27 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
     }
 
     cupsdLogMessage(CUPSD_LOG_DEBUG2, "get_jobs: count=%d", count);
+
+   /*
+    * Remember where the next page starts...
+    */
+
+    if (job && limit > 0)
+    {
+      snprintf(cursor, sizeof(cursor), "%s/%s/%d/%d/%s/%d/%d/%d", which_jobs,
+               dest ? dest : "", dtype, dmask, username, need_load_job,
+	       first_job_id, (first_index > 1 ? first_index : 1) + count);
+
+      cupsdSetString(&con->jobs_cursor, cursor);
+      con->jobs_pos = cupsArrayGetIndex(list);
+      con->jobs_id  = job->id;
+    }
+    else
+      cupsdClearString(&con->jobs_cursor);
   }
 
-  cupsArrayDelete(ra);
+  if (!con->ipp_stream)
+    cupsArrayDelete(ra);
 
   if (delete_list)
     cupsArrayDelete(list);
@@ -7392,9 +8135,12 @@ get_printer_attrs(cupsd_client_t  *con,	/* I - Client connection */
 
   ra = create_requested_array(con->request);
 
+  create_ipp_task(con, ra);
+
   copy_printer_attrs(con, printer, ra);
 
-  cupsArrayDelete(ra);
+  if (!con->ipp_task)
+    cupsArrayDelete(ra);
 
   con->response->request.status.status_code = IPP_OK;
 }
@@ -7568,6 +8314,11 @@ get_printers(cupsd_client_t *con,	/* I - Client connection */
 
   ra = create_requested_array(con->request);
 
+  create_ipp_stream(con, ra, NULL, 0);
+
+  if (!con->ipp_stream)
+    create_ipp_task(con, ra);
+
  /*
   * OK, build a list of printers for this printer...
   */
@@ -7604,6 +8355,17 @@ get_printers(cupsd_client_t *con,	/* I - Client connection */
 	  !user_allowed(printer, username))
         continue;
 
+      if (con->ipp_stream)
+      {
+       /*
+        * Copy the printer's attributes when the response is written...
+	*/
+
+        add_stream_printer(con, printer);
+	count ++;
+	continue;
+      }
+
      /*
       * Add the group separator as needed...
       */
@@ -7621,7 +8383,8 @@ get_printers(cupsd_client_t *con,	/* I - Client connection */
     }
   }
 
-  cupsArrayDelete(ra);
+  if (!con->ipp_task && !con->ipp_stream)
+    cupsArrayDelete(ra);
 
   con->response->request.status.status_code = IPP_OK;
 }
@@ -8083,6 +8846,124 @@ hold_new_jobs(cupsd_client_t  *con,	/* I - Connection */
 }
 
 
+/*
+ * 'ipp_task_thread()' - Copy printer attributes for queued responses.
+ */
+
+static void *				/* O - Exit status */
+ipp_task_thread(void *data)		/* I - Unused */
+{
+  int			i;		/* Looping var */
+  cupsd_ipp_task_t	*task;		/* Current task */
+  cupsd_ipp_printer_t	*p;		/* Current printer */
+  ipp_t			*response;	/* Response being built */
+  int			version;	/* Major IPP version of response */
+
+
+  (void)data;
+
+  _cupsMutexLock(&ipp_mutex);
+
+  while (!ipp_stop)
+  {
+    if ((task = ipp_queue) == NULL)
+    {
+      _cupsCondWait(&ipp_cond, &ipp_mutex, 0.0);
+      continue;
+    }
+
+    if ((ipp_queue = task->next) == NULL)
+      ipp_queue_last = NULL;
+
+    ipp_active ++;
+
+    _cupsMutexUnlock(&ipp_mutex);
+
+   /*
+    * Copy the static attributes for each printer under its read lock...
+    */
+
+    response = task->con->response;
+    version  = response->request.status.version[0];
+
+    for (i = task->num_printers, p = task->printers; i > 0; i --, p ++)
+    {
+      if ((p->attrs = ippNew()) == NULL)
+        continue;
+
+      _cupsRWLockRead(&p->printer->lock);
+
+      copy_static_attrs(p->attrs, p->printer->attrs, task->ra, version, 0);
+      if (p->printer->ppd_attrs)
+	copy_static_attrs(p->attrs, p->printer->ppd_attrs, task->ra, version, 0);
+      copy_static_attrs(p->attrs, CommonData, task->ra, version, IPP_TAG_COPY);
+
+      _cupsRWUnlock(&p->printer->lock);
+
+      if (p->key && p->attrs->attrs)
+        p->data = _ippEncodeAttributes(p->attrs, &p->datalen);
+    }
+
+   /*
+    * Then splice them into the response after each printer's dynamic
+    * attributes, working backwards so that printers sharing an insertion
+    * point stay in order...
+    */
+
+    for (i = task->num_printers - 1; i >= 0; i --)
+    {
+      p = task->printers + i;
+
+      if (!p->attrs || !p->attrs->attrs)
+        continue;
+
+      p->attrs->last->next = p->after->next;
+      p->after->next       = p->attrs->attrs;
+
+      if (response->last == p->after)
+        response->last = p->attrs->last;
+
+      p->attrs->attrs = NULL;
+      p->attrs->last  = NULL;
+    }
+
+    _ippResetIndex(response);
+
+   /*
+    * Hand the task back to the main loop, waking it up if it isn't already
+    * going to look at the completed tasks...
+    */
+
+    _cupsMutexLock(&ipp_mutex);
+
+    ipp_active --;
+
+    task->next = NULL;
+
+    if (ipp_done_last)
+      ipp_done_last->next = task;
+    else if (write(ipp_pipes[1], "", 1) < 1)
+    {
+     /*
+      * Can't log from here; the pipe only ever holds one byte, so this should
+      * never happen...
+      */
+    }
+
+    if (!ipp_done)
+      ipp_done = task;
+
+    ipp_done_last = task;
+
+    _cupsCondBroadcast(&ipp_cond);
+  }
+
+  _cupsMutexUnlock(&ipp_mutex);
+
+  return (NULL);
+}
+
+
 /*
  * 'move_job()' - Move a job to a new destination.
  */
@@ -8681,6 +9562,56 @@ print_job(cupsd_client_t  *con,		/* I - Client connection */
 }
 
 
+/*
+ * 'queue_ipp_task()' - Queue a threaded response for the worker threads.
+ */
+
+static int				/* O - 1 if queued, 0 to respond now */
+queue_ipp_task(cupsd_client_t  *con,	/* I - Client connection */
+               ipp_attribute_t *uri)	/* I - Request URI */
+{
+  cupsd_ipp_task_t	*task = con->ipp_task;
+					/* Task */
+
+
+  if (task->num_printers == 0 || !con->response || con->response->request.status.status_code != IPP_STATUS_OK)
+  {
+   /*
+    * Nothing for the workers to do...
+    */
+
+    con->ipp_task = NULL;
+    free_ipp_task(task);
+
+    return (0);
+  }
+
+  task->uri = uri;
+
+  cupsdLogClient(con, CUPSD_LOG_DEBUG, "Queuing response with %d printer(s) for IPP threads.", task->num_printers);
+
+ /*
+  * Stop watching the client until the response is ready...
+  */
+
+  cupsdRemoveSelect(httpGetFd(con->http));
+
+  _cupsMutexLock(&ipp_mutex);
+
+  if (ipp_queue_last)
+    ipp_queue_last->next = task;
+  else
+    ipp_queue = task;
+
+  ipp_queue_last = task;
+
+  _cupsCondBroadcast(&ipp_cond);
+  _cupsMutexUnlock(&ipp_mutex);
+
+  return (1);
+}
+
+
 /*
  * 'read_job_ticket()' - Read a job ticket embedded in a print file.
  *
@@ -8723,8 +9654,7 @@ read_job_ticket(cupsd_client_t *con)	/* I - Client connection */
   cups_option_t		*options;	/* Options */
   ipp_t			*ticket;	/* New attributes */
   ipp_attribute_t	*attr,		/* Current attribute */
-			*attr2,		/* Job attribute */
-			*prev2;		/* Previous job attribute */
+			*attr2;		/* Job attribute */
 
 
  /*
@@ -8832,25 +9762,7 @@ read_job_ticket(cupsd_client_t *con)	/* I - Client connection */
       * Some other value; first free the old value...
       */
 
-      if (con->request->attrs == attr2)
-      {
-	con->request->attrs = attr2->next;
-	prev2               = NULL;
-      }
-      else
-      {
-	for (prev2 = con->request->attrs; prev2; prev2 = prev2->next)
-	  if (prev2->next == attr2)
-	  {
-	    prev2->next = attr2->next;
-	    break;
-	  }
-      }
-
-      if (con->request->last == attr2)
-        con->request->last = prev2;
-
-      ippDeleteAttribute(NULL, attr2);
+      ippDeleteAttribute(con->request, attr2);
     }
 
    /*
@@ -10095,6 +11007,100 @@ send_http_error(
 }
 
 
+/*
+ * 'send_ipp_response()' - Send the response header for an IPP request.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+send_ipp_response(cupsd_client_t  *con,	/* I - Client connection */
+                  ipp_attribute_t *uri)	/* I - Request URI */
+{
+  if (con->response)
+  {
+   /*
+    * Sending data from the scheduler...
+    */
+
+    cupsdLogClient(con, con->response->request.status.status_code >= IPP_STATUS_ERROR_BAD_REQUEST && con->response->request.status.status_code != IPP_STATUS_ERROR_NOT_FOUND ? CUPSD_LOG_ERROR : CUPSD_LOG_DEBUG, "Returning IPP %s for %s (%s) from %s.",  ippErrorString(con->response->request.status.status_code), ippOpString(con->request->request.op.operation_id), uri ? uri->values[0].string.text : "no URI", con->http->hostname);
+
+    httpClearFields(con->http);
+
+#ifdef CUPSD_USE_CHUNKING
+   /*
+    * Because older versions of CUPS (1.1.17 and older) and some IPP
+    * clients do not implement chunking properly, we cannot use
+    * chunking by default.  This may become the default in future
+    * CUPS releases, or we might add a configuration directive for
+    * it.
+    */
+
+    if (con->http->version == HTTP_1_1)
+#else
+   /*
+    * Streamed responses are only used with HTTP/1.1 clients and are always
+    * chunked since their length isn't known up front...
+    */
+
+    if (con->ipp_stream)
+#endif /* CUPSD_USE_CHUNKING */
+    {
+      cupsdLogClient(con, CUPSD_LOG_DEBUG, "Transfer-Encoding: chunked");
+      httpSetLength(con->http, 0);
+    }
+    else
+    {
+      size_t	length;			/* Length of response */
+
+
+      length = ippLength(con->response);
+
+      if (con->file >= 0 && !con->pipe_pid)
+      {
+	struct stat	fileinfo;	/* File information */
+
+	if (!fstat(con->file, &fileinfo))
+	  length += (size_t)fileinfo.st_size;
+      }
+
+      cupsdLogClient(con, CUPSD_LOG_DEBUG, "Content-Length: " CUPS_LLFMT, CUPS_LLCAST length);
+      httpSetLength(con->http, length);
+    }
+
+    if (cupsdSendHeader(con, HTTP_OK, "application/ipp", CUPSD_AUTH_NONE))
+    {
+     /*
+      * Tell the caller the response header was sent successfully.  Don't
+      * watch for input until the response is written, since a pipelined
+      * request may already be on its way...
+      */
+
+      cupsdAddSelect(httpGetFd(con->http), NULL, (cupsd_selfunc_t)cupsdWriteClient, con);
+
+      return (1);
+    }
+    else
+    {
+     /*
+      * Tell the caller the response header could not be sent...
+      */
+
+      return (0);
+    }
+  }
+  else
+  {
+   /*
+    * Sending data from a subprocess like cups-deviced; tell the caller
+    * everything is A-OK so far...
+    */
+
+    return (1);
+  }
+}
+
+
+
+
 /*
  * 'send_ipp_status()' - Send a status back to the IPP client.
  */
@@ -10512,15 +11518,7 @@ set_job_attrs(cupsd_client_t  *con,	/* I - Client connection */
       * Some other value; first free the old value...
       */
 
-      if (job->attrs->prev)
-        job->attrs->prev->next = attr2->next;
-      else
-        job->attrs->attrs = attr2->next;
-
-      if (job->attrs->last == attr2)
-        job->attrs->last = job->attrs->prev;
-
-      ippDeleteAttribute(NULL, attr2);
+      ippDeleteAttribute(job->attrs, attr2);
 
      /*
       * Then copy the attribute...
@@ -10537,15 +11535,7 @@ set_job_attrs(cupsd_client_t  *con,	/* I - Client connection */
       if ((attr2 = ippFindAttribute(job->attrs, attr->name,
                                     IPP_TAG_ZERO)) != NULL)
       {
-        if (job->attrs->prev)
-	  job->attrs->prev->next = attr2->next;
-	else
-	  job->attrs->attrs = attr2->next;
-
-        if (attr2 == job->attrs->last)
-	  job->attrs->last = job->attrs->prev;
-
-        ippDeleteAttribute(NULL, attr2);
+        ippDeleteAttribute(job->attrs, attr2);
 
         event |= CUPSD_EVENT_JOB_CONFIG_CHANGED;
       }
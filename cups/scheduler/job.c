@@ -96,6 +96,25 @@
  */
 
 
+/*
+ * Debug log history buffers are allocated this many at a time...
+ */
+
+#define CUPSD_JOBLOG_SLAB	64	/* Histories per slab */
+#define CUPSD_JOBLOG_MAXMSG	2047	/* Maximum length of a history message */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct cupsd_joblogmsg_s	/**** Debug log history message ****/
+{
+  time_t		time;		/* Time of message */
+  size_t		length;		/* Length of message */
+} cupsd_joblogmsg_t;
+
+
 /*
  * Local globals...
  */
@@ -107,25 +126,69 @@ static mime_filter_t	gziptoany_filter =
 			  0,		/* Cost */
 			  "gziptoany"	/* Filter program to run */
 			};
+static cups_array_t	*job_dests = NULL,
+					/* Index of jobs by destination */
+			*job_users = NULL;
+					/* Index of active jobs by user */
+static int		job_cache_generation = 0,
+					/* Generation of job.cache, 0 if none */
+			journal_started = 0,
+					/* Has job.journal been started? */
+			journal_records = 0,
+					/* Number of records in job.journal */
+			journal_next_job_id = 0,
+					/* NextJobId in job.journal */
+			num_journal_deletes = 0,
+					/* Number of pending DeleteJob records */
+			alloc_journal_deletes = 0,
+					/* Allocated DeleteJob records */
+			*journal_deletes = NULL;
+					/* Pending DeleteJob records */
+static _cups_mutex_t	joblog_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for debug log histories */
+static cups_array_t	*joblog_slabs = NULL;
+					/* Slabs of debug log histories */
+static cupsd_joblog_t	*joblog_free = NULL;
+					/* Free debug log histories */
+static int		joblog_allocated = 0,
+					/* Number of histories allocated */
+			joblog_jobs = 0,
+					/* Number of histories in use */
+			joblog_dropped = 0;
+					/* Messages dropped for lack of memory */
 
 
 /*
  * Local functions...
  */
 
+#ifdef DEBUG
+static void	check_job_index(void);
+#endif /* DEBUG */
 static int	compare_active_jobs(void *first, void *second, void *data);
 static int	compare_completed_jobs(void *first, void *second, void *data);
+static int	compare_job_index(cupsd_jobindex_t *first,
+		                  cupsd_jobindex_t *second, void *data);
 static int	compare_jobs(void *first, void *second, void *data);
 static void	dump_job_history(cupsd_job_t *job);
 static void	finalize_job(cupsd_job_t *job, int set_job_state);
+static cupsd_jobindex_t *find_job_index(cups_array_t **a, const char *name,
+			                int create);
+static void	free_job_index(cups_array_t **a);
 static void	free_job_history(cupsd_job_t *job);
+static void	free_job_logs(void);
 static char	*get_options(cupsd_job_t *job, int banner_page, char *copies,
 		             size_t copies_size, char *title,
 			     size_t title_size);
+static unsigned	hash_data(unsigned hash, const void *data, size_t datalen);
 static size_t	ipp_length(ipp_t *ipp);
-static void	load_job_cache(const char *filename);
+static unsigned	job_cache_hash(cupsd_job_t *job);
+static void	load_job_cache(const char *filename, int journal);
 static void	load_next_job_id(const char *filename);
 static void	load_request_root(void);
+static cupsd_joblog_t *new_job_log(void);
+static cups_file_t *open_job_journal(const char *filename);
+static void	read_job_log(cupsd_joblog_t *history, size_t pos, void *data, size_t bytes);
 static void	remove_job_files(cupsd_job_t *job);
 static void	remove_job_history(cupsd_job_t *job);
 static void	set_time(cupsd_job_t *job, const char *name);
@@ -134,6 +197,23 @@ static void	stop_job(cupsd_job_t *job, cupsd_jobaction_t action);
 static void	unload_job(cupsd_job_t *job);
 static void	update_job(cupsd_job_t *job);
 static void	update_job_attrs(cupsd_job_t *job, int do_message);
+static void	update_job_index(cupsd_job_t *job, int active);
+static void	write_job_cache(cups_file_t *fp, cupsd_job_t *job);
+static void	write_job_log(cupsd_joblog_t *history, const void *data, size_t bytes);
+
+
+/*
+ * 'cupsdAddActiveJob()' - Add a job to the active jobs list.
+ */
+
+void
+cupsdAddActiveJob(cupsd_job_t *job)	/* I - Job */
+{
+  if (!cupsArrayFind(ActiveJobs, job))
+    cupsArrayAdd(ActiveJobs, job);
+
+  update_job_index(job, 1);
+}
 
 
 /*
@@ -168,12 +248,78 @@ cupsdAddJob(int        priority,	/* I - Job priority */
   */
 
   cupsArrayAdd(Jobs, job);
-  cupsArrayAdd(ActiveJobs, job);
+  cupsdAddActiveJob(job);
 
   return (job);
 }
 
 
+/*
+ * 'cupsdAddJobLog()' - Add a message to the debug log history of a job.
+ *
+ * Each processing job gets a fixed-size history from a shared pool that is
+ * limited to MaxDebugHistorySize bytes.  The oldest messages are discarded to
+ * make room or to keep at most LogDebugHistory messages, and messages are
+ * dropped when the pool is exhausted.
+ */
+
+void
+cupsdAddJobLog(cupsd_job_t *job,	/* I - Job */
+               const char  *message)	/* I - Message */
+{
+  cupsd_joblog_t	*history;	/* Debug log history */
+  cupsd_joblogmsg_t	msg,		/* New message */
+			oldmsg;		/* Oldest message */
+
+
+ /*
+  * Only processing jobs dump their history, so don't tie up a history for
+  * pending, held, or finished jobs...
+  */
+
+  if (!job->printer)
+    return;
+
+  _cupsMutexLock(&joblog_mutex);
+
+  if ((history = job->history) == NULL && (history = job->history = new_job_log()) == NULL)
+  {
+    joblog_dropped ++;
+    _cupsMutexUnlock(&joblog_mutex);
+    return;
+  }
+
+  msg.time   = time(NULL);
+  msg.length = strlen(message);
+
+  if (msg.length > CUPSD_JOBLOG_MAXMSG)
+    msg.length = CUPSD_JOBLOG_MAXMSG;
+
+ /*
+  * Discard old messages as needed...
+  */
+
+  while (history->count > 0 && (history->count >= LogDebugHistory || (CUPSD_JOBLOG_SIZE - (history->head - history->tail)) < (sizeof(msg) + msg.length)))
+  {
+    read_job_log(history, history->tail, &oldmsg, sizeof(oldmsg));
+
+    history->tail += sizeof(oldmsg) + oldmsg.length;
+    history->count --;
+  }
+
+ /*
+  * Add the new message...
+  */
+
+  write_job_log(history, &msg, sizeof(msg));
+  write_job_log(history, message, msg.length);
+
+  history->count ++;
+
+  _cupsMutexUnlock(&joblog_mutex);
+}
+
+
 /*
  * 'cupsdCancelJobs()' - Cancel all jobs for the given destination/user.
  */
@@ -1461,6 +1607,32 @@ cupsdDeleteJob(cupsd_job_t       *job,	/* I - Job */
   cupsArrayRemove(ActiveJobs, job);
   cupsArrayRemove(PrintingJobs, job);
 
+  update_job_index(job, 0);
+
+  if (job->cache_hash)
+  {
+   /*
+    * Record the deletion in the job.journal file on the next save...
+    */
+
+    if (num_journal_deletes >= alloc_journal_deletes)
+    {
+      int	*temp;			/* New DeleteJob records */
+
+
+      if ((temp = realloc(journal_deletes, (size_t)(alloc_journal_deletes + 64) * sizeof(int))) != NULL)
+      {
+        journal_deletes       = temp;
+	alloc_journal_deletes += 64;
+      }
+      else
+        job_cache_generation = 0;	/* Force a full job.cache save */
+    }
+
+    if (num_journal_deletes < alloc_journal_deletes)
+      journal_deletes[num_journal_deletes ++] = job->id;
+  }
+
   free(job);
 }
 
@@ -1488,10 +1660,51 @@ cupsdFreeAllJobs(void)
        job = (cupsd_job_t *)cupsArrayNext(Jobs))
     cupsdDeleteJob(job, CUPSD_JOB_DEFAULT);
 
+  free_job_index(&job_dests);
+  free_job_index(&job_users);
+  free_job_logs();
+
+  free(journal_deletes);
+  journal_deletes       = NULL;
+  num_journal_deletes   = 0;
+  alloc_journal_deletes = 0;
+
   cupsdReleaseSignals();
 }
 
 
+/*
+ * 'cupsdFindFirstJob()' - Find the first job with an ID at or after the
+ *                         specified ID.
+ *
+ * The job becomes the current element of the Jobs array so that callers can
+ * continue with cupsArrayNext().
+ */
+
+cupsd_job_t *				/* O - Job data or NULL */
+cupsdFindFirstJob(int id)		/* I - First job ID */
+{
+  int		left,			/* Left side of search */
+		right,			/* Right side of search */
+		middle;			/* Middle of search */
+  cupsd_job_t	*job;			/* Current job */
+
+
+  for (left = 0, right = cupsArrayCount(Jobs); left < right;)
+  {
+    middle = (left + right) / 2;
+    job    = (cupsd_job_t *)cupsArrayIndex(Jobs, middle);
+
+    if (job->id < id)
+      left = middle + 1;
+    else
+      right = middle;
+  }
+
+  return ((cupsd_job_t *)cupsArrayIndex(Jobs, left));
+}
+
+
 /*
  * 'cupsdFindJob()' - Find the specified job.
  */
@@ -1516,22 +1729,57 @@ cups_array_t *				/* O - Array of jobs */
 cupsdGetCompletedJobs(
     cupsd_printer_t *p)			/* I - Printer */
 {
-  cups_array_t	*list;			/* Array of jobs */
+  cups_array_t	*list,			/* Array of jobs */
+		*jobs;			/* Jobs to look at */
+  cupsd_jobindex_t *dindex;		/* Destination index entry */
   cupsd_job_t	*job;			/* Current job */
 
 
+#ifdef DEBUG
+  check_job_index();
+#endif /* DEBUG */
+
   list = cupsArrayNew(compare_completed_jobs, NULL);
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
+ /*
+  * Only look at the jobs for the printer, if any...
+  */
+
+  if (!p)
+    jobs = Jobs;
+  else if ((dindex = find_job_index(&job_dests, p->name, 0)) != NULL)
+    jobs = dindex->jobs;
+  else
+    return (list);
+
+  for (job = (cupsd_job_t *)cupsArrayFirst(jobs);
        job;
-       job = (cupsd_job_t *)cupsArrayNext(Jobs))
-    if ((!p || !_cups_strcasecmp(p->name, job->dest)) && job->state_value >= IPP_JOB_STOPPED && job->completed_time)
+       job = (cupsd_job_t *)cupsArrayNext(jobs))
+    if (job->state_value >= IPP_JOB_STOPPED && job->completed_time)
       cupsArrayAdd(list, job);
 
   return (list);
 }
 
 
+/*
+ * 'cupsdGetJobLogStats()' - Get statistics for the debug log histories.
+ */
+
+void
+cupsdGetJobLogStats(
+    cupsd_joblogstats_t *stats)		/* O - Statistics */
+{
+  _cupsMutexLock(&joblog_mutex);
+
+  stats->jobs    = joblog_jobs;
+  stats->dropped = joblog_dropped;
+  stats->size    = (size_t)joblog_allocated * sizeof(cupsd_joblog_t);
+
+  _cupsMutexUnlock(&joblog_mutex);
+}
+
+
 /*
  * 'cupsdGetPrinterJobCount()' - Get the number of pending, processing,
  *                               or held jobs in a printer or class.
@@ -1541,17 +1789,40 @@ int					/* O - Job count */
 cupsdGetPrinterJobCount(
     const char *dest)			/* I - Printer or class name */
 {
-  int		count;			/* Job count */
-  cupsd_job_t	*job;			/* Current job */
+  cupsd_jobindex_t	*dindex;	/* Destination index entry */
 
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs), count = 0;
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
-    if (job->dest && !_cups_strcasecmp(job->dest, dest))
-      count ++;
+#ifdef DEBUG
+  check_job_index();
+#endif /* DEBUG */
 
-  return (count);
+  if ((dindex = find_job_index(&job_dests, dest, 0)) != NULL)
+    return (dindex->num_active);
+  else
+    return (0);
+}
+
+
+/*
+ * 'cupsdGetPrinterJobs()' - Get all jobs for a printer or class.
+ *
+ * The returned array is sorted by job ID and must not be freed.
+ */
+
+cups_array_t *				/* O - Array of jobs or NULL */
+cupsdGetPrinterJobs(const char *dest)	/* I - Printer or class name */
+{
+  cupsd_jobindex_t	*dindex;	/* Destination index entry */
+
+
+#ifdef DEBUG
+  check_job_index();
+#endif /* DEBUG */
+
+  if ((dindex = find_job_index(&job_dests, dest, 0)) != NULL)
+    return (dindex->jobs);
+  else
+    return (NULL);
 }
 
 
@@ -1564,24 +1835,31 @@ int					/* O - Job count */
 cupsdGetUserJobCount(
     const char *username)		/* I - Username */
 {
-  int		count;			/* Job count */
-  cupsd_job_t	*job;			/* Current job */
+  cupsd_jobindex_t	*uindex;	/* User index entry */
 
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs), count = 0;
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
-    if (!_cups_strcasecmp(job->username, username))
-      count ++;
+#ifdef DEBUG
+  check_job_index();
+#endif /* DEBUG */
 
-  return (count);
+  if ((uindex = find_job_index(&job_users, username, 0)) != NULL)
+    return (uindex->num_active);
+  else
+    return (0);
 }
 
 /*
  * Purge old files that have become obviously stranded
  * this is based on the current file name scheme of:
- * one of a, c or d; 5 decimal digits; optional - and
+ * one of a, c or d; 5 or more decimal digits; optional - and
  * subsequent characters.
+ *
+ * The RequestRoot directory is read into an array that is sorted by job ID,
+ * so that the files for a job are adjacent and each group can be checked in a
+ * single pass.  When OrphanPurgeBatch is non-zero the scan and removal are
+ * done OrphanPurgeBatch files at a time from the main loop via
+ * cupsdPurgeOrphanFiles(), after the scheduler has started accepting
+ * requests.
  */
 
 #define CONTROL_NAME_MIN 6
@@ -1596,10 +1874,20 @@ enum Kind {
 
 struct Entries {
   char      name[CONTROL_NAME_MAX];
+  int       id;
   enum Kind kind;
   uint      seen[(int) (1 + eData)];
 };
 
+static struct {
+  cups_dir_t*     dir;		// RequestRoot directory while scanning
+  struct Entries* entries;	// Request files
+  uint            count;	// Number of request files
+  uint            alloc;	// Allocated request files
+  uint            next;		// Next request file to check
+  int             deleted;	// Number of files removed
+} orphans;
+
 static void removeRequestFile(const char* name)
 {
   char path[PATH_MAX];
@@ -1610,46 +1898,106 @@ static void removeRequestFile(const char* name)
   cupsdUnlinkOrRemoveFile(path);
 }
 
-static Boolean isEntryInJobArray(struct Entries* e)
+static int compare_entries(const void* a, const void* b)
 {
-  // this works for [ac]XXXXX and dXXXXX-YYY; atoi stops at the -
-  int num = atoi(&e->name[1]);
+  const struct Entries* ea = (const struct Entries*) a;
+  const struct Entries* eb = (const struct Entries*) b;
 
-  for (cupsd_job_t* job = cupsArrayFirst(Jobs); job != NULL; job = cupsArrayNext(Jobs)) {
-    if (job->id == num) {
-      return true;
-    }
-  }
+  if (ea->id != eb->id)
+    return (ea->id < eb->id ? -1 : 1);
 
-  return false;
+  return ((int) ea->kind - (int) eb->kind);
 }
 
-static int handle_orphans(struct Entries* entries, uint count)
+// Read up to limit (0 = all) entries from RequestRoot, returns 1 when done
+static int scan_orphans(int limit)
 {
-  int ctDeleted = 0;
+  cups_dentry_t* p;
+
+  while ((p = cupsDirRead(orphans.dir)) != NULL) {
+    if (S_ISREG(p->fileinfo.st_mode)) {
+      size_t nameLen = strlen(p->filename);
+
+      if (nameLen < CONTROL_NAME_MIN || nameLen >= CONTROL_NAME_MAX) {
+	continue;
+      }
+
+      enum Kind kind = eNoKind;
+
+      char ch = p->filename[0];
+      if (ch == 'a')
+	kind = eAuth;
+      else if (ch == 'c')
+	kind = eCtrl;
+      else if (ch == 'd')
+	kind = eData;
+
+      if (kind != eNoKind && isdigit(p->filename[1] & 255)) {
+	if (orphans.count == orphans.alloc) {
+	  // Grow geometrically so that the copying stays linear overall...
+	  uint num = orphans.alloc ? 2 * orphans.alloc : 1024;
+	  struct Entries* narray = (struct Entries*) realloc(orphans.entries, num * sizeof(struct Entries));
+
+	  if (narray == NULL) {
+	    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to allocate memory for %u request files.", num);
+	    free(orphans.entries);
+	    orphans.entries = NULL;
+	    orphans.count   = 0;
+	    orphans.alloc   = 0;
+	    return (1);
+	  }
 
-  for (uint o = 0;  o < (count - 1);  o++) {
-    struct Entries* cursor = &entries[o];
+	  orphans.entries = narray;
+	  orphans.alloc   = num;
+	}
 
-    for (uint i = o + 1; i < count; i++) {
-      struct Entries* now = &entries[i];
+	struct Entries* e = &orphans.entries[orphans.count++];
 
-      if (memcmp(&cursor->name[1], &now->name[1], 5) == 0) {
-	cursor->seen[now->kind]++;
-	now->seen[cursor->kind]++;
+	memset(e, 0, sizeof(struct Entries));
+	// this works for [ac]XXXXX and dXXXXX-YYY; atoi stops at the -
+	e->id   = atoi(&p->filename[1]);
+	e->kind = kind;
+	strlcpy(e->name, p->filename, CONTROL_NAME_MAX);
       }
     }
+
+    if (limit > 0 && --limit == 0)
+      return (0);
   }
 
-/*
-  for (uint i = 0; i < count; i++) {
-    struct Entries* now = &entries[i];
-    fprintf(stderr, "%.32s %d %d %d %d\n", now->name, now->kind, now->seen[0], now->seen[1], now->seen[2]);
+  return (1);
+}
+
+// Count the kinds of files for each job ID, entries must be sorted by ID
+static void count_orphans(void)
+{
+  uint first, last;
+
+  for (first = 0; first < orphans.count; first = last) {
+    uint groupSeen[(int) (1 + eData)] = { 0 };
+
+    for (last = first; last < orphans.count && orphans.entries[last].id == orphans.entries[first].id; last++)
+      groupSeen[orphans.entries[last].kind]++;
+
+    for (uint i = first; i < last; i++) {
+      struct Entries* now = &orphans.entries[i];
+
+      memcpy(now->seen, groupSeen, sizeof(now->seen));
+      now->seen[now->kind]--;		// Don't count ourselves
+    }
   }
-*/
+}
+
+// Remove up to limit (0 = all) orphans, returns 1 when done
+static int handle_orphans(int limit)
+{
+  int checked = 0;
 
-  for (uint i = 0; i < count; i++) {
-    struct Entries* now = &entries[i];
+  for (; orphans.next < orphans.count; orphans.next++) {
+    struct Entries* now = &orphans.entries[orphans.next];
+
+    if (limit > 0 && checked++ >= limit)
+      return (0);
 
     switch (now->kind) {
       default:
@@ -1674,89 +2022,72 @@ static int handle_orphans(struct Entries* entries, uint count)
 	break;
     }
 
-    // remove this orphan if it isn't otherwise referenced by the actively scanned Jobs
-    // array.
-    if (! isEntryInJobArray(now)) {
-      ctDeleted++;
+    // remove this orphan if it isn't otherwise referenced by the Jobs array.
+    if (!cupsdFindJob(now->id)) {
+      orphans.deleted++;
       removeRequestFile(now->name);
     }
   }
 
-  return ctDeleted;
+  return (1);
 }
 
-// this always consumes src
-static struct Entries* moreEntries(struct Entries* src, uint oldNum)
+// Free the purge state, returns the number of files removed
+static int finish_orphans(void)
 {
-  uint num = oldNum + 10;
-  struct Entries* narray = (struct Entries*) calloc(num, sizeof(struct Entries));
-  if (narray != NULL) {
-    memcpy(narray, src, oldNum * sizeof(struct Entries));
-  }
-  free(src);
-  return narray;
-}
+  int ctDeleted = orphans.deleted;
 
-static int purge_orphan_request_data()
-{
-  uint ctEntries = 0;
-  uint allocEntries = 0;
-  struct Entries* entries = NULL;
+  if (orphans.dir)
+    cupsDirClose(orphans.dir);
 
-  cups_dir_t* dir = cupsDirOpen(RequestRoot);
+  free(orphans.entries);
 
-  if (dir != NULL) {
-    cups_dentry_t* p;
+  memset(&orphans, 0, sizeof(orphans));
 
-    while ((p = cupsDirRead(dir)) != NULL) {
-      if (S_ISREG(p->fileinfo.st_mode)) {
-	size_t nameLen = strlen(p->filename);
+  return ctDeleted;
+}
 
-	if (nameLen < CONTROL_NAME_MIN || nameLen >= CONTROL_NAME_MAX) {
-	  continue;
-	}
+// Do one step of the purge, returns 1 when the purge is complete
+static int step_orphans(int limit)
+{
+  if (orphans.dir) {
+    if (!scan_orphans(limit))
+      return (0);
 
-	enum Kind kind = eNoKind;
-
-	char ch = p->filename[0];
-	if (ch == 'a')
-	  kind = eAuth;
-	else if (ch == 'c')
-	  kind = eCtrl;
-	else if (ch == 'd')
-	  kind = eData;
-
-	if (kind != eNoKind) {
-	  if (ctEntries == allocEntries) {
-	    entries = moreEntries(entries, allocEntries);
-	    if (entries == NULL) {
-	      allocEntries = 0;
-	      ctEntries = 0;
-	      break;
-	    }
-	    allocEntries += 10;
-	  }
-	  entries[ctEntries].kind = kind;
-	  strlcpy(entries[ctEntries].name, p->filename, CONTROL_NAME_MAX);
-	  ctEntries++;
-	}
-      }
+    cupsDirClose(orphans.dir);
+    orphans.dir = NULL;
+
+    if (orphans.count > 0) {
+      qsort(orphans.entries, orphans.count, sizeof(struct Entries), compare_entries);
+      count_orphans();
     }
 
-    cupsDirClose(dir);
+    if (limit > 0)
+      return (0);
   }
 
-  int ctDeleted = 0;
+  return (handle_orphans(limit));
+}
 
-  if (entries != NULL) {
-    if (ctEntries > 0) {
-      ctDeleted = handle_orphans(entries, ctEntries);
-    }
+static int purge_orphan_request_data()
+{
+  if (orphans.dir || orphans.entries) {
+    // Already purging in the background...
+    return 0;
+  }
 
-    free(entries);
+  if ((orphans.dir = cupsDirOpen(RequestRoot)) == NULL) {
+    return 0;
   }
 
-  return ctDeleted;
+  if (OrphanPurgeBatch > 0) {
+    cupsdLogMessage(CUPSD_LOG_DEBUG, "Purging orphan request files %d at a time.", OrphanPurgeBatch);
+    return 0;
+  }
+
+  step_orphans(0);
+
+  return finish_orphans();
 }
 
 
@@ -1767,10 +2098,13 @@ static int purge_orphan_request_data()
 void
 cupsdLoadAllJobs(void)
 {
-  char		filename[1024];		/* Full filename of job.cache file */
-  struct stat	fileinfo;		/* Information on job.cache file */
+  char		filename[1024],		/* Full filename of job.cache file */
+		journal[1024];		/* Full filename of job.journal file */
+  struct stat	fileinfo,		/* Information on job.cache file */
+		journalinfo;		/* Information on job.journal file */
   cups_dir_t	*dir;			/* RequestRoot dir */
   cups_dentry_t	*dent;			/* Entry in RequestRoot */
+  cupsd_job_t	*job;			/* Current job */
   int		load_cache = 1;		/* Load the job.cache file? */
 
 
@@ -1792,6 +2126,11 @@ cupsdLoadAllJobs(void)
   */
 
   snprintf(filename, sizeof(filename), "%s/job.cache", CacheDir);
+  snprintf(journal, sizeof(journal), "%s/job.journal", CacheDir);
+
+  job_cache_generation = 0;
+  journal_started      = 0;
+  journal_records      = 0;
 
   if (stat(filename, &fileinfo))
   {
@@ -1816,6 +2155,14 @@ cupsdLoadAllJobs(void)
   }
   else
   {
+   /*
+    * Changes made after the job.cache file was written are appended to the
+    * job.journal file...
+    */
+
+    if (!stat(journal, &journalinfo) && journalinfo.st_mtime > fileinfo.st_mtime)
+      fileinfo.st_mtime = journalinfo.st_mtime;
+
     while ((dent = cupsDirRead(dir)) != NULL)
     {
       if (strlen(dent->filename) >= 6 && dent->filename[0] == 'c' && dent->fileinfo.st_mtime > fileinfo.st_mtime)
@@ -1839,10 +2186,30 @@ cupsdLoadAllJobs(void)
   if (load_cache)
   {
    /*
-    * Load the job.cache file...
+    * Load the job.cache file and replay any changes from the job.journal
+    * file...
+    */
+
+    load_job_cache(filename, 0);
+
+    if (job_cache_generation)
+      load_job_cache(journal, 1);
+
+   /*
+    * Remember what has been written so that only changes get appended to the
+    * journal...
     */
 
-    load_job_cache(filename);
+    if (job_cache_generation)
+    {
+      for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
+	   job;
+	   job = (cupsd_job_t *)cupsArrayNext(Jobs))
+	if (!job->printer || !job->printer->temporary)
+	  job->cache_hash = job_cache_hash(job);
+
+      journal_next_job_id = NextJobId;
+    }
   }
   else
   {
@@ -1853,6 +2220,7 @@ cupsdLoadAllJobs(void)
     load_request_root();
 
     load_next_job_id(filename);
+    load_next_job_id(journal);
   }
 
   /*
@@ -1896,7 +2264,7 @@ cupsdLoadJob(cupsd_job_t *job)		/* I - Job */
     return (1);
   }
 
-  if ((job->attrs = ippNew()) == NULL)
+  if ((job->attrs = _ippNewArena()) == NULL)
   {
     cupsdLogJob(job, CUPSD_LOG_ERROR, "Ran out of memory for job attributes.");
     return (0);
@@ -1997,6 +2365,7 @@ cupsdLoadJob(cupsd_job_t *job)		/* I - Job */
     }
 
     cupsdSetString(&job->dest, dest);
+    cupsdUpdateJobIndex(job);
   }
   else if ((destptr = cupsdFindDest(job->dest)) == NULL)
   {
@@ -2102,6 +2471,7 @@ cupsdLoadJob(cupsd_job_t *job)		/* I - Job */
     }
 
     cupsdSetString(&job->username, attr->values[0].string.text);
+    cupsdUpdateJobIndex(job);
   }
 
   if (!job->name)
@@ -2352,6 +2722,8 @@ cupsdMoveJob(cupsd_job_t     *job,	/* I - Job */
   cupsdSetString(&job->dest, p->name);
   job->dtype = p->type & (CUPS_PRINTER_CLASS | CUPS_PRINTER_REMOTE);
 
+  cupsdUpdateJobIndex(job);
+
   if ((attr = ippFindAttribute(job->attrs, "job-printer-uri",
                                IPP_TAG_URI)) != NULL)
     ippSetString(job->attrs, &attr, 0, p->uri);
@@ -2365,6 +2737,28 @@ cupsdMoveJob(cupsd_job_t     *job,	/* I - Job */
 }
 
 
+/*
+ * 'cupsdPurgeOrphanFiles()' - Purge orphaned request files in the background.
+ *
+ * Returns 1 if there is still work to do and 0 when the purge is complete.
+ */
+
+int					/* O - 1 if more files to purge */
+cupsdPurgeOrphanFiles(void)
+{
+  if (!orphans.dir && !orphans.entries)
+    return (0);
+
+  if (!step_orphans(OrphanPurgeBatch > 0 ? OrphanPurgeBatch : 0))
+    return (1);
+
+  if (finish_orphans() > 0)
+    cupsdCleanJobs();
+
+  return (0);
+}
+
+
 /*
  * 'cupsdReleaseJob()' - Release the specified job.
  */
@@ -2390,6 +2784,19 @@ cupsdReleaseJob(cupsd_job_t *job)	/* I - Job */
 }
 
 
+/*
+ * 'cupsdRemoveActiveJob()' - Remove a job from the active jobs list.
+ */
+
+void
+cupsdRemoveActiveJob(cupsd_job_t *job)	/* I - Job */
+{
+  cupsArrayRemove(ActiveJobs, job);
+
+  update_job_index(job, 0);
+}
+
+
 /*
  * 'cupsdRestartJob()' - Restart the specified job.
  */
@@ -2413,13 +2820,13 @@ cupsdRestartJob(cupsd_job_t *job)	/* I - Job */
 void
 cupsdSaveAllJobs(void)
 {
-  int		i;			/* Looping var */
   cups_file_t	*fp;			/* job.cache file */
   char		filename[1024],		/* job.cache filename */
 		temp[1024];		/* Temporary string */
   cupsd_job_t	*job;			/* Current job */
   time_t	curtime;		/* Current time */
   struct tm	curdate;		/* Current date */
+  int		generation;		/* New job.cache generation */
 
 
   snprintf(filename, sizeof(filename), "%s/job.cache", CacheDir);
@@ -2436,8 +2843,12 @@ cupsdSaveAllJobs(void)
   localtime_r(&curtime, &curdate);
   strftime(temp, sizeof(temp) - 1, "%Y-%m-%d %H:%M", &curdate);
 
+  if ((generation = (int)curtime) <= job_cache_generation)
+    generation = job_cache_generation + 1;
+
   cupsFilePuts(fp, "# Job cache file for " CUPS_SVERSION "\n");
   cupsFilePrintf(fp, "# Written by cupsd on %s\n", temp);
+  cupsFilePrintf(fp, "Generation %d\n", generation);
   cupsFilePrintf(fp, "NextJobId %d\n", NextJobId);
 
  /*
@@ -2454,31 +2865,152 @@ cupsdSaveAllJobs(void)
       * Don't save jobs on temporary printers...
       */
 
+      job->cache_hash = 0;
       continue;
     }
 
-    cupsFilePrintf(fp, "<Job %d>\n", job->id);
-    cupsFilePrintf(fp, "State %d\n", job->state_value);
-    cupsFilePrintf(fp, "Created %ld\n", (long)job->creation_time);
-    if (job->completed_time)
-      cupsFilePrintf(fp, "Completed %ld\n", (long)job->completed_time);
-    cupsFilePrintf(fp, "Priority %d\n", job->priority);
-    if (job->hold_until)
-      cupsFilePrintf(fp, "HoldUntil %ld\n", (long)job->hold_until);
-    cupsFilePrintf(fp, "Username %s\n", job->username);
-    if (job->name)
-      cupsFilePutConf(fp, "Name", job->name);
-    cupsFilePrintf(fp, "Destination %s\n", job->dest);
-    cupsFilePrintf(fp, "DestType %d\n", job->dtype);
-    cupsFilePrintf(fp, "KOctets %d\n", job->koctets);
-    cupsFilePrintf(fp, "NumFiles %d\n", job->num_files);
-    for (i = 0; i < job->num_files; i ++)
-      cupsFilePrintf(fp, "File %d %s/%s %d\n", i + 1, job->filetypes[i]->super,
-                     job->filetypes[i]->type, job->compressions[i]);
-    cupsFilePuts(fp, "</Job>\n");
+    write_job_cache(fp, job);
+
+    job->cache_hash = job_cache_hash(job);
+  }
+
+  if (cupsdCloseCreatedConfFile(fp, filename))
+  {
+    job_cache_generation = 0;
+    return;
   }
 
-  cupsdCloseCreatedConfFile(fp, filename);
+ /*
+  * The new job.cache file replaces the journal...
+  */
+
+  snprintf(filename, sizeof(filename), "%s/job.journal", CacheDir);
+  if (cupsdUnlinkOrRemoveFile(filename) && errno != ENOENT)
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to remove \"%s\": %s", filename,
+                    strerror(errno));
+
+  job_cache_generation = generation;
+  journal_started      = 0;
+  journal_records      = 0;
+  journal_next_job_id  = NextJobId;
+  num_journal_deletes  = 0;
+}
+
+
+/*
+ * 'cupsdSaveChangedJobs()' - Append changed jobs to the job.journal file.
+ *
+ * Only jobs whose job.cache record has changed since the last save are
+ * written, so the cost of a save depends on the number of changes and not on
+ * the number of jobs.  Once the journal holds more records than there are
+ * jobs, a new job.cache file is written instead.
+ */
+
+void
+cupsdSaveChangedJobs(void)
+{
+  int		i;			/* Looping var */
+  cups_file_t	*fp = NULL;		/* job.journal file */
+  char		filename[1024];		/* job.journal filename */
+  cupsd_job_t	*job;			/* Current job */
+  unsigned	hash;			/* Hash of job.cache record */
+  int		records = 0;		/* Number of records written */
+
+
+ /*
+  * Write a new job.cache file if there isn't a current one or the journal has
+  * grown too large...
+  */
+
+  if (!job_cache_generation || journal_records > cupsArrayCount(Jobs) + 100)
+  {
+    cupsdSaveAllJobs();
+    return;
+  }
+
+  snprintf(filename, sizeof(filename), "%s/job.journal", CacheDir);
+
+ /*
+  * Write pending deletions and the next job ID...
+  */
+
+  for (i = 0; i < num_journal_deletes; i ++)
+  {
+    if (!fp && (fp = open_job_journal(filename)) == NULL)
+    {
+      cupsdSaveAllJobs();
+      return;
+    }
+
+    cupsFilePrintf(fp, "DeleteJob %d\n", journal_deletes[i]);
+    records ++;
+  }
+
+  num_journal_deletes = 0;
+
+  if (NextJobId != journal_next_job_id)
+  {
+    if (!fp && (fp = open_job_journal(filename)) == NULL)
+    {
+      cupsdSaveAllJobs();
+      return;
+    }
+
+    cupsFilePrintf(fp, "NextJobId %d\n", NextJobId);
+    journal_next_job_id = NextJobId;
+  }
+
+ /*
+  * Then write each job that has changed...
+  */
+
+  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
+       job;
+       job = (cupsd_job_t *)cupsArrayNext(Jobs))
+  {
+    if (job->printer && job->printer->temporary)
+      continue;
+
+    if ((hash = job_cache_hash(job)) == job->cache_hash)
+      continue;
+
+    if (!fp && (fp = open_job_journal(filename)) == NULL)
+    {
+      cupsdSaveAllJobs();
+      return;
+    }
+
+    write_job_cache(fp, job);
+
+    job->cache_hash = hash;
+    records ++;
+  }
+
+  if (!fp)
+    return;
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG, "Appended %d records to job.journal.",
+                  records);
+
+  journal_records += records;
+
+ /*
+  * Synchronize changes to disk if SyncOnClose is enabled.
+  */
+
+  if (SyncOnClose && (cupsFileFlush(fp) || fsync(cupsFileNumber(fp))))
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to sync changes to \"%s\": %s",
+		    filename, strerror(errno));
+    job_cache_generation = 0;
+  }
+
+  if (cupsFileClose(fp))
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to write changes to \"%s\": %s",
+		    filename, strerror(errno));
+    job_cache_generation = 0;
+  }
 }
 
 
@@ -2894,8 +3426,7 @@ cupsdSetJobState(
         * Make sure the job is in the active list...
 	*/
 
-        if (!cupsArrayFind(ActiveJobs, job))
-	  cupsArrayAdd(ActiveJobs, job);
+        cupsdAddActiveJob(job);
 
        /*
 	* Save the job state to disk...
@@ -2918,7 +3449,7 @@ cupsdSetJobState(
 	  for (i = 0; job->filters[i] < 0; i++);
 
 	  if (!job->filters[i] && job->backend <= 0)
-	    cupsArrayRemove(ActiveJobs, job);
+	    cupsdRemoveActiveJob(job);
 	}
 	else
 	{
@@ -2926,7 +3457,7 @@ cupsdSetJobState(
 	  * Otherwise just remove the job from the active list immediately...
 	  */
 
-	  cupsArrayRemove(ActiveJobs, job);
+	  cupsdRemoveActiveJob(job);
 	}
 
        /*
@@ -3066,6 +3597,20 @@ cupsdUnloadCompletedJobs(void)
 }
 
 
+/*
+ * 'cupsdUpdateJobIndex()' - Update the destination and user indexes for a job.
+ *
+ * This must be called whenever the job-originating-user-name or destination
+ * of a job changes.
+ */
+
+void
+cupsdUpdateJobIndex(cupsd_job_t *job)	/* I - Job */
+{
+  update_job_index(job, job->index_active);
+}
+
+
 /*
  * 'cupsdUpdateJobs()' - Update the history/file files for all jobs.
  */
@@ -3126,6 +3671,83 @@ cupsdUpdateJobs(void)
 }
 
 
+#ifdef DEBUG
+/*
+ * 'check_job_index()' - Validate the job indexes against the job lists.
+ */
+
+static void
+check_job_index(void)
+{
+  cupsd_job_t		*job;		/* Current job */
+  cupsd_jobindex_t	*dindex,	/* Destination index entry */
+			*uindex;	/* User index entry */
+  int			count,		/* Number of jobs */
+			total;		/* Total number of indexed jobs */
+
+
+  for (dindex = (cupsd_jobindex_t *)cupsArrayFirst(job_dests), total = 0;
+       dindex;
+       dindex = (cupsd_jobindex_t *)cupsArrayNext(job_dests))
+  {
+    for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs), count = 0;
+	 job;
+	 job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
+      if (job->dest && !_cups_strcasecmp(job->dest, dindex->name))
+	count ++;
+
+    if (count != dindex->num_active)
+      cupsdLogMessage(CUPSD_LOG_ERROR, "check_job_index: Destination \"%s\" has %d active jobs but index has %d.", dindex->name, count, dindex->num_active);
+
+    for (job = (cupsd_job_t *)cupsArrayFirst(Jobs), count = 0;
+	 job;
+	 job = (cupsd_job_t *)cupsArrayNext(Jobs))
+      if (job->dest && !_cups_strcasecmp(job->dest, dindex->name))
+	count ++;
+
+    if (count != cupsArrayCount(dindex->jobs))
+      cupsdLogMessage(CUPSD_LOG_ERROR, "check_job_index: Destination \"%s\" has %d jobs but index has %d.", dindex->name, count, cupsArrayCount(dindex->jobs));
+
+    total += cupsArrayCount(dindex->jobs);
+  }
+
+  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs), count = 0;
+       job;
+       job = (cupsd_job_t *)cupsArrayNext(Jobs))
+    if (job->dest)
+      count ++;
+
+  if (count != total)
+    cupsdLogMessage(CUPSD_LOG_ERROR, "check_job_index: %d jobs have a destination but %d are indexed.", count, total);
+
+  for (uindex = (cupsd_jobindex_t *)cupsArrayFirst(job_users), total = 0;
+       uindex;
+       uindex = (cupsd_jobindex_t *)cupsArrayNext(job_users))
+  {
+    for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs), count = 0;
+	 job;
+	 job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
+      if (job->username && !_cups_strcasecmp(job->username, uindex->name))
+	count ++;
+
+    if (count != uindex->num_active)
+      cupsdLogMessage(CUPSD_LOG_ERROR, "check_job_index: User \"%s\" has %d active jobs but index has %d.", uindex->name, count, uindex->num_active);
+
+    total += uindex->num_active;
+  }
+
+  for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs), count = 0;
+       job;
+       job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
+    if (job->username)
+      count ++;
+
+  if (count != total)
+    cupsdLogMessage(CUPSD_LOG_ERROR, "check_job_index: %d active jobs have a user but %d are indexed.", count, total);
+}
+#endif /* DEBUG */
+
+
 /*
  * 'compare_active_jobs()' - Compare the job IDs and priorities of two jobs.
  */
@@ -3170,6 +3792,22 @@ compare_completed_jobs(void *first,	/* I - First job */
 }
 
 
+/*
+ * 'compare_job_index()' - Compare two job index entries.
+ */
+
+static int				/* O - Result of comparison */
+compare_job_index(
+    cupsd_jobindex_t *first,		/* I - First index entry */
+    cupsd_jobindex_t *second,		/* I - Second index entry */
+    void             *data)		/* I - App data (not used) */
+{
+  (void)data;
+
+  return (_cups_strcasecmp(first->name, second->name));
+}
+
+
 /*
  * 'compare_jobs()' - Compare the job IDs of two jobs.
  */
@@ -3195,8 +3833,14 @@ dump_job_history(cupsd_job_t *job)	/* I - Job */
   int			i,		/* Looping var */
 			oldsize;	/* Current MaxLogSize */
   struct tm		date;		/* Date/time value */
-  cupsd_joblog_t	*message;	/* Current message */
-  char			temp[2048],	/* Log message */
+  cupsd_joblog_t	*history;	/* Debug log history */
+  cupsd_joblogmsg_t	msg;		/* Current message */
+  size_t		pos;		/* Position in history */
+  time_t		first,		/* Time of first message */
+			last;		/* Time of last message */
+  char			message[CUPSD_JOBLOG_MAXMSG + 1],
+					/* Message string */
+			temp[2048],	/* Log message */
 			*ptr,		/* Pointer into log message */
 			start[256],	/* Start time */
 			end[256];	/* End time */
@@ -3207,8 +3851,11 @@ dump_job_history(cupsd_job_t *job)	/* I - Job */
   * See if we have anything to dump...
   */
 
-  if (!job->history)
+  if ((history = job->history) == NULL || history->count == 0)
+  {
+    free_job_history(job);
     return;
+  }
 
  /*
   * Disable log rotation temporarily...
@@ -3221,12 +3868,20 @@ dump_job_history(cupsd_job_t *job)	/* I - Job */
   * Copy the debug messages to the log...
   */
 
-  message = (cupsd_joblog_t *)cupsArrayFirst(job->history);
-  localtime_r(&(message->time), &date);
+  for (i = 0, pos = history->tail, first = last = 0; i < history->count; i ++, pos += sizeof(msg) + msg.length)
+  {
+    read_job_log(history, pos, &msg, sizeof(msg));
+
+    if (i == 0)
+      first = msg.time;
+
+    last = msg.time;
+  }
+
+  localtime_r(&first, &date);
   strftime(start, sizeof(start), "%X", &date);
 
-  message = (cupsd_joblog_t *)cupsArrayLast(job->history);
-  localtime_r(&(message->time), &date);
+  localtime_r(&last, &date);
   strftime(end, sizeof(end), "%X", &date);
 
   snprintf(temp, sizeof(temp),
@@ -3234,10 +3889,14 @@ dump_job_history(cupsd_job_t *job)	/* I - Job */
            job->id, start, end);
   cupsdWriteErrorLog(CUPSD_LOG_DEBUG, temp);
 
-  for (message = (cupsd_joblog_t *)cupsArrayFirst(job->history);
-       message;
-       message = (cupsd_joblog_t *)cupsArrayNext(job->history))
-    cupsdWriteErrorLog(CUPSD_LOG_DEBUG, message->message);
+  for (i = 0, pos = history->tail; i < history->count; i ++, pos += sizeof(msg) + msg.length)
+  {
+    read_job_log(history, pos, &msg, sizeof(msg));
+    read_job_log(history, pos + sizeof(msg), message, msg.length);
+    message[msg.length] = '\0';
+
+    cupsdWriteErrorLog(CUPSD_LOG_DEBUG, message);
+  }
 
   snprintf(temp, sizeof(temp), "[Job %d] End of messages", job->id);
   cupsdWriteErrorLog(CUPSD_LOG_DEBUG, temp);
@@ -3292,30 +3951,61 @@ dump_job_history(cupsd_job_t *job)	/* I - Job */
   * Free all messages...
   */
 
-  free_job_history(job);
+  free_job_history(job);
+}
+
+
+/*
+ * 'free_job_history()' - Free any log history.
+ */
+
+static void
+free_job_history(cupsd_job_t *job)	/* I - Job */
+{
+  if (!job->history)
+    return;
+
+ /*
+  * Return the history to the free list...
+  */
+
+  _cupsMutexLock(&joblog_mutex);
+
+  job->history->next = joblog_free;
+  joblog_free        = job->history;
+  job->history       = NULL;
+
+  joblog_jobs --;
+
+  _cupsMutexUnlock(&joblog_mutex);
 }
 
 
 /*
- * 'free_job_history()' - Free any log history.
+ * 'free_job_logs()' - Free the debug log history slabs if none are in use.
  */
 
 static void
-free_job_history(cupsd_job_t *job)	/* I - Job */
+free_job_logs(void)
 {
-  char	*message;			/* Current message */
+  void	*slab;				/* Current slab */
 
 
-  if (!job->history)
-    return;
+  _cupsMutexLock(&joblog_mutex);
 
-  for (message = (char *)cupsArrayFirst(job->history);
-       message;
-       message = (char *)cupsArrayNext(job->history))
-    free(message);
+  if (joblog_jobs == 0)
+  {
+    for (slab = cupsArrayFirst(joblog_slabs); slab; slab = cupsArrayNext(joblog_slabs))
+      free(slab);
+
+    cupsArrayDelete(joblog_slabs);
+
+    joblog_slabs     = NULL;
+    joblog_free      = NULL;
+    joblog_allocated = 0;
+  }
 
-  cupsArrayDelete(job->history);
-  job->history = NULL;
+  _cupsMutexUnlock(&joblog_mutex);
 }
 
 
@@ -3855,6 +4545,70 @@ finalize_job(cupsd_job_t *job,		/* I - Job */
 }
 
 
+/*
+ * 'find_job_index()' - Find (or create) a job index entry.
+ */
+
+static cupsd_jobindex_t *		/* O - Index entry or NULL */
+find_job_index(cups_array_t **a,	/* IO - Index array */
+               const char   *name,	/* I  - Destination or user name */
+               int          create)	/* I  - Create the entry as needed? */
+{
+  cupsd_jobindex_t	key,		/* Search key */
+			*entry;		/* Matching entry */
+
+
+  if (!name)
+    return (NULL);
+
+  if (*a)
+  {
+    key.name = (char *)name;
+
+    if ((entry = (cupsd_jobindex_t *)cupsArrayFind(*a, &key)) != NULL)
+      return (entry);
+  }
+
+  if (!create)
+    return (NULL);
+
+  if (!*a && (*a = cupsArrayNew((cups_array_func_t)compare_job_index, NULL)) == NULL)
+    return (NULL);
+
+  if ((entry = calloc(1, sizeof(cupsd_jobindex_t))) == NULL)
+    return (NULL);
+
+  cupsdSetString(&entry->name, name);
+  cupsArrayAdd(*a, entry);
+
+  return (entry);
+}
+
+
+/*
+ * 'free_job_index()' - Free all entries in a job index.
+ */
+
+static void
+free_job_index(cups_array_t **a)	/* IO - Index array */
+{
+  cupsd_jobindex_t	*entry;		/* Current entry */
+
+
+  for (entry = (cupsd_jobindex_t *)cupsArrayFirst(*a);
+       entry;
+       entry = (cupsd_jobindex_t *)cupsArrayNext(*a))
+  {
+    cupsdClearString(&entry->name);
+    cupsArrayDelete(entry->jobs);
+    free(entry);
+  }
+
+  cupsArrayDelete(*a);
+  *a = NULL;
+}
+
+
 /*
  * 'get_options()' - Get a string containing the job options.
  */
@@ -4356,6 +5110,25 @@ get_options(cupsd_job_t *job,		/* I - Job */
 }
 
 
+/*
+ * 'hash_data()' - Add data to a FNV-1a hash.
+ */
+
+static unsigned				/* O - New hash value */
+hash_data(unsigned   hash,		/* I - Current hash value */
+          const void *data,		/* I - Data to hash */
+	  size_t     datalen)		/* I - Length of data */
+{
+  const unsigned char	*ptr;		/* Pointer into data */
+
+
+  for (ptr = (const unsigned char *)data; datalen > 0; datalen --, ptr ++)
+    hash = (hash ^ *ptr) * 16777619U;
+
+  return (hash);
+}
+
+
 /*
  * 'ipp_length()' - Compute the size of the buffer needed to hold
  *		    the textual IPP attributes.
@@ -4488,26 +5261,77 @@ ipp_length(ipp_t *ipp)			/* I - IPP request */
 
 
 /*
- * 'load_job_cache()' - Load jobs from the job.cache file.
+ * 'job_cache_hash()' - Compute a hash of the job.cache record for a job.
+ */
+
+static unsigned				/* O - Hash value, never 0 */
+job_cache_hash(cupsd_job_t *job)	/* I - Job */
+{
+  unsigned	hash = 2166136261U;	/* Hash value */
+  long		values[7];		/* Numeric values */
+
+
+  values[0] = job->state_value;
+  values[1] = (long)job->creation_time;
+  values[2] = (long)job->completed_time;
+  values[3] = job->priority;
+  values[4] = (long)job->hold_until;
+  values[5] = job->dtype;
+  values[6] = job->koctets;
+
+  hash = hash_data(hash, values, sizeof(values));
+  hash = hash_data(hash, job->username ? job->username : "", job->username ? strlen(job->username) + 1 : 1);
+  hash = hash_data(hash, job->name ? job->name : "", job->name ? strlen(job->name) + 1 : 1);
+  hash = hash_data(hash, job->dest ? job->dest : "", job->dest ? strlen(job->dest) + 1 : 1);
+  hash = hash_data(hash, &job->num_files, sizeof(job->num_files));
+
+  if (job->num_files > 0)
+  {
+    hash = hash_data(hash, job->filetypes, (size_t)job->num_files * sizeof(mime_type_t *));
+    hash = hash_data(hash, job->compressions, (size_t)job->num_files * sizeof(int));
+  }
+
+  return (hash ? hash : 1);
+}
+
+
+/*
+ * 'load_job_cache()' - Load jobs from the job.cache or job.journal file.
+ *
+ * Records in the job.journal file replace any existing job with the same ID
+ * and are only used when the journal generation matches the job.cache file.
  */
 
 static void
-load_job_cache(const char *filename)	/* I - job.cache filename */
+load_job_cache(const char *filename,	/* I - job.cache filename */
+               int        journal)	/* I - 1 = job.journal, 0 = job.cache */
 {
   cups_file_t	*fp;			/* job.cache file */
   char		line[1024],		/* Line buffer */
 		*value;			/* Value on line */
   int		linenum;		/* Line number in file */
-  cupsd_job_t	*job;			/* Current job */
+  cupsd_job_t	*job,			/* Current job */
+		*oldjob;		/* Existing job with the same ID */
   int		jobid;			/* Job ID */
   char		jobfile[1024];		/* Job filename */
+  int		valid = !journal,	/* Does the journal match job.cache? */
+		skip = 0;		/* Skip the current journal record? */
 
 
  /*
   * Open the job.cache file...
   */
 
-  if ((fp = cupsdOpenConfFile(filename)) == NULL)
+  if (journal)
+  {
+    if ((fp = cupsFileOpen(filename, "r")) == NULL)
+    {
+      if (errno != ENOENT)
+        cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to open \"%s\": %s", filename, strerror(errno));
+      return;
+    }
+  }
+  else if ((fp = cupsdOpenConfFile(filename)) == NULL)
   {
     load_request_root();
     return;
@@ -4525,11 +5349,47 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
 
   while (cupsFileGetConf(fp, line, sizeof(line), &value, &linenum))
   {
-    if (!_cups_strcasecmp(line, "NextJobId"))
+    if (!_cups_strcasecmp(line, "Generation"))
+    {
+      if (!value)
+        continue;
+
+      if (!journal)
+      {
+        job_cache_generation = atoi(value);
+      }
+      else if (atoi(value) == job_cache_generation)
+      {
+        valid = 1;
+      }
+      else
+      {
+        cupsdLogMessage(CUPSD_LOG_INFO, "Ignoring out-of-date job journal file \"%s\".", filename);
+        break;
+      }
+    }
+    else if (!valid)
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Missing Generation directive on line %d of %s.", linenum, filename);
+      break;
+    }
+    else if (skip)
+    {
+      if (!_cups_strcasecmp(line, "</Job>"))
+        skip = 0;
+    }
+    else if (!_cups_strcasecmp(line, "NextJobId"))
     {
       if (value)
         NextJobId = atoi(value);
     }
+    else if (!_cups_strcasecmp(line, "DeleteJob") && journal && !job)
+    {
+      if (value && (oldjob = cupsdFindJob(atoi(value))) != NULL)
+        cupsdDeleteJob(oldjob, CUPSD_JOB_DEFAULT);
+
+      journal_records ++;
+    }
     else if (!_cups_strcasecmp(line, "<Job"))
     {
       if (job)
@@ -4561,12 +5421,29 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
 	  cupsdLogMessage(CUPSD_LOG_ERROR, "[Job %d] Files have gone away.",
 			  jobid);
 
+          if (journal)
+	  {
+	   /*
+	    * Skip this record, a later DeleteJob record removes it...
+	    */
+
+	    skip = 1;
+	    continue;
+	  }
+
          /*
           * job.cache file is out-of-date compared to spool directory; load
-          * that instead...
+          * that instead after discarding the jobs loaded so far...
           */
 
 	  cupsFileClose(fp);
+
+	  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
+	       job;
+	       job = (cupsd_job_t *)cupsArrayNext(Jobs))
+	    cupsdDeleteJob(job, CUPSD_JOB_DEFAULT);
+
+	  job_cache_generation = 0;
           load_request_root();
           return;
 	}
@@ -4627,10 +5504,23 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
         }
       }
 
+      if (journal)
+      {
+       /*
+        * Replace the previous copy of the job...
+	*/
+
+        if ((oldjob = cupsdFindJob(job->id)) != NULL)
+	  cupsdDeleteJob(oldjob, CUPSD_JOB_DEFAULT);
+
+        journal_records ++;
+      }
+
       cupsArrayAdd(Jobs, job);
+      cupsdUpdateJobIndex(job);
 
       if (job->state_value <= IPP_JOB_STOPPED && cupsdLoadJob(job))
-	cupsArrayAdd(ActiveJobs, job);
+	cupsdAddActiveJob(job);
       else if (job->state_value > IPP_JOB_STOPPED)
       {
         if (!job->completed_time || !job->creation_time || !job->name || !job->koctets)
@@ -4784,9 +5674,18 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
   {
     cupsdLogMessage(CUPSD_LOG_ERROR,
 		    "Missing </Job> directive on line %d of %s.", linenum, filename);
-    cupsdDeleteJob(job, CUPSD_JOB_PURGE);
+
+   /*
+    * A partial journal record keeps the files for the previous copy of the
+    * job...
+    */
+
+    cupsdDeleteJob(job, journal ? CUPSD_JOB_DEFAULT : CUPSD_JOB_PURGE);
   }
 
+  if (journal && valid)
+    journal_started = 1;
+
   cupsFileClose(fp);
 }
 
@@ -4916,20 +5815,173 @@ load_request_root(void)
         */
 
 	cupsArrayAdd(Jobs, job);
+	cupsdUpdateJobIndex(job);
 
 	if (job->state_value <= IPP_JOB_STOPPED)
-	  cupsArrayAdd(ActiveJobs, job);
+	  cupsdAddActiveJob(job);
 	else
 	  unload_job(job);
       }
       else
+      {
+       /*
+        * cupsdLoadJob() may have indexed the job before failing...
+	*/
+
+	cupsdClearString(&job->username);
+	cupsdClearString(&job->dest);
+	update_job_index(job, 0);
+
         free(job);
+      }
     }
 
   cupsDirClose(dir);
 }
 
 
+/*
+ * 'new_job_log()' - Get a debug log history from the shared pool.
+ *
+ * Histories are allocated in slabs of CUPSD_JOBLOG_SLAB, limited to
+ * MaxDebugHistorySize bytes in total.  The joblog_mutex must be held.
+ */
+
+static cupsd_joblog_t *			/* O - History or @code NULL@ if none */
+new_job_log(void)
+{
+  int			i,		/* Looping var */
+			count;		/* Number of histories to allocate */
+  cupsd_joblog_t	*slab,		/* New slab */
+			*history;	/* History */
+
+
+  if (!joblog_free)
+  {
+   /*
+    * Allocate another slab, up to the memory limit...
+    */
+
+    count = CUPSD_JOBLOG_SLAB;
+
+    if (MaxDebugHistorySize > 0)
+    {
+      int avail = MaxDebugHistorySize / (int)sizeof(cupsd_joblog_t) - joblog_allocated;
+					/* Histories left under the limit */
+
+      if (count > avail)
+        count = avail;
+    }
+
+    if (count <= 0)
+      return (NULL);
+
+    if (!joblog_slabs && (joblog_slabs = cupsArrayNew(NULL, NULL)) == NULL)
+      return (NULL);
+
+    if ((slab = calloc((size_t)count, sizeof(cupsd_joblog_t))) == NULL)
+      return (NULL);
+
+    cupsArrayAdd(joblog_slabs, slab);
+
+    for (i = count - 1; i >= 0; i --)
+    {
+      slab[i].next = joblog_free;
+      joblog_free  = slab + i;
+    }
+
+    joblog_allocated += count;
+  }
+
+  history     = joblog_free;
+  joblog_free = history->next;
+
+  history->next  = NULL;
+  history->count = 0;
+  history->head  = 0;
+  history->tail  = 0;
+
+  joblog_jobs ++;
+
+  return (history);
+}
+
+
+/*
+ * 'open_job_journal()' - Open the job.journal file for appending.
+ */
+
+static cups_file_t *			/* O - File or NULL on error */
+open_job_journal(const char *filename)	/* I - job.journal filename */
+{
+  cups_file_t	*fp;			/* job.journal file */
+
+
+  if (journal_started)
+  {
+    if ((fp = cupsFileOpen(filename, "a")) == NULL)
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to open \"%s\": %s", filename,
+		      strerror(errno));
+
+    return (fp);
+  }
+
+ /*
+  * Start a new journal for the current job.cache file...
+  */
+
+  if ((fp = cupsFileOpen(filename, "w")) == NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to create \"%s\": %s", filename,
+		    strerror(errno));
+    return (NULL);
+  }
+
+  if (!getuid() && fchown(cupsFileNumber(fp), getuid(), Group))
+    cupsdLogMessage(CUPSD_LOG_WARN, "Unable to change group for \"%s\": %s",
+		    filename, strerror(errno));
+
+  if (fchmod(cupsFileNumber(fp), ConfigFilePerm))
+    cupsdLogMessage(CUPSD_LOG_WARN,
+		    "Unable to change permissions for \"%s\": %s",
+		    filename, strerror(errno));
+
+  cupsFilePuts(fp, "# Job journal file for " CUPS_SVERSION "\n");
+  cupsFilePrintf(fp, "Generation %d\n", job_cache_generation);
+
+  journal_started = 1;
+  journal_records = 0;
+
+  return (fp);
+}
+
+
+/*
+ * 'read_job_log()' - Copy data out of a debug log history.
+ */
+
+static void
+read_job_log(cupsd_joblog_t *history,	/* I - History */
+             size_t         pos,	/* I - Position in history */
+	     void           *data,	/* I - Data buffer */
+	     size_t         bytes)	/* I - Number of bytes */
+{
+  size_t	offset = pos % CUPSD_JOBLOG_SIZE,
+					/* Offset in buffer */
+		count = CUPSD_JOBLOG_SIZE - offset;
+					/* Bytes before the end of the buffer */
+
+
+  if (count > bytes)
+    count = bytes;
+
+  memcpy(data, history->data + offset, count);
+
+  if (count < bytes)
+    memcpy((char *)data + count, history->data, bytes - count);
+}
+
+
 /*
  * 'remove_job_files()' - Remove the document files for a job.
  */
@@ -5731,6 +6783,78 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
 }
 
 
+/*
+ * 'update_job_index()' - Update the destination and user index entries for a
+ *                        job.
+ *
+ * The destination index tracks every job for a destination plus the number
+ * of active jobs, while the user index only tracks the number of active jobs.
+ * User entries are freed once they have no active jobs, destination entries
+ * are kept until all jobs are freed.
+ */
+
+static void
+update_job_index(cupsd_job_t *job,	/* I - Job */
+                 int         active)	/* I - Is the job in ActiveJobs? */
+{
+  cupsd_jobindex_t	*dindex,	/* New destination index entry */
+			*uindex;	/* New user index entry */
+
+
+  dindex = find_job_index(&job_dests, job->dest, 1);
+  uindex = active ? find_job_index(&job_users, job->username, 1) : NULL;
+
+ /*
+  * Remove the job from the old entries...
+  */
+
+  if (job->dest_index)
+  {
+    if (job->index_active)
+      job->dest_index->num_active --;
+
+    if (job->dest_index != dindex)
+      cupsArrayRemove(job->dest_index->jobs, job);
+  }
+
+  if (job->user_index)
+  {
+    if (job->index_active)
+      job->user_index->num_active --;
+
+    if (job->user_index != uindex && job->user_index->num_active <= 0)
+    {
+      cupsArrayRemove(job_users, job->user_index);
+      cupsdClearString(&job->user_index->name);
+      free(job->user_index);
+    }
+  }
+
+ /*
+  * Then add it to the new ones...
+  */
+
+  if (dindex)
+  {
+    if (!dindex->jobs)
+      dindex->jobs = cupsArrayNew(compare_jobs, NULL);
+
+    if (dindex != job->dest_index)
+      cupsArrayAdd(dindex->jobs, job);
+
+    if (active)
+      dindex->num_active ++;
+  }
+
+  if (uindex)
+    uindex->num_active ++;
+
+  job->dest_index   = dindex;
+  job->user_index   = uindex;
+  job->index_active = active;
+}
+
+
 /*
  * 'update_job_attrs()' - Update the job-printer-* attributes.
  */
@@ -5843,3 +6967,63 @@ update_job_attrs(cupsd_job_t *job,	/* I - Job to update */
   job->dirty = 1;
   cupsdMarkDirty(CUPSD_DIRTY_JOBS);
 }
+
+
+/*
+ * 'write_job_cache()' - Write the job.cache record for a job.
+ */
+
+static void
+write_job_cache(cups_file_t *fp,	/* I - job.cache or job.journal file */
+                cupsd_job_t *job)	/* I - Job */
+{
+  int	i;				/* Looping var */
+
+
+  cupsFilePrintf(fp, "<Job %d>\n", job->id);
+  cupsFilePrintf(fp, "State %d\n", job->state_value);
+  cupsFilePrintf(fp, "Created %ld\n", (long)job->creation_time);
+  if (job->completed_time)
+    cupsFilePrintf(fp, "Completed %ld\n", (long)job->completed_time);
+  cupsFilePrintf(fp, "Priority %d\n", job->priority);
+  if (job->hold_until)
+    cupsFilePrintf(fp, "HoldUntil %ld\n", (long)job->hold_until);
+  cupsFilePrintf(fp, "Username %s\n", job->username);
+  if (job->name)
+    cupsFilePutConf(fp, "Name", job->name);
+  cupsFilePrintf(fp, "Destination %s\n", job->dest);
+  cupsFilePrintf(fp, "DestType %d\n", job->dtype);
+  cupsFilePrintf(fp, "KOctets %d\n", job->koctets);
+  cupsFilePrintf(fp, "NumFiles %d\n", job->num_files);
+  for (i = 0; i < job->num_files; i ++)
+    cupsFilePrintf(fp, "File %d %s/%s %d\n", i + 1, job->filetypes[i]->super,
+                   job->filetypes[i]->type, job->compressions[i]);
+  cupsFilePuts(fp, "</Job>\n");
+}
+
+
+/*
+ * 'write_job_log()' - Copy data into a debug log history.
+ */
+
+static void
+write_job_log(cupsd_joblog_t *history,	/* I - History */
+              const void     *data,	/* I - Data to copy */
+	      size_t         bytes)	/* I - Number of bytes */
+{
+  size_t	offset = history->head % CUPSD_JOBLOG_SIZE,
+					/* Offset in buffer */
+		count = CUPSD_JOBLOG_SIZE - offset;
+					/* Bytes before the end of the buffer */
+
+
+  if (count > bytes)
+    count = bytes;
+
+  memcpy(history->data + offset, data, count);
+
+  if (count < bytes)
+    memcpy(history->data, (const char *)data + count, bytes - count);
+
+  history->head += bytes;
+}
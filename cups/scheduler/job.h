@@ -19,6 +19,18 @@ typedef enum cupsd_jobaction_e		/**** Actions for state changes ****/
 } cupsd_jobaction_t;
 
 
+/*
+ * Job index structure...
+ */
+
+typedef struct cupsd_jobindex_s		/**** Job index entry ****/
+{
+  char			*name;		/* Destination or user name */
+  int			num_active;	/* Number of active jobs */
+  cups_array_t		*jobs;		/* Jobs for destination, sorted by ID */
+} cupsd_jobindex_t;
+
+
 /*
  * Job request structure...
  */
@@ -82,18 +94,36 @@ struct cupsd_job_s			/**** Job request ****/
                             /* AUTH_BEARER_UID environment variable */
   void			*profile,	/* Security profile for filters */
 			*bprofile;	/* Security profile for backend */
-  cups_array_t		*history;	/* Debug log history */
+  struct cupsd_joblog_s	*history;	/* Debug log history */
   int			progress;	/* Printing progress */
   int			num_keywords;	/* Number of PPD keywords */
   cups_option_t		*keywords;	/* PPD keywords */
+  cupsd_jobindex_t	*dest_index,	/* Destination index entry */
+			*user_index;	/* User index entry */
+  int			index_active;	/* Counted as active in the indexes? */
+  unsigned		cache_hash;	/* Hash of last job.cache record, 0 if
+					 * not written */
 };
 
-typedef struct cupsd_joblog_s		/**** Job log message ****/
+#define CUPSD_JOBLOG_SIZE	16384	/* Size of each debug log history */
+
+typedef struct cupsd_joblog_s		/**** Job debug log history ****/
 {
-  time_t		time;		/* Time of message */
-  char			message[1];	/* Message string */
+  struct cupsd_joblog_s	*next;		/* Next free history */
+  int			count;		/* Number of messages */
+  size_t		head,		/* Total bytes added */
+			tail;		/* Total bytes discarded */
+  char			data[CUPSD_JOBLOG_SIZE];
+					/* Ring buffer of messages */
 } cupsd_joblog_t;
 
+typedef struct cupsd_joblogstats_s	/**** Debug log history statistics ****/
+{
+  int			jobs,		/* Jobs with a history */
+			dropped;	/* Messages dropped for lack of memory */
+  size_t		size;		/* Bytes allocated for histories */
+} cupsd_joblogstats_t;
+
 
 /*
  * Globals...
@@ -119,6 +149,13 @@ VAR int			MaxJobs		VALUE(0),
 					/* Max time for a job */
 VAR int			JobAutoPurge	VALUE(0);
 					/* Automatically purge jobs */
+VAR int			OrphanPurgeBatch VALUE(0);
+					/* Orphan request files to check per
+					 * main loop iteration, 0 for all at
+					 * startup */
+VAR int			MaxDebugHistorySize VALUE(16 * 1024 * 1024);
+					/* Max memory for debug log history,
+					 * 0 for no limit */
 VAR cups_array_t	*Jobs		VALUE(NULL),
 					/* List of current jobs */
 			*ActiveJobs	VALUE(NULL),
@@ -139,7 +176,9 @@ VAR int			JobKillDelay	VALUE(DEFAULT_TIMEOUT),
  * Prototypes...
  */
 
+extern void		cupsdAddActiveJob(cupsd_job_t *job);
 extern cupsd_job_t	*cupsdAddJob(int priority, const char *dest);
+extern void		cupsdAddJobLog(cupsd_job_t *job, const char *message);
 extern void		cupsdCancelJobs(const char *dest, const char *username,
 			                int purge);
 extern void		cupsdCheckJobs(void);
@@ -147,17 +186,23 @@ extern void		cupsdCleanJobs(void);
 extern void		cupsdContinueJob(cupsd_job_t *job);
 extern void		cupsdDeleteJob(cupsd_job_t *job,
 			               cupsd_jobaction_t action);
+extern cupsd_job_t	*cupsdFindFirstJob(int id);
 extern cupsd_job_t	*cupsdFindJob(int id);
 extern void		cupsdFreeAllJobs(void);
 extern cups_array_t	*cupsdGetCompletedJobs(cupsd_printer_t *p);
+extern void		cupsdGetJobLogStats(cupsd_joblogstats_t *stats);
 extern int		cupsdGetPrinterJobCount(const char *dest);
+extern cups_array_t	*cupsdGetPrinterJobs(const char *dest);
 extern int		cupsdGetUserJobCount(const char *username);
 extern void		cupsdLoadAllJobs(void);
 extern int		cupsdLoadJob(cupsd_job_t *job);
 extern void		cupsdMoveJob(cupsd_job_t *job, cupsd_printer_t *p);
+extern int		cupsdPurgeOrphanFiles(void);
 extern void		cupsdReleaseJob(cupsd_job_t *job);
+extern void		cupsdRemoveActiveJob(cupsd_job_t *job);
 extern void		cupsdRestartJob(cupsd_job_t *job);
 extern void		cupsdSaveAllJobs(void);
+extern void		cupsdSaveChangedJobs(void);
 extern void		cupsdSaveJob(cupsd_job_t *job);
 extern void		cupsdSetJobHoldUntil(cupsd_job_t *job,
 			                     const char *when, int update);
@@ -172,4 +217,5 @@ extern void		cupsdStopAllJobs(cupsd_jobaction_t action,
 			                 int kill_delay);
 extern int		cupsdTimeoutJob(cupsd_job_t *job);
 extern void		cupsdUnloadCompletedJobs(void);
+extern void		cupsdUpdateJobIndex(cupsd_job_t *job);
 extern void		cupsdUpdateJobs(void);
@@ -51,6 +51,41 @@
 #define PWG_JobAccountingUserURI	"JAUU"
 
 
+/*
+ * Size of the log buffers used when LogFlushInterval is set...
+ */
+
+#define CUPSD_LOGBUF_SIZE	262144	/* Size of each log buffer */
+
+
+/*
+ * Seconds between entries in the access and page log indexes...
+ */
+
+#define CUPSD_LOGINDEX_INTERVAL	60
+
+
+/*
+ * Local types...
+ */
+
+typedef struct cupsd_logbuf_s		/**** Log buffer ****/
+{
+  cups_file_t	**lf;			/* Log file */
+  char		**logname;		/* Log filename */
+  char		*data;			/* Ring buffer */
+  size_t	head,			/* Total bytes queued */
+		tail;			/* Total bytes written */
+} cupsd_logbuf_t;
+
+typedef struct cupsd_logindex_s		/**** Log file index ****/
+{
+  cups_file_t	**lf;			/* Log file */
+  cups_file_t	*fp;			/* Index file */
+  time_t	next;			/* Time of next index entry */
+} cupsd_logindex_t;
+
+
 /*
  * Local globals...
  */
@@ -60,6 +95,35 @@ static _cups_mutex_t log_mutex = _CUPS_MUTEX_INITIALIZER;
 static size_t	log_linesize = 0;	/* Size of line for output file */
 static char	*log_line = NULL;	/* Line for output file */
 
+static cupsd_logbuf_t log_access = { &AccessFile, &AccessLog, NULL, 0, 0 },
+					/* Access log buffer */
+		log_error = { &ErrorFile, &ErrorLog, NULL, 0, 0 },
+					/* Error log buffer */
+		log_page = { &PageFile, &PageLog, NULL, 0, 0 };
+					/* Page log buffer */
+static cupsd_logbuf_t * const log_bufs[] =
+		{			/* Log buffers, in flush order */
+		  &log_access,
+		  &log_error,
+		  &log_page
+		};
+static cupsd_logindex_t log_indexes[] =
+		{			/* Access and page log indexes */
+		  { &AccessFile, NULL, 0 },
+		  { &PageFile, NULL, 0 }
+		};
+static _cups_cond_t log_cond = _CUPS_COND_INITIALIZER;
+					/* Condition to wake the log writer */
+static _cups_cond_t log_space_cond = _CUPS_COND_INITIALIZER;
+					/* Condition for free buffer space */
+static _cups_thread_t log_thread;	/* Log writer thread */
+static int	log_writer = 0,		/* Is the log writer running? */
+		log_stop = 0,		/* Stop the log writer? */
+		log_report = 0,		/* Report dropped/delayed lines? */
+		log_dropped = 0,	/* Number of lines dropped */
+		log_delayed = 0;	/* Number of lines delayed */
+static time_t	log_report_time = 0;	/* Time of next report */
+
 #ifdef HAVE_ASL_H
 static const int log_levels[] =		/* ASL levels... */
 		{
@@ -96,6 +160,15 @@ static const int log_levels[] =		/* SYSLOG levels... */
  */
 
 static int	format_log_line(const char *message, va_list ap);
+static void	log_copy(cupsd_logbuf_t *lb, const char *data, size_t bytes);
+static void	log_index(cups_file_t **lf);
+static char	*log_json_string(char *buffer, size_t bufsize, const char *s);
+static char	*log_json_time(char *buffer, size_t bufsize, struct timeval *t);
+static char	*log_json_value(char *buffer, size_t bufsize, char *valptr, const char *key, int quote);
+static void	log_open_index(cups_file_t **lf, const char *filename, int rotate);
+static void	log_queue(cupsd_logbuf_t *lb, const char *prefix, const char *message);
+static void	log_write(cupsd_logbuf_t *lb);
+static void	*log_writer_thread(void *arg);
 
 
 /*
@@ -243,6 +316,8 @@ cupsdCheckLogFile(cups_file_t **lf,	/* IO - Log file */
 
       fchown(cupsFileNumber(*lf), RunUser, Group);
       fchmod(cupsFileNumber(*lf), LogFilePerm);
+
+      log_open_index(lf, filename, 0);
     }
   }
 
@@ -265,6 +340,8 @@ cupsdCheckLogFile(cups_file_t **lf,	/* IO - Log file */
     unlink(backname);
     rename(filename, backname);
 
+    log_open_index(lf, filename, 1);
+
     if ((*lf = cupsFileOpen(filename, "a")) == NULL)
     {
 #ifdef HAVE_SYSTEMD_SD_JOURNAL_H
@@ -598,36 +675,7 @@ cupsdLogJob(cupsd_job_t *job,		/* I - Job */
       * Add message to the job history...
       */
 
-      cupsd_joblog_t *temp;		/* Copy of log message */
-      size_t         log_len = strlen(log_line);
-					/* Length of log message */
-
-      if ((temp = malloc(sizeof(cupsd_joblog_t) + log_len)) != NULL)
-      {
-        temp->time = time(NULL);
-	memcpy(temp->message, log_line, log_len + 1);
-      }
-
-      if (!job->history)
-	job->history = cupsArrayNew(NULL, NULL);
-
-      if (job->history && temp)
-      {
-	cupsArrayAdd(job->history, temp);
-
-	if (cupsArrayCount(job->history) > LogDebugHistory)
-	{
-	 /*
-	  * Remove excess messages...
-	  */
-
-	  temp = cupsArrayFirst(job->history);
-	  cupsArrayRemove(job->history, temp);
-	  free(temp);
-	}
-      }
-      else if (temp)
-	free(temp);
+      cupsdAddJobLog(job, log_line);
 
       return (1);
     }
@@ -770,12 +818,16 @@ int					/* O - 1 on success, 0 on error */
 cupsdLogPage(cupsd_job_t *job,		/* I - Job being printed */
              const char  *page)		/* I - Page being printed */
 {
-  int			i;		/* Looping var */
+  int			i,		/* Looping var */
+			ret = 1;	/* Return value */
   char			buffer[2048],	/* Buffer for page log */
 			*bufptr,	/* Pointer into buffer */
+			*valptr,	/* Pointer to current value */
 			name[256];	/* Attribute name */
   const char		*format,	/* Pointer into PageLogFormat */
-			*nameend;	/* End of attribute name */
+			*nameend,	/* End of attribute name */
+			*key;		/* JSON key for current value */
+  int			json;		/* Write JSON? */
   ipp_attribute_t	*attr;		/* Current attribute */
   char			number[256];	/* Page number */
   int			copies;		/* Number of copies */
@@ -792,45 +844,63 @@ cupsdLogPage(cupsd_job_t *job,		/* I - Job being printed */
   copies = 1;
   sscanf(page, "%255s%d", number, &copies);
 
-  for (format = PageLogFormat, bufptr = buffer; *format; format ++)
+  json   = LogFileFormat == CUPSD_LOGFORMAT_JSON && strcmp(PageLog, "syslog");
+  bufptr = buffer;
+
+  if (json)
+    *bufptr++ = '{';
+
+  for (format = PageLogFormat; *format; format ++)
   {
     if (*format == '%')
     {
       format ++;
 
+      valptr = bufptr;
+      key    = NULL;
+
       switch (*format)
       {
         case '%' :			/* Literal % */
-	    if (bufptr < (buffer + sizeof(buffer) - 1))
+	    if (!json && bufptr < (buffer + sizeof(buffer) - 1))
 	      *bufptr++ = '%';
 	    break;
 
         case 'p' :			/* Printer name */
+	    key = "printer";
 	    strlcpy(bufptr, job->dest, sizeof(buffer) - (size_t)(bufptr - buffer));
 	    bufptr += strlen(bufptr);
 	    break;
 
         case 'j' :			/* Job ID */
+	    key = "job-id";
 	    snprintf(bufptr, sizeof(buffer) - (size_t)(bufptr - buffer), "%d", job->id);
 	    bufptr += strlen(bufptr);
 	    break;
 
         case 'u' :			/* Username */
+	    key = "user";
 	    strlcpy(bufptr, job->username ? job->username : "-", sizeof(buffer) - (size_t)(bufptr - buffer));
 	    bufptr += strlen(bufptr);
 	    break;
 
         case 'T' :			/* Date and time */
-	    strlcpy(bufptr, cupsdGetDateTime(NULL, LogTimeFormat), sizeof(buffer) - (size_t)(bufptr - buffer));
+	    key = "time";
+	    if (json)
+	      log_json_time(bufptr, sizeof(buffer) - (size_t)(bufptr - buffer), NULL);
+	    else
+	      strlcpy(bufptr, cupsdGetDateTime(NULL, LogTimeFormat), sizeof(buffer) - (size_t)(bufptr - buffer));
 	    bufptr += strlen(bufptr);
 	    break;
 
         case 'P' :			/* Page number */
+	    key = "page";
 	    strlcpy(bufptr, number, sizeof(buffer) - (size_t)(bufptr - buffer));
 	    bufptr += strlen(bufptr);
 	    break;
 
         case 'C' :			/* Number of copies */
+	    key = "copies";
 	    snprintf(bufptr, sizeof(buffer) - (size_t)(bufptr - buffer), "%d", copies);
 	    bufptr += strlen(bufptr);
 	    break;
@@ -846,6 +916,7 @@ cupsdLogPage(cupsd_job_t *job,		/* I - Job being printed */
 	      name[nameend - format - 1] = '\0';
 
 	      format = nameend;
+	      key    = name;
 
 	      attr = ippFindAttribute(job->attrs, name, IPP_TAG_ZERO);
 	      if (!attr && !strcmp(name, "job-billing"))
@@ -937,18 +1008,31 @@ cupsdLogPage(cupsd_job_t *job,		/* I - Job being printed */
 	    }
 
         default :
-	    if (bufptr < (buffer + sizeof(buffer) - 2))
+	    if (!json && bufptr < (buffer + sizeof(buffer) - 2))
 	    {
 	      *bufptr++ = '%';
 	      *bufptr++ = *format;
 	    }
 	    break;
       }
+
+      if (json && key)
+      {
+       /*
+        * Replace the value with a "key":value pair...
+	*/
+
+	*bufptr = '\0';
+	bufptr  = log_json_value(buffer, sizeof(buffer) - 1, valptr, key, *format != 'j' && *format != 'C' && *format != 'T');
+      }
     }
-    else if (bufptr < (buffer + sizeof(buffer) - 1))
+    else if (!json && bufptr < (buffer + sizeof(buffer) - 1))
       *bufptr++ = *format;
   }
 
+  if (json)
+    *bufptr++ = '}';
+
   *bufptr = '\0';
 
 #ifdef HAVE_SYSTEMD_SD_JOURNAL_H
@@ -993,20 +1077,36 @@ cupsdLogPage(cupsd_job_t *job,		/* I - Job being printed */
   * Not using syslog; check the log file...
   */
 
-  if (!cupsdCheckLogFile(&PageFile, PageLog))
-    return (0);
+  _cupsMutexLock(&log_mutex);
 
- /*
-  * Print a page log entry of the form:
-  *
-  *    printer user job-id [DD/MON/YYYY:HH:MM:SS +TTTT] page num-copies \
-  *        billing hostname
-  */
+  if (log_writer)
+  {
+   /*
+    * Queue the page log entry for the log writer thread...
+    */
 
-  cupsFilePrintf(PageFile, "%s\n", buffer);
-  cupsFileFlush(PageFile);
+    log_queue(&log_page, NULL, buffer);
+  }
+  else if (cupsdCheckLogFile(&PageFile, PageLog))
+  {
+   /*
+    * Print a page log entry of the form:
+    *
+    *    printer user job-id [DD/MON/YYYY:HH:MM:SS +TTTT] page num-copies \
+    *        billing hostname
+    */
 
-  return (1);
+    cupsFilePrintf(PageFile, "%s\n", buffer);
+    cupsFileFlush(PageFile);
+
+    log_index(&PageFile);
+  }
+  else
+    ret = 0;
+
+  _cupsMutexUnlock(&log_mutex);
+
+  return (ret);
 }
 
 
@@ -1018,7 +1118,9 @@ int					/* O - 1 on success, 0 on error */
 cupsdLogRequest(cupsd_client_t *con,	/* I - Request to log */
                 http_status_t  code)	/* I - Response code */
 {
-  char	temp[2048];			/* Temporary string for URI */
+  int	ret = 1;			/* Return value */
+  char	temp[2048],			/* Temporary string for URI */
+	line[8192];			/* Log line */
   static const char * const states[] =	/* HTTP client states... */
 		{
 		  "WAITING",
@@ -1181,31 +1283,183 @@ cupsdLogRequest(cupsd_client_t *con,	/* I - Request to log */
   * Not using syslog; check the log file...
   */
 
-  if (!cupsdCheckLogFile(&AccessFile, AccessLog))
-    return (0);
+  if (LogFileFormat == CUPSD_LOGFORMAT_JSON)
+  {
+    char	host[1024],		/* JSON hostname */
+		user[1024],		/* JSON username */
+		uri[4096],		/* JSON URI */
+		op[256],		/* JSON operation */
+		status[256],		/* JSON status */
+		curtime[64];		/* JSON time */
+
+    snprintf(line, sizeof(line),
+             "{\"time\":%s,\"host\":%s,\"user\":%s,\"method\":\"%s\",\"uri\":%s,\"version\":\"%d.%d\",\"status\":%d,\"bytes\":" CUPS_LLFMT ",\"operation\":%s,\"status-code\":%s}",
+	     log_json_time(curtime, sizeof(curtime), &(con->start)),
+	     log_json_string(host, sizeof(host), con->http->hostname),
+	     con->username[0] != '\0' ? log_json_string(user, sizeof(user), con->username) : "null",
+	     states[con->operation],
+	     log_json_string(uri, sizeof(uri), _httpEncodeURI(temp, con->uri, sizeof(temp))),
+	     con->http->version / 100, con->http->version % 100,
+	     code, CUPS_LLCAST con->bytes,
+	     con->request ?
+	         log_json_string(op, sizeof(op), ippOpString(con->request->request.op.operation_id)) : "null",
+	     con->response ?
+	         log_json_string(status, sizeof(status), ippErrorString(con->response->request.status.status_code)) : "null");
+  }
+  else
+    snprintf(line, sizeof(line),
+             "%s - %s %s \"%s %s HTTP/%d.%d\" %d " CUPS_LLFMT " %s %s",
+	     con->http->hostname,
+	     con->username[0] != '\0' ? con->username : "-",
+	     cupsdGetDateTime(&(con->start), LogTimeFormat),
+	     states[con->operation],
+	     _httpEncodeURI(temp, con->uri, sizeof(temp)),
+	     con->http->version / 100, con->http->version % 100,
+	     code, CUPS_LLCAST con->bytes,
+	     con->request ?
+	         ippOpString(con->request->request.op.operation_id) : "-",
+	     con->response ?
+	         ippErrorString(con->response->request.status.status_code) :
+	         "-");
+
+  _cupsMutexLock(&log_mutex);
+
+  if (log_writer)
+  {
+   /*
+    * Queue the request for the log writer thread...
+    */
+
+    log_queue(&log_access, NULL, line);
+  }
+  else if (cupsdCheckLogFile(&AccessFile, AccessLog))
+  {
+   /*
+    * Write a log of the request in "common log format"...
+    */
+
+    cupsFilePrintf(AccessFile, "%s\n", line);
+    cupsFileFlush(AccessFile);
+
+    log_index(&AccessFile);
+  }
+  else
+    ret = 0;
+
+  _cupsMutexUnlock(&log_mutex);
+
+  return (ret);
+}
+
+
+/*
+ * 'cupsdStartLogWriter()' - Start the log writer thread.
+ *
+ * When LogFlushInterval is set, lines for the access, error, and page logs
+ * are queued in a buffer for each file and written by a separate thread,
+ * which flushes the files every LogFlushInterval seconds or sooner when a
+ * buffer is half full.
+ */
+
+void
+cupsdStartLogWriter(void)
+{
+  int	i;				/* Looping var */
+
+
+  if (LogFlushInterval <= 0 || log_writer)
+    return;
+
+  for (i = 0; i < (int)(sizeof(log_bufs) / sizeof(log_bufs[0])); i ++)
+  {
+    if ((log_bufs[i]->data = malloc(CUPSD_LOGBUF_SIZE)) == NULL)
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to allocate memory for log buffers.");
+
+      while (i > 0)
+      {
+        i --;
+        free(log_bufs[i]->data);
+        log_bufs[i]->data = NULL;
+      }
+      return;
+    }
+
+    log_bufs[i]->head = log_bufs[i]->tail = 0;
+  }
+
+  _cupsMutexLock(&log_mutex);
+
+  log_stop        = 0;
+  log_report      = 0;
+  log_report_time = 0;
+  log_dropped     = 0;
+  log_delayed     = 0;
+
+  if ((log_thread = _cupsThreadCreate((_cups_thread_func_t)log_writer_thread, NULL)) != 0)
+    log_writer = 1;
+
+  _cupsMutexUnlock(&log_mutex);
+
+  if (!log_writer)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to start log writer thread.");
+
+    for (i = 0; i < (int)(sizeof(log_bufs) / sizeof(log_bufs[0])); i ++)
+    {
+      free(log_bufs[i]->data);
+      log_bufs[i]->data = NULL;
+    }
+    return;
+  }
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG, "Started log writer, flushing every %d seconds.", LogFlushInterval);
+}
+
+
+/*
+ * 'cupsdStopLogWriter()' - Stop the log writer thread.
+ *
+ * Any queued lines are written before the thread exits, after which logging
+ * goes directly to the log files again.
+ */
+
+void
+cupsdStopLogWriter(void)
+{
+  int	i;				/* Looping var */
+
+
+  if (!log_writer)
+    return;
+
+  _cupsMutexLock(&log_mutex);
+  log_stop = 1;
+  _cupsCondBroadcast(&log_cond);
+  _cupsMutexUnlock(&log_mutex);
+
+  _cupsThreadWait(log_thread);
 
  /*
-  * Write a log of the request in "common log format"...
+  * Wake any thread still waiting for buffer space so it writes directly to
+  * the log file, then free the buffers while nobody can be copying into
+  * them...
   */
 
-  cupsFilePrintf(AccessFile,
-                 "%s - %s %s \"%s %s HTTP/%d.%d\" %d " CUPS_LLFMT " %s %s\n",
-        	 con->http->hostname,
-		 con->username[0] != '\0' ? con->username : "-",
-		 cupsdGetDateTime(&(con->start), LogTimeFormat),
-		 states[con->operation],
-		 _httpEncodeURI(temp, con->uri, sizeof(temp)),
-		 con->http->version / 100, con->http->version % 100,
-		 code, CUPS_LLCAST con->bytes,
-		 con->request ?
-		     ippOpString(con->request->request.op.operation_id) : "-",
-		 con->response ?
-		     ippErrorString(con->response->request.status.status_code) :
-		     "-");
-
-  cupsFileFlush(AccessFile);
+  _cupsMutexLock(&log_mutex);
+
+  _cupsCondBroadcast(&log_space_cond);
 
-  return (1);
+  for (i = 0; i < (int)(sizeof(log_bufs) / sizeof(log_bufs[0])); i ++)
+  {
+    free(log_bufs[i]->data);
+    log_bufs[i]->data = NULL;
+  }
+
+  _cupsMutexUnlock(&log_mutex);
+
+  if (log_dropped || log_delayed)
+    cupsdLogMessage(CUPSD_LOG_WARN, "Log buffers were full: %d lines dropped, %d lines delayed.", log_dropped, log_delayed);
 }
 
 
@@ -1218,6 +1472,7 @@ cupsdWriteErrorLog(int        level,	/* I - Log level */
                    const char *message)	/* I - Message string */
 {
   int		ret = 1;		/* Return value */
+  char		prefix[256];		/* Line prefix for log writer */
   static const char	levels[] =	/* Log levels... */
 		{
 		  ' ',
@@ -1258,7 +1513,31 @@ cupsdWriteErrorLog(int        level,	/* I - Log level */
 
   _cupsMutexLock(&log_mutex);
 
-  if (!cupsdCheckLogFile(&ErrorFile, ErrorLog))
+  if (log_writer)
+  {
+   /*
+    * Queue the log message for the log writer thread, preceded by a report
+    * of any lines that had to be dropped or delayed (at most once per flush
+    * interval)...
+    */
+
+    if (log_report && time(NULL) >= log_report_time)
+    {
+      char	report[256];		/* Report message */
+
+      snprintf(prefix, sizeof(prefix), "W %s ", cupsdGetDateTime(NULL, LogTimeFormat));
+      snprintf(report, sizeof(report), "Log buffers full: %d lines dropped, %d lines delayed so far.", log_dropped, log_delayed);
+
+      log_report      = 0;
+      log_report_time = time(NULL) + LogFlushInterval;
+
+      log_queue(&log_error, prefix, report);
+    }
+
+    snprintf(prefix, sizeof(prefix), "%c %s ", levels[level], cupsdGetDateTime(NULL, LogTimeFormat));
+    log_queue(&log_error, prefix, message);
+  }
+  else if (!cupsdCheckLogFile(&ErrorFile, ErrorLog))
   {
     ret = 0;
   }
@@ -1341,3 +1620,424 @@ format_log_line(const char *message,	/* I - Printf-style format string */
 
   return (1);
 }
+
+
+/*
+ * 'log_copy()' - Copy data into a log buffer.
+ *
+ * The log mutex must be held and the buffer must have room for the data.
+ */
+
+static void
+log_copy(cupsd_logbuf_t *lb,		/* I - Log buffer */
+         const char     *data,		/* I - Data to copy */
+	 size_t         bytes)		/* I - Number of bytes */
+{
+  size_t	offset = lb->head % CUPSD_LOGBUF_SIZE,
+					/* Offset in buffer */
+		count = CUPSD_LOGBUF_SIZE - offset;
+					/* Bytes before the end of the buffer */
+
+
+  if (count > bytes)
+    count = bytes;
+
+  memcpy(lb->data + offset, data, count);
+
+  if (count < bytes)
+    memcpy(lb->data, data + count, bytes - count);
+
+  lb->head += bytes;
+}
+
+
+/*
+ * 'log_index()' - Add an entry to the index of a log file as needed.
+ *
+ * Each line of the index holds a UNIX time and the size of the log file at
+ * that time, so everything before that offset was logged by then.
+ */
+
+static void
+log_index(cups_file_t **lf)		/* I - Log file */
+{
+  int			i;		/* Looping var */
+  cupsd_logindex_t	*li;		/* Log index */
+  time_t		curtime;	/* Current time */
+
+
+  for (i = (int)(sizeof(log_indexes) / sizeof(log_indexes[0])), li = log_indexes; i > 0; i --, li ++)
+    if (li->lf == lf)
+      break;
+
+  if (i == 0 || !li->fp || (curtime = time(NULL)) < li->next)
+    return;
+
+  cupsFilePrintf(li->fp, "%ld " CUPS_LLFMT "\n", (long)curtime, CUPS_LLCAST cupsFileTell(*lf));
+  cupsFileFlush(li->fp);
+
+  li->next = curtime + CUPSD_LOGINDEX_INTERVAL;
+}
+
+
+/*
+ * 'log_json_string()' - Quote a string for a JSON log line.
+ *
+ * Long strings are truncated so that the result is always a valid JSON
+ * string.
+ */
+
+static char *				/* O - Quoted string */
+log_json_string(char       *buffer,	/* I - String buffer */
+                size_t     bufsize,	/* I - Size of string buffer */
+		const char *s)		/* I - String to quote */
+{
+  char		*bufptr,		/* Pointer into buffer */
+		*bufend;		/* End of buffer, less closing quote */
+  static const char hex[] = "0123456789abcdef";
+					/* Hex digits */
+
+
+  bufptr = buffer;
+  bufend = buffer + bufsize - 2;
+
+  *bufptr++ = '\"';
+
+  for (; *s; s ++)
+  {
+    if (*s == '\"' || *s == '\\')
+    {
+      if ((bufptr + 2) > bufend)
+        break;
+
+      *bufptr++ = '\\';
+      *bufptr++ = *s;
+    }
+    else if ((*s & 255) < ' ')
+    {
+      if ((bufptr + 6) > bufend)
+        break;
+
+      *bufptr++ = '\\';
+      *bufptr++ = 'u';
+      *bufptr++ = '0';
+      *bufptr++ = '0';
+      *bufptr++ = hex[(*s >> 4) & 15];
+      *bufptr++ = hex[*s & 15];
+    }
+    else
+    {
+      if (bufptr >= bufend)
+        break;
+
+      *bufptr++ = *s;
+    }
+  }
+
+  *bufptr++ = '\"';
+  *bufptr   = '\0';
+
+  return (buffer);
+}
+
+
+/*
+ * 'log_json_time()' - Format a time for a JSON log line.
+ *
+ * Times are written as UNIX time, with microseconds when LogTimeFormat is
+ * "usecs".
+ */
+
+static char *				/* O - Formatted time */
+log_json_time(char           *buffer,	/* I - String buffer */
+              size_t         bufsize,	/* I - Size of string buffer */
+	      struct timeval *t)	/* I - Time value or @code NULL@ for current */
+{
+  struct timeval	curtime;	/* Current time value */
+
+
+  if (!t)
+  {
+    gettimeofday(&curtime, NULL);
+    t = &curtime;
+  }
+
+  if (LogTimeFormat == CUPSD_TIME_USECS)
+    snprintf(buffer, bufsize, "%ld.%06d", (long)t->tv_sec, (int)t->tv_usec);
+  else
+    snprintf(buffer, bufsize, "%ld", (long)t->tv_sec);
+
+  return (buffer);
+}
+
+
+/*
+ * 'log_json_value()' - Replace a page log value with a JSON "key":value pair.
+ *
+ * The pair is dropped if it does not fit in the buffer.
+ */
+
+static char *				/* O - New end of line */
+log_json_value(char       *buffer,	/* I - Line buffer */
+               size_t     bufsize,	/* I - Size of line buffer */
+	       char       *valptr,	/* I - Value in line buffer */
+	       const char *key,		/* I - Key for value */
+	       int        quote)	/* I - Quote the value? */
+{
+  char		value[2048],		/* Copy of value */
+		pair[4096],		/* "key":value pair */
+		*pairptr;		/* Pointer into pair */
+  size_t	len;			/* Length of pair */
+
+
+  strlcpy(value, valptr, sizeof(value));
+
+  pairptr = pair;
+
+  if (valptr > (buffer + 1))
+    *pairptr++ = ',';
+
+  log_json_string(pairptr, sizeof(pair) - (size_t)(pairptr - pair) - 1, key);
+  pairptr += strlen(pairptr);
+  *pairptr++ = ':';
+
+  if (quote)
+    log_json_string(pairptr, sizeof(pair) - (size_t)(pairptr - pair), value);
+  else
+    strlcpy(pairptr, value[0] ? value : "null", sizeof(pair) - (size_t)(pairptr - pair));
+
+  if ((len = strlen(pair)) >= (bufsize - (size_t)(valptr - buffer)))
+  {
+    *valptr = '\0';
+    return (valptr);
+  }
+
+  memcpy(valptr, pair, len + 1);
+
+  return (valptr + len);
+}
+
+
+/*
+ * 'log_open_index()' - Open the index for a log file, rotating it as needed.
+ */
+
+static void
+log_open_index(cups_file_t **lf,	/* I - Log file */
+               const char  *filename,	/* I - Log filename */
+	       int         rotate)	/* I - Rotate the index? */
+{
+  int			i;		/* Looping var */
+  cupsd_logindex_t	*li;		/* Log index */
+  char			idxname[1024],	/* Index filename */
+			backname[1024];	/* Backup index filename */
+
+
+  for (i = (int)(sizeof(log_indexes) / sizeof(log_indexes[0])), li = log_indexes; i > 0; i --, li ++)
+    if (li->lf == lf)
+      break;
+
+  if (i == 0)
+    return;
+
+  if (li->fp)
+  {
+    cupsFileClose(li->fp);
+    li->fp = NULL;
+  }
+
+  li->next = 0;
+
+  snprintf(idxname, sizeof(idxname), "%s.idx", filename);
+
+  if (rotate)
+  {
+    snprintf(backname, sizeof(backname), "%s.O.idx", filename);
+
+    unlink(backname);
+    rename(idxname, backname);
+  }
+
+  if (LogFileFormat != CUPSD_LOGFORMAT_JSON)
+    return;
+
+  if ((li->fp = cupsFileOpen(idxname, "a")) != NULL)
+  {
+    fchown(cupsFileNumber(li->fp), RunUser, Group);
+    fchmod(cupsFileNumber(li->fp), LogFilePerm);
+  }
+}
+
+
+/*
+ * 'log_queue()' - Queue a line for the log writer thread.
+ *
+ * The log mutex must be held.  When the buffer is full the line is dropped or
+ * the caller waits for the log writer, depending on LogBufferFull.  If the log
+ * writer stops while waiting, the line is written directly to the log file.
+ */
+
+static void
+log_queue(cupsd_logbuf_t *lb,		/* I - Log buffer */
+          const char     *prefix,	/* I - Line prefix or @code NULL@ */
+	  const char     *message)	/* I - Message */
+{
+  size_t	prefixlen,		/* Length of prefix */
+		messagelen,		/* Length of message */
+		len;			/* Length of line */
+  int		delayed = 0;		/* Was this line delayed? */
+
+
+  prefixlen  = prefix ? strlen(prefix) : 0;
+  messagelen = strlen(message);
+
+  if ((len = prefixlen + messagelen + 1) > CUPSD_LOGBUF_SIZE)
+  {
+    messagelen = CUPSD_LOGBUF_SIZE - prefixlen - 1;
+    len        = CUPSD_LOGBUF_SIZE;
+  }
+
+  while ((CUPSD_LOGBUF_SIZE - (lb->head - lb->tail)) < len)
+  {
+   /*
+    * Drop the line when asked to, or when the log writer itself is logging
+    * since nobody else will make room for it...
+    */
+
+    if (LogBufferFull == CUPSD_LOGFULL_DROP || _cupsThreadIsSelf(log_thread))
+    {
+      log_dropped ++;
+      log_report = 1;
+      return;
+    }
+
+    if (!delayed)
+    {
+      delayed = 1;
+      log_delayed ++;
+      log_report = 1;
+    }
+
+    _cupsCondBroadcast(&log_cond);
+    _cupsCondWait(&log_space_cond, &log_mutex, 0.0);
+
+    if (!log_writer)
+    {
+     /*
+      * The log writer has stopped and its buffers are about to be freed...
+      */
+
+      if (cupsdCheckLogFile(lb->lf, *(lb->logname)))
+      {
+        cupsFilePrintf(*(lb->lf), "%s%s\n", prefix ? prefix : "", message);
+        cupsFileFlush(*(lb->lf));
+
+        log_index(lb->lf);
+      }
+      return;
+    }
+  }
+
+  if (prefixlen)
+    log_copy(lb, prefix, prefixlen);
+
+  log_copy(lb, message, messagelen);
+  log_copy(lb, "\n", 1);
+
+  if ((lb->head - lb->tail) >= CUPSD_LOGBUF_SIZE / 2)
+    _cupsCondBroadcast(&log_cond);
+}
+
+
+/*
+ * 'log_write()' - Write the queued lines in a log buffer.
+ *
+ * The log mutex must be held; it is released while writing to the log file
+ * since the queued data is not touched by other threads until the buffer
+ * tail moves.
+ */
+
+static void
+log_write(cupsd_logbuf_t *lb)		/* I - Log buffer */
+{
+  size_t	head = lb->head,	/* End of queued data */
+		tail = lb->tail,	/* Start of queued data */
+		offset,			/* Offset in buffer */
+		bytes;			/* Bytes to write */
+
+
+  if (head == tail)
+    return;
+
+  _cupsMutexUnlock(&log_mutex);
+
+  if (cupsdCheckLogFile(lb->lf, *(lb->logname)))
+  {
+    while (tail < head)
+    {
+      offset = tail % CUPSD_LOGBUF_SIZE;
+      bytes  = CUPSD_LOGBUF_SIZE - offset;
+
+      if (bytes > (head - tail))
+        bytes = head - tail;
+
+      cupsFileWrite(*(lb->lf), lb->data + offset, bytes);
+      tail += bytes;
+    }
+
+    cupsFileFlush(*(lb->lf));
+
+    log_index(lb->lf);
+  }
+
+  _cupsMutexLock(&log_mutex);
+
+  lb->tail = head;
+
+  _cupsCondBroadcast(&log_space_cond);
+}
+
+
+/*
+ * 'log_writer_thread()' - Write queued log lines.
+ */
+
+static void *				/* O - Exit status */
+log_writer_thread(void *arg)		/* I - Argument (unused) */
+{
+  int	i,				/* Looping var */
+	pending;			/* Are lines still queued? */
+
+
+  (void)arg;
+
+  _cupsMutexLock(&log_mutex);
+
+  for (;;)
+  {
+    if (!log_stop)
+      _cupsCondWait(&log_cond, &log_mutex, LogFlushInterval);
+
+    for (i = 0, pending = 0; i < (int)(sizeof(log_bufs) / sizeof(log_bufs[0])); i ++)
+    {
+      log_write(log_bufs[i]);
+
+      if (log_bufs[i]->head != log_bufs[i]->tail)
+        pending = 1;
+    }
+
+    if (log_stop && !pending)
+      break;
+  }
+
+ /*
+  * Everything has been written, so log directly to the files from now on...
+  */
+
+  log_writer = 0;
+
+  _cupsCondBroadcast(&log_space_cond);
+  _cupsMutexUnlock(&log_mutex);
+
+  return (NULL);
+}
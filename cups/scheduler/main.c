@@ -109,6 +109,8 @@ main(int  argc,				/* I - Number of command-line args */
 			print_profile = 0;
 					/* Print the sandbox profile to stdout? */
   int			fds;		/* Number of ready descriptors */
+  int			purge_orphans = 1;
+					/* Orphan request files to purge? */
   cupsd_client_t	*con;		/* Current client */
   cupsd_job_t		*job;		/* Current job */
   cupsd_listener_t	*lis;		/* Current listener */
@@ -782,6 +784,9 @@ main(int  argc,				/* I - Number of command-line args */
     if ((timeout = select_timeout(fds)) > 1 && LastEvent)
       timeout = 1;
 
+    if (purge_orphans)
+      timeout = 0;
+
 #ifdef HAVE_ONDEMAND
    /*
     * If no other work is scheduled and we're being controlled by launchd,
@@ -981,6 +986,12 @@ main(int  argc,				/* I - Number of command-line args */
     if (JobHistoryUpdate && current_time >= JobHistoryUpdate)
       cupsdCleanJobs();
 
+   /*
+    * Purge orphaned request files in the background as needed...
+    */
+
+    purge_orphans = cupsdPurgeOrphanFiles();
+
    /*
     * Update any pending multi-file documents...
     */
@@ -1000,10 +1011,11 @@ main(int  argc,				/* I - Number of command-line args */
 	 con = (cupsd_client_t *)cupsArrayNext(Clients))
     {
      /*
-      * Process pending data in the input buffer...
+      * Process pending data in the input buffer, unless it is a pipelined
+      * request that has to wait for the current response to be sent...
       */
 
-      if (httpGetReady(con->http))
+      if (httpGetReady(con->http) && httpGetState(con->http) != HTTP_STATE_GET_SEND && httpGetState(con->http) != HTTP_STATE_POST_SEND && httpGetState(con->http) != HTTP_STATE_STATUS)
       {
         cupsdReadClient(con);
 	continue;
@@ -1032,6 +1044,10 @@ main(int  argc,				/* I - Number of command-line args */
       size_t		string_count,	/* String count */
 			alloc_bytes,	/* Allocated string bytes */
 			total_bytes;	/* Total string bytes */
+#ifdef HAVE_SSL
+      size_t		tls_full,	/* Full TLS handshakes */
+			tls_resumed;	/* Resumed TLS handshakes */
+#endif /* HAVE_SSL */
 #ifdef HAVE_MALLINFO
       struct mallinfo	mem;		/* Malloc information */
 
@@ -1064,6 +1080,16 @@ main(int  argc,				/* I - Number of command-line args */
                       "Report: stringpool-total-bytes=" CUPS_LLFMT,
 		      CUPS_LLCAST total_bytes);
 
+#ifdef HAVE_SSL
+      _httpTLSGetStatistics(&tls_full, &tls_resumed);
+      cupsdLogMessage(CUPSD_LOG_DEBUG,
+                      "Report: tls-full-handshakes=" CUPS_LLFMT,
+		      CUPS_LLCAST tls_full);
+      cupsdLogMessage(CUPSD_LOG_DEBUG,
+                      "Report: tls-resumed-handshakes=" CUPS_LLFMT,
+		      CUPS_LLCAST tls_resumed);
+#endif /* HAVE_SSL */
+
       report_time = current_time;
     }
 
@@ -1518,7 +1544,7 @@ process_children(void)
 	  for (i = 0; job->filters[i] < 0; i++);
 
 	  if (!job->filters[i] && job->backend <= 0)
-	    cupsArrayRemove(ActiveJobs, job);
+	    cupsdRemoveActiveJob(job);
 	}
 	else if (job->current_file < job->num_files && job->printer)
 	{
@@ -26,7 +26,10 @@ extern "C" {
  * Prototypes...
  */
 
+extern void	_mimeCompileTypes(mime_t *mime, int dispatch);
 extern void	_mimeError(mime_t *mime, const char *format, ...) _CUPS_FORMAT(2, 3);
+extern void	_mimeFlushFilterPaths(mime_t *mime, mime_type_t *type);
+extern void	_mimeFreeTypeIndex(mime_t *mime);
 
 extern mime_type_t  *mimeFileTypeFD(mime_t *mime, int fd, const char *filename);
 
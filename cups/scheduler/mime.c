@@ -88,6 +88,9 @@ mimeDelete(mime_t *mime)		/* I - MIME database */
   * Free the types and filters arrays, and then the MIME database structure.
   */
 
+  _mimeFreeTypeIndex(mime);
+  _mimeFlushFilterPaths(mime, NULL);
+
   cupsArrayDelete(mime->types);
   cupsArrayDelete(mime->filters);
   cupsArrayDelete(mime->srcs);
@@ -121,6 +124,13 @@ mimeDeleteFilter(mime_t        *mime,	/* I - MIME database */
 #endif /* DEBUG */
 
   cupsArrayRemove(mime->filters, filter);
+
+ /*
+  * Flush the cached paths that might use this filter...
+  */
+
+  _mimeFlushFilterPaths(mime, filter->dst);
+
   free(filter);
 
  /*
@@ -158,6 +168,14 @@ mimeDeleteType(mime_t      *mime,	/* I - MIME database */
 
   cupsArrayRemove(mime->types, mt);
 
+ /*
+  * Deleting a type invalidates the compiled type rules used by
+  * mimeFileType() and the cached filter paths that use the type...
+  */
+
+  _mimeFreeTypeIndex(mime);
+  _mimeFlushFilterPaths(mime, mt);
+
   mime_delete_rules(mt->rules);
   free(mt);
 }
@@ -398,6 +416,13 @@ mimeLoadTypes(mime_t     *mime,		/* I - MIME database or @code NULL@ to create a
 
   cupsDirClose(dir);
 
+ /*
+  * Compile the type rules now so the first file to be typed doesn't pay for
+  * it...
+  */
+
+  _mimeCompileTypes(mime, 1);
+
   DEBUG_printf(("1mimeLoadTypes: Returning %p.", mime));
 
   return (mime);
@@ -104,8 +104,10 @@ typedef struct _mime_s			/**** MIME Database ****/
   cups_array_t		*types;		/* File types */
   cups_array_t		*filters;	/* Type conversion filters */
   cups_array_t		*srcs;		/* Filters sorted by source type */
+  cups_array_t		*paths;		/* Cached filter paths by destination */
   mime_error_cb_t	error_cb;	/* Error message callback */
   void			*error_ctx;	/* Pointer for callback */
+  struct _mime_typeindex_s *typeindex;	/* Compiled type rules */
 } mime_t;
 
 
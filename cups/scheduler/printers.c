@@ -41,7 +41,10 @@ static void	add_printer_defaults(cupsd_printer_t *p);
 static void	add_printer_filter(cupsd_printer_t *p, mime_type_t *type,
 				   const char *filter);
 static void	add_printer_formats(cupsd_printer_t *p);
+static int	compare_attr_cache(cupsd_attrcache_t *a, cupsd_attrcache_t *b,
+		                   void *data);
 static int	compare_printers(void *first, void *second, void *data);
+static void	free_attr_cache(cupsd_attrcache_t *cache, void *data);
 static void	delete_printer_filters(cupsd_printer_t *p);
 static void	dirty_printer(cupsd_printer_t *p);
 static void	load_ppd(cupsd_printer_t *p);
@@ -125,6 +128,54 @@ cupsdAddPrinter(const char *name)	/* I - Name of printer */
 }
 
 
+/*
+ * 'cupsdCachePrinterAttrs()' - Cache encoded printer attributes.
+ *
+ * The cache takes ownership of "data".  Each printer keeps a limited number of
+ * entries, keyed by the IPP version and requested attributes of the request.
+ */
+
+void
+cupsdCachePrinterAttrs(
+    cupsd_printer_t *p,			/* I - Printer */
+    const char      *key,		/* I - Cache key */
+    void            *data,		/* I - Encoded attributes */
+    size_t          datalen)		/* I - Length of encoded attributes */
+{
+  cupsd_attrcache_t	*cache;		/* New cache entry */
+
+
+  if (!p->attr_cache)
+  {
+    if ((p->attr_cache = cupsArrayNew3((cups_array_func_t)compare_attr_cache, NULL, NULL, 0, NULL, (cups_afree_func_t)free_attr_cache)) == NULL)
+    {
+      free(data);
+      return;
+    }
+  }
+  else if (cupsArrayCount(p->attr_cache) >= 16)
+  {
+   /*
+    * Too many different requests, start over...
+    */
+
+    cupsArrayClear(p->attr_cache);
+  }
+
+  if ((cache = calloc(1, sizeof(cupsd_attrcache_t))) == NULL || (cache->key = strdup(key)) == NULL)
+  {
+    free(cache);
+    free(data);
+    return;
+  }
+
+  cache->data    = data;
+  cache->datalen = datalen;
+
+  cupsArrayAdd(p->attr_cache, cache);
+}
+
+
 /*
  * 'cupsdCreateCommonData()' - Create the common printer data.
  */
@@ -389,7 +440,20 @@ cupsdCreateCommonData(void)
 
 
   if (CommonData)
+  {
+    cupsd_printer_t	*printer;	/* Current printer */
+
+   /*
+    * IPP worker threads may still be copying the old common data...
+    */
+
+    cupsdWaitIPPThreads();
+
+    for (printer = (cupsd_printer_t *)cupsArrayFirst(Printers); printer; printer = (cupsd_printer_t *)cupsArrayNext(Printers))
+      cupsdFlushPrinterAttrCache(printer);
+
     ippDelete(CommonData);
+  }
 
   CommonData = ippNew();
 
@@ -730,6 +794,13 @@ cupsdDeletePrinter(
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdDeletePrinter(p=%p(%s), update=%d)",
                   p, p->name, update);
 
+ /*
+  * Make sure no IPP worker thread is still copying this printer's
+  * attributes...
+  */
+
+  cupsdWaitIPPThreads();
+
  /*
   * Save the current position in the Printers array...
   */
@@ -821,6 +892,7 @@ cupsdDeletePrinter(
 
   ippDelete(p->attrs);
   ippDelete(p->ppd_attrs);
+  cupsArrayDelete(p->attr_cache);
 
   mimeDeleteType(MimeDatabase, p->filetype);
   mimeDeleteType(MimeDatabase, p->prefiltertype);
@@ -898,6 +970,24 @@ cupsdDeleteTemporaryPrinters(int force) /* I - Force deletion instead of auto? *
 }
 
 
+/*
+ * 'cupsdFindCachedPrinterAttrs()' - Find cached printer attributes.
+ */
+
+cupsd_attrcache_t *			/* O - Cache entry or `NULL` */
+cupsdFindCachedPrinterAttrs(
+    cupsd_printer_t *p,			/* I - Printer */
+    const char      *key)		/* I - Cache key */
+{
+  cupsd_attrcache_t	search;		/* Search key */
+
+
+  search.key = (char *)key;
+
+  return ((cupsd_attrcache_t *)cupsArrayFind(p->attr_cache, &search));
+}
+
+
 /*
  * 'cupsdFindDest()' - Find a destination in the list.
  */
@@ -930,6 +1020,22 @@ cupsdFindPrinter(const char *name)	/* I - Name of printer to find */
 }
 
 
+/*
+ * 'cupsdFlushPrinterAttrCache()' - Discard cached printer attributes.
+ *
+ * This must be called whenever the static attributes of the printer change.
+ */
+
+void
+cupsdFlushPrinterAttrCache(
+    cupsd_printer_t *p)			/* I - Printer */
+{
+  cupsArrayClear(p->attr_cache);
+
+  p->attr_cache_gen ++;
+}
+
+
 /*
  * 'cupsdLoadAllPrinters()' - Load printers from the printers.conf file.
  */
@@ -2088,9 +2194,14 @@ cupsdSetPrinterAttr(
   }
 
  /*
-  * Then add or update the attribute as needed...
+  * Then add or update the attribute as needed, holding the printer lock for
+  * any IPP worker threads...
   */
 
+  _cupsRWLockWrite(&p->lock);
+
+  cupsdFlushPrinterAttrCache(p);
+
   if (!strcmp(name, "marker-levels") || !strcmp(name, "marker-low-levels") ||
       !strcmp(name, "marker-high-levels"))
   {
@@ -2113,6 +2224,7 @@ cupsdSetPrinterAttr(
 
     if (!attr)
     {
+      _cupsRWUnlock(&p->lock);
       free(temp);
       cupsdLogMessage(CUPSD_LOG_ERROR,
                       "Unable to allocate memory for printer attribute "
@@ -2164,6 +2276,7 @@ cupsdSetPrinterAttr(
 
     if (!attr)
     {
+      _cupsRWUnlock(&p->lock);
       free(temp);
       cupsdLogMessage(CUPSD_LOG_ERROR,
                       "Unable to allocate memory for printer attribute "
@@ -2243,11 +2356,17 @@ cupsdSetPrinterAttr(
     }
 
     if (!colors || !levels || !types)
+    {
+      _cupsRWUnlock(&p->lock);
       return;
+    }
 
     count = ippGetCount(colors);
     if (count != ippGetCount(levels) || count != ippGetCount(types))
+    {
+      _cupsRWUnlock(&p->lock);
       return;
+    }
 
     for (i = 0; i < count; i ++)
     {
@@ -2273,6 +2392,8 @@ cupsdSetPrinterAttr(
         ippSetOctetString(p->attrs, &supply, i, buffer, (int)strlen(buffer));
     }
   }
+
+  _cupsRWUnlock(&p->lock);
 }
 
 
@@ -2302,6 +2423,8 @@ cupsdSetPrinterAttrs(cupsd_printer_t *p)/* I - Printer to setup */
 
   _cupsRWLockWrite(&p->lock);
 
+  cupsdFlushPrinterAttrCache(p);
+
  /*
   * Clear out old filters, if any...
   */
@@ -3798,6 +3921,22 @@ add_printer_formats(cupsd_printer_t *p)	/* I - Printer */
 }
 
 
+/*
+ * 'compare_attr_cache()' - Compare two attribute cache entries.
+ */
+
+static int				/* O - Result of comparison */
+compare_attr_cache(
+    cupsd_attrcache_t *a,		/* I - First cache entry */
+    cupsd_attrcache_t *b,		/* I - Second cache entry */
+    void              *data)		/* I - App data (not used) */
+{
+  (void)data;
+
+  return (strcmp(a->key, b->key));
+}
+
+
 /*
  * 'compare_printers()' - Compare two printers.
  */
@@ -3882,6 +4021,23 @@ dirty_printer(cupsd_printer_t *p)	/* I - Printer */
 }
 
 
+/*
+ * 'free_attr_cache()' - Free an attribute cache entry.
+ */
+
+static void
+free_attr_cache(
+    cupsd_attrcache_t *cache,		/* I - Cache entry */
+    void              *data)		/* I - App data (not used) */
+{
+  (void)data;
+
+  free(cache->key);
+  free(cache->data);
+  free(cache);
+}
+
+
 /*
  * 'load_ppd()' - Load a cached PPD file, updating the cache as needed.
  */
@@ -31,6 +31,18 @@ typedef struct
 } cupsd_quota_t;
 
 
+/*
+ * Cached printer attributes...
+ */
+
+typedef struct
+{
+  char		*key;			/* IPP version and requested attributes */
+  void		*data;			/* Encoded attributes */
+  size_t	datalen;		/* Length of encoded attributes */
+} cupsd_attrcache_t;
+
+
 /*
  * DNS-SD types to make the code cleaner/clearer...
  */
@@ -94,6 +106,8 @@ struct cupsd_printer_s
   cupsd_job_t	*job;			/* Current job in queue */
   ipp_t		*attrs,			/* Attributes supported by this printer */
 		*ppd_attrs;		/* Attributes based on the PPD */
+  cups_array_t	*attr_cache;		/* Encoded Get-Printer-Attributes data */
+  int		attr_cache_gen;		/* Generation of cached attributes */
   int		num_printers,		/* Number of printers in class */
 		last_printer;		/* Last printer job was sent to */
   struct cupsd_printer_s **printers;	/* Printers in class */
@@ -157,14 +171,20 @@ VAR cupsd_policy_t	*DefaultPolicyPtr
  */
 
 extern cupsd_printer_t	*cupsdAddPrinter(const char *name);
+extern void		cupsdCachePrinterAttrs(cupsd_printer_t *p,
+			                       const char *key, void *data,
+					       size_t datalen);
 extern void		cupsdCreateCommonData(void);
 extern void		cupsdDeleteAllPrinters(void);
 extern int		cupsdDeletePrinter(cupsd_printer_t *p, int update);
 extern void             cupsdDeleteTemporaryPrinters(int force);
+extern cupsd_attrcache_t	*cupsdFindCachedPrinterAttrs(cupsd_printer_t *p,
+			                             const char *key);
 extern cupsd_printer_t	*cupsdFindDest(const char *name);
 extern cupsd_printer_t	*cupsdFindPrinter(const char *name);
 extern cupsd_quota_t	*cupsdFindQuota(cupsd_printer_t *p,
 			                const char *username);
+extern void		cupsdFlushPrinterAttrCache(cupsd_printer_t *p);
 extern void		cupsdFreeQuotas(cupsd_printer_t *p);
 extern void		cupsdLoadAllPrinters(void);
 extern void		cupsdRenamePrinter(cupsd_printer_t *p,
@@ -87,6 +87,7 @@ cupsdUpdateQuota(
     int             k)			/* I - Number of kilobytes */
 {
   cupsd_quota_t		*q;		/* Quota data */
+  cups_array_t		*jobs;		/* Jobs for printer */
   cupsd_job_t		*job;		/* Current job */
   time_t		curtime;	/* Current time */
   ipp_attribute_t	*attr;		/* Job attribute */
@@ -124,16 +125,17 @@ cupsdUpdateQuota(
   q->page_count  = 0;
   q->k_count     = 0;
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
+  jobs = cupsdGetPrinterJobs(p->name);
+
+  for (job = (cupsd_job_t *)cupsArrayFirst(jobs);
        job;
-       job = (cupsd_job_t *)cupsArrayNext(Jobs))
+       job = (cupsd_job_t *)cupsArrayNext(jobs))
   {
    /*
-    * We only care about the current printer/class and user...
+    * We only care about the current user...
     */
 
-    if (_cups_strcasecmp(job->dest, p->name) != 0 ||
-        _cups_strcasecmp(job->username, q->username) != 0)
+    if (_cups_strcasecmp(job->username, q->username) != 0)
       continue;
 
    /*
@@ -56,46 +56,51 @@
  *                         cupsd_selfunc_t write_cb, void *data);
  *     void cupsdRemoveSelect(int fd);
  *     int cupsdDoSelect(int timeout);
+ *     int cupsdSetSelectBackend(const char *backend);
  *
  *
  * IMPLEMENTATION STRATEGY
  *
  *     0. Common Stuff
- *         a. CUPS array of file descriptor to callback functions
- *            and data + temporary array of removed fd's.
- *         b. cupsdStartSelect() creates the arrays
- *         c. cupsdStopSelect() destroys the arrays and all elements.
- *         d. cupsdAddSelect() adds to the array and allocates a
+ *         a. Table of file descriptor to callback functions and data,
+ *            indexed by the file descriptor number, + temporary list
+ *            of removed fd's.
+ *         b. cupsdAddSelect() grows the table as needed.
+ *         c. cupsdStopSelect() destroys the table and all elements.
+ *         d. cupsdAddSelect() adds to the table and allocates a
  *            new callback element.
- *         e. cupsdRemoveSelect() removes from the active array and
- *            adds to the inactive array.
+ *         e. cupsdRemoveSelect() removes from the table and marks
+ *            the element inactive, adding it to the inactive list.
  *         f. _cupsd_fd_t provides a reference-counted structure for
  *            tracking file descriptors that are monitored.
  *         g. cupsdDoSelect() frees all inactive FDs.
+ *         h. cupsdSetSelectBackend() switches between the backends
+ *            that are available at run-time, as set by the
+ *            SelectBackend directive in cupsd.conf.
  *
  *     1. select() O(n)
  *         a. Input/Output fd_set variables, copied to working
  *            copies and then used with select().
- *         b. Loop through CUPS array, using FD_ISSET and calling
+ *         b. Loop through fd table, using FD_ISSET and calling
  *            the read/write callbacks as needed.
  *         c. cupsdRemoveSelect() clears fd_set bit from main and
  *            working sets.
  *         d. cupsdStopSelect() frees all of the memory used by the
- *            CUPS array and fd_set's.
+ *            fd table and fd_set's.
  *
- *     2. poll() - O(n log n)
- *         a. Regular array of pollfd, sorted the same as the CUPS
- *            array.
+ *     2. poll() - O(n)
+ *         a. Regular array of pollfd, sorted the same as the fd
+ *            table.
  *         b. Loop through pollfd array, call the corresponding
  *            read/write callbacks as needed.
- *         c. cupsdAddSelect() adds first to CUPS array and flags the
+ *         c. cupsdAddSelect() adds first to fd table and flags the
  *            pollfd array as invalid.
  *         d. cupsdDoSelect() rebuilds pollfd array as needed, calls
  *            poll(), then loops through the pollfd array looking up
  *            as needed.
  *         e. cupsdRemoveSelect() flags the pollfd array as invalid.
  *         f. cupsdStopSelect() frees all of the memory used by the
- *            CUPS array and pollfd array.
+ *            fd table and pollfd array.
  *
  *     3. epoll() - O(n)
  *         a. cupsdStartSelect() creates epoll file descriptor using
@@ -105,11 +110,14 @@
  *            (EPOLL_CTL_ADD) or remove (EPOLL_CTL_DEL) a single
  *            event using the level-triggered semantics. The event
  *            user data field is a pointer to the new callback array
- *            element.
+ *            element.  epoll_ctl() is only called to modify
+ *            (EPOLL_CTL_MOD) an event when the read/write interest
+ *            changes.
  *         c. cupsdDoSelect() uses epoll_wait() with the global event
  *            buffer allocated in cupsdStartSelect() and then loops
  *            through the events, using the user data field to find
- *            the callback record.
+ *            the callback record and its inactive flag to skip
+ *            removed records without any lookups.
  *         d. cupsdStopSelect() closes the epoll file descriptor and
  *            frees all of the memory used by the event buffer.
  *
@@ -122,7 +130,8 @@
  *            pointer to the new callback array element.
  *         d. cupsdDoSelect() uses kevent() to poll for events and
  *            loops through the events, using the user data field to
- *            find the callback record.
+ *            find the callback record and its inactive flag to skip
+ *            removed records.
  *         e. cupsdStopSelect() closes the kqueue() file descriptor
  *            and frees all of the memory used by the event buffer.
  *
@@ -181,6 +190,13 @@ typedef struct _cupsd_fd_s
   cupsd_selfunc_t	read_cb,	/* Read callback */
 			write_cb;	/* Write callback */
   void			*data;		/* Data pointer for callbacks */
+#ifdef HAVE_EPOLL
+  unsigned		events;		/* Events registered with epoll */
+#endif /* HAVE_EPOLL */
+#if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
+  int			inactive;	/* Removed while selecting? */
+  struct _cupsd_fd_s	*next;		/* Next inactive record */
+#endif /* HAVE_EPOLL || HAVE_KQUEUE */
 } _cupsd_fd_t;
 
 
@@ -188,9 +204,16 @@ typedef struct _cupsd_fd_s
  * Local globals...
  */
 
-static cups_array_t	*cupsd_fds = NULL;
+static _cupsd_fd_t	**cupsd_fds = NULL;
+					/* File descriptor table */
+static int		cupsd_alloc_fds = 0,
+					/* Allocated table entries */
+			cupsd_num_fds = 0,
+					/* Number of file descriptors */
+			cupsd_max_fd = -1;
+					/* Highest file descriptor */
 #if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
-static cups_array_t	*cupsd_inactive_fds = NULL;
+static _cupsd_fd_t	*cupsd_inactive_fds = NULL;
 static int		cupsd_in_select = 0;
 #endif /* HAVE_EPOLL || HAVE_KQUEUE */
 
@@ -218,8 +241,11 @@ static fd_set		cupsd_global_input,
  * Local functions...
  */
 
-static int		compare_fds(_cupsd_fd_t *a, _cupsd_fd_t *b);
-static _cupsd_fd_t	*find_fd(int fd);
+static int		add_fd(_cupsd_fd_t *fdptr);
+#ifdef HAVE_EPOLL
+static int		start_epoll(void);
+#endif /* HAVE_EPOLL */
+#define			find_fd(f) ((f) < cupsd_alloc_fds ? cupsd_fds[(f)] : NULL)
 #define			release_fd(f) { \
 			  (f)->use --; \
 			  if (!(f)->use) free((f));\
@@ -270,7 +296,7 @@ cupsdAddSelect(int             fd,	/* I - File descriptor */
     fdptr->fd  = fd;
     fdptr->use = 1;
 
-    if (!cupsArrayAdd(cupsd_fds, fdptr))
+    if (!add_fd(fdptr))
     {
       cupsdLogMessage(CUPSD_LOG_EMERG, "Unable to add fd %d to array!", fd);
       free(fdptr);
@@ -343,13 +369,21 @@ cupsdAddSelect(int             fd,	/* I - File descriptor */
 
     event.data.ptr = fdptr;
 
-    if (epoll_ctl(cupsd_epoll_fd, added ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd,
-                  &event))
+    if (!added && event.events == fdptr->events)
+    {
+     /*
+      * Nothing to tell epoll, we are just changing callbacks...
+      */
+    }
+    else if (epoll_ctl(cupsd_epoll_fd, added ? EPOLL_CTL_ADD : EPOLL_CTL_MOD,
+                       fd, &event))
     {
       close(cupsd_epoll_fd);
       cupsd_epoll_fd       = -1;
       cupsd_update_pollfds = 1;
     }
+    else
+      fdptr->events = event.events;
   }
   else
 #  endif /* HAVE_EPOLL */
@@ -425,7 +459,7 @@ cupsdDoSelect(long timeout)		/* I - Timeout in seconds */
   {
     fdptr = (_cupsd_fd_t *)event->udata;
 
-    if (cupsArrayFind(cupsd_inactive_fds, fdptr))
+    if (fdptr->inactive)
       continue;
 
     retain_fd(fdptr);
@@ -434,7 +468,7 @@ cupsdDoSelect(long timeout)		/* I - Timeout in seconds */
       (*(fdptr->read_cb))(fdptr->data);
 
     if (fdptr->use > 1 && fdptr->write_cb && event->filter == EVFILT_WRITE &&
-        !cupsArrayFind(cupsd_inactive_fds, fdptr))
+        !fdptr->inactive)
       (*(fdptr->write_cb))(fdptr->data);
 
     release_fd(fdptr);
@@ -442,7 +476,8 @@ cupsdDoSelect(long timeout)		/* I - Timeout in seconds */
 
 #elif defined(HAVE_POLL)
   struct pollfd		*pfd;		/* Current pollfd structure */
-  int			count;		/* Number of file descriptors */
+  int			i,		/* Looping var */
+			count;		/* Number of file descriptors */
 
 
 #  ifdef HAVE_EPOLL
@@ -450,7 +485,6 @@ cupsdDoSelect(long timeout)		/* I - Timeout in seconds */
 
   if (cupsd_epoll_fd >= 0)
   {
-    int			i;		/* Looping var */
     struct epoll_event	*event;		/* Current event */
 
 
@@ -471,7 +505,7 @@ cupsdDoSelect(long timeout)		/* I - Timeout in seconds */
       {
 	fdptr = (_cupsd_fd_t *)event->data.ptr;
 
-	if (cupsArrayFind(cupsd_inactive_fds, fdptr))
+	if (fdptr->inactive)
 	  continue;
 
 	retain_fd(fdptr);
@@ -481,7 +515,7 @@ cupsdDoSelect(long timeout)		/* I - Timeout in seconds */
 
 	if (fdptr->use > 1 && fdptr->write_cb &&
             (event->events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) &&
-            !cupsArrayFind(cupsd_inactive_fds, fdptr))
+            !fdptr->inactive)
 	  (*(fdptr->write_cb))(fdptr->data);
 
 	release_fd(fdptr);
@@ -492,7 +526,7 @@ cupsdDoSelect(long timeout)		/* I - Timeout in seconds */
   }
 #  endif /* HAVE_EPOLL */
 
-  count = cupsArrayCount(cupsd_fds);
+  count = cupsd_num_fds;
 
   if (cupsd_update_pollfds)
   {
@@ -531,10 +565,11 @@ cupsdDoSelect(long timeout)		/* I - Timeout in seconds */
     * Rebuild the array...
     */
 
-    for (fdptr = (_cupsd_fd_t *)cupsArrayFirst(cupsd_fds), pfd = cupsd_pollfds;
-         fdptr;
-	 fdptr = (_cupsd_fd_t *)cupsArrayNext(cupsd_fds), pfd ++)
+    for (i = 0, pfd = cupsd_pollfds; i <= cupsd_max_fd; i ++)
     {
+      if ((fdptr = cupsd_fds[i]) == NULL)
+        continue;
+
       pfd->fd      = fdptr->fd;
       pfd->events  = 0;
 
@@ -543,6 +578,8 @@ cupsdDoSelect(long timeout)		/* I - Timeout in seconds */
 
       if (fdptr->write_cb)
 	pfd->events |= POLLOUT;
+
+      pfd ++;
     }
   }
 
@@ -580,17 +617,18 @@ cupsdDoSelect(long timeout)		/* I - Timeout in seconds */
 
 #else /* select() */
   struct timeval	stimeout;	/* Timeout for select() */
-  int			maxfd;		/* Maximum file descriptor */
+  int			i,		/* Looping var */
+			maxfd;		/* Maximum file descriptor */
 
 
  /*
   * Figure out the highest file descriptor number...
   */
 
-  if ((fdptr = (_cupsd_fd_t *)cupsArrayLast(cupsd_fds)) == NULL)
+  if (cupsd_max_fd < 0)
     maxfd = 1;
   else
-    maxfd = fdptr->fd + 1;
+    maxfd = cupsd_max_fd + 1;
 
  /*
   * Do the select()...
@@ -617,10 +655,11 @@ cupsdDoSelect(long timeout)		/* I - Timeout in seconds */
     * Do callbacks for each file descriptor...
     */
 
-    for (fdptr = (_cupsd_fd_t *)cupsArrayFirst(cupsd_fds);
-         fdptr;
-	 fdptr = (_cupsd_fd_t *)cupsArrayNext(cupsd_fds))
+    for (i = 0; i < maxfd && i <= cupsd_max_fd; i ++)
     {
+      if ((fdptr = cupsd_fds[i]) == NULL)
+        continue;
+
       retain_fd(fdptr);
 
       if (fdptr->read_cb && FD_ISSET(fdptr->fd, &cupsd_current_input))
@@ -647,11 +686,9 @@ cupsdDoSelect(long timeout)		/* I - Timeout in seconds */
 
   cupsd_in_select = 0;
 
-  for (fdptr = (_cupsd_fd_t *)cupsArrayFirst(cupsd_inactive_fds);
-       fdptr;
-       fdptr = (_cupsd_fd_t *)cupsArrayNext(cupsd_inactive_fds))
+  while ((fdptr = cupsd_inactive_fds) != NULL)
   {
-    cupsArrayRemove(cupsd_inactive_fds, fdptr);
+    cupsd_inactive_fds = fdptr->next;
     release_fd(fdptr);
   }
 #endif /* HAVE_EPOLL || HAVE_KQUEUE */
@@ -713,9 +750,18 @@ cupsdRemoveSelect(int fd)		/* I - File descriptor */
     return;
 
 #ifdef HAVE_EPOLL
-  if (epoll_ctl(cupsd_epoll_fd, EPOLL_CTL_DEL, fd, &event))
+ /*
+  * Remove the file descriptor from epoll, falling back to poll() on errors
+  * other than the file descriptor having been closed already...
+  */
+
+  if (cupsd_epoll_fd < 0 ||
+      (epoll_ctl(cupsd_epoll_fd, EPOLL_CTL_DEL, fd, &event) &&
+       errno != EBADF && errno != ENOENT))
   {
-    close(cupsd_epoll_fd);
+    if (cupsd_epoll_fd >= 0)
+      close(cupsd_epoll_fd);
+
     cupsd_epoll_fd       = -1;
     cupsd_update_pollfds = 1;
   }
@@ -767,15 +813,23 @@ cupsdRemoveSelect(int fd)		/* I - File descriptor */
 #endif /* HAVE_KQUEUE */
 
  /*
-  * Remove the file descriptor from the active array and add to the
-  * inactive array (or release, if we don't need the inactive array...)
+  * Remove the file descriptor from the table and add to the inactive list
+  * (or release, if we don't need the inactive list...)
   */
 
-  cupsArrayRemove(cupsd_fds, fdptr);
+  cupsd_fds[fd] = NULL;
+  cupsd_num_fds --;
+
+  while (cupsd_max_fd >= 0 && !cupsd_fds[cupsd_max_fd])
+    cupsd_max_fd --;
 
 #if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
   if (cupsd_in_select)
-    cupsArrayAdd(cupsd_inactive_fds, fdptr);
+  {
+    fdptr->inactive    = 1;
+    fdptr->next        = cupsd_inactive_fds;
+    cupsd_inactive_fds = fdptr;
+  }
   else
 #endif /* HAVE_EPOLL || HAVE_KQUEUE */
 
@@ -783,6 +837,58 @@ cupsdRemoveSelect(int fd)		/* I - File descriptor */
 }
 
 
+/*
+ * 'cupsdSetSelectBackend()' - Choose the file polling backend.
+ *
+ * Only the backends compiled into cupsd can be chosen.  On Linux this is
+ * "epoll" (the default) or "poll", otherwise it is the single backend
+ * chosen by configure.
+ */
+
+int					/* O - 1 on success, 0 if not supported */
+cupsdSetSelectBackend(
+    const char *backend)		/* I - "auto" or backend name */
+{
+  cupsdLogMessage(CUPSD_LOG_DEBUG, "cupsdSetSelectBackend(backend=\"%s\")", backend);
+
+#ifdef HAVE_EPOLL
+  if (!strcmp(backend, "auto") || !strcmp(backend, "epoll"))
+  {
+    if (cupsd_epoll_fd < 0 && !start_epoll())
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to use epoll, using poll instead: %s", strerror(errno));
+
+    return (1);
+  }
+  else if (!strcmp(backend, "poll"))
+  {
+    if (cupsd_epoll_fd >= 0)
+    {
+      close(cupsd_epoll_fd);
+      cupsd_epoll_fd = -1;
+    }
+
+    cupsd_update_pollfds = 1;
+
+    return (1);
+  }
+
+#elif defined(HAVE_KQUEUE)
+  if (!strcmp(backend, "auto") || !strcmp(backend, "kqueue"))
+    return (1);
+
+#elif defined(HAVE_POLL)
+  if (!strcmp(backend, "auto") || !strcmp(backend, "poll"))
+    return (1);
+
+#else /* select() */
+  if (!strcmp(backend, "auto") || !strcmp(backend, "select"))
+    return (1);
+#endif /* HAVE_EPOLL */
+
+  return (0);
+}
+
+
 /*
  * 'cupsdStartSelect()' - Initialize the file polling engine.
  */
@@ -792,12 +898,6 @@ cupsdStartSelect(void)
 {
   cupsdLogMessage(CUPSD_LOG_DEBUG, "cupsdStartSelect()");
 
-  cupsd_fds = cupsArrayNew((cups_array_func_t)compare_fds, NULL);
-
-#if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
-  cupsd_inactive_fds = cupsArrayNew((cups_array_func_t)compare_fds, NULL);
-#endif /* HAVE_EPOLL || HAVE_KQUEUE */
-
 #ifdef HAVE_EPOLL
   cupsd_epoll_fd       = epoll_create(MaxFDs);
   cupsd_epoll_events   = calloc((size_t)MaxFDs, sizeof(struct epoll_event));
@@ -825,21 +925,23 @@ cupsdStartSelect(void)
 void
 cupsdStopSelect(void)
 {
+  int		i;			/* Looping var */
   _cupsd_fd_t	*fdptr;			/* Current file descriptor */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG, "cupsdStopSelect()");
 
-  for (fdptr = (_cupsd_fd_t *)cupsArrayFirst(cupsd_fds);
-       fdptr;
-       fdptr = (_cupsd_fd_t *)cupsArrayNext(cupsd_fds))
-    free(fdptr);
+  for (i = 0; i <= cupsd_max_fd; i ++)
+    if ((fdptr = cupsd_fds[i]) != NULL)
+      free(fdptr);
 
-  cupsArrayDelete(cupsd_fds);
-  cupsd_fds = NULL;
+  free(cupsd_fds);
+  cupsd_fds       = NULL;
+  cupsd_alloc_fds = 0;
+  cupsd_num_fds   = 0;
+  cupsd_max_fd    = -1;
 
 #if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
-  cupsArrayDelete(cupsd_inactive_fds);
   cupsd_inactive_fds = NULL;
 #endif /* HAVE_EPOLL || HAVE_KQUEUE */
 
@@ -890,34 +992,86 @@ cupsdStopSelect(void)
 
 
 /*
- * 'compare_fds()' - Compare file descriptors.
+ * 'add_fd()' - Add a file descriptor record to the table.
  */
 
-static int				/* O - Result of comparison */
-compare_fds(_cupsd_fd_t *a,		/* I - First file descriptor */
-            _cupsd_fd_t *b)		/* I - Second file descriptor */
+static int				/* O - 1 on success, 0 on error */
+add_fd(_cupsd_fd_t *fdptr)		/* I - File descriptor record */
 {
-  return (a->fd - b->fd);
+  if (fdptr->fd >= cupsd_alloc_fds)
+  {
+   /*
+    * Grow the table to cover the new file descriptor...
+    */
+
+    int		allocfds;		/* New table size */
+    _cupsd_fd_t	**fds;			/* New table */
+
+    if ((allocfds = 2 * cupsd_alloc_fds) <= fdptr->fd)
+      allocfds = fdptr->fd + 64;
+
+    if ((fds = realloc(cupsd_fds, (size_t)allocfds * sizeof(_cupsd_fd_t *))) == NULL)
+      return (0);
+
+    memset(fds + cupsd_alloc_fds, 0, (size_t)(allocfds - cupsd_alloc_fds) * sizeof(_cupsd_fd_t *));
+
+    cupsd_fds       = fds;
+    cupsd_alloc_fds = allocfds;
+  }
+
+  cupsd_fds[fdptr->fd] = fdptr;
+  cupsd_num_fds ++;
+
+  if (fdptr->fd > cupsd_max_fd)
+    cupsd_max_fd = fdptr->fd;
+
+  return (1);
 }
 
 
+#ifdef HAVE_EPOLL
 /*
- * 'find_fd()' - Find an existing file descriptor record.
+ * 'start_epoll()' - Create the epoll file descriptor and add the current
+ *                   file descriptors to it.
  */
 
-static _cupsd_fd_t *			/* O - FD record pointer or NULL */
-find_fd(int fd)				/* I - File descriptor */
+static int				/* O - 1 on success, 0 on error */
+start_epoll(void)
 {
-  _cupsd_fd_t	*fdptr,			/* Matching record (if any) */
-		key;			/* Search key */
+  int			i;		/* Looping var */
+  _cupsd_fd_t		*fdptr;		/* Current file descriptor */
+  struct epoll_event	event;		/* Event data */
+
+
+  if ((cupsd_epoll_fd = epoll_create(MaxFDs)) < 0)
+    return (0);
+
+  for (i = 0; i <= cupsd_max_fd; i ++)
+  {
+    if ((fdptr = cupsd_fds[i]) == NULL)
+      continue;
+
+    event.events   = 0;
+    event.data.ptr = fdptr;
 
+    if (fdptr->read_cb)
+      event.events |= EPOLLIN;
+
+    if (fdptr->write_cb)
+      event.events |= EPOLLOUT;
 
-  cupsArraySave(cupsd_fds);
+    if (epoll_ctl(cupsd_epoll_fd, EPOLL_CTL_ADD, fdptr->fd, &event))
+    {
+      close(cupsd_epoll_fd);
+      cupsd_epoll_fd       = -1;
+      cupsd_update_pollfds = 1;
 
-  key.fd = fd;
-  fdptr  = (_cupsd_fd_t *)cupsArrayFind(cupsd_fds, &key);
+      return (0);
+    }
 
-  cupsArrayRestore(cupsd_fds);
+    fdptr->events = event.events;
+  }
 
-  return (fdptr);
+  return (1);
 }
+#endif /* HAVE_EPOLL */
@@ -63,6 +63,13 @@ cupsdStartServer(void)
 
   cupsdStartListening();
   cupsdStartBrowsing();
+  cupsdStartIPPThreads();
+
+ /*
+  * Start the log writer (as needed)...
+  */
+
+  cupsdStartLogWriter();
 
  /*
   * Create a pipe for CGI processes...
@@ -110,6 +117,7 @@ cupsdStopServer(void)
   * Close all network clients...
   */
 
+  cupsdStopIPPThreads();
   cupsdCloseAllClients();
   cupsdStopListening();
   cupsdStopBrowsing();
@@ -138,9 +146,11 @@ cupsdStopServer(void)
   }
 
  /*
-  * Close all log files...
+  * Stop the log writer and close all log files...
   */
 
+  cupsdStopLogWriter();
+
   if (AccessFile != NULL)
   {
     if (AccessFile != LogStderr)
@@ -55,7 +55,7 @@ cupsdCleanDirty(void)
   {
     cupsd_job_t	*job;			/* Current job */
 
-    cupsdSaveAllJobs();
+    cupsdSaveChangedJobs();
 
     for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
          job;
@@ -15,17 +15,21 @@
 #include <cups/dir.h>
 #include <cups/debug-private.h>
 #include <cups/ppd-private.h>
-#include "mime.h"
+#include <sys/time.h>
+#include "mime-private.h"
 
 
 /*
  * Local functions...
  */
 
+static void	add_files(cups_array_t *files, const char *dirname);
 static void	add_ppd_filter(mime_t *mime, mime_type_t *filtertype,
 		               const char *filter);
 static void	add_ppd_filters(mime_t *mime, ppd_file_t *ppd);
 static void	print_rules(mime_magic_t *rules);
+static int	time_filters(mime_t *mime, const char *dstname);
+static int	time_types(mime_t *mime, const char *dirname);
 static void	type_dir(mime_t *mime, const char *dirname);
 
 
@@ -38,6 +42,8 @@ main(int  argc,				/* I - Number of command-line args */
      char *argv[])			/* I - Command-line arguments */
 {
   int		i;			/* Looping vars */
+  int		status = 0,		/* Exit status */
+		timed = 0;		/* Timed typing of files? */
   const char	*filter_path;		/* Filter path */
   char		super[MIME_MAX_SUPER],	/* Super-type name */
 		type[MIME_MAX_TYPE];	/* Type name */
@@ -61,7 +67,43 @@ main(int  argc,				/* I - Number of command-line args */
   srcinfo.st_size = 0;
 
   for (i = 1; i < argc; i ++)
-    if (!strcmp(argv[i], "-d"))
+    if (!strcmp(argv[i], "-b"))
+    {
+      i ++;
+
+      if (i < argc)
+      {
+	if (!mime)
+	  mime = mimeLoad("../conf", filter_path);
+
+	if (ppd)
+	  add_ppd_filters(mime, ppd);
+
+        if (time_types(mime, argv[i]))
+	  status = 1;
+
+        timed = 1;
+      }
+    }
+    else if (!strcmp(argv[i], "-t"))
+    {
+      i ++;
+
+      if (i < argc)
+      {
+	if (!mime)
+	  mime = mimeLoad("../conf", filter_path);
+
+	if (ppd)
+	  add_ppd_filters(mime, ppd);
+
+        if (time_filters(mime, argv[i]))
+	  status = 1;
+
+        timed = 1;
+      }
+    }
+    else if (!strcmp(argv[i], "-d"))
     {
       i ++;
 
@@ -163,7 +205,7 @@ main(int  argc,				/* I - Number of command-line args */
       add_ppd_filters(mime, ppd);
   }
 
-  if (!src)
+  if (!src && !timed)
   {
     puts("MIME database types:");
     for (src = mimeFirstType(mime); src; src = mimeNextType(mime))
@@ -185,7 +227,40 @@ main(int  argc,				/* I - Number of command-line args */
     type_dir(mime, "../doc");
   }
 
-  return (0);
+  return (status);
+}
+
+
+/*
+ * 'add_files()' - Add the regular files in a directory tree to an array.
+ */
+
+static void
+add_files(cups_array_t *files,		/* I - Array of filenames */
+          const char   *dirname)	/* I - Directory */
+{
+  cups_dir_t	*dir;			/* Directory */
+  cups_dentry_t	*dent;			/* Directory entry */
+  char		filename[1024];		/* Filename */
+
+
+  if ((dir = cupsDirOpen(dirname)) == NULL)
+    return;
+
+  while ((dent = cupsDirRead(dir)) != NULL)
+  {
+    if (dent->filename[0] == '.')
+      continue;
+
+    snprintf(filename, sizeof(filename), "%s/%s", dirname, dent->filename);
+
+    if (S_ISDIR(dent->fileinfo.st_mode))
+      add_files(files, filename);
+    else if (S_ISREG(dent->fileinfo.st_mode))
+      cupsArrayAdd(files, strdup(filename));
+  }
+
+  cupsDirClose(dir);
 }
 
 
@@ -422,6 +497,238 @@ print_rules(mime_magic_t *rules)	/* I - Rules to print */
 }
 
 
+/*
+ * 'time_filters()' - Time finding the filters from every type to a type.
+ *
+ * The filters are found once with an empty cache and then again using the
+ * cached paths, and the results of both are compared.
+ */
+
+static int				/* O - 0 if results match, 1 otherwise */
+time_filters(mime_t     *mime,		/* I - MIME database */
+             const char *dstname)	/* I - Destination super/type */
+{
+  char		super[MIME_MAX_SUPER],	/* Super-type name */
+		type[MIME_MAX_TYPE];	/* Type name */
+  mime_type_t	*src,			/* Source type */
+		*dst;			/* Destination type */
+  int		i,			/* Looping var */
+		pass,			/* Current pass */
+		count,			/* Number of types */
+		cost,			/* Cost of filters */
+		status = 0;		/* Return status */
+  cups_array_t	**results,		/* Filters for each type */
+		*filters;		/* Filters for current type */
+  int		*costs;			/* Cost for each type */
+  mime_filter_t	*f0,			/* Filter from first lookup */
+		*f1;			/* Filter from cached lookup */
+  struct timeval start,			/* Start time */
+		end;			/* End time */
+  double	secs;			/* Elapsed time */
+
+
+  if (sscanf(dstname, "%15[^/]/%255s", super, type) != 2 ||
+      (dst = mimeType(mime, super, type)) == NULL)
+  {
+    printf("%s: Unknown destination type.\n", dstname);
+    return (1);
+  }
+
+  count   = mimeNumTypes(mime);
+  results = calloc((size_t)count, sizeof(cups_array_t *));
+  costs   = calloc((size_t)count, sizeof(int));
+
+  if (!results || !costs)
+  {
+    perror("testmime");
+    free(results);
+    free(costs);
+    return (1);
+  }
+
+  printf("Finding filters from %d types to %s:\n", count, dstname);
+
+ /*
+  * Find the filters with an empty cache...
+  */
+
+  _mimeFlushFilterPaths(mime, NULL);
+
+  gettimeofday(&start, NULL);
+
+  for (src = mimeFirstType(mime), i = 0; src; src = mimeNextType(mime), i ++)
+    results[i] = mimeFilter2(mime, src, 0, dst, costs + i);
+
+  gettimeofday(&end, NULL);
+
+  secs = (end.tv_sec - start.tv_sec) +
+         0.000001 * (end.tv_usec - start.tv_usec);
+
+  printf("    first lookup: %.6f seconds, %.0f lookups/second\n", secs,
+         secs > 0.0 ? count / secs : 0.0);
+
+ /*
+  * Then find them 10 more times using the cached paths...
+  */
+
+  gettimeofday(&start, NULL);
+
+  for (pass = 0; pass < 10; pass ++)
+  {
+    for (src = mimeFirstType(mime), i = 0; src; src = mimeNextType(mime), i ++)
+    {
+      filters = mimeFilter2(mime, src, 0, dst, &cost);
+
+      if (pass == 0)
+      {
+        int same = cost == costs[i] &&
+	           cupsArrayCount(filters) == cupsArrayCount(results[i]);
+					/* Same result? */
+
+        for (f0 = (mime_filter_t *)cupsArrayFirst(results[i]),
+	         f1 = (mime_filter_t *)cupsArrayFirst(filters);
+	     same && f0;
+	     f0 = (mime_filter_t *)cupsArrayNext(results[i]),
+	         f1 = (mime_filter_t *)cupsArrayNext(filters))
+	  same = f0 == f1;
+
+        if (!same)
+	{
+	  printf("    %s/%s: %d filters, cost %d (first lookup) != %d filters, "
+	         "cost %d (cached lookup)\n", src->super, src->type,
+		 cupsArrayCount(results[i]), costs[i], cupsArrayCount(filters),
+		 cost);
+	  status = 1;
+	}
+      }
+
+      cupsArrayDelete(filters);
+    }
+  }
+
+  gettimeofday(&end, NULL);
+
+  secs = (end.tv_sec - start.tv_sec) +
+         0.000001 * (end.tv_usec - start.tv_usec);
+
+  printf("    cached lookup: %.6f seconds, %.0f lookups/second\n", secs,
+         secs > 0.0 ? 10 * count / secs : 0.0);
+
+  if (!status)
+    puts("    Results match.");
+
+  for (i = 0; i < count; i ++)
+    cupsArrayDelete(results[i]);
+
+  free(results);
+  free(costs);
+
+  return (status);
+}
+
+
+/*
+ * 'time_types()' - Time typing the files in a directory tree.
+ *
+ * The files are typed by checking every type and then using the compiled type
+ * rules, and the results of both are compared.
+ */
+
+static int				/* O - 0 if results match, 1 otherwise */
+time_types(mime_t     *mime,		/* I - MIME database */
+           const char *dirname)		/* I - Directory */
+{
+  cups_array_t	*files;			/* Files to type */
+  char		*filename;		/* Current file */
+  int		i,			/* Looping var */
+		pass,			/* Current pass */
+		dispatch,		/* Use compiled type rules? */
+		count,			/* Number of files */
+		status = 0;		/* Return status */
+  mime_type_t	**results[2];		/* Type of each file */
+  struct timeval start,			/* Start time */
+		end;			/* End time */
+  double	secs;			/* Elapsed time */
+  static const char * const modes[2] =	/* Names of modes */
+  {
+    "all types",
+    "compiled rules"
+  };
+
+
+  files = cupsArrayNew((cups_array_func_t)strcmp, NULL);
+  add_files(files, dirname);
+
+  if ((count = cupsArrayCount(files)) == 0)
+  {
+    printf("%s: No files to type.\n", dirname);
+    cupsArrayDelete(files);
+    return (1);
+  }
+
+  results[0] = calloc((size_t)count, sizeof(mime_type_t *));
+  results[1] = calloc((size_t)count, sizeof(mime_type_t *));
+
+  if (!results[0] || !results[1])
+  {
+    perror("testmime");
+    free(results[0]);
+    free(results[1]);
+    cupsArrayDelete(files);
+    return (1);
+  }
+
+  printf("Typing %d files in %s %d times:\n", count, dirname, 10);
+
+  for (dispatch = 0; dispatch < 2; dispatch ++)
+  {
+    _mimeCompileTypes(mime, dispatch);
+
+    gettimeofday(&start, NULL);
+
+    for (pass = 0; pass < 10; pass ++)
+      for (filename = (char *)cupsArrayFirst(files), i = 0;
+           filename;
+	   filename = (char *)cupsArrayNext(files), i ++)
+	results[dispatch][i] = mimeFileType(mime, filename, NULL, NULL);
+
+    gettimeofday(&end, NULL);
+
+    secs = (end.tv_sec - start.tv_sec) +
+           0.000001 * (end.tv_usec - start.tv_usec);
+
+    printf("    %s: %.3f seconds, %.0f files/second\n", modes[dispatch], secs,
+           secs > 0.0 ? 10 * count / secs : 0.0);
+  }
+
+  for (filename = (char *)cupsArrayFirst(files), i = 0;
+       filename;
+       filename = (char *)cupsArrayNext(files), i ++)
+  {
+    if (results[0][i] != results[1][i])
+    {
+      printf("    %s: %s/%s (%s) != %s/%s (%s)\n", filename,
+             results[0][i] ? results[0][i]->super : "none",
+             results[0][i] ? results[0][i]->type : "none", modes[0],
+             results[1][i] ? results[1][i]->super : "none",
+             results[1][i] ? results[1][i]->type : "none", modes[1]);
+      status = 1;
+    }
+
+    free(filename);
+  }
+
+  if (!status)
+    puts("    Results match.");
+
+  free(results[0]);
+  free(results[1]);
+  cupsArrayDelete(files);
+
+  return (status);
+}
+
+
 /*
  * 'type_dir()' - Show the MIME types for a given directory.
  */
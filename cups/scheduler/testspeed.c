@@ -26,7 +26,13 @@
 
 static int	do_test(const char *server, int port,
 		        http_encryption_t encryption, int requests,
-			const char *opstring, int verbose);
+			const char *opstring, const char *printer,
+			int verbose);
+static int	run_clients(const char *command, const char *server, int port,
+		            http_encryption_t encryption, int children,
+			    int requests, const char *opstring,
+			    const char *printer, int verbose,
+			    double *elapsed);
 static void	usage(void) _CUPS_NORETURN;
 
 
@@ -47,13 +53,11 @@ main(int  argc,				/* I - Number of command-line arguments */
   int		requests;		/* Number of requests to send */
   int		children;		/* Number of children to fork */
   int		good_children;		/* Number of children that exited normally */
-  int		pid;			/* Child PID */
-  int		status;			/* Child status */
-  time_t	start,			/* Start time */
-		end;			/* End time */
+  int		scaling;		/* Report scaling from 1 to children? */
   double	elapsed;		/* Elapsed time */
   int		verbose;		/* Verbosity */
   const char	*opstring;		/* Operation name */
+  const char	*printer;		/* Printer name */
 
 
  /*
@@ -62,11 +66,13 @@ main(int  argc,				/* I - Number of command-line arguments */
 
   requests   = 100;
   children   = 5;
+  scaling    = 0;
   server     = (char *)cupsServer();
   port       = ippPort();
   encryption = HTTP_ENCRYPT_IF_REQUESTED;
   verbose    = 0;
   opstring   = NULL;
+  printer    = "test";
 
   for (i = 1; i < argc; i ++)
     if (argv[i][0] == '-')
@@ -86,6 +92,14 @@ main(int  argc,				/* I - Number of command-line arguments */
 	      children = atoi(argv[i]);
 	      break;
 
+	  case 'd' : /* Printer */
+	      i ++;
+	      if (i >= argc)
+		usage();
+
+	      printer = argv[i];
+	      break;
+
           case 'o' : /* Operation */
 	      i ++;
 	      if (i >= argc)
@@ -102,6 +116,10 @@ main(int  argc,				/* I - Number of command-line arguments */
 	      requests = atoi(argv[i]);
 	      break;
 
+	  case 's' : /* Report scaling */
+	      scaling = 1;
+	      break;
+
           case 'v' : /* Verbose logging */
               verbose ++;
 	      break;
@@ -122,92 +140,54 @@ main(int  argc,				/* I - Number of command-line arguments */
       }
     }
 
- /*
-  * Then create child processes to act as clients...
-  */
-
-  if (children > 0)
-  {
-    printf("testspeed: Simulating %d clients with %d requests to %s with "
-           "%sencryption...\n", children, requests, server,
-	   encryption == HTTP_ENCRYPT_IF_REQUESTED ? "no " : "");
-  }
-
-  start = time(NULL);
-
   if (children < 1)
-    return (do_test(server, port, encryption, requests, opstring, verbose));
-  else if (children == 1)
-    good_children = do_test(server, port, encryption, requests, opstring,
-                            verbose) ? 0 : 1;
-  else
-  {
-    char	options[255],		/* Command-line options for child */
-		reqstr[255],		/* Requests string for child */
-		serverstr[255];		/* Server:port string for child */
-
-
-    snprintf(reqstr, sizeof(reqstr), "%d", requests);
-
-    if (port == 631 || server[0] == '/')
-      strlcpy(serverstr, server, sizeof(serverstr));
-    else
-      snprintf(serverstr, sizeof(serverstr), "%s:%d", server, port);
+    return (do_test(server, port, encryption, requests, opstring, printer,
+                    verbose));
 
-    strlcpy(options, "-cr", sizeof(options));
+  if (scaling)
+  {
+   /*
+    * Run with 1, 2, 4, ... clients to show how the request rate scales with
+    * the number of concurrent clients...
+    */
 
-    if (encryption == HTTP_ENCRYPT_REQUIRED)
-      strlcat(options, "E", sizeof(options));
+    int	clients;			/* Number of clients */
+    double base = 0.0;			/* Requests per second for 1 client */
 
-    if (verbose)
-      strlcat(options, "v", sizeof(options));
+    printf("testspeed: Scaling from 1 to %d clients with %d requests each "
+           "to %s...\n", children, requests, server);
 
-    for (i = 0; i < children; i ++)
+    for (clients = 1; clients <= children; clients *= 2)
     {
-      fflush(stdout);
-
-      if ((pid = fork()) == 0)
-      {
-       /*
-	* Child goes here...
-	*/
-
-        if (opstring)
-	  execlp(argv[0], argv[0], options, "0", reqstr, "-o", opstring,
-	         serverstr, (char *)NULL);
-        else
-	  execlp(argv[0], argv[0], options, "0", reqstr, serverstr, (char *)NULL);
+      double	rate;			/* Requests per second */
 
-	exit(errno);
-      }
-      else if (pid < 0)
+      if ((good_children = run_clients(argv[0], server, port, encryption,
+                                       clients, requests, opstring, printer,
+				       verbose, &elapsed)) <= 0 ||
+          elapsed <= 0.0)
       {
-	printf("testspeed: Fork failed: %s\n", strerror(errno));
-	break;
+        printf("testspeed: %3d clients failed\n", clients);
+	return (1);
       }
-      else
-	printf("testspeed: Started child %d...\n", pid);
-    }
 
-   /*
-    * Wait for children to finish...
-    */
+      rate = good_children * requests / elapsed;
 
-    puts("testspeed: Waiting for children to finish...");
+      if (clients == 1)
+        base = rate;
 
-    for (good_children = 0;;)
-    {
-      pid = wait(&status);
+      printf("testspeed: %3d clients %.1fr/s (%.2fx)\n", clients, rate,
+             base > 0.0 ? rate / base : 0.0);
+    }
 
-      if (pid < 0 && errno != EINTR)
-	break;
+    return (0);
+  }
 
-      printf("testspeed: Ended child %d (%d)...\n", pid, status / 256);
+  printf("testspeed: Simulating %d clients with %d requests to %s with "
+         "%sencryption...\n", children, requests, server,
+	 encryption == HTTP_ENCRYPT_IF_REQUESTED ? "no " : "");
 
-      if (!status)
-        good_children ++;
-    }
-  }
+  good_children = run_clients(argv[0], server, port, encryption, children,
+                              requests, opstring, printer, verbose, &elapsed);
 
  /*
   * Compute the total run time...
@@ -215,9 +195,7 @@ main(int  argc,				/* I - Number of command-line arguments */
 
   if (good_children > 0)
   {
-    end     = time(NULL);
-    elapsed = end - start;
-    i       = good_children * requests;
+    i = good_children * requests;
 
     printf("testspeed: %dx%d=%d requests in %.1fs (%.3fs/r, %.1fr/s)\n",
 	   good_children, requests, i, elapsed, elapsed / i, i / elapsed);
@@ -241,6 +219,7 @@ do_test(const char        *server,	/* I - Server to use */
         http_encryption_t encryption,	/* I - Encryption to use */
 	int               requests,	/* I - Number of requests to send */
 	const char        *opstring,	/* I - Operation string */
+	const char        *printer,	/* I - Printer name */
 	int               verbose)	/* I - Verbose output? */
 {
   int		i;			/* Looping var */
@@ -251,6 +230,8 @@ do_test(const char        *server,	/* I - Server to use */
   double	reqtime,		/* Time for this request */
 		elapsed;		/* Elapsed time */
   int		op;			/* Current operation */
+  char		uri[HTTP_MAX_URI],	/* Printer URI */
+		resource[256];		/* Printer resource */
   static ipp_op_t ops[5] =		/* Operations to test... */
 		{
 		  IPP_PRINT_JOB,
@@ -272,6 +253,10 @@ do_test(const char        *server,	/* I - Server to use */
     return (1);
   }
 
+  httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL,
+                   "localhost", 0, "/printers/%s", printer);
+  snprintf(resource, sizeof(resource), "/printers/%s", printer);
+
  /*
   * Do multiple requests...
   */
@@ -284,7 +269,8 @@ do_test(const char        *server,	/* I - Server to use */
     *    attributes-charset
     *    attributes-natural-language
     *
-    * In addition, IPP_GET_JOBS needs a printer-uri attribute.
+    * In addition, IPP_GET_JOBS and IPP_GET_PRINTER_ATTRIBUTES need a
+    * printer-uri attribute.
     */
 
     if (opstring)
@@ -310,10 +296,16 @@ do_test(const char        *server,	/* I - Server to use */
 	  ippDelete(cupsDoRequest(http, request, "/"));
           break;
 
+      case IPP_GET_PRINTER_ATTRIBUTES :
+	  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri",
+                       NULL, uri);
+	  ippDelete(cupsDoRequest(http, request, resource));
+          break;
+
       case IPP_PRINT_JOB :
 	  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri",
-                       NULL, "ipp://localhost/printers/test");
-	  ippDelete(cupsDoFileRequest(http, request, "/printers/test",
+                       NULL, uri);
+	  ippDelete(cupsDoFileRequest(http, request, resource,
 	                              "../data/testprint.ps"));
           break;
     }
@@ -357,6 +349,117 @@ do_test(const char        *server,	/* I - Server to use */
 }
 
 
+/*
+ * 'run_clients()' - Run child processes to act as clients.
+ */
+
+static int				/* O - Number of children that exited normally */
+run_clients(
+    const char        *command,		/* I - Command to run */
+    const char        *server,		/* I - Server to use */
+    int               port,		/* I - Port number to use */
+    http_encryption_t encryption,	/* I - Encryption to use */
+    int               children,		/* I - Number of children */
+    int               requests,		/* I - Number of requests per child */
+    const char        *opstring,	/* I - Operation string */
+    const char        *printer,		/* I - Printer name */
+    int               verbose,		/* I - Verbose output? */
+    double            *elapsed)		/* O - Elapsed time */
+{
+  int		i;			/* Looping var */
+  int		good_children;		/* Number of children that exited normally */
+  int		pid;			/* Child PID */
+  int		status;			/* Child status */
+  struct timeval start,			/* Start time */
+		end;			/* End time */
+
+
+  gettimeofday(&start, NULL);
+
+  if (children == 1)
+    good_children = do_test(server, port, encryption, requests, opstring,
+                            printer, verbose) ? 0 : 1;
+  else
+  {
+    char	options[255],		/* Command-line options for child */
+		reqstr[255],		/* Requests string for child */
+		serverstr[255];		/* Server:port string for child */
+
+
+    snprintf(reqstr, sizeof(reqstr), "%d", requests);
+
+    if (port == 631 || server[0] == '/')
+      strlcpy(serverstr, server, sizeof(serverstr));
+    else
+      snprintf(serverstr, sizeof(serverstr), "%s:%d", server, port);
+
+    strlcpy(options, "-cdr", sizeof(options));
+
+    if (encryption == HTTP_ENCRYPT_REQUIRED)
+      strlcat(options, "E", sizeof(options));
+
+    if (verbose)
+      strlcat(options, "v", sizeof(options));
+
+    for (i = 0; i < children; i ++)
+    {
+      fflush(stdout);
+
+      if ((pid = fork()) == 0)
+      {
+       /*
+	* Child goes here...
+	*/
+
+        if (opstring)
+	  execlp(command, command, options, "0", printer, reqstr, "-o",
+	         opstring, serverstr, (char *)NULL);
+        else
+	  execlp(command, command, options, "0", printer, reqstr, serverstr,
+	         (char *)NULL);
+
+	exit(errno);
+      }
+      else if (pid < 0)
+      {
+	printf("testspeed: Fork failed: %s\n", strerror(errno));
+	break;
+      }
+      else if (verbose)
+	printf("testspeed: Started child %d...\n", pid);
+    }
+
+   /*
+    * Wait for children to finish...
+    */
+
+    if (verbose)
+      puts("testspeed: Waiting for children to finish...");
+
+    for (good_children = 0;;)
+    {
+      pid = wait(&status);
+
+      if (pid < 0 && errno != EINTR)
+	break;
+
+      if (verbose)
+        printf("testspeed: Ended child %d (%d)...\n", pid, status / 256);
+
+      if (!status)
+        good_children ++;
+    }
+  }
+
+  gettimeofday(&end, NULL);
+
+  *elapsed = (end.tv_sec - start.tv_sec) +
+             0.000001 * (end.tv_usec - start.tv_usec);
+
+  return (good_children);
+}
+
+
 /*
  * 'usage()' - Show program usage...
  */
@@ -364,7 +467,7 @@ do_test(const char        *server,	/* I - Server to use */
 static void
 usage(void)
 {
-  puts("Usage: testspeed [-c children] [-h] [-o operation] [-r requests] [-v] "
-       "[-E] hostname[:port]");
+  puts("Usage: testspeed [-c children] [-d printer] [-h] [-o operation] "
+       "[-r requests] [-s] [-v] [-E] hostname[:port]");
   exit(0);
 }
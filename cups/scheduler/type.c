@@ -13,6 +13,7 @@
  */
 
 #include <cups/string-private.h>
+#include <limits.h>
 #include <locale.h>
 #include "mime.h"
 #include "mime-private.h"
@@ -35,17 +36,52 @@ typedef struct _mime_filebuf_s		/**** File buffer for MIME typing ****/
   int		offset,			/* Offset in file */
 		length;			/* Length of buffered data */
   unsigned char	buffer[MIME_MAX_BUFFER];/* Buffered data */
+  int		textoffset,		/* Offset of text copy */
+		textlength;		/* Length of text copy or -1 */
+  char		text[MIME_MAX_BUFFER + 1];
+					/* Nul-terminated copy of buffer */
 } _mime_filebuf_t;
 
+typedef struct _mime_typeext_s		/**** Types for a filename extension ****/
+{
+  char		*ext;			/* Extension (points into rule) */
+  cups_array_t	*types;			/* Types with a "*.ext" match rule */
+} _mime_typeext_t;
+
+typedef struct _mime_trigger_s		/**** Files a rule can match ****/
+{
+  int		any;			/* Can any file match? */
+  unsigned char	bytes[32];		/* Bitmap of possible first bytes */
+  cups_array_t	*exts;			/* Possible filename extensions */
+} _mime_trigger_t;
+
+typedef struct _mime_typeindex_s	/**** Compiled type rules ****/
+{
+  int		dispatch;		/* 1 to use index, 0 to check all types */
+  cups_array_t	*bytes[256],		/* Types by first byte of file */
+		*exts,			/* Types by filename extension */
+		*others;		/* Types to check for every file */
+} _mime_typeindex_t;
+
 
 /*
  * Local functions...
  */
 
+static int	mime_compare_exts(_mime_typeext_t *a, _mime_typeext_t *b);
 static int	mime_compare_types(mime_type_t *t0, mime_type_t *t1);
+static mime_type_t *mime_check_list(cups_array_t *types, const char *filename,
+		                    _mime_filebuf_t *fb, mime_type_t *best);
 static int	mime_check_rules(const char *filename, _mime_filebuf_t *fb,
 		                 mime_magic_t *rules);
+static mime_type_t *mime_check_types(mime_t *mime, const char *filename,
+		                     _mime_filebuf_t *fb);
+static void	mime_merge_trigger(_mime_trigger_t *trigger,
+		                   _mime_trigger_t *rule);
 static int	mime_patmatch(const char *s, const char *pat);
+static int	mime_trigger_cost(_mime_trigger_t *trigger);
+static void	mime_trigger_rules(mime_magic_t *rules, int logic,
+		                   _mime_trigger_t *trigger);
 
 
 /*
@@ -99,6 +135,13 @@ mimeAddType(mime_t     *mime,		/* I - MIME database */
     return (NULL);
   }
 
+ /*
+  * Adding a type or rules for a type invalidates the compiled type rules used
+  * by mimeFileType() - they are recompiled the next time a file is typed...
+  */
+
+  _mimeFreeTypeIndex(mime);
+
  /*
   * See if the type already exists; if so, return the existing type...
   */
@@ -143,6 +186,9 @@ mimeAddType(mime_t     *mime,		/* I - MIME database */
 
 /*
  * 'mimeAddTypeRule()' - Add a detection rule for a file type.
+ *
+ * The type must have been returned by a prior call to mimeAddType(), which
+ * invalidates the database's compiled type rules.
  */
 
 int					/* O - 0 on success, -1 on failure */
@@ -578,6 +624,125 @@ mimeAddTypeRule(mime_type_t *mt,	/* I - Type to add to */
 }
 
 
+/*
+ * '_mimeCompileTypes()' - Compile the type rules in a MIME database.
+ *
+ * Each type is indexed by the first bytes and filename extensions its rules
+ * can match, so that mimeFileType() only needs to check the rules of types
+ * that can possibly match a given file.  Types with rules that can match any
+ * file, for example "printable(0,1024)", are checked for every file.  When
+ * "dispatch" is 0 every type is checked for every file.
+ */
+
+void
+_mimeCompileTypes(mime_t *mime,		/* I - MIME database */
+                  int    dispatch)	/* I - 1 to index types, 0 to check all types */
+{
+  int			i;		/* Looping var */
+  _mime_typeindex_t	*index;		/* Compiled type rules */
+  mime_type_t		*type;		/* Current type */
+  _mime_trigger_t	trigger;	/* Files the type can match */
+  char			*extname;	/* Current extension */
+  _mime_typeext_t	key,		/* Extension search key */
+			*ext;		/* Types for extension */
+
+
+  DEBUG_printf(("_mimeCompileTypes(mime=%p, dispatch=%d)", mime, dispatch));
+
+  if (!mime)
+    return;
+
+  _mimeFreeTypeIndex(mime);
+
+  if ((index = calloc(1, sizeof(_mime_typeindex_t))) == NULL)
+    return;
+
+  mime->typeindex = index;
+
+  if (!dispatch)
+    return;
+
+  index->dispatch = 1;
+  index->exts     = cupsArrayNew((cups_array_func_t)mime_compare_exts, NULL);
+  index->others   = cupsArrayNew(NULL, NULL);
+
+  for (type = (mime_type_t *)cupsArrayFirst(mime->types);
+       type;
+       type = (mime_type_t *)cupsArrayNext(mime->types))
+  {
+   /*
+    * Types without rules never match a file...
+    */
+
+    if (!type->rules)
+      continue;
+
+    memset(&trigger, 0, sizeof(trigger));
+    mime_trigger_rules(type->rules, MIME_MAGIC_OR, &trigger);
+
+    DEBUG_printf(("1_mimeCompileTypes: %s/%s any=%d, cost=%d", type->super,
+                  type->type, trigger.any, mime_trigger_cost(&trigger)));
+
+    if (trigger.any)
+    {
+      if (!cupsArrayAdd(index->others, type))
+        index->dispatch = 0;
+
+      continue;
+    }
+
+    for (i = 0; i < 256; i ++)
+    {
+      if (!(trigger.bytes[i / 8] & (1 << (i & 7))))
+        continue;
+
+      if (!index->bytes[i])
+        index->bytes[i] = cupsArrayNew(NULL, NULL);
+
+      if (!cupsArrayAdd(index->bytes[i], type))
+        index->dispatch = 0;
+    }
+
+    for (extname = (char *)cupsArrayFirst(trigger.exts);
+         extname;
+	 extname = (char *)cupsArrayNext(trigger.exts))
+    {
+      key.ext = extname;
+
+      if ((ext = (_mime_typeext_t *)cupsArrayFind(index->exts, &key)) == NULL)
+      {
+        if ((ext = calloc(1, sizeof(_mime_typeext_t))) == NULL)
+	{
+	  index->dispatch = 0;
+	  break;
+	}
+
+        ext->ext   = extname;
+	ext->types = cupsArrayNew(NULL, NULL);
+
+        if (!cupsArrayAdd(index->exts, ext))
+	{
+	  cupsArrayDelete(ext->types);
+	  free(ext);
+	  index->dispatch = 0;
+	  break;
+	}
+      }
+
+      if (!cupsArrayAdd(ext->types, type))
+        index->dispatch = 0;
+    }
+
+    cupsArrayDelete(trigger.exts);
+  }
+
+  DEBUG_printf(("1_mimeCompileTypes: %d types, %d extensions, %d others, "
+                "dispatch=%d", cupsArrayCount(mime->types),
+		cupsArrayCount(index->exts), cupsArrayCount(index->others),
+		index->dispatch));
+}
+
+
 /*
  * 'mimeFileType()' - Determine the type of a file.
  */
@@ -590,8 +755,7 @@ mimeFileType(mime_t     *mime,		/* I - MIME database */
 {
   _mime_filebuf_t	fb;		/* File buffer */
   const char		*base;		/* Base filename of file */
-  mime_type_t		*type,		/* File type */
-			*best;		/* Best match */
+  mime_type_t		*best;		/* Best match */
 
 
   DEBUG_printf(("mimeFileType(mime=%p, pathname=\"%s\", filename=\"%s\", "
@@ -624,8 +788,9 @@ mimeFileType(mime_t     *mime,		/* I - MIME database */
   * buffer, returning an error if we can't read anything...
   */
 
-  fb.offset = 0;
-  fb.length = (int)cupsFileRead(fb.fp, (char *)fb.buffer, MIME_MAX_BUFFER);
+  fb.offset     = 0;
+  fb.length     = (int)cupsFileRead(fb.fp, (char *)fb.buffer, MIME_MAX_BUFFER);
+  fb.textlength = -1;
 
   if (fb.length <= 0)
   {
@@ -657,14 +822,7 @@ mimeFileType(mime_t     *mime,		/* I - MIME database */
   * Then check it against all known types...
   */
 
-  for (type = (mime_type_t *)cupsArrayFirst(mime->types), best = NULL;
-       type;
-       type = (mime_type_t *)cupsArrayNext(mime->types))
-    if (mime_check_rules(base, &fb, type->rules))
-    {
-      if (!best || type->priority > best->priority)
-        best = type;
-    }
+  best = mime_check_types(mime, base, &fb);
 
  /*
   * Finally, close the file and return a match (if any)...
@@ -691,8 +849,7 @@ mimeFileTypeFD(mime_t   *mime,	/* I - MIME database */
 {
   _mime_filebuf_t	fb;		/* File buffer */
   const char		*base;		/* Base filename of file */
-  mime_type_t		*type,		/* File type */
-			*best;		/* Best match */
+  mime_type_t		*best;		/* Best match */
   int                    fd_new;        /* Dup the input fd to this so we can wrap it in a cupsFile */
   off_t                 save_pos;       /* For restoring our position in the original file... */
 
@@ -743,8 +900,9 @@ mimeFileTypeFD(mime_t   *mime,	/* I - MIME database */
   * buffer, returning an error if we can't read anything...
   */
 
-  fb.offset = 0;
-  fb.length = (int)cupsFileRead(fb.fp, (char *)fb.buffer, MIME_MAX_BUFFER);
+  fb.offset     = 0;
+  fb.length     = (int)cupsFileRead(fb.fp, (char *)fb.buffer, MIME_MAX_BUFFER);
+  fb.textlength = -1;
 
   if (fb.length <= 0)
   {
@@ -770,14 +928,7 @@ mimeFileTypeFD(mime_t   *mime,	/* I - MIME database */
   * Then check it against all known types...
   */
 
-  for (type = (mime_type_t *)cupsArrayFirst(mime->types), best = NULL;
-       type;
-       type = (mime_type_t *)cupsArrayNext(mime->types))
-    if (mime_check_rules(base, &fb, type->rules))
-    {
-      if (!best || type->priority > best->priority)
-        best = type;
-    }
+  best = mime_check_types(mime, base, &fb);
 
  /*
   * Finally, close the file and return a match (if any)...
@@ -792,6 +943,42 @@ mimeFileTypeFD(mime_t   *mime,	/* I - MIME database */
 }
 
 
+/*
+ * '_mimeFreeTypeIndex()' - Free the compiled type rules of a MIME database.
+ */
+
+void
+_mimeFreeTypeIndex(mime_t *mime)	/* I - MIME database */
+{
+  int			i;		/* Looping var */
+  _mime_typeindex_t	*index;		/* Compiled type rules */
+  _mime_typeext_t	*ext;		/* Current extension */
+
+
+  if (!mime || (index = mime->typeindex) == NULL)
+    return;
+
+  DEBUG_printf(("_mimeFreeTypeIndex(mime=%p)", mime));
+
+  for (i = 0; i < 256; i ++)
+    cupsArrayDelete(index->bytes[i]);
+
+  for (ext = (_mime_typeext_t *)cupsArrayFirst(index->exts);
+       ext;
+       ext = (_mime_typeext_t *)cupsArrayNext(index->exts))
+  {
+    cupsArrayDelete(ext->types);
+    free(ext);
+  }
+
+  cupsArrayDelete(index->exts);
+  cupsArrayDelete(index->others);
+  free(index);
+
+  mime->typeindex = NULL;
+}
+
+
 /*
  * 'mimeType()' - Lookup a file type.
  */
@@ -831,6 +1018,18 @@ mimeType(mime_t     *mime,		/* I - MIME database */
 }
 
 
+/*
+ * 'mime_compare_exts()' - Compare two filename extensions.
+ */
+
+static int				/* O - Result of comparison */
+mime_compare_exts(_mime_typeext_t *a,	/* I - First extension */
+                  _mime_typeext_t *b)	/* I - Second extension */
+{
+  return (strcmp(a->ext, b->ext));
+}
+
+
 /*
  * 'mime_compare_types()' - Compare two MIME super/type names.
  */
@@ -849,6 +1048,45 @@ mime_compare_types(mime_type_t *t0,	/* I - First type */
 }
 
 
+/*
+ * 'mime_check_list()' - Check a list of types against a file.
+ *
+ * The best match has the highest priority, with ties going to the type that
+ * sorts first so the result doesn't depend on the order types are checked.
+ */
+
+static mime_type_t *			/* O - Best match */
+mime_check_list(
+    cups_array_t    *types,		/* I - Types to check */
+    const char      *filename,		/* I - Filename */
+    _mime_filebuf_t *fb,		/* I - File to check */
+    mime_type_t     *best)		/* I - Best match so far or @code NULL@ */
+{
+  mime_type_t	*type;			/* Current type */
+
+
+  for (type = (mime_type_t *)cupsArrayFirst(types);
+       type;
+       type = (mime_type_t *)cupsArrayNext(types))
+  {
+   /*
+    * Don't bother with the rules of a type that can't beat the current
+    * match...
+    */
+
+    if (best && (type->priority < best->priority ||
+                 (type->priority == best->priority &&
+		  mime_compare_types(type, best) >= 0)))
+      continue;
+
+    if (mime_check_rules(filename, fb, type->rules))
+      best = type;
+  }
+
+  return (best);
+}
+
+
 /*
  * 'mime_check_rules()' - Check each rule in a list.
  */
@@ -865,7 +1103,8 @@ mime_check_rules(
 		result;			/* Result of test */
   unsigned	intv;			/* Integer value */
   short		shortv;			/* Short value */
-  unsigned char	*bufptr;		/* Pointer into buffer */
+  unsigned char	*bufptr,		/* Pointer into buffer */
+		*next;			/* Next occurrence of character */
 
 
   DEBUG_printf(("4mime_check_rules(filename=\"%s\", fb=%p, rules=%p)", filename,
@@ -1018,12 +1257,20 @@ mime_check_rules(
 
           if (fb->length > 0)
           {
-            char temp[MIME_MAX_BUFFER + 1];
-					/* Temporary buffer */
+           /*
+	    * Make a nul-terminated copy of the buffer, which is shared by all
+	    * of the regex rules until the buffer is reloaded...
+	    */
 
-            memcpy(temp, fb->buffer, (size_t)fb->length);
-            temp[fb->length] = '\0';
-            result = !regexec(&(rules->value.rev), temp, 0, NULL, 0);
+            if (fb->textoffset != fb->offset || fb->textlength != fb->length)
+            {
+              memcpy(fb->text, fb->buffer, (size_t)fb->length);
+              fb->text[fb->length] = '\0';
+              fb->textoffset       = fb->offset;
+              fb->textlength       = fb->length;
+            }
+
+            result = !regexec(&(rules->value.rev), fb->text, 0, NULL, 0);
           }
 
           DEBUG_printf(("5mime_check_rules: result=%d", result));
@@ -1105,7 +1352,8 @@ mime_check_rules(
 	  * Load the buffer if necessary...
 	  */
 
-          if (fb->offset < 0 || rules->offset < fb->offset)
+          if (fb->offset < 0 || rules->offset < fb->offset ||
+	      (rules->offset + 1) > (fb->offset + fb->length))
 	  {
 	   /*
 	    * Reload file buffer...
@@ -1124,7 +1372,7 @@ mime_check_rules(
 	  * can't match...
 	  */
 
-	  if (fb->length < 1)
+	  if ((rules->offset + 1) > (fb->offset + fb->length))
 	    result = 0;
 	  else
 	    result = (fb->buffer[rules->offset - fb->offset] ==
@@ -1243,9 +1491,28 @@ mime_check_rules(
 	    else
 	      region = fb->length - rules->length;
 
+	    bufptr = fb->buffer + rules->offset - fb->offset;
+
 	    for (n = 0; n < region; n ++)
-	      if ((result = (memcmp(fb->buffer + rules->offset - fb->offset + n, rules->value.stringv, (size_t)rules->length) == 0)) != 0)
+	    {
+	     /*
+	      * Skip ahead to the next occurrence of the first character...
+	      */
+
+	      if (rules->length > 0 && bufptr[n] != (unsigned char)rules->value.stringv[0])
+	      {
+	        if ((next = memchr(bufptr + n, rules->value.stringv[0], (size_t)(region - n))) == NULL)
+	        {
+	          result = 0;
+	          break;
+	        }
+
+	        n = (int)(next - bufptr);
+	      }
+
+	      if ((result = (memcmp(bufptr + n, rules->value.stringv, (size_t)rules->length) == 0)) != 0)
 		break;
+	    }
           }
 	  break;
 
@@ -1288,6 +1555,85 @@ mime_check_rules(
 }
 
 
+/*
+ * 'mime_check_types()' - Check the types in a MIME database against a file.
+ */
+
+static mime_type_t *			/* O - Best match or @code NULL@ */
+mime_check_types(
+    mime_t          *mime,		/* I - MIME database */
+    const char      *filename,		/* I - Filename */
+    _mime_filebuf_t *fb)		/* I - File to check */
+{
+  _mime_typeindex_t	*index;		/* Compiled type rules */
+  mime_type_t		*best;		/* Best match */
+  const char		*ptr;		/* Pointer into filename */
+  _mime_typeext_t	key,		/* Extension search key */
+			*ext;		/* Types for extension */
+
+
+  if (!mime->typeindex)
+    _mimeCompileTypes(mime, 1);
+
+  if ((index = mime->typeindex) == NULL || !index->dispatch)
+    return (mime_check_list(mime->types, filename, fb, NULL));
+
+ /*
+  * Check the types that can match the first byte of the file (the buffer
+  * still starts at offset 0), the types that can match one of its
+  * extensions, and the types that can match any file...
+  */
+
+  best = mime_check_list(index->bytes[fb->buffer[0]], filename, fb, NULL);
+
+  for (ptr = strchr(filename, '.'); ptr; ptr = strchr(ptr + 1, '.'))
+  {
+    key.ext = (char *)ptr + 1;
+
+    if ((ext = (_mime_typeext_t *)cupsArrayFind(index->exts, &key)) != NULL)
+      best = mime_check_list(ext->types, filename, fb, best);
+  }
+
+  return (mime_check_list(index->others, filename, fb, best));
+}
+
+
+/*
+ * 'mime_merge_trigger()' - Add the files a rule can match to a trigger.
+ */
+
+static void
+mime_merge_trigger(
+    _mime_trigger_t *trigger,		/* I - Trigger to add to */
+    _mime_trigger_t *rule)		/* I - Trigger for rule (freed) */
+{
+  int	i;				/* Looping var */
+  char	*extname;			/* Current extension */
+
+
+  if (rule->any)
+    trigger->any = 1;
+
+  for (i = 0; i < (int)sizeof(trigger->bytes); i ++)
+    trigger->bytes[i] |= rule->bytes[i];
+
+  for (extname = (char *)cupsArrayFirst(rule->exts);
+       extname;
+       extname = (char *)cupsArrayNext(rule->exts))
+  {
+    if (!trigger->exts)
+      trigger->exts = cupsArrayNew((cups_array_func_t)strcmp, NULL);
+
+    if (!cupsArrayFind(trigger->exts, extname) &&
+        !cupsArrayAdd(trigger->exts, extname))
+      trigger->any = 1;
+  }
+
+  cupsArrayDelete(rule->exts);
+  rule->exts = NULL;
+}
+
+
 /*
  * 'mime_patmatch()' - Pattern matching.
  */
@@ -1390,3 +1736,169 @@ mime_patmatch(const char *s,		/* I - String to match against */
 
   return (*s == *pat);
 }
+
+
+/*
+ * 'mime_trigger_cost()' - Return the number of index entries for a trigger.
+ */
+
+static int				/* O - Number of bytes and extensions */
+mime_trigger_cost(
+    _mime_trigger_t *trigger)		/* I - Trigger */
+{
+  int	i,				/* Looping var */
+	cost;				/* Number of bytes and extensions */
+
+
+  if (trigger->any)
+    return (INT_MAX);
+
+  for (i = 0, cost = cupsArrayCount(trigger->exts); i < 256; i ++)
+    if (trigger->bytes[i / 8] & (1 << (i & 7)))
+      cost ++;
+
+  return (cost);
+}
+
+
+/*
+ * 'mime_trigger_rules()' - Find the files a list of rules can match.
+ *
+ * The result is a superset: a file whose first byte and extensions aren't in
+ * the trigger can't match the rules, so there is no need to check them.  The
+ * trigger for an OR list is the union of the triggers of its rules, while an
+ * AND list can only match files that its most selective rule matches.
+ */
+
+static void
+mime_trigger_rules(
+    mime_magic_t    *rules,		/* I - Rules */
+    int             logic,		/* I - Logic to apply */
+    _mime_trigger_t *trigger)		/* O - Files the rules can match */
+{
+  _mime_trigger_t	rule,		/* Files the current rule can match */
+			best;		/* Most selective rule for AND */
+  int			have_best = 0;	/* Have a most selective rule? */
+  unsigned char		ch;		/* First byte */
+
+
+  if (logic != MIME_MAGIC_AND && logic != MIME_MAGIC_OR)
+  {
+    trigger->any = 1;
+    return;
+  }
+
+  for (; rules; rules = rules->next)
+  {
+    memset(&rule, 0, sizeof(rule));
+
+    if (rules->invert)
+    {
+     /*
+      * Not matching something can match anything...
+      */
+
+      rule.any = 1;
+    }
+    else
+    {
+      switch (rules->op)
+      {
+	case MIME_MAGIC_MATCH :
+	   /*
+	    * Simple "*.ext" patterns only match files with that extension...
+	    */
+
+	    if (!strncmp(rules->value.matchv, "*.", 2) &&
+		rules->value.matchv[2] &&
+		!strpbrk(rules->value.matchv + 2, "*?[\\"))
+	    {
+	      if ((rule.exts = cupsArrayNew((cups_array_func_t)strcmp,
+	                                    NULL)) == NULL ||
+		  !cupsArrayAdd(rule.exts, rules->value.matchv + 2))
+		rule.any = 1;
+	    }
+	    else
+	      rule.any = 1;
+	    break;
+
+	case MIME_MAGIC_STRING :
+	case MIME_MAGIC_ISTRING :
+	    if (rules->offset != 0 || rules->length < 1)
+	    {
+	      rule.any = 1;
+	      break;
+	    }
+
+	    ch = (unsigned char)rules->value.stringv[0];
+	    rule.bytes[ch / 8] |= (unsigned char)(1 << (ch & 7));
+
+	    if (rules->op == MIME_MAGIC_ISTRING)
+	    {
+	      ch = (unsigned char)_cups_tolower(ch);
+	      rule.bytes[ch / 8] |= (unsigned char)(1 << (ch & 7));
+	      ch = (unsigned char)_cups_toupper(ch);
+	      rule.bytes[ch / 8] |= (unsigned char)(1 << (ch & 7));
+	    }
+	    break;
+
+	case MIME_MAGIC_CHAR :
+	case MIME_MAGIC_SHORT :
+	case MIME_MAGIC_INT :
+	    if (rules->offset != 0)
+	    {
+	      rule.any = 1;
+	      break;
+	    }
+
+	    if (rules->op == MIME_MAGIC_CHAR)
+	      ch = rules->value.charv;
+	    else if (rules->op == MIME_MAGIC_SHORT)
+	      ch = (unsigned char)((unsigned short)rules->value.shortv >> 8);
+	    else
+	      ch = (unsigned char)(rules->value.intv >> 24);
+
+	    rule.bytes[ch / 8] |= (unsigned char)(1 << (ch & 7));
+	    break;
+
+	case MIME_MAGIC_NOP :
+	case MIME_MAGIC_AND :
+	case MIME_MAGIC_OR :
+	   /*
+	    * Groups match what their children match; empty groups never
+	    * match...
+	    */
+
+	    if (rules->child)
+	      mime_trigger_rules(rules->child, rules->op, &rule);
+	    break;
+
+	default :
+	   /*
+	    * Other rules look at the whole file or the locale...
+	    */
+
+	    rule.any = 1;
+	    break;
+      }
+    }
+
+    if (logic == MIME_MAGIC_OR)
+    {
+      mime_merge_trigger(trigger, &rule);
+    }
+    else if (!have_best || mime_trigger_cost(&rule) < mime_trigger_cost(&best))
+    {
+      if (have_best)
+        cupsArrayDelete(best.exts);
+
+      best      = rule;
+      have_best = 1;
+    }
+    else
+      cupsArrayDelete(rule.exts);
+  }
+
+  if (have_best)
+    mime_merge_trigger(trigger, &best);
+}
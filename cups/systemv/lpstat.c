@@ -1287,6 +1287,7 @@ show_jobs(const char *dests,		/* I - Destinations */
 	  const char *which)		/* I - Show which jobs? */
 {
   int		i;			/* Looping var */
+  http_t	*http;			/* Connection to server */
   ipp_t		*request,		/* IPP Request */
 		*response;		/* IPP Response */
   ipp_attribute_t *attr,		/* Current attribute */
@@ -1346,10 +1347,17 @@ show_jobs(const char *dests,		/* I - Destinations */
                NULL, which);
 
  /*
-  * Do the request and get back a response...
+  * Do the request and read the jobs as they arrive...
   */
 
-  response = cupsDoRequest(CUPS_HTTP_DEFAULT, request, "/");
+  if ((http = _cupsConnect()) == NULL)
+  {
+    _cupsLangPrintf(stderr, "lpstat: %s", cupsLastErrorString());
+    ippDelete(request);
+    return (1);
+  }
+
+  response = _cupsStreamRequest(http, request, "/", &attr);
 
   if (cupsLastError() == IPP_STATUS_ERROR_BAD_REQUEST ||
       cupsLastError() == IPP_STATUS_ERROR_VERSION_NOT_SUPPORTED)
@@ -1358,12 +1366,14 @@ show_jobs(const char *dests,		/* I - Destinations */
 		    _("%s: Error - add '/version=1.1' to server name."),
 		    "lpstat");
     ippDelete(response);
+    httpFlush(http);
     return (1);
   }
   else if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
   {
     _cupsLangPrintf(stderr, "lpstat: %s", cupsLastErrorString());
     ippDelete(response);
+    httpFlush(http);
     return (1);
   }
 
@@ -1382,14 +1392,14 @@ show_jobs(const char *dests,		/* I - Destinations */
 
     rank = -1;
 
-    for (attr = response->attrs; attr != NULL; attr = attr->next)
+    for (; attr != NULL; attr = _ippReadAttribute(http, response))
     {
      /*
       * Skip leading attributes until we hit a job...
       */
 
       while (attr != NULL && attr->group_tag != IPP_TAG_JOB)
-        attr = attr->next;
+        attr = _ippReadAttribute(http, response);
 
       if (attr == NULL)
         break;
@@ -1432,7 +1442,7 @@ show_jobs(const char *dests,		/* I - Destinations */
 	         attr->value_tag == IPP_TAG_KEYWORD)
 	  reasons = attr;
 
-        attr = attr->next;
+        attr = _ippReadAttribute(http, response);
       }
 
      /*
@@ -1498,7 +1508,16 @@ show_jobs(const char *dests,		/* I - Destinations */
         break;
     }
 
+    if (ippGetState(response) == IPP_STATE_ERROR)
+    {
+      _cupsLangPrintf(stderr, "lpstat: %s", cupsLastErrorString());
+      ippDelete(response);
+      httpFlush(http);
+      return (1);
+    }
+
     ippDelete(response);
+    httpFlush(http);
   }
 
   return (0);
@@ -1516,6 +1535,7 @@ show_printers(const char  *printers,	/* I - Destinations */
               int         long_status)	/* I - Show long status? */
 {
   int		i, j;			/* Looping vars */
+  http_t	*http;			/* Connection to server for printers */
   ipp_t		*request,		/* IPP Request */
 		*response,		/* IPP Response */
 		*jobs;			/* IPP Get Jobs response */
@@ -1583,10 +1603,20 @@ show_printers(const char  *printers,	/* I - Destinations */
                NULL, cupsUser());
 
  /*
-  * Do the request and get back a response...
+  * Do the request and read the printers as they arrive.  This uses its own
+  * connection since the default connection is used to get the current job
+  * of each printer...
   */
 
-  response = cupsDoRequest(CUPS_HTTP_DEFAULT, request, "/");
+  if ((http = httpConnect2(cupsServer(), ippPort(), NULL, AF_UNSPEC,
+                           cupsEncryption(), 1, 30000, NULL)) == NULL)
+  {
+    _cupsLangPrintf(stderr, _("%s: Unable to connect to server."), "lpstat");
+    ippDelete(request);
+    return (1);
+  }
+
+  response = _cupsStreamRequest(http, request, "/", &attr);
 
   if (cupsLastError() == IPP_STATUS_ERROR_BAD_REQUEST ||
       cupsLastError() == IPP_STATUS_ERROR_VERSION_NOT_SUPPORTED)
@@ -1595,12 +1625,14 @@ show_printers(const char  *printers,	/* I - Destinations */
 		    _("%s: Error - add '/version=1.1' to server name."),
 		    "lpstat");
     ippDelete(response);
+    httpClose(http);
     return (1);
   }
   else if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
   {
     _cupsLangPrintf(stderr, "lpstat: %s", cupsLastErrorString());
     ippDelete(response);
+    httpClose(http);
     return (1);
   }
 
@@ -1611,14 +1643,14 @@ show_printers(const char  *printers,	/* I - Destinations */
     * their status...
     */
 
-    for (attr = response->attrs; attr != NULL; attr = attr->next)
+    for (; attr != NULL; attr = _ippReadAttribute(http, response))
     {
      /*
       * Skip leading attributes until we hit a job...
       */
 
       while (attr != NULL && attr->group_tag != IPP_TAG_PRINTER)
-        attr = attr->next;
+        attr = _ippReadAttribute(http, response);
 
       if (attr == NULL)
         break;
@@ -1680,7 +1712,7 @@ show_printers(const char  *printers,	/* I - Destinations */
 	         attr->value_tag == IPP_TAG_NAME)
 	  denied = attr;
 
-        attr = attr->next;
+        attr = _ippReadAttribute(http, response);
       }
 
      /*
@@ -2007,9 +2039,19 @@ show_printers(const char  *printers,	/* I - Destinations */
         break;
     }
 
+    if (ippGetState(response) == IPP_STATE_ERROR)
+    {
+      _cupsLangPrintf(stderr, "lpstat: %s", cupsLastErrorString());
+      ippDelete(response);
+      httpClose(http);
+      return (1);
+    }
+
     ippDelete(response);
   }
 
+  httpClose(http);
+
   return (0);
 }
 
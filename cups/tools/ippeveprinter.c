@@ -1462,7 +1462,10 @@ create_printer(
     "deflate",
     "gzip",
 #endif /* HAVE_LIBZ */
-    "none"
+    "none",
+#if defined(HAVE_LIBZ) && defined(HAVE_ZSTD)
+    "zstd"
+#endif /* HAVE_LIBZ && HAVE_ZSTD */
   };
   static const char * const identify_actions[] =
   {
@@ -23,6 +23,8 @@
 #else
 #  include <signal.h>
 #  include <termios.h>
+#  include <sys/mman.h>
+#  include <sys/wait.h>
 #endif /* _WIN32 */
 #ifndef O_BINARY
 #  define O_BINARY 0
@@ -167,6 +169,7 @@ static int	Cancel = 0;		/* Cancel test? */
 static void	add_stringf(cups_array_t *a, const char *s, ...) _CUPS_FORMAT(2, 3);
 static int      compare_uris(const char *a, const char *b);
 static void	copy_hex_string(char *buffer, unsigned char *data, int datalen, size_t bufsize);
+static int	do_parallel_tests(const char *testfile, cups_array_t *uris, int max_tests, _ipp_vars_t *vars, _cups_testdata_t *data);
 static int	do_test(_ipp_file_t *f, _ipp_vars_t *vars, _cups_testdata_t *data);
 static int	do_tests(const char *testfile, _ipp_vars_t *vars, _cups_testdata_t *data);
 static int	error_cb(_ipp_file_t *f, _cups_testdata_t *data, const char *error);
@@ -214,7 +217,9 @@ main(int  argc,				/* I - Number of command-line args */
   const char		*ext,		/* Extension on filename */
 			*testfile;	/* Test file to use */
   int			interval,	/* Test interval in microseconds */
-			repeat;		/* Repeat count */
+			repeat,		/* Repeat count */
+			parallel;	/* Maximum parallel tests */
+  cups_array_t		*uris;		/* URIs for parallel tests */
   _cups_testdata_t	data;		/* Test data */
   _ipp_vars_t		vars;		/* Variables */
   _cups_globals_t	*cg = _cupsGlobals();
@@ -250,6 +255,8 @@ main(int  argc,				/* I - Number of command-line args */
 
   interval = 0;
   repeat   = 0;
+  parallel = 0;
+  uris     = NULL;
   status   = 0;
   testfile = NULL;
 
@@ -280,6 +287,19 @@ main(int  argc,				/* I - Number of command-line args */
 
       data.output = _CUPS_OUTPUT_IPPSERVER;
     }
+    else if (!strcmp(argv[i], "--parallel"))
+    {
+      i ++;
+
+      if (i >= argc || (parallel = atoi(argv[i])) <= 0)
+      {
+	_cupsLangPuts(stderr, _("ipptool: Missing or bad count for \"--parallel\"."));
+	usage();
+      }
+
+      if (!uris)
+        uris = cupsArrayNew3(NULL, NULL, NULL, 0, (cups_acopy_func_t)strdup, (cups_afree_func_t)free);
+    }
     else if (!strcmp(argv[i], "--stop-after-include-error"))
     {
       data.stop_after_include_error = 1;
@@ -618,11 +638,13 @@ main(int  argc,				/* I - Number of command-line args */
       * Set URI...
       */
 
-      if (vars.uri)
+      if (vars.uri && !uris)
       {
         _cupsLangPuts(stderr, _("ipptool: May only specify a single URI."));
         usage();
       }
+      else if (uris)
+        cupsArrayAdd(uris, argv[i]);
 
 #ifdef HAVE_SSL
       if (!strncmp(argv[i], "ipps://", 7) || !strncmp(argv[i], "https://", 8))
@@ -666,7 +688,18 @@ main(int  argc,				/* I - Number of command-line args */
       else
         testfile = argv[i];
 
-      if (!do_tests(testfile, &vars, &data))
+      if (uris)
+      {
+        if (data.output == _CUPS_OUTPUT_PLIST || data.output == _CUPS_OUTPUT_IPPSERVER || interval || repeat)
+        {
+	  _cupsLangPuts(stderr, _("ipptool: \"--parallel\" is incompatible with \"--ippserver\", \"-P\", \"-X\", \"-i\", and \"-n\"."));
+	  usage();
+        }
+
+        if (!do_parallel_tests(testfile, uris, parallel, &vars, &data))
+          status = 1;
+      }
+      else if (!do_tests(testfile, &vars, &data))
         status = 1;
     }
   }
@@ -881,6 +914,200 @@ copy_hex_string(char          *buffer,	/* I - String buffer */
 }
 
 
+/*
+ * 'do_parallel_tests()' - Run a test file on multiple printers in parallel.
+ *
+ * Each printer is tested by a child process whose output is saved to a
+ * temporary file and then copied to the standard output in the order the
+ * URIs were listed.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+do_parallel_tests(
+    const char       *testfile,		/* I - Test file to use */
+    cups_array_t     *uris,		/* I - Printer URIs */
+    int              max_tests,		/* I - Maximum number of parallel tests */
+    _ipp_vars_t      *vars,		/* I - Variables */
+    _cups_testdata_t *data)		/* I - Test data */
+{
+  int		i,			/* Looping var */
+		num_uris,		/* Number of URIs */
+		num_active = 0,		/* Number of running tests */
+		status;			/* Exit status of child */
+  const char	*uri;			/* Current URI */
+  int		pass = 1;		/* Did all tests pass? */
+#ifdef _WIN32
+ /*
+  * No fork() on Windows, so just run the tests one URI at a time...
+  */
+
+  (void)max_tests;
+  (void)num_active;
+  (void)status;
+
+  for (i = 0, num_uris = cupsArrayCount(uris); i < num_uris; i ++)
+  {
+    uri = (const char *)cupsArrayIndex(uris, i);
+
+    if (data->output == _CUPS_OUTPUT_TEST || data->output == _CUPS_OUTPUT_LIST)
+      cupsFilePrintf(cupsFileStdout(), "%s:\n", uri);
+
+    if (!_ippVarsSet(vars, "uri", uri) || !do_tests(testfile, vars, data))
+      pass = 0;
+  }
+
+#else
+  pid_t		pid;			/* Child process ID */
+  int		*counts;		/* Test counts from each child */
+  char		(*tempfiles)[1024];	/* Output files */
+  int		fd;			/* Output file descriptor */
+  cups_file_t	*tempfile;		/* Output file */
+  char		buffer[8192];		/* Copy buffer */
+  ssize_t	bytes;			/* Bytes read */
+  int		error = 0;		/* Unable to start a test? */
+
+
+  if ((num_uris = cupsArrayCount(uris)) == 0)
+    return (0);
+
+  tempfiles = calloc((size_t)num_uris, sizeof(tempfiles[0]));
+  counts    = mmap(NULL, (size_t)num_uris * 4 * sizeof(int), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
+
+  if (!tempfiles || counts == MAP_FAILED)
+  {
+    print_fatal_error(data, "Unable to start parallel tests: %s", strerror(errno));
+    free(tempfiles);
+    if (counts != MAP_FAILED)
+      munmap(counts, (size_t)num_uris * 4 * sizeof(int));
+    return (0);
+  }
+
+  cupsFileFlush(cupsFileStdout());
+
+  for (i = 0; i < num_uris || num_active > 0;)
+  {
+    if (i < num_uris && num_active < max_tests && !Cancel && !error)
+    {
+     /*
+      * Start the next test...
+      */
+
+      uri = (const char *)cupsArrayIndex(uris, i);
+
+      if ((fd = cupsTempFd(tempfiles[i], sizeof(tempfiles[i]))) < 0)
+      {
+	print_fatal_error(data, "Unable to create temporary file: %s", strerror(errno));
+	tempfiles[i][0] = '\0';
+	error = 1;
+	continue;
+      }
+
+      if ((pid = fork()) == 0)
+      {
+       /*
+        * Child runs the tests with its standard output going to the temporary
+	* file and saves the test counts for the parent...
+	*/
+
+        int	*child_counts = counts + 4 * i;
+					/* Counts for this child */
+
+        dup2(fd, 1);
+	close(fd);
+
+        data->test_count = data->pass_count = data->fail_count = data->skip_count = 0;
+
+        status = _ippVarsSet(vars, "uri", uri) && do_tests(testfile, vars, data);
+
+        cupsFileFlush(cupsFileStdout());
+
+        child_counts[0] = data->test_count;
+        child_counts[1] = data->pass_count;
+        child_counts[2] = data->fail_count;
+        child_counts[3] = data->skip_count;
+
+	_exit(status ? 0 : 1);
+      }
+
+      close(fd);
+
+      if (pid < 0)
+      {
+	print_fatal_error(data, "Unable to start test for \"%s\": %s", uri, strerror(errno));
+	unlink(tempfiles[i]);
+	tempfiles[i][0] = '\0';
+	error = 1;
+	continue;
+      }
+
+      num_active ++;
+      i ++;
+      continue;
+    }
+
+   /*
+    * Wait for a test to finish...
+    */
+
+    if (num_active == 0)
+      break;
+
+    if ((pid = wait(&status)) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      break;
+    }
+
+    if (status)
+      pass = 0;
+
+    num_active --;
+  }
+
+  if (error)
+    pass = 0;
+
+ /*
+  * Copy the output from each test in order...
+  */
+
+  for (i = 0; i < num_uris; i ++)
+  {
+    if (!tempfiles[i][0])
+      continue;
+
+    if (data->output == _CUPS_OUTPUT_TEST || data->output == _CUPS_OUTPUT_LIST)
+      cupsFilePrintf(cupsFileStdout(), "%s:\n", (const char *)cupsArrayIndex(uris, i));
+
+    if ((tempfile = cupsFileOpen(tempfiles[i], "r")) != NULL)
+    {
+      while ((bytes = cupsFileRead(tempfile, buffer, sizeof(buffer))) > 0)
+        cupsFileWrite(cupsFileStdout(), buffer, (size_t)bytes);
+
+      cupsFileClose(tempfile);
+    }
+
+    unlink(tempfiles[i]);
+
+    data->test_count += counts[4 * i + 0];
+    data->pass_count += counts[4 * i + 1];
+    data->fail_count += counts[4 * i + 2];
+    data->skip_count += counts[4 * i + 3];
+  }
+
+  munmap(counts, (size_t)num_uris * 4 * sizeof(int));
+  free(tempfiles);
+#endif /* _WIN32 */
+
+  if (!pass)
+    data->pass = 0;
+
+  return (pass);
+}
+
+
 /*
  * 'do_test()' - Do a single test from the test file.
  */
@@ -4304,8 +4531,10 @@ static void
 usage(void)
 {
   _cupsLangPuts(stderr, _("Usage: ipptool [options] URI filename [ ... filenameN ]"));
+  _cupsLangPuts(stderr, _("       ipptool [options] --parallel count URI [ ... URIN ] filename [ ... filenameN ]"));
   _cupsLangPuts(stderr, _("Options:"));
   _cupsLangPuts(stderr, _("--ippserver filename    Produce ippserver attribute file"));
+  _cupsLangPuts(stderr, _("--parallel count        Run tests on multiple URIs in parallel"));
   _cupsLangPuts(stderr, _("--stop-after-include-error\n"
                           "                        Stop tests after a failed INCLUDE"));
   _cupsLangPuts(stderr, _("--version               Show version"));